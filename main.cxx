@@ -27,19 +27,31 @@
 
 #include <iostream>
 #include <fstream>
+#include <cstdlib> // std::strtod
 #include <cstdint>
 #include <cstring>
 #include <cerrno>
+#include <cstdio>         // std::remove
+#include <csignal>        // std::signal
 #include <string>
+#include <vector>
 #include <chrono>
-#include <unistd.h>       // getopt, usleep
+#include <iterator>       // std::istreambuf_iterator
+#include <iomanip>        // std::setw
+#include <getopt.h>       // getopt_long
 #include <linux/limits.h> // PATH_MAX
 #include <sys/types.h>    // S_ISREG
 #include <sys/stat.h>     // struct stat
-#include "src/pcoder.hxx"
-#include "src/bhcoder.hxx"
-#include "src/ahcoder.hxx"
-#include "src/acoder.hxx"
+#include "src/blocks.hxx"
+#include "src/batch.hxx"
+#include "src/archive.hxx"
+#include "src/models.hxx"
+#include "src/cache.hxx"
+#include "src/server.hxx"
+#include "src/threadpool.hxx"
+#include "src/lzcoder.hxx"
+#include "src/instrument.hxx"
+#include "src/dispatch.hxx"
 
 #define ERROR_CODING_METHOD   ( -1)
 #define ERROR_IFILE_PATH      ( -2)
@@ -49,6 +61,26 @@
 #define ERROR_IS_REGULAR_FILE ( -6)
 #define ERROR_FILE_OPEN       ( -7)
 #define ERROR_FILE_EXIST      ( -8)
+#define ERROR_STATS_FORMAT    ( -9)
+#define ERROR_DECODING        (-10)
+#define ERROR_PREFERENCE      (-11)
+#define ERROR_BATCH_FAILED    (-12)
+#define ERROR_JOBS_NUMBER     (-13)
+#define ERROR_MODEL_FILE      (-14)
+#define ERROR_CACHE_SIZE      (-15)
+#define ERROR_SOCKET          (-16)
+#define ERROR_REQUEST_FAILED  (-17)
+#define ERROR_PIPELINE_DEPTH  (-18)
+#define ERROR_MEMORY_BUDGET   (-19)
+#define ERROR_AGING_PERIOD    (-20)
+#define ERROR_LZ77_SETTINGS   (-21)
+#define ERROR_BWT_BACKEND     (-22)
+#define ERROR_FILTER          (-23)
+#define ERROR_SEARCH          (-24)
+#define ERROR_APPEND          (-25)
+#define ERROR_CPU_LEVEL       (-26)
+#define ERROR_ARCHIVE         (-27)
+#define ERROR_CODING          (-28)
 
 using std::cout;
 using std::endl;
@@ -56,25 +88,121 @@ using std::cerr;
 using std::flush;
 using std::string;
 
-using staticcodes::shennon;
-using staticcodes::fano;
-using staticcodes::huffman;
+using blockcodes::method_t;
+
+enum stats_format_t { STATS_TEXT, STATS_JSON };
+
+static struct option const LONG_OPTIONS[] = {
+	{ "stats",   required_argument, nullptr, 'S' },
+	{ "prefer",  required_argument, nullptr, 'P' },
+	{ "batch",   no_argument,       nullptr, 'B' },
+	{ "list",    required_argument, nullptr, 'L' },
+	{ "jobs",    required_argument, nullptr, 'J' },
+	{ "out-dir", required_argument, nullptr, 'O' },
+	{ "train",   no_argument,       nullptr, 'T' },
+	{ "model",   required_argument, nullptr, 'M' },
+	{ "cache",   required_argument, nullptr, 'C' },
+	{ "serve",   required_argument, nullptr, 'V' },
+	{ "connect", required_argument, nullptr, 'N' },
+	{ "pipeline", optional_argument, nullptr, 'Q' },
+	{ "max-memory", required_argument, nullptr, 'X' },
+	{ "aging",   required_argument, nullptr, 'G' },
+	{ "level",   required_argument, nullptr, 'E' },
+	{ "window",  required_argument, nullptr, 'W' },
+	{ "backend", required_argument, nullptr, 'K' },
+	{ "filter",  required_argument, nullptr, 'F' },
+	{ "stride",  required_argument, nullptr, 'D' },
+	{ "pin",     no_argument,       nullptr, 'A' },
+	{ "bench-scheduler", no_argument, nullptr, 'H' },
+	{ "perf",    no_argument,       nullptr, 'U' },
+	{ "search",  required_argument, nullptr, 'R' },
+	{ "context", required_argument, nullptr, 'Z' },
+	{ "append",  no_argument,       nullptr, 'Y' },
+	{ "from",    required_argument, nullptr, 'I' },
+	{ "cpu",     required_argument, nullptr, 'u' },
+	{ "dedup",   required_argument, nullptr, 'e' },
+	{ "archive", required_argument, nullptr, 'a' },
+	{ nullptr,   0,                 nullptr,  0  }
+};
 
 int    is_regular_file(char const* path);
 int    prepare_input_file(char const* ifilename, std::ifstream& ifile);
 int    prepare_output_file(char const* ofilename, std::ofstream& ofile);
+int    read_path_list(char const* listname, std::vector<string>& paths);
+int    run_batch(batchcodes::options_t const& options, std::vector<string> const& paths, stats_format_t stats_format);
+int    run_archive_list(char const* archivename, stats_format_t stats_format);
+int    run_train(char const* ifilename, char const* ofilename, stats_format_t stats_format);
+int    run_server(char const* socketname, sharedmodels::Model const* model, uint64_t memory_budget, stats_format_t stats_format);
+int    run_bench(size_t jobs, bool pin, stats_format_t stats_format);
+int    run_search(char const* pattern, size_t context, char const* ifilename, sharedmodels::Model const* model,
+                  stats_format_t stats_format);
+int    run_append(char const* ifilename, char const* ofilename, method_t method, double speed_weight,
+                  sharedmodels::Model const* model, uint64_t memory_budget, uint64_t aging_period, stats_format_t stats_format);
+int    run_client(char const* socketname, int inv, method_t method, double speed_weight,
+                  char const* ifilename, char const* ofilename, stats_format_t stats_format);
+void   stop_server(int signum);
+string stats_json(char const* operation, method_t method, char const* ifilename, char const* ofilename,
+                  uint64_t isize, uint64_t osize, uint64_t elapsed_ns, instrumentation::Stats const& stats);
+string hw_json(instrumentation::Stats const& stats, uint64_t text_size);
+string printable(string const& text);
+void   print_hw_stats(instrumentation::Stats const& stats, uint64_t text_size);
 string help();
 
 int main(int argc, char* argv[]) {
 	int opt    =  0;
 	int inv    = -1;
-	int method =  0;
+	method_t method = blockcodes::STORED;
+	double   speed_weight = blockcodes::PREFER_BALANCED;
 	char* ifilename = nullptr;
 	char* ofilename = nullptr;
+	stats_format_t stats_format = STATS_TEXT;
+
+	bool   batch = false;
+	size_t jobs  = 0;
+	bool   pin   = false;
+	bool   bench = false;
+	bool   perf  = false;
+	string out_dir;
+	string dedup_store;
+	string archive;
+	std::vector<string> paths;
+
+	bool  train     = false;
+	char* modelname = nullptr;
+	sharedmodels::Model model;
+
+	char* servename   = nullptr;
+	char* connectname = nullptr;
+
+	size_t pipeline_depth = 0;
+
+	uint64_t memory_budget = 0;
+	bool     cache_given   = false;
+
+	uint64_t aging_period = 0; // 0 keeps the default of the coder
+
+	int    lz_level  = dictcodes::DEFAULT_LEVEL;
+	size_t lz_window = dictcodes::DEFAULT_WINDOW;
+	bool   lz_given  = false;
+
+	method_t bwt_backend   = blockcodes::ARITHMETIC;
+	bool     backend_given = false;
+
+	filtercodes::filter_t filter       = filtercodes::NO_FILTER;
+	size_t                stride       = filtercodes::DEFAULT_STRIDE;
+	bool                  filter_given = false;
+
+	char*  pattern       = nullptr;
+	size_t context       = blockcodes::DEFAULT_SEARCH_CONTEXT;
+	bool   context_given = false;
+
+	bool     append       = false;
+	uint64_t start_offset = 0;
+	bool     start_given  = false;
 
 	// Command line options
-	if (argc == 8 && std::strcmp(argv[1], "-h"))
-		while ((opt = getopt(argc, argv, "cdi:o:m:")) != -1)  {
+	if (argc >= 2 && std::strcmp(argv[1], "-h")) {
+		while ((opt = getopt_long(argc, argv, "cdi:o:m:", LONG_OPTIONS, nullptr)) != -1)  {
 			switch (opt) {
 				case 'c' :
 					inv = 0;
@@ -97,22 +225,384 @@ int main(int argc, char* argv[]) {
 					}
 					break;
 				case 'm' :
-					if      (!std::strcmp(optarg, "shennon"))    method = 1;
-					else if (!std::strcmp(optarg, "fano"))       method = 2;
-					else if (!std::strcmp(optarg, "huffman"))    method = 3;
-					else if (!std::strcmp(optarg, "bhuffman"))   method = 4;
-					else if (!std::strcmp(optarg, "ahuffman"))   method = 5;
-					else if (!std::strcmp(optarg, "arithmetic")) method = 6;
-					else {
+					method = blockcodes::method_from_name(optarg);
+					if (method == blockcodes::STORED) {
 						std::cerr << "main: Invalid coding method, rerun with -h for help" << std::endl;
 						return ERROR_CODING_METHOD;
 					}
 					break;
+				case 'S' :
+					if      (!std::strcmp(optarg, "text")) stats_format = STATS_TEXT;
+					else if (!std::strcmp(optarg, "json")) stats_format = STATS_JSON;
+					else {
+						cerr << "main: Invalid stats format, rerun with -h for help" << endl;
+						return ERROR_STATS_FORMAT;
+					}
+					break;
+				case 'P' : {
+					char* end = nullptr;
+					if      (!std::strcmp(optarg, "ratio"))    speed_weight = blockcodes::PREFER_RATIO;
+					else if (!std::strcmp(optarg, "balanced")) speed_weight = blockcodes::PREFER_BALANCED;
+					else if (!std::strcmp(optarg, "speed"))    speed_weight = blockcodes::PREFER_SPEED;
+					else if ((speed_weight = std::strtod(optarg, &end)) < 0 || speed_weight > 1 || *end) {
+						cerr << "main: Invalid preference, rerun with -h for help" << endl;
+						return ERROR_PREFERENCE;
+					}
+					break;
+				}
+				case 'B' :
+					batch = true;
+					break;
+				case 'L' :
+					batch = true;
+					if (int errcode = read_path_list(optarg, paths))
+						return errcode;
+					break;
+				case 'J' : {
+					char* end = nullptr;
+					long  n   = std::strtol(optarg, &end, 10);
+					if (n <= 0 || *end) {
+						cerr << "main: Invalid number of jobs, rerun with -h for help" << endl;
+						return ERROR_JOBS_NUMBER;
+					}
+					jobs = n;
+					break;
+				}
+				case 'O' :
+					out_dir = optarg;
+					break;
+				case 'e' :
+					dedup_store = optarg;
+					if (dedup_store.empty() || dedup_store.size() > PATH_MAX) {
+						cerr << "main: Invalid chunk store path, rerun with -h for help" << endl;
+						return ERROR_OFILE_PATH;
+					}
+					break;
+				case 'a' :
+					archive = optarg;
+					if (archive.empty() || archive.size() > PATH_MAX) {
+						cerr << "main: Invalid archive path, rerun with -h for help" << endl;
+						return ERROR_OFILE_PATH;
+					}
+					break;
+				case 'A' :
+					pin = true;
+					break;
+				case 'H' :
+					bench = true;
+					break;
+				case 'U' :
+					perf = true;
+					break;
+				case 'T' :
+					train = true;
+					break;
+				case 'M' :
+					modelname = optarg;
+					break;
+				case 'C' : {
+					char* end = nullptr;
+					long  n   = std::strtol(optarg, &end, 10);
+					if (n < 0 || *end) {
+						cerr << "main: Invalid cache size, rerun with -h for help" << endl;
+						return ERROR_CACHE_SIZE;
+					}
+					modelcache::ModelCache::instance().set_capacity(static_cast<size_t>(n) << 20);
+					cache_given = true;
+					break;
+				}
+				case 'X' : {
+					char* end = nullptr;
+					long  n   = std::strtol(optarg, &end, 10);
+					if (n <= 0 || *end) {
+						cerr << "main: Invalid memory budget, rerun with -h for help" << endl;
+						return ERROR_MEMORY_BUDGET;
+					}
+					memory_budget = static_cast<uint64_t>(n) << 20;
+					break;
+				}
+				case 'G' : {
+					char* end = nullptr;
+					long  n   = std::strtol(optarg, &end, 10);
+					if (n <= 0 || *end) {
+						cerr << "main: Invalid aging period, rerun with -h for help" << endl;
+						return ERROR_AGING_PERIOD;
+					}
+					aging_period = n;
+					break;
+				}
+				case 'E' : {
+					char* end = nullptr;
+					long  n   = std::strtol(optarg, &end, 10);
+					if (n < dictcodes::MIN_LEVEL || n > dictcodes::MAX_LEVEL || *end) {
+						cerr << "main: Invalid effort level, rerun with -h for help" << endl;
+						return ERROR_LZ77_SETTINGS;
+					}
+					lz_level = n;
+					lz_given = true;
+					break;
+				}
+				case 'W' : {
+					char* end = nullptr;
+					long  n   = std::strtol(optarg, &end, 10);
+					if (n <= 0 || static_cast<size_t>(n) > (dictcodes::MAX_WINDOW >> 10) || *end) {
+						cerr << "main: Invalid window size, rerun with -h for help" << endl;
+						return ERROR_LZ77_SETTINGS;
+					}
+					lz_window = static_cast<size_t>(n) << 10;
+					lz_given  = true;
+					break;
+				}
+				case 'K' :
+					bwt_backend = blockcodes::method_from_name(optarg);
+					if (bwt_backend != blockcodes::HUFFMAN4 && bwt_backend != blockcodes::ARITHMETIC) {
+						cerr << "main: Invalid bwt back end, rerun with -h for help" << endl;
+						return ERROR_BWT_BACKEND;
+					}
+					backend_given = true;
+					break;
+				case 'F' :
+					filter = filtercodes::filter_from_name(optarg);
+					if (filter == filtercodes::FILTER_NUM) {
+						cerr << "main: Invalid filter, rerun with -h for help" << endl;
+						return ERROR_FILTER;
+					}
+					filter_given = true;
+					break;
+				case 'D' : {
+					char* end = nullptr;
+					long  n   = std::strtol(optarg, &end, 10);
+					if (n <= 0 || static_cast<size_t>(n) > filtercodes::MAX_STRIDE || *end) {
+						cerr << "main: Invalid delta stride, rerun with -h for help" << endl;
+						return ERROR_FILTER;
+					}
+					stride       = n;
+					filter_given = true;
+					break;
+				}
+				case 'R' :
+					pattern = optarg;
+					if (!*pattern) {
+						cerr << "main: Invalid search pattern, rerun with -h for help" << endl;
+						return ERROR_SEARCH;
+					}
+					break;
+				case 'Z' : {
+					char* end = nullptr;
+					long  n   = std::strtol(optarg, &end, 10);
+					if (n < 0 || n > 4096 || *end) {
+						cerr << "main: Invalid search context, rerun with -h for help" << endl;
+						return ERROR_SEARCH;
+					}
+					context       = n;
+					context_given = true;
+					break;
+				}
+				case 'Y' :
+					append = true;
+					break;
+				case 'I' : {
+					char*     end = nullptr;
+					long long n   = std::strtoll(optarg, &end, 10);
+					if (n < 0 || !*optarg || *end) {
+						cerr << "main: Invalid start offset, rerun with -h for help" << endl;
+						return ERROR_APPEND;
+					}
+					start_offset = n;
+					start_given  = true;
+					break;
+				}
+				case 'u' : {
+					cpudispatch::level_t level = cpudispatch::level_from_name(optarg);
+					if (level == cpudispatch::LEVEL_NUM || !cpudispatch::set_level(level)) {
+						cerr << "main: Invalid or unsupported CPU level, rerun with -h for help" << endl;
+						return ERROR_CPU_LEVEL;
+					}
+					break;
+				}
+				case 'V' :
+					servename = optarg;
+					break;
+				case 'N' :
+					connectname = optarg;
+					break;
+				case 'Q' : {
+					pipeline_depth = blockcodes::DEFAULT_PIPELINE_DEPTH;
+					if (!optarg) break;
+
+					char* end = nullptr;
+					long  n   = std::strtol(optarg, &end, 10);
+					if (n <= 0 || *end) {
+						cerr << "main: Invalid pipeline depth, rerun with -h for help" << endl;
+						return ERROR_PIPELINE_DEPTH;
+					}
+					pipeline_depth = n;
+					break;
+				}
 				case '?' :
 					cerr << "main: Invalid option, rerun with -h for help" << endl;
 					return ERROR_OPTION_TYPE;
 			}
 		}
+
+		// The cache counts against the budget, keep it to a small share of it unless told otherwise
+		if (memory_budget && !cache_given)
+			modelcache::ModelCache::instance().set_capacity(memory_budget / 16);
+
+		// Counters are a diagnostic, without them the run goes on with timers only
+		string perf_error;
+		if (perf && !instrumentation::enable_hw_counters(&perf_error))
+			cerr << "main: Hardware counters unavailable (" << perf_error << "), reporting times only" << endl;
+
+		// Batches, servers and pipelines all run on the scheduler, sized before any of them starts it
+		concurrency::configure_scheduler(jobs, pin);
+
+		if (bench) {
+			if (inv != -1 || ifilename || ofilename || method || batch || train || modelname || servename || connectname ||
+			    !archive.empty() || optind != argc) {
+				cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+				return ERROR_OPTION_NUMBER;
+			}
+
+			return run_bench(jobs, pin, stats_format);
+		}
+
+		// Batches, servers and clients code whole files per worker, so only single-file compressing is pipelined
+		if (pipeline_depth && (inv || train || batch || servename || connectname)) {
+			cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+			return ERROR_OPTION_NUMBER;
+		}
+
+		// Coder settings (aging period, lz77 level and window, bwt back end, filter) are recorded in the compressed
+		// blocks, so they are for compressing only; training takes none and servers code requests with the defaults
+		if ((aging_period || lz_given || backend_given || filter_given) && (inv || train || servename || connectname)) {
+			cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+			return ERROR_OPTION_NUMBER;
+		}
+
+		// Chunks are shared by the files of one batch only
+		if (!dedup_store.empty() && !batch) {
+			cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+			return ERROR_OPTION_NUMBER;
+		}
+
+		// Archive entries are plain containers, a chunk store and its recipes cannot be kept inside one
+		if (!archive.empty() && !dedup_store.empty()) {
+			cerr << "main: --dedup and --archive cannot be combined, deduplicate the batch into files or archive it" << endl;
+			return ERROR_OPTION_NUMBER;
+		}
+
+		// Archives are written and extracted by batches and listed on their own
+		if (!archive.empty() && ((!batch && inv != -1) || pipeline_depth || append || start_given ||
+		                         train || servename || connectname || pattern)) {
+			cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+			return ERROR_OPTION_NUMBER;
+		}
+
+		if (context_given && !pattern) {
+			cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+			return ERROR_OPTION_NUMBER;
+		}
+
+		// Appended blocks continue each other, so they are neither pipelined nor filtered
+		if ((append && (inv || pipeline_depth || filter_given || batch || train || servename || connectname || pattern)) ||
+		    (start_given && (inv != 1 || batch || train || servename || connectname || pattern))) {
+			cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+			return ERROR_OPTION_NUMBER;
+		}
+
+		if (train) {
+			if (inv != -1 || !ifilename || !ofilename || method || batch || modelname || servename || connectname || pattern ||
+			    optind != argc) {
+				cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+				return ERROR_OPTION_NUMBER;
+			}
+
+			return run_train(ifilename, ofilename, stats_format);
+		}
+
+		// The server does the coding, so models live there
+		if (connectname) {
+			if (inv == -1 || !ifilename || !ofilename || (!inv && !method) || batch || modelname || servename || memory_budget ||
+			    pattern || optind != argc) {
+				cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+				return ERROR_OPTION_NUMBER;
+			}
+
+			return run_client(connectname, inv, method, speed_weight, ifilename, ofilename, stats_format);
+		}
+
+		if (modelname && !model.load(modelname))
+			return ERROR_MODEL_FILE;
+
+		// Listing reads the central directory only
+		if (!archive.empty() && !batch) {
+			if (ifilename || ofilename || method || modelname || !out_dir.empty() || optind != argc) {
+				cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+				return ERROR_OPTION_NUMBER;
+			}
+
+			return run_archive_list(archive.c_str(), stats_format);
+		}
+
+		// Searching reads the methods from the compressed file like decompressing and prints the matches
+		if (pattern) {
+			if (inv != -1 || !ifilename || ofilename || method || batch || servename || optind != argc) {
+				cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+				return ERROR_OPTION_NUMBER;
+			}
+
+			return run_search(pattern, context, ifilename, modelname ? &model : nullptr, stats_format);
+		}
+
+		if (servename) {
+			if (inv != -1 || ifilename || ofilename || method || batch || optind != argc) {
+				cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+				return ERROR_OPTION_NUMBER;
+			}
+
+			return run_server(servename, modelname ? &model : nullptr, memory_budget, stats_format);
+		}
+
+		if (batch) {
+			paths.insert(paths.end(), argv + optind, argv + argc);
+
+			// Extracting an archive takes the names of the entries, all of them if none are given
+			if (inv == -1 || ifilename || ofilename || (!inv && !method) || (paths.empty() && (archive.empty() || !inv))) {
+				cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+				return ERROR_OPTION_NUMBER;
+			}
+
+			batchcodes::options_t options;
+			options.operation    = inv ? batchcodes::DECOMPRESS : batchcodes::COMPRESS;
+			options.method       = method;
+			options.speed_weight = speed_weight;
+			options.jobs         = jobs;
+			options.out_dir      = out_dir;
+			options.model        = modelname ? &model : nullptr;
+			options.memory_budget = memory_budget;
+			options.aging_period  = aging_period;
+			options.lz_level      = lz_level;
+			options.lz_window     = lz_window;
+			options.bwt_backend   = bwt_backend;
+			options.filter        = filter;
+			options.stride        = stride;
+			options.dedup_store   = dedup_store;
+			options.archive       = archive;
+
+			return run_batch(options, paths, stats_format);
+		}
+
+		// Decoding takes the methods from the container, so -m is required for compressing only
+		if (inv == -1 || !ifilename || !ofilename || (!inv && !method) || optind != argc) {
+			cerr << "main: Invalid number of options, rerun with -h for help" << endl;
+			return ERROR_OPTION_NUMBER;
+		}
+
+		if (append)
+			return run_append(ifilename, ofilename, method, speed_weight, modelname ? &model : nullptr, memory_budget, aging_period,
+			                  stats_format);
+	}
 	else if (argc == 2 && !std::strcmp(argv[1], "-h")) {
 		cout << help();
 		return 0;
@@ -132,27 +622,48 @@ int main(int argc, char* argv[]) {
 		return errcode;
 
 	// Main part
+	instrumentation::Stats stats;
+
 	if (!inv) {
-		cout << "Compressing, please wait... " << flush;
+		if (stats_format == STATS_TEXT)
+			cout << "Compressing, please wait... " << flush;
 
 		auto start = std::chrono::steady_clock::now();
-		if      (method == 1) staticcodes  ::pcoder<shennon> s(ifile, ofile);
-		else if (method == 2) staticcodes  ::pcoder<fano>    f(ifile, ofile);
-		else if (method == 3) staticcodes  ::pcoder<huffman> h(ifile, ofile);
-		else if (method == 4) contextcodes ::bhcoder         bh(ifile, ofile);
-		else if (method == 5) adaptivecodes::ahcoder         ah(ifile, ofile);
-		else if (method == 6) staticcodes  ::acoder          a(ifile, ofile);
+		blockcodes::bcoder coder(method, blockcodes::DEFAULT_BLOCK_SIZE, speed_weight, modelname ? &model : nullptr);
+		if (pipeline_depth)
+			coder.set_pipeline(jobs ? jobs : concurrency::hardware_workers(), pipeline_depth);
+		coder.set_memory_budget(memory_budget);
+		if (aging_period) coder.set_aging(aging_period);
+		coder.set_lz77(lz_level, lz_window);
+		coder.set_bwt_backend(bwt_backend);
+		coder.set_filter(filter, stride);
+		coder(ifile, ofile);
+		stats = coder.stats();
 		auto end  = std::chrono::steady_clock::now();
 		auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
-		cout << "Done" << flush;
-		usleep(250000);
-		cout << endl << endl;
+		if (!coder.good()) {
+			ifile.close();
+			ofile.close();
+			std::remove(ofilename);
+			return coder.error() == blockcodes::BUDGET_ERROR ? ERROR_MEMORY_BUDGET : ERROR_CODING;
+		}
 
 		ifile.clear();
 		ifile.seekg(0, std::ios::end);
 		uint64_t isize = ifile.tellg();
 
+		if (stats_format == STATS_JSON) {
+			uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+			cout << stats_json("compress", method, ifilename, ofilename, isize, ofile.tellp(), elapsed_ns, stats) << endl;
+
+			ifile.close();
+			ofile.close();
+			return 0;
+		}
+
+		cout << "Done" << endl << endl;
+
 		double isize_kb = static_cast<double>(isize) / 1024;
 		double osize_kb = static_cast<double>(ofile.tellp()) / 1024;
 		int    ratio    = (isize_kb - osize_kb) / isize_kb * 100;
@@ -166,28 +677,50 @@ int main(int argc, char* argv[]) {
 		cout << "Compressed file size:   "   << osize_kb  << " Kbyte"        << endl;
 		cout << "Compression ratio:      "   << ratio     << '%'             << endl;
 		cout << "Time taken:             "   << diff      << " milliseconds" << endl;
+		cout << "Peak memory:            "   << instrumentation::peak_rss_bytes() / (1024.0 * 1024) << " Mbyte" << endl;
+		print_hw_stats(stats, isize);
 		cout << std::fixed;
 	}
 	else {
-		cout << "Decompressing, please wait... " << flush;
+		if (stats_format == STATS_TEXT)
+			cout << "Decompressing, please wait... " << flush;
 
 		auto start = std::chrono::steady_clock::now();
-		if      (method == 1) staticcodes  ::pdecoder<shennon> s(ifile, ofile);
-		else if (method == 2) staticcodes  ::pdecoder<fano>    f(ifile, ofile);
-		else if (method == 3) staticcodes  ::pdecoder<huffman> h(ifile, ofile);
-		else if (method == 4) contextcodes ::bhdecoder         bh(ifile, ofile);
-		else if (method == 5) adaptivecodes::ahdecoder         ah(ifile, ofile);
-		else if (method == 6) staticcodes  ::adecoder          a(ifile, ofile);
+		blockcodes::bdecoder decoder(modelname ? &model : nullptr);
+		decoder.set_memory_budget(memory_budget);
+		decoder.set_start(start_offset);
+		decoder.set_legacy_method(method);
+		decoder(ifile, ofile);
+		stats = decoder.stats();
 		auto end  = std::chrono::steady_clock::now();
 		auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
-		cout << "Done" << flush;
-		usleep(250000);
-		cout << endl << endl;
+		if (!decoder.good()) {
+			ifile.close();
+			ofile.close();
+			std::remove(ofilename);
+			return ERROR_DECODING;
+		}
+
+		if (stats_format == STATS_JSON) {
+			ifile.clear();
+			ifile.seekg(0, std::ios::end);
+
+			uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+			cout << stats_json("decompress", decoder.method(), ifilename, ofilename, ifile.tellg(), ofile.tellp(), elapsed_ns, stats) << endl;
+
+			ifile.close();
+			ofile.close();
+			return 0;
+		}
+
+		cout << "Done" << endl << endl;
 
 		cout << "Original file:       " << ifilename << endl;
 		cout << "Decompressed file:   " << ofilename << endl;
 		cout << "Time taken:          " << diff      << " milliseconds" << endl;
+		cout << "Peak memory:         " << instrumentation::peak_rss_bytes() / (1024.0 * 1024) << " Mbyte" << endl;
+		print_hw_stats(stats, ofile.tellp());
 	}
 
 	// Finish
@@ -235,6 +768,680 @@ int prepare_output_file(char const* ofilename, std::ofstream& ofile) {
 	return 0;
 }
 
+int read_path_list(char const* listname, std::vector<string>& paths) {
+	std::ifstream list;
+	std::istream* in = &std::cin;
+
+	if (std::strcmp(listname, "-")) {
+		list.open(listname);
+		if (!list.is_open()) {
+			cerr << "read_path_list: " << std::strerror(errno) << endl;
+			return ERROR_FILE_OPEN;
+		}
+		in = &list;
+	}
+
+	string path;
+	while (std::getline(*in, path))
+		if (!path.empty())
+			paths.push_back(path);
+
+	return 0;
+}
+
+int run_batch(batchcodes::options_t const& options, std::vector<string> const& paths, stats_format_t stats_format) {
+	bool compress = options.operation == batchcodes::COMPRESS;
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<batchcodes::result_t> failures;
+	bool                              archive = !options.archive.empty();
+	std::vector<batchcodes::job_t>    jobs    = archive ? batchcodes::plan_archive(paths, options, failures)
+	                                                    : batchcodes::plan_jobs(paths, options, failures);
+
+	if (stats_format == STATS_TEXT)
+		cout << (compress ? "Compressing " : "Decompressing ") << jobs.size() << " files, please wait... " << flush;
+
+	bool                              dedup = !options.dedup_store.empty();
+	batchcodes::dedup_report_t        report;
+	batchcodes::archive_report_t      archived;
+	std::vector<batchcodes::result_t> results = archive ? batchcodes::run_archive_jobs(jobs, options, archived)
+	                                          : dedup   ? batchcodes::run_dedup_jobs(jobs, options, report)
+	                                                    : batchcodes::run_jobs(jobs, options);
+
+	auto end = std::chrono::steady_clock::now();
+	uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	instrumentation::Stats stats;
+	uint64_t isize = 0;
+	uint64_t osize = 0;
+	size_t   done  = 0;
+
+	for (const auto& result : results) {
+		if (!result.ok) {
+			failures.push_back(result);
+			continue;
+		}
+
+		stats += result.stats;
+		isize += result.isize;
+		osize += result.osize;
+		++done;
+	}
+
+	// The store is the bulk of what deduplicated files take
+	if (dedup && report.ok) {
+		stats += report.stats;
+		if (compress) osize += report.osize;
+		else          isize += report.isize;
+	}
+
+	// The archive adds its header and directory to the entries
+	if (archive && archived.ok && compress)
+		osize = archived.size;
+
+	// Throughput is of the uncompressed text either way, so that both directions compare
+	uint64_t text_size  = compress ? isize : osize;
+	double   seconds    = elapsed_ns / 1e9;
+	double   throughput = seconds > 0 ? text_size / seconds / (1024 * 1024) : 0;
+
+	if (stats_format == STATS_JSON) {
+		using instrumentation::json_string;
+		using std::to_string;
+
+		string json = "{";
+		json += "\"operation\":"       + json_string(compress ? "compress" : "decompress") + ',';
+		if (compress)
+			json += "\"method\":"      + json_string(blockcodes::method_name(options.method)) + ',';
+		json += "\"files\":"           + to_string(done)            + ',';
+		json += "\"failed\":"          + to_string(failures.size()) + ',';
+		json += "\"input_bytes\":"     + to_string(isize)           + ',';
+		json += "\"output_bytes\":"    + to_string(osize)           + ',';
+		json += "\"elapsed_ns\":"      + to_string(elapsed_ns)      + ',';
+		json += "\"throughput_mib_s\":" + to_string(throughput)     + ',';
+		json += "\"peak_rss_bytes\":"  + to_string(instrumentation::peak_rss_bytes()) + ',';
+
+		if (dedup) {
+			json += "\"dedup\":{\"store\":" + json_string(options.dedup_store) + ',';
+			if (compress) {
+				json += "\"chunks\":"             + to_string(report.chunks)             + ',';
+				json += "\"unique_chunks\":"      + to_string(report.unique_chunks)      + ',';
+				json += "\"deduplicated_bytes\":" + to_string(report.deduplicated_bytes) + ',';
+			}
+			json += "\"store_text_bytes\":" + to_string(compress ? report.isize : report.osize) + ',';
+			json += "\"store_bytes\":"      + to_string(compress ? report.osize : report.isize) + "},";
+		}
+
+		if (archive) {
+			json += "\"archive\":{\"path\":" + json_string(options.archive) + ',';
+			json += "\"entries\":"             + to_string(archived.entries) + ',';
+			json += "\"bytes\":"               + to_string(archived.size)    + "},";
+		}
+
+		json += "\"failures\":[";
+		for (size_t i = 0; i < failures.size(); ++i) {
+			if (i) json += ',';
+			json += "{\"path\":" + json_string(failures[i].ipath) + ",\"error\":" + json_string(failures[i].error) + '}';
+		}
+		json += "],";
+		json += hw_json(stats, compress ? isize : osize);
+
+		// Summed per-stage timers and counters of all the files
+		json += stats.to_json().substr(1);
+		cout << json << endl;
+	}
+	else {
+		cout << "Done" << endl << endl;
+
+		for (const auto& failure : failures)
+			cout << "FAILED " << failure.ipath << ": " << failure.error << endl;
+		if (!failures.empty()) cout << endl;
+
+		std::cout.precision(6);
+		cout << "STATS"                    << endl;
+		cout << "Files processed:        " << done                 << endl;
+		cout << "Files failed:           " << failures.size()      << endl;
+		cout << "Total input size:       " << isize / 1024.0       << " Kbyte"        << endl;
+		cout << "Total output size:      " << osize / 1024.0       << " Kbyte"        << endl;
+		if (dedup && compress) {
+			cout << "Chunks:                 " << report.chunks << " (" << report.unique_chunks << " distinct)" << endl;
+			cout << "Deduplicated:           " << report.deduplicated_bytes / 1024.0 << " Kbyte" << endl;
+		}
+		if (dedup) {
+			cout << "Chunk store text:       " << (compress ? report.isize : report.osize) / 1024.0 << " Kbyte" << endl;
+			cout << "Chunk store size:       " << (compress ? report.osize : report.isize) / 1024.0 << " Kbyte" << endl;
+		}
+		if (archive && archived.ok) {
+			cout << "Archive entries:        " << archived.entries << endl;
+			cout << "Archive size:           " << archived.size / 1024.0 << " Kbyte" << endl;
+		}
+		cout << "Time taken:             " << elapsed_ns / 1000000 << " milliseconds" << endl;
+		cout << "Throughput:             " << throughput           << " Mbyte/s"      << endl;
+		cout << "Peak memory:            " << instrumentation::peak_rss_bytes() / (1024.0 * 1024) << " Mbyte" << endl;
+		print_hw_stats(stats, compress ? isize : osize);
+	}
+
+	return failures.empty() ? 0 : ERROR_BATCH_FAILED;
+}
+
+int run_archive_list(char const* archivename, stats_format_t stats_format) {
+	std::ifstream afile;
+	if (int errcode = prepare_input_file(archivename, afile))
+		return errcode;
+
+	std::vector<archivecodes::entry_t> entries;
+	string error;
+
+	if (!archivecodes::read_directory(afile, entries, error)) {
+		cerr << "run_archive_list: " << error << endl;
+		return ERROR_ARCHIVE;
+	}
+
+	afile.clear();
+	afile.seekg(0, std::ios::end);
+	uint64_t asize = afile.tellg();
+
+	uint64_t size   = 0;
+	uint64_t stored = 0;
+	for (const auto& entry : entries) {
+		size   += entry.size;
+		stored += entry.stored_size;
+	}
+
+	auto hex = [](uint64_t digest) {
+		char buf[17];
+		std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(digest));
+		return string(buf);
+	};
+
+	if (stats_format == STATS_JSON) {
+		using instrumentation::json_string;
+		using std::to_string;
+
+		string json = "{";
+		json += "\"operation\":\"list\",";
+		json += "\"archive\":{\"path\":" + json_string(archivename) + ",\"bytes\":" + to_string(asize) + "},";
+		json += "\"input_bytes\":"  + to_string(size)   + ',';
+		json += "\"stored_bytes\":" + to_string(stored) + ',';
+		json += "\"entries\":[";
+		for (size_t i = 0; i < entries.size(); ++i) {
+			archivecodes::entry_t const& entry = entries[i];
+
+			if (i) json += ',';
+			json += "{\"name\":"        + json_string(entry.name) + ',';
+			json += "\"method\":"       + json_string(blockcodes::method_name(entry.method)) + ',';
+			json += "\"bytes\":"        + to_string(entry.size)        + ',';
+			json += "\"stored_bytes\":" + to_string(entry.stored_size) + ',';
+			json += "\"offset\":"       + to_string(entry.offset)      + ',';
+			json += "\"digest\":\""     + hex(entry.digest)            + "\"}";
+		}
+		json += "]}";
+
+		cout << json << endl;
+		return 0;
+	}
+
+	cout << std::left  << std::setw(12) << "Method"
+	     << std::right << std::setw(14) << "Size" << std::setw(14) << "Stored" << "  "
+	     << std::left  << std::setw(18) << "Digest" << "Name" << endl;
+
+	for (const auto& entry : entries)
+		cout << std::left  << std::setw(12) << blockcodes::method_name(entry.method)
+		     << std::right << std::setw(14) << entry.size << std::setw(14) << entry.stored_size << "  "
+		     << std::left  << std::setw(18) << hex(entry.digest) << entry.name << endl;
+
+	cout << std::right << endl;
+	cout << "Entries:                " << entries.size()  << endl;
+	cout << "Total size:             " << size / 1024.0   << " Kbyte" << endl;
+	cout << "Archive size:           " << asize / 1024.0  << " Kbyte" << endl;
+
+	return 0;
+}
+
+int run_train(char const* ifilename, char const* ofilename, stats_format_t stats_format) {
+	std::ifstream ifile;
+	if (int errcode = prepare_input_file(ifilename, ifile))
+		return errcode;
+
+	std::ofstream ofile;
+	if (int errcode = prepare_output_file(ofilename, ofile))
+		return errcode;
+
+	if (stats_format == STATS_TEXT)
+		cout << "Training, please wait... " << flush;
+
+	auto start = std::chrono::steady_clock::now();
+	sharedmodels::Model model;
+	model.train(ifile);
+	bool saved = model.save(ofile);
+	auto end   = std::chrono::steady_clock::now();
+
+	ifile.close();
+	ofile.close();
+
+	if (!saved) return ERROR_FILE_OPEN;
+
+	uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	if (stats_format == STATS_JSON) {
+		using instrumentation::json_string;
+		using std::to_string;
+
+		string json = "{";
+		json += "\"operation\":\"train\",";
+		json += "\"input\":{\"path\":"  + json_string(ifilename) + ",\"bytes\":" + to_string(model.symbols()) + "},";
+		json += "\"output\":{\"path\":" + json_string(ofilename) + ",\"bytes\":" + to_string(model.size())    + "},";
+		json += "\"model_id\":"   + to_string(model.id()) + ',';
+		json += "\"elapsed_ns\":" + to_string(elapsed_ns) + '}';
+
+		cout << json << endl;
+		return 0;
+	}
+
+	cout << "Done" << endl << endl;
+
+	std::cout.precision(6);
+	cout << "Corpus file:   "            << ifilename << endl;
+	cout << "Model file:    "            << ofilename << endl;
+	cout << "--------------------"       << endl;
+	cout << "STATS"                      << endl;
+	cout << "Corpus size:            "   << model.symbols() / 1024.0 << " Kbyte"        << endl;
+	cout << "Model size:             "   << model.size() / 1024.0    << " Kbyte"        << endl;
+	cout << "Model id:               "   << model.id()               << endl;
+	cout << "Time taken:             "   << elapsed_ns / 1000000     << " milliseconds" << endl;
+
+	return 0;
+}
+
+int run_server(char const* socketname, sharedmodels::Model const* model, uint64_t memory_budget, stats_format_t stats_format) {
+	servercodes::Server server(socketname, model, memory_budget);
+
+	if (!server.listen())
+		return ERROR_SOCKET;
+
+	std::signal(SIGINT,  stop_server);
+	std::signal(SIGTERM, stop_server);
+
+	if (stats_format == STATS_TEXT)
+		cout << "Serving on " << socketname << " with " << server.workers() << " workers, interrupt to stop... " << flush;
+
+	auto start = std::chrono::steady_clock::now();
+	server.run();
+	auto end   = std::chrono::steady_clock::now();
+
+	uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	if (stats_format == STATS_JSON) {
+		using instrumentation::json_string;
+		using std::to_string;
+
+		string json = "{";
+		json += "\"operation\":\"serve\",";
+		json += "\"socket\":"     + json_string(socketname)         + ',';
+		json += "\"workers\":"    + to_string(server.workers())     + ',';
+		json += "\"requests\":"   + to_string(server.requests())    + ',';
+		json += "\"failed\":"     + to_string(server.failed())      + ',';
+		json += "\"peak_rss_bytes\":" + to_string(instrumentation::peak_rss_bytes()) + ',';
+		json += "\"elapsed_ns\":" + to_string(elapsed_ns)           + '}';
+
+		cout << json << endl;
+		return 0;
+	}
+
+	cout << "Done" << endl << endl;
+
+	cout << "STATS"                    << endl;
+	cout << "Requests served:        " << server.requests()    << endl;
+	cout << "Requests failed:        " << server.failed()      << endl;
+	cout << "Time taken:             " << elapsed_ns / 1000000 << " milliseconds" << endl;
+	cout << "Peak memory:            " << instrumentation::peak_rss_bytes() / (1024.0 * 1024) << " Mbyte" << endl;
+
+	return 0;
+}
+
+void stop_server(int /* signum */) {
+	servercodes::Server::stop();
+}
+
+int run_bench(size_t jobs, bool pin, stats_format_t stats_format) {
+	if (stats_format == STATS_TEXT)
+		cout << "Benchmarking the scheduler, please wait... " << flush;
+
+	std::vector<concurrency::bench_result_t> results = concurrency::bench_scheduler(jobs ? jobs : concurrency::hardware_workers(), pin);
+
+	if (stats_format == STATS_JSON) {
+		using std::to_string;
+
+		string json = "{\"operation\":\"bench-scheduler\",\"pinned\":";
+		json += pin ? "true" : "false";
+		json += ",\"results\":[";
+		for (size_t i = 0; i < results.size(); ++i) {
+			if (i) json += ',';
+			json += "{\"workers\":"       + to_string(results[i].workers)       + ',';
+			json += "\"empty_task_ns\":"  + to_string(results[i].empty_task_ns) + ',';
+			json += "\"spawn_task_ns\":"  + to_string(results[i].spawn_task_ns) + ',';
+			json += "\"work_ms\":"        + to_string(results[i].work_ms)       + ',';
+			json += "\"speedup\":"        + to_string(results[i].speedup)       + '}';
+		}
+		json += "]}";
+
+		cout << json << endl;
+		return 0;
+	}
+
+	cout << "Done" << endl << endl;
+
+	cout << "STATS" << endl;
+	cout << "Workers   Empty task, ns   Spawned task, ns   Work, ms   Speedup" << endl;
+	cout << std::fixed;
+	for (const auto& result : results) {
+		cout.precision(1);
+		cout << std::setw(7)  << result.workers       << "   "
+		     << std::setw(14) << result.empty_task_ns << "   "
+		     << std::setw(16) << result.spawn_task_ns << "   "
+		     << std::setw(8)  << result.work_ms       << "   ";
+		cout.precision(2);
+		cout << std::setw(7)  << result.speedup       << endl;
+	}
+
+	return 0;
+}
+
+// Neighborhoods of matches are printed on one line each, with bytes that are not printable as dots
+string printable(string const& text) {
+	string line = text;
+	for (auto&& c : line)
+		if (c < 0x20 || c == 0x7F) c = '.';
+
+	return line;
+}
+
+int run_search(char const* pattern, size_t context, char const* ifilename, sharedmodels::Model const* model,
+               stats_format_t stats_format) {
+	std::ifstream ifile;
+	if (int errcode = prepare_input_file(ifilename, ifile))
+		return errcode;
+
+	if (stats_format == STATS_TEXT)
+		cout << "Searching, please wait... " << flush;
+
+	auto start = std::chrono::steady_clock::now();
+	blockcodes::bsearcher searcher(pattern, context, model);
+	searcher(ifile);
+	auto end   = std::chrono::steady_clock::now();
+
+	if (!searcher.good()) {
+		ifile.close();
+		return ERROR_DECODING;
+	}
+
+	ifile.clear();
+	ifile.seekg(0, std::ios::end);
+	uint64_t isize = ifile.tellg();
+	ifile.close();
+
+	instrumentation::Stats const&           stats   = searcher.stats();
+	std::vector<blockcodes::match_t> const& matches = searcher.matches();
+	uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	if (stats_format == STATS_JSON) {
+		using instrumentation::json_string;
+		using std::to_string;
+
+		string json = "{";
+		json += "\"operation\":\"search\",";
+		json += "\"pattern\":"     + json_string(pattern) + ',';
+		json += "\"input\":{\"path\":" + json_string(ifilename) + ",\"bytes\":" + to_string(isize) + "},";
+		json += "\"matches\":[";
+		for (size_t i = 0; i < matches.size(); ++i) {
+			if (i) json += ',';
+			json += "{\"offset\":" + to_string(matches[i].offset) + ',';
+			json += "\"start\":"   + to_string(matches[i].start)  + ',';
+			json += "\"text\":"    + json_string(matches[i].text)  + '}';
+		}
+		json += "],";
+		json += "\"elapsed_ns\":"  + to_string(elapsed_ns) + ',';
+		json += "\"peak_rss_bytes\":" + to_string(instrumentation::peak_rss_bytes()) + ',';
+
+		string coder_json = stats.to_json();
+		json += coder_json.substr(1);
+
+		cout << json << endl;
+		return 0;
+	}
+
+	cout << "Done" << endl << endl;
+
+	for (const auto& match : matches)
+		cout << match.offset << ": " << printable(match.text) << endl;
+
+	if (!matches.empty()) cout << endl;
+
+	cout << "Compressed file:   "        << ifilename << endl;
+	cout << "--------------------"       << endl;
+	cout << "STATS"                      << endl;
+	cout << "Matches:                "   << matches.size() << endl;
+	cout << "Blocks searched coded:  "   << stats.count(instrumentation::CODED_SEARCHES_COUNTER) << " of "
+	                                     << stats.count(instrumentation::BLOCKS_COUNTER) << endl;
+	cout << "Time taken:             "   << elapsed_ns / 1000000 << " milliseconds" << endl;
+	cout << "Peak memory:            "   << instrumentation::peak_rss_bytes() / (1024.0 * 1024) << " Mbyte" << endl;
+
+	return 0;
+}
+
+// A missing or empty output file is compressed into with appendable blocks, so that it can be appended to later
+int run_append(char const* ifilename, char const* ofilename, method_t method, double speed_weight,
+               sharedmodels::Model const* model, uint64_t memory_budget, uint64_t aging_period, stats_format_t stats_format) {
+	std::ifstream ifile;
+	if (int errcode = prepare_input_file(ifilename, ifile))
+		return errcode;
+
+	struct stat s;
+	bool exists = !stat(ofilename, &s) && s.st_size;
+
+	std::fstream ofile(ofilename, exists ? std::ios::in | std::ios::out | std::ios::binary
+	                                     : std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!ofile.is_open()) {
+		cerr << "run_append: " << std::strerror(errno) << endl;
+		return ERROR_FILE_OPEN;
+	}
+
+	if (stats_format == STATS_TEXT)
+		cout << "Appending, please wait... " << flush;
+
+	auto start = std::chrono::steady_clock::now();
+	blockcodes::bcoder coder(method, blockcodes::DEFAULT_BLOCK_SIZE, speed_weight, model);
+	coder.set_memory_budget(memory_budget);
+	if (aging_period) coder.set_aging(aging_period);
+	coder.set_appendable(true);
+
+	if (exists) coder.append(ifile, ofile);
+	else        coder(ifile, ofile);
+	auto end = std::chrono::steady_clock::now();
+
+	if (!coder.good()) {
+		ofile.close();
+		if (!exists) std::remove(ofilename);
+
+		if (coder.error() == blockcodes::BUDGET_ERROR)    return ERROR_MEMORY_BUDGET;
+		if (coder.error() == blockcodes::CONTAINER_ERROR) return ERROR_APPEND;
+		return ERROR_CODING;
+	}
+
+	ifile.clear();
+	ifile.seekg(0, std::ios::end);
+	uint64_t isize = ifile.tellg();
+
+	ofile.seekp(0, std::ios::end);
+	uint64_t osize = ofile.tellp();
+
+	instrumentation::Stats const& stats = coder.stats();
+	uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	if (stats_format == STATS_JSON) {
+		cout << stats_json("append", method, ifilename, ofilename, isize, osize, elapsed_ns, stats) << endl;
+		return 0;
+	}
+
+	cout << "Done" << endl << endl;
+
+	std::cout.precision(6);
+	cout << "Appended file:     "        << ifilename << endl;
+	cout << "Compressed file:   "        << ofilename << endl;
+	cout << "--------------------"       << endl;
+	cout << "STATS"                      << endl;
+	cout << "Appended size:          "   << isize / 1024.0 << " Kbyte" << endl;
+	cout << "Compressed file size:   "   << osize / 1024.0 << " Kbyte" << endl;
+	cout << "Time taken:             "   << elapsed_ns / 1000000 << " milliseconds" << endl;
+	cout << "Peak memory:            "   << instrumentation::peak_rss_bytes() / (1024.0 * 1024) << " Mbyte" << endl;
+	print_hw_stats(stats, isize);
+
+	return 0;
+}
+
+int run_client(char const* socketname, int inv, method_t method, double speed_weight,
+               char const* ifilename, char const* ofilename, stats_format_t stats_format) {
+	std::ifstream ifile;
+	if (int errcode = prepare_input_file(ifilename, ifile))
+		return errcode;
+
+	servercodes::request_t request;
+	request.type         = inv ? servercodes::DECOMPRESS_BUFFER : servercodes::COMPRESS_BUFFER;
+	request.method       = method;
+	request.speed_weight = speed_weight;
+	request.data.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+	ifile.close();
+
+	servercodes::Client client;
+	if (!client.connect(socketname)) {
+		cerr << "run_client: " << std::strerror(errno) << endl;
+		return ERROR_SOCKET;
+	}
+
+	if (stats_format == STATS_TEXT)
+		cout << (inv ? "Decompressing" : "Compressing") << " on the server, please wait... " << flush;
+
+	servercodes::response_t response;
+
+	auto start = std::chrono::steady_clock::now();
+	bool sent  = client.request(request, response);
+	auto end   = std::chrono::steady_clock::now();
+
+	if (!sent) {
+		cerr << "run_client: Connection to the server broke" << endl;
+		return ERROR_SOCKET;
+	}
+
+	if (response.status != servercodes::OK) {
+		cerr << "run_client: " << response.data << endl;
+		return inv ? ERROR_DECODING : ERROR_REQUEST_FAILED;
+	}
+
+	std::ofstream ofile;
+	if (int errcode = prepare_output_file(ofilename, ofile))
+		return errcode;
+
+	ofile.write(response.data.data(), response.data.size());
+	ofile.close();
+
+	uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	if (stats_format == STATS_JSON) {
+		using instrumentation::json_string;
+		using std::to_string;
+
+		string json = "{";
+		json += "\"operation\":"   + json_string(inv ? "decompress" : "compress") + ',';
+		if (!inv)
+			json += "\"method\":"  + json_string(blockcodes::method_name(method)) + ',';
+		json += "\"input\":{\"path\":"  + json_string(ifilename) + ",\"bytes\":" + to_string(response.isize) + "},";
+		json += "\"output\":{\"path\":" + json_string(ofilename) + ",\"bytes\":" + to_string(response.osize) + "},";
+		json += "\"elapsed_ns\":"  + to_string(elapsed_ns) + ',';
+
+		// Round trip above, time in the server queue and per-stage timers and counters of its coder below
+		json += "\"server\":{";
+		json += "\"queue_ns\":"    + to_string(response.queue_ns)   + ',';
+		json += "\"elapsed_ns\":"  + to_string(response.elapsed_ns);
+		json += response.stats.size() > 2 ? ',' + response.stats.substr(1) : string("}");
+		json += '}';
+
+		cout << json << endl;
+		return 0;
+	}
+
+	cout << "Done" << endl << endl;
+
+	std::cout.precision(6);
+	cout << "Original file:       " << ifilename                  << endl;
+	cout << (inv ? "Decompressed file:   " : "Compressed file:     ") << ofilename << endl;
+	cout << "--------------------"  << endl;
+	cout << "STATS"                 << endl;
+	cout << "Input size:          " << response.isize / 1024.0    << " Kbyte"        << endl;
+	cout << "Output size:         " << response.osize / 1024.0    << " Kbyte"        << endl;
+	cout << "Time taken:          " << elapsed_ns / 1000000       << " milliseconds" << endl;
+	cout << "Server coding time:  " << response.elapsed_ns / 1000000 << " milliseconds" << endl;
+	cout << "Server queue time:   " << response.queue_ns / 1000000   << " milliseconds" << endl;
+
+	return 0;
+}
+
+string stats_json(char const* operation, method_t method, char const* ifilename, char const* ofilename,
+                  uint64_t isize, uint64_t osize, uint64_t elapsed_ns, instrumentation::Stats const& stats) {
+	using instrumentation::json_string;
+	using std::to_string;
+
+	string json = "{";
+	json += "\"operation\":"   + json_string(operation)            + ',';
+	json += "\"method\":"      + json_string(blockcodes::method_name(method)) + ',';
+	json += "\"cpu\":"         + json_string(cpudispatch::level_name(cpudispatch::active_level())) + ',';
+	json += "\"input\":{\"path\":"  + json_string(ifilename) + ",\"bytes\":" + to_string(isize) + "},";
+	json += "\"output\":{\"path\":" + json_string(ofilename) + ",\"bytes\":" + to_string(osize) + "},";
+	json += "\"elapsed_ns\":"  + to_string(elapsed_ns) + ',';
+	json += "\"peak_rss_bytes\":" + to_string(instrumentation::peak_rss_bytes()) + ',';
+	json += hw_json(stats, std::strcmp(operation, "compress") ? osize : isize);
+
+	// Merge per-stage timers and counters into the top-level object
+	string coder_json = stats.to_json();
+	json += coder_json.substr(1);
+
+	return json;
+}
+
+// Instructions per cycle and misses per byte of the uncompressed text, "hw":{...}, with a trailing comma;
+// empty if no hardware events were counted
+string hw_json(instrumentation::Stats const& stats, uint64_t text_size) {
+	using namespace instrumentation;
+	using std::to_string;
+
+	uint64_t cycles = stats.hw_total(CYCLES_HW);
+	if (!cycles) return "";
+
+	double bytes = text_size ? text_size : 1;
+
+	string json = "\"hw\":{";
+	json += "\"ipc\":"                    + to_string(static_cast<double>(stats.hw_total(INSTRUCTIONS_HW)) / cycles) + ',';
+	json += "\"cycles_per_byte\":"        + to_string(cycles / bytes)                              + ',';
+	json += "\"branch_misses_per_byte\":" + to_string(stats.hw_total(BRANCH_MISSES_HW) / bytes)    + ',';
+	json += "\"l1d_misses_per_byte\":"    + to_string(stats.hw_total(L1D_MISSES_HW) / bytes)       + ',';
+	json += "\"llc_misses_per_byte\":"    + to_string(stats.hw_total(LLC_MISSES_HW) / bytes)       + "},";
+	return json;
+}
+
+void print_hw_stats(instrumentation::Stats const& stats, uint64_t text_size) {
+	using namespace instrumentation;
+
+	uint64_t cycles = stats.hw_total(CYCLES_HW);
+	if (!cycles) return;
+
+	double bytes = text_size ? text_size : 1;
+
+	cout << "Instructions per cycle: " << static_cast<double>(stats.hw_total(INSTRUCTIONS_HW)) / cycles << endl;
+	cout << "Cycles per byte:        " << cycles / bytes                                            << endl;
+	cout << "Branch misses per byte: " << stats.hw_total(BRANCH_MISSES_HW) / bytes                  << endl;
+	cout << "L1d misses per byte:    " << stats.hw_total(L1D_MISSES_HW) / bytes                     << endl;
+	cout << "LLC misses per byte:    " << stats.hw_total(LLC_MISSES_HW) / bytes                     << endl;
+}
+
 string help() {
 	return
 		"REQUIRED OPTIONS\n"
@@ -253,6 +1460,165 @@ string help() {
 		"\n"
 		"	-m method\n"
 		"	    Coding method, m can be \"shennon\", \"fano\", \"huffman\",\n"
-		"	    \"bhuffman\", \"ahuffman\" or \"arithmetic\"\n"
+		"	    \"bhuffman\", \"ahuffman\", \"arithmetic\", \"huffman4\" (canonical Huffman\n"
+		"	    code split into four interleaved streams, fast to decode), \"wahuffman\"\n"
+		"	    (ahuffman with weight aging, for streams whose statistics drift), \"lz77\"\n"
+		"	    (repeated strings replaced with matches, then canonical Huffman coded),\n"
+		"	    \"bwt\" (Burrows-Wheeler block sorting, best on large texts), \"dhuffman\"\n"
+		"	    (canonical Huffman codes rebuilt from running counts every few thousand\n"
+		"	    symbols, single pass like ahuffman but much faster), \"huffman16\"\n"
+		"	    (canonical Huffman codes of little-endian 16-bit symbols such as token\n"
+		"	    ids, rare symbols escaped), \"whuffman\" (canonical Huffman codes of\n"
+		"	    whole words and separators, for text and logs, decodes a word per\n"
+		"	    lookup) or \"auto\" (picks a method for every block by trial coding\n"
+		"	    samples of it); required\n"
+		"	    for compressing only, decompressing reads the methods from the compressed file;\n"
+		"	    files written by older versions, with no container header, are decompressed\n"
+		"	    with the method given (one of the first six)\n"
+		"\n"
+		"OPTIONAL OPTIONS\n"
+		"	--prefer=preference\n"
+		"	    Speed/ratio trade-off for -m auto, preference can be \"ratio\",\n"
+		"	    \"balanced\" (default), \"speed\" or a weight of speed from 0 to 1\n"
+		"\n"
+		"	--aging=symbols\n"
+		"	    Halve the weights of the wahuffman tree every so many symbols (4096 by\n"
+		"	    default); shorter periods follow faster drifting statistics\n"
+		"\n"
+		"	--level=level\n"
+		"	    Effort of lz77 match finding from 1 (fastest) to 9 (smallest output), 6\n"
+		"	    by default; decompressing speed does not depend on it\n"
+		"\n"
+		"	--window=size\n"
+		"	    How far back lz77 matches reach in KiB, rounded down to a power of two\n"
+		"	    from 1 to 16384, 1024 by default (blocks are 4 MiB)\n"
+		"\n"
+		"	--backend=method\n"
+		"	    Coder of bwt blocks after the transform, \"arithmetic\" (default, smaller)\n"
+		"	    or \"huffman4\" (faster to decode)\n"
+		"\n"
+		"	--filter=filter\n"
+		"	    Reversible filter applied to every block before coding, filter can be\n"
+		"	    \"none\" (default), \"rle\" (long runs of a byte), \"delta\" (slowly\n"
+		"	    varying integers), \"mtf\" (move-to-front) or \"auto\" (picks one per\n"
+		"	    block by the entropy of its output); recorded in the compressed file\n"
+		"\n"
+		"	--stride=bytes\n"
+		"	    Distance of the byte delta subtracts from 1 to 255, 1 by default (2 or 4\n"
+		"	    for 16-bit or 32-bit integers, the record width for columns)\n"
+		"\n"
+		"	--max-memory=size\n"
+		"	    Memory budget in MiB: compressing picks blocks small enough to stay within\n"
+		"	    it (failing if even 64 KiB blocks do not fit), decompressing refuses blocks\n"
+		"	    that do not fit; also bounds batches and servers, and makes the --cache\n"
+		"	    default 1/16 of the budget; peak memory of the run is reported in stats\n"
+		"\n"
+		"	--pipeline[=depth]\n"
+		"	    Compress with a reader thread, up to --jobs blocks coded at once on the\n"
+		"	    scheduler and a writer thread, connected by queues of depth blocks\n"
+		"	    (4 by default); overlaps disk I/O with coding, the output is unchanged\n"
+		"\n"
+		"	--append\n"
+		"	    Compress the input onto the end of the output file instead of replacing\n"
+		"	    it (creating it if it is missing); ahuffman and wahuffman blocks continue\n"
+		"	    the adaptive tree from the checkpoint that ends the file, so only the new\n"
+		"	    text is coded; not combined with --pipeline or --filter\n"
+		"\n"
+		"	--from=offset\n"
+		"	    Decompress the text from offset on; blocks that end before it are skipped\n"
+		"	    without decoding, ahuffman and wahuffman ones restart from checkpoints\n"
+		"\n"
+		"SERVER MODE\n"
+		"	--serve=socket\n"
+		"	    Run as a long-lived server accepting compress/decompress requests (memory\n"
+		"	    buffers or file paths) on the Unix domain socket until interrupted; requests\n"
+		"	    are coded by a pool of --jobs workers, with the --model kept loaded\n"
+		"\n"
+		"	--connect=socket -c | -d -i input -o output\n"
+		"	    Send the input file to a server as a buffer and write the result to output;\n"
+		"	    prints the round trip, queue and coding times of the request\n"
+		"\n"
+		"SHARED MODELS\n"
+		"	--train -i corpus -o model\n"
+		"	    Build a model (byte and bigram frequencies, adapted FGK tree) from a sample\n"
+		"	    corpus of typical inputs\n"
+		"\n"
+		"	--model=model\n"
+		"	    Compress or decompress with the statistics of a trained model instead of\n"
+		"	    storing them in every file (pays off for small inputs); the compressed file\n"
+		"	    records the model id, decompressing needs the same model\n"
+		"\n"
+		"	--cache=size\n"
+		"	    Memory bound of the in-process cache of built code trees in MiB, 64 by\n"
+		"	    default, 0 disables it; code trees are reused between blocks and files\n"
+		"	    with equal frequencies or the same shared model\n"
+		"\n"
+		"SEARCH MODE\n"
+		"	--search=pattern -i input\n"
+		"	    Print the offset of every occurrence of pattern in the text of a compressed\n"
+		"	    file with its neighborhood; shennon, fano and huffman blocks are searched\n"
+		"	    in their coded form with the pattern coded the same way and only the\n"
+		"	    neighborhoods of matches are decoded, other blocks are decoded first\n"
+		"\n"
+		"	--context=bytes\n"
+		"	    Bytes of text shown on either side of a match from 0 to 4096, 16 by default\n"
+		"\n"
+		"BATCH MODE\n"
+		"	--batch path...\n"
+		"	    Compress (-c) or decompress (-d) many files concurrently instead of -i/-o;\n"
+		"	    paths are regular files or directories walked recursively (in directories\n"
+		"	    only files without the \".lc\" suffix are compressed and only files with\n"
+		"	    it are decompressed), outputs get the \".lc\" suffix appended or stripped\n"
+		"\n"
+		"	--list=file\n"
+		"	    Read paths (one per line) from file, \"-\" for standard input; implies --batch\n"
+		"\n"
+		"	--jobs=n\n"
+		"	    Number of worker threads of the work-stealing scheduler that batches,\n"
+		"	    servers and --pipeline share, one per hardware thread by default\n"
+		"\n"
+		"	--pin\n"
+		"	    Bind every worker thread of the scheduler to a hardware thread of its own\n"
+		"\n"
+		"	--out-dir=dir\n"
+		"	    Write outputs under dir (keeping paths relative to the given directories)\n"
+		"	    instead of next to the inputs\n"
+		"\n"
+		"	--dedup=store\n"
+		"	    Deduplicate the batch: inputs are cut into content-defined chunks, every\n"
+		"	    distinct chunk is kept once in the store file, which is compressed with\n"
+		"	    -m, and outputs are recipes that refer to it; decompressing with the same\n"
+		"	    store rebuilds the files (the store is best kept outside of the paths);\n"
+		"	    it does not go with --archive\n"
+		"\n"
+		"	--archive=archive\n"
+		"	    Compress the batch into one archive file instead of a file per input: every\n"
+		"	    file is an entry with its method, sizes and checksum, listed in a central\n"
+		"	    directory at the end; decompressing extracts the entries named by the paths\n"
+		"	    (all of them if none are given) under --out-dir, --jobs of them at once and\n"
+		"	    each checked against its checksum. Without -c or -d the entries are listed.\n"
+		"	    Entries are not deduplicated, --dedup cannot be given with --archive\n"
+		"\n"
+		"	--bench-scheduler\n"
+		"	    Measure the overhead of scheduling empty tasks and the scaling of a fixed\n"
+		"	    amount of work on 1 to --jobs workers (honours --pin)\n"
+		"\n"
+		"	--cpu=level\n"
+		"	    Vector instructions the filter kernels use, level can be \"scalar\",\n"
+		"	    \"sse2\", \"avx2\" or \"avx512\" (AVX-512BW); by default the highest level\n"
+		"	    the CPU supports, or the one in the LIBCODERS_CPU environment variable;\n"
+		"	    levels above what the CPU supports are refused, outputs never differ\n"
+		"\n"
+		"	--perf\n"
+		"	    Count hardware events (cycles, instructions, branch misses, L1d and LLC\n"
+		"	    misses) per coder stage with perf_event_open and report instructions per\n"
+		"	    cycle and misses per byte of text; where the kernel has no counters the\n"
+		"	    run goes on with timers only\n"
+		"\n"
+		"	--stats=format\n"
+		"	    Statistics output format, format can be \"text\" (default) or \"json\";\n"
+		"	    json prints a single object with sizes, elapsed time, per-stage timers\n"
+		"	    (input, statistics, model, coding, output) and counters (symbols, bits,\n"
+		"	    tree_rebuilds, fgk_swaps) of the coder\n"
 		"\n";
 }
@@ -26,27 +26,34 @@
  */
 
 #include <iostream>
-#include <fstream>
 #include <cstdlib>    // size_t
 #include <cstdint>
 #include <cstring>
 #include <cerrno>
 #include <vector>
+#include <memory>
 #include <utility>    // std::pair
 #include <algorithm>  // std::stable_sort
 #include <functional> // std::greater
 #include <cmath>      // std::floor
 #include "pcoder.hxx"
 #include "acoder.hxx"
+#include "cache.hxx"
 
 namespace staticcodes {
 
+	using namespace instrumentation;
+
 	static constexpr size_t EOT = ALPHABET; // End of Transmission
 
 	// ------------------------------------------------------
 	// --------------------- STATISTICS ---------------------
 	// ------------------------------------------------------
 
+	// Scaled down (a quarter of M) the coding range keeps 29 bits, so a symbol rarer than 1 in 2^29 would get
+	// an empty range; from 2^24 symbols on, every symbol is counted as at least 1 / 2^24 of the text
+	static constexpr unsigned MIN_RANGE_BITS = 24;
+
 	void Statistics::create_range_vector() {
 		std::vector<std::pair<uint32_t, int> > sorted_freq;
 
@@ -56,12 +63,20 @@ namespace staticcodes {
 
 		std::stable_sort(sorted_freq.begin(), sorted_freq.end(), std::greater<std::pair<uint32_t, int> >());
 
-		sorted_freq.push_back(std::pair<uint32_t, int>(sorted_freq.back().first, EOT));
+		sorted_freq.push_back(std::pair<uint32_t, int>(1, EOT));
 		++m_total_chars;
 
+		uint64_t floor = m_total_chars >> MIN_RANGE_BITS;
+		uint64_t total = 0;
+
+		for (auto& f : sorted_freq) {
+			if (f.first < floor) f.first = floor;
+			total += f.first;
+		}
+
 		std::vector<double> sum_ranges(sorted_freq.size() + 1, 0.0);
 		for (size_t i = 1; i < sum_ranges.size(); ++i)
-			sum_ranges[i] = sum_ranges[i-1] + sorted_freq[i-1].first / static_cast<double>(m_total_chars);
+			sum_ranges[i] = sum_ranges[i-1] + sorted_freq[i-1].first / static_cast<double>(total);
 
 		m_range_vec.clear();
 		m_range_vec.resize(ALPHABET + 1);
@@ -70,6 +85,24 @@ namespace staticcodes {
 			m_range_vec[sorted_freq[i].second] = std::pair<double, double>(sum_ranges[i], sum_ranges[i+1]);
 	}
 
+	void Statistics::cached_range_vector(sharedmodels::Model const* model, Stats& stats) {
+		modelcache::ModelCache& cache = modelcache::ModelCache::instance();
+		modelcache::key_t key = model ? modelcache::model_key("arithmetic", model->id())
+		                              : modelcache::histogram_key("arithmetic", &m_freq_vec[0], m_freq_vec.size());
+
+		if (std::shared_ptr<range_vec_t const> cached = cache.find<range_vec_t>(key)) {
+			stats.add(CACHE_HITS_COUNTER);
+			m_range_vec = *cached;
+			++m_total_chars; // EOT, as create_range_vector does
+			return;
+		}
+
+		stats.add(CACHE_MISSES_COUNTER);
+		create_range_vector();
+
+		cache.insert<range_vec_t>(key, std::make_shared<range_vec_t const>(m_range_vec), m_range_vec.size() * sizeof(m_range_vec[0]));
+	}
+
 	// ------------------------------------------------------
 	// --------------------- ARITHMETIC ---------------------
 	// ------------------------------------------------------
@@ -176,9 +209,12 @@ namespace staticcodes {
 	// -------------------------------------------------------
 
 	class acoder::CoderImpl : private Statistics, private arithmetic {
-		bitseq_t m_seq;
+		bitseq_t                   m_seq;
+		Stats                      m_stats;
+		sharedmodels::Model const* m_model;
+		bool                       m_good;
 
-		void create_bit_sequence(std::ifstream& ifile) {
+		uint64_t create_bit_sequence(std::istream& ifile) {
 			m_seq.clear();
 
 			ifile.clear();
@@ -187,12 +223,15 @@ namespace staticcodes {
 			size_t Low  = 0;
 			size_t High = m_Max;
 
-			int count = 0;
+			int      count     = 0;
+			uint64_t cnt_chars = 0;
 
 			char c;
-			while (ifile.read(&c, sizeof(c)))
+			while (ifile.read(&c, sizeof(c))) {
 				encode_symbol(static_cast<uint8_t>(c), Low, High, count, m_range_vec, m_seq);
-		
+				++cnt_chars;
+			}
+
 			encode_symbol(EOT, Low, High, count, m_range_vec, m_seq);
 
 			if ((Low < m_quarter) && (m_half < High)) {
@@ -206,16 +245,44 @@ namespace staticcodes {
 				for (int i = 0; i < count + 1; ++i)
 					m_seq.push_back(0);
 			}
+
+			return cnt_chars;
 		}
 
 	public:
-		void compress(std::ifstream& ifile, std::ofstream& ofile) {
-			create_freq_vector(ifile);
-			create_range_vector();
-			create_bit_sequence(ifile);
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+			m_good = true;
+
+			{
+				ScopedTimer timer(m_stats, STATISTICS_STAGE);
+				if (m_model) load_freq_vector(m_model->order0());
+				else         create_freq_vector(ifile);
+			}
+
+			if (m_total_chars > MAX_TABLE_TEXT) {
+				std::cerr << "acoder::compress: Text too long for one frequency table, code it in blocks" << std::endl;
+				m_good = false;
+				return;
+			}
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				cached_range_vector(m_model, m_stats);
+			}
 
-			for (const auto& freq : m_freq_vec)
-				ofile.write(reinterpret_cast<const char*>(&freq), sizeof(freq));
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+				m_stats.add(SYMBOLS_COUNTER, create_bit_sequence(ifile));
+			}
+
+			m_stats.add(BITS_COUNTER, m_seq.size());
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+
+			if (!m_model)
+				for (const auto& freq : m_freq_vec)
+					ofile.write(reinterpret_cast<const char*>(&freq), sizeof(freq));
 
 			uint8_t bit_buffer  = 0;
 			size_t  bit_counter = 0;
@@ -233,30 +300,53 @@ namespace staticcodes {
 			if (bit_counter) ofile.write(reinterpret_cast<const char*>(&bit_buffer), sizeof(bit_buffer));
 		}
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile) {
+		void operator()(std::istream& ifile, std::ostream& ofile) {
 			compress(ifile, ofile);
 		}
 
-		CoderImpl(std::ifstream& ifile, std::ofstream& ofile) : arithmetic(2147483648) {
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		bool good() const {
+			return m_good;
+		}
+
+		CoderImpl(std::istream& ifile, std::ostream& ofile) : arithmetic(2147483648), m_model(nullptr), m_good(true) {
 			compress(ifile, ofile);
 		}
 
-		CoderImpl() : arithmetic(2147483648)
+		CoderImpl(sharedmodels::Model const& model) : arithmetic(2147483648), m_model(&model), m_good(true)
+		{ }
+
+		CoderImpl() : arithmetic(2147483648), m_model(nullptr), m_good(true)
 		{ }
 	};
 
-	void acoder::compress(std::ifstream& ifile, std::ofstream& ofile) {
+	void acoder::compress(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->compress(ifile, ofile);
 	}
 
-	void acoder::operator()(std::ifstream& ifile, std::ofstream& ofile) {
+	void acoder::operator()(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->operator()(ifile, ofile);
 	}
 
-	acoder::acoder(std::ifstream& ifile, std::ofstream& ofile)
+	Stats const& acoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bool acoder::good() const {
+		return m_pImpl->good();
+	}
+
+	acoder::acoder(std::istream& ifile, std::ostream& ofile)
 		: m_pImpl(new CoderImpl(ifile, ofile))
 	{ }
 
+	acoder::acoder(sharedmodels::Model const& model)
+		: m_pImpl(new CoderImpl(model))
+	{ }
+
 	acoder::acoder() : m_pImpl(new CoderImpl)
 	{ }
 
@@ -268,9 +358,12 @@ namespace staticcodes {
 	// -------------------------------------------------------
 
 	class adecoder::DecoderImpl : private Statistics, private arithmetic {
-		bitseq_t m_seq;
+		bitseq_t                   m_seq;
+		Stats                      m_stats;
+		sharedmodels::Model const* m_model;
+		uint64_t                   m_symbols;
 
-		void read_bit_sequence(std::ifstream& ifile) {
+		void read_bit_sequence(std::istream& ifile) {
 			m_seq.clear();
 
 			char curr_byte;
@@ -280,16 +373,29 @@ namespace staticcodes {
 		}
 
 	public:
-		void decompress(std::ifstream& ifile, std::ofstream& ofile) {
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
 			m_freq_vec.clear();
 			m_total_chars = 0;
 
-			for (size_t i = 0; i < ALPHABET; ++i) {
-				uint32_t tmp;
-				ifile.read(reinterpret_cast<char*>(&tmp), sizeof(tmp));
-				m_freq_vec.push_back(tmp);
-				m_total_chars += tmp;
+			if (m_model) {
+				ScopedTimer timer(m_stats, STATISTICS_STAGE);
+				load_freq_vector(m_model->order0());
+				if (!m_symbols) return;
 			}
+			else {
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+
+				for (size_t i = 0; i < ALPHABET; ++i) {
+					uint32_t tmp;
+					ifile.read(reinterpret_cast<char*>(&tmp), sizeof(tmp));
+					m_freq_vec.push_back(tmp);
+					m_total_chars += tmp;
+				}
+			}
+
+			uint64_t total_chars = m_model ? m_symbols : m_total_chars;
 
 			if (ifile.peek() == EOF) {
 				if (!ifile.eof())
@@ -297,8 +403,17 @@ namespace staticcodes {
 				return;
 			}
 
-			create_range_vector();
-			read_bit_sequence(ifile);
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				cached_range_vector(m_model, m_stats);
+			}
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+				read_bit_sequence(ifile);
+			}
+
+			ScopedTimer timer(m_stats, CODING_STAGE);
 
 			size_t N = std::ceil(std::log2(static_cast<double>(m_Max)));
 			int l_index = 0;
@@ -316,6 +431,10 @@ namespace staticcodes {
 			uint64_t cnt_chars = 0;
 
 			while (true) {			
+				// Corrupted frequencies may ask for more bits than the text has
+				if (static_cast<size_t>(r_index) >= m_seq.size())
+					break;
+
 				value = get_value(l_index, r_index, m_seq);
 
 				size_t range = High - Low;
@@ -332,42 +451,62 @@ namespace staticcodes {
 					}
 				}
 
-				while(scaling(Low, High, l_index, r_index, m_seq) || expansion(Low, High, l_index, r_index, m_seq))
+				while(static_cast<size_t>(r_index) < m_seq.size() &&
+				      (scaling(Low, High, l_index, r_index, m_seq) || expansion(Low, High, l_index, r_index, m_seq)))
 					;
 
-				if (symbol == EOT || cnt_chars == m_total_chars - 1)
+				if (symbol == EOT || cnt_chars == total_chars)
 					break;
 
 				char c = symbol;
 				ofile.write(&c, sizeof(c));
 				++cnt_chars;
 			}
+
+			m_stats.add(SYMBOLS_COUNTER, cnt_chars);
+			m_stats.add(BITS_COUNTER, l_index);
 		}
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile) {
+		void operator()(std::istream& ifile, std::ostream& ofile) {
 			decompress(ifile, ofile);
 		}
 
-		DecoderImpl(std::ifstream& ifile, std::ofstream& ofile) : arithmetic(2147483648) {
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		DecoderImpl(std::istream& ifile, std::ostream& ofile) : arithmetic(2147483648), m_model(nullptr), m_symbols(0) {
 			decompress(ifile, ofile);
 		}
 
-		DecoderImpl() : arithmetic(2147483648)
+		DecoderImpl(sharedmodels::Model const& model, uint64_t symbols)
+			: arithmetic(2147483648), m_model(&model), m_symbols(symbols)
+		{ }
+
+		DecoderImpl() : arithmetic(2147483648), m_model(nullptr), m_symbols(0)
 		{ }
 	};
 
-	void adecoder::decompress(std::ifstream& ifile, std::ofstream& ofile) {
+	void adecoder::decompress(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->decompress(ifile, ofile);
 	}
 
-	void adecoder::operator()(std::ifstream& ifile, std::ofstream& ofile) {
+	void adecoder::operator()(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->operator()(ifile, ofile);
 	}
 
-	adecoder::adecoder(std::ifstream& ifile, std::ofstream& ofile)
+	Stats const& adecoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	adecoder::adecoder(std::istream& ifile, std::ostream& ofile)
 		: m_pImpl(new DecoderImpl(ifile, ofile))
 	{ }
 
+	adecoder::adecoder(sharedmodels::Model const& model, uint64_t symbols)
+		: m_pImpl(new DecoderImpl(model, symbols))
+	{ }
+
 	adecoder::adecoder() : m_pImpl(new DecoderImpl)
 	{ }
 
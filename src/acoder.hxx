@@ -29,8 +29,11 @@
 #ifndef ACODER_HXX
 #define ACODER_HXX
 
-#include <fstream>
+#include <iostream>
+#include <cstdint>
 #include <memory>
+#include "instrument.hxx"
+#include "models.hxx"
 
 namespace staticcodes {
 
@@ -45,11 +48,20 @@ namespace staticcodes {
 	public:
 
 		// Encodes text and writes the final bit sequence to the output file
-		void compress(std::ifstream& ifile, std::ofstream& ofile);
+		void compress(std::istream& ifile, std::ostream& ofile);
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile);
+		void operator()(std::istream& ifile, std::ostream& ofile);
 
-		acoder(std::ifstream& ifile, std::ofstream& ofile);
+		// Stage timers and counters of the last compress call
+		instrumentation::Stats const& stats() const;
+
+		// False if the last compress call refused a text longer than MAX_TABLE_TEXT, nothing is written then
+		bool good() const;
+
+		acoder(std::istream& ifile, std::ostream& ofile);
+
+		// Codes with the frequencies of a pre-trained model, so no frequency table is written
+		explicit acoder(sharedmodels::Model const& model);
 
 		acoder();
 
@@ -67,11 +79,17 @@ namespace staticcodes {
 	public:
 
 		// Decodes text and writes the final bit sequence to the output file
-		void decompress(std::ifstream& ifile, std::ofstream& ofile);
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last decompress call
+		instrumentation::Stats const& stats() const;
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile);
+		adecoder(std::istream& ifile, std::ostream& ofile);
 
-		adecoder(std::ifstream& ifile, std::ofstream& ofile);
+		// Decodes a text of "symbols" chars coded with the frequencies of the model
+		adecoder(sharedmodels::Model const& model, uint64_t symbols);
 
 		adecoder();
 
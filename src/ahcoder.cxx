@@ -26,7 +26,6 @@
  */
 
 #include <iostream>
-#include <fstream>
 #include <cstdlib> // size_t
 #include <cstdint>
 #include <vector>
@@ -36,8 +35,11 @@
 
 namespace adaptivecodes {
 
+	using namespace instrumentation;
+
 	using bitseq_t  = std::vector<bool>;
 	using symbseq_t = std::vector<uint8_t>;
+	using weights_t = std::vector<std::pair<uint8_t, uint64_t> >;
 
 	constexpr size_t MAX_LEAF_NUM = 256;
 	constexpr size_t MAX_NODE_NUM = 512;
@@ -45,6 +47,9 @@ namespace adaptivecodes {
 	// NYT = Not Yet Transmitted
 	enum node_type {NYT_NODE = -1, INTERNAL_NODE = -2};
 
+	static_assert(NYT_NODE == sharedmodels::FGK_NYT && INTERNAL_NODE == sharedmodels::FGK_INTERNAL,
+	              "FGK node types must match the shared model file");
+
 	// -------------------------------------------------------
 	// ------------------------ NODE -------------------------
 	// -------------------------------------------------------
@@ -81,6 +86,14 @@ namespace adaptivecodes {
 		Node*    m_nodes[MAX_NODE_NUM + 1];
 		Node*    m_dcurr;
 		bitseq_t m_buf;
+		uint64_t m_aging_period; // symbols between halvings of the weights, 0 means never
+		uint64_t m_aging_count;  // symbols since the last halving
+
+	protected:
+		uint64_t m_swaps;
+		uint64_t m_rebuilds;
+
+	private:
 
 		void update_tree(Node* node) {
 			while (node) {
@@ -119,6 +132,8 @@ namespace adaptivecodes {
 			std::swap(m_nodes[a->order], m_nodes[b->order]);
 			std::swap(a->order, b->order);
 			std::swap(a->parent, b->parent);
+
+			++m_swaps;
 		}
 
 		bool is_in_tree(uint8_t byte) const {
@@ -146,6 +161,7 @@ namespace adaptivecodes {
 
 		void encode_existing_byte(uint8_t byte) {
 			update_tree(m_leaves[byte]);
+			age();
 		}
 
 		void encode_new_byte(uint8_t byte) {
@@ -160,9 +176,86 @@ namespace adaptivecodes {
 			m_nyt = m_nyt->left;
 
 			update_tree(m_leaves[byte]);
+			age();
+		}
+
+		// Every aging period halves the weights of the leaves (rounding up, so that seen symbols keep theirs)
+		// and rebuilds the tree from them, so that recent symbols outweigh old ones. The rebuild depends on
+		// the weights only, so the encoder and the decoder stay in step
+		void age() {
+			if (!m_aging_period || ++m_aging_count < m_aging_period) return;
+			m_aging_count = 0;
+
+			weights_t weights;
+			for (size_t symbol = 0; symbol < MAX_LEAF_NUM; ++symbol)
+				if (m_leaves[symbol])
+					weights.emplace_back(symbol, (m_leaves[symbol]->weight + 1) / 2);
+
+			if (weights.empty()) return;
+
+			rebuild(weights);
+			++m_rebuilds;
+		}
+
+		// Replaces the tree with the one built from the weights of its leaves (in the order of symbols)
+		void rebuild(weights_t const& weights) {
+			// The NYT node (weight 0) and the leaves in the order of their weights
+			std::vector<sharedmodels::fgk_node_t> nodes;
+			nodes.reserve(MAX_NODE_NUM);
+			nodes.push_back(sharedmodels::fgk_node_t{ NYT_NODE, -1, -1, 0, 0 });
+
+			for (const auto& leaf : weights)
+				nodes.push_back(sharedmodels::fgk_node_t{ leaf.first, -1, -1, 0, leaf.second });
+
+			if (nodes.size() < 2) {
+				assign(nodes.data(), nodes.size());
+				return;
+			}
+
+			size_t leaf_num = nodes.size();
+			std::stable_sort(nodes.begin() + 1, nodes.end(),
+			                 [](sharedmodels::fgk_node_t const& a, sharedmodels::fgk_node_t const& b) { return a.weight < b.weight; });
+
+			// Huffman merging with a queue of leaves and a queue of merged nodes: the nodes leave the queues
+			// with nondecreasing weights and siblings next to each other, which is the order of FGK
+			std::vector<size_t> sequence;
+			sequence.reserve(2 * leaf_num);
+			size_t next_leaf = 0, next_merged = leaf_num;
+
+			auto take = [&]() {
+				bool leaf = next_leaf < leaf_num && (next_merged == nodes.size() || nodes[next_leaf].weight <= nodes[next_merged].weight);
+				size_t i = leaf ? next_leaf++ : next_merged++;
+				sequence.push_back(i);
+				return i;
+			};
+
+			while (sequence.size() < 2 * leaf_num - 2) {
+				size_t left  = take();
+				size_t right = take();
+				nodes.push_back(sharedmodels::fgk_node_t{ INTERNAL_NODE, static_cast<int32_t>(left), static_cast<int32_t>(right), 0,
+				                                          nodes[left].weight + nodes[right].weight });
+			}
+			sequence.push_back(nodes.size() - 1);
+
+			// Records in the order of the stored trees: the root (the last node to leave) first
+			std::vector<size_t> record(nodes.size());
+			for (size_t i = 0; i < sequence.size(); ++i)
+				record[sequence[i]] = sequence.size() - 1 - i;
+
+			sharedmodels::fgk_state_t state(nodes.size());
+			for (size_t i = 0; i < nodes.size(); ++i) {
+				sharedmodels::fgk_node_t node = nodes[i];
+				if (node.symbol == INTERNAL_NODE) {
+					node.left  = record[node.left];
+					node.right = record[node.right];
+				}
+				state[record[i]] = node;
+			}
+
+			assign(state.data(), state.size());
 		}
 
-		void delete_tree() { delete_tree(m_root); }
+		void delete_tree() { delete_tree(m_root); m_root = nullptr; }
 
 		void delete_tree(const Node* m_root) {
 			if (!m_root) return;
@@ -172,8 +265,42 @@ namespace adaptivecodes {
 			delete m_root;
 		}
 
+		// Replaces the tree with one made of the records, see dump
+		void assign(sharedmodels::fgk_node_t const* records, size_t size) {
+			delete_tree();
+
+			for (auto&& leaf : m_leaves)
+				leaf = nullptr;
+			for (auto&& node: m_nodes)
+				node = nullptr;
+
+			for (size_t i = 0; i < size; ++i) {
+				Node* node = new Node(records[i].symbol, MAX_NODE_NUM - i, records[i].weight);
+				m_nodes[node->order] = node;
+
+				if      (node->symbol == NYT_NODE) m_nyt = node;
+				else if (node->symbol >= 0)        m_leaves[node->symbol] = node;
+			}
+
+			for (size_t i = 0; i < size; ++i) {
+				if (records[i].symbol != INTERNAL_NODE) continue;
+
+				Node* node  = m_nodes[MAX_NODE_NUM - i];
+				node->left  = m_nodes[MAX_NODE_NUM - records[i].left];
+				node->right = m_nodes[MAX_NODE_NUM - records[i].right];
+				node->left->parent  = node;
+				node->right->parent = node;
+			}
+
+			m_root  = m_nodes[MAX_NODE_NUM];
+			m_dcurr = m_root;
+		}
+
 	public:
-		fgk() : m_nyt(new Node(NYT_NODE, MAX_NODE_NUM)), m_root(m_nyt), m_dcurr(m_root) {
+		fgk()
+			: m_nyt(new Node(NYT_NODE, MAX_NODE_NUM)), m_root(m_nyt), m_dcurr(m_root), m_aging_period(0), m_aging_count(0),
+			  m_swaps(0), m_rebuilds(0)
+		{
 			for (auto&& leaf : m_leaves)
 				leaf = nullptr;
 			for (auto&& node: m_nodes)
@@ -248,6 +375,61 @@ namespace adaptivecodes {
 		bitseq_t get_nyt_code() const {
 			return get_symbol_code(m_nyt);
 		}
+
+		// Updates the tree with a byte without coding it
+		void learn(uint8_t byte) {
+			if (is_in_tree(byte)) encode_existing_byte(byte);
+			else                  encode_new_byte(byte);
+		}
+
+		// Stores the tree as records ordered by node order, the root first
+		void dump(sharedmodels::fgk_state_t& state) const {
+			state.clear();
+
+			for (size_t order = MAX_NODE_NUM; m_nodes[order]; --order) {
+				Node const* node = m_nodes[order];
+
+				sharedmodels::fgk_node_t record;
+				record.symbol   = node->symbol;
+				record.left     = node->left  ? MAX_NODE_NUM - node->left->order  : -1;
+				record.right    = node->right ? MAX_NODE_NUM - node->right->order : -1;
+				record.reserved = 0;
+				record.weight   = node->weight;
+				state.push_back(record);
+
+				if (!order) break;
+			}
+		}
+
+		// Replaces the tree with a stored one (validated by the model loader)
+		void restore(sharedmodels::fgk_node_t const* records, size_t size) {
+			assign(records, size);
+			m_buf.clear();
+			m_aging_count = 0;
+		}
+
+		// Weights of the leaves in the order of symbols and the symbols since the last aging
+		void checkpoint(checkpoint_t& checkpoint) const {
+			checkpoint.aging_count = m_aging_count;
+			checkpoint.weights.clear();
+
+			for (size_t symbol = 0; symbol < MAX_LEAF_NUM; ++symbol)
+				if (m_leaves[symbol])
+					checkpoint.weights.emplace_back(symbol, m_leaves[symbol]->weight);
+		}
+
+		// Replaces the tree with the one rebuilt from a checkpoint (validated by the container)
+		void resume(checkpoint_t const& checkpoint) {
+			rebuild(checkpoint.weights);
+			m_buf.clear();
+			m_aging_count = checkpoint.aging_count;
+		}
+
+		// Halves the weights every "period" symbols from now on, 0 turns aging off
+		void set_aging(uint64_t period) {
+			m_aging_period = period;
+			m_aging_count  = 0;
+		}
 	};
 
 	// -------------------------------------------------------
@@ -255,6 +437,11 @@ namespace adaptivecodes {
 	// -------------------------------------------------------
 
 	class ahcoder::CoderImpl : private fgk {
+		Stats                      m_stats;
+		sharedmodels::Model const* m_model;
+		checkpoint_t               m_start;
+		bool                       m_resume; // the next compress call starts from m_start
+
 		void flush_output_buffer(std::ostream& ofile, bitseq_t& outbuf) {
 			symbseq_t out_bytes;
 			out_bytes.reserve((MAX_NODE_NUM * CHAR_BIT) / 2);
@@ -277,26 +464,56 @@ namespace adaptivecodes {
 		}
 
 	public:
-		void compress(std::ifstream& ifile, std::ofstream& ofile) {
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
+			if (m_resume) {
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				fgk::resume(m_start);
+				m_resume = false;
+			}
+			else if (m_model) {
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				restore(m_model->fgk_nodes(), m_model->fgk_size());
+			}
+
+			uint64_t swaps_before    = m_swaps;
+			uint64_t rebuilds_before = m_rebuilds;
+
 			uint8_t inbuf[MAX_NODE_NUM];
 
 			bitseq_t outbuf;
 			outbuf.reserve(MAX_NODE_NUM * CHAR_BIT + 64);
 
 			while (ifile.good()) {
-				ifile.read(reinterpret_cast<char*>(inbuf), MAX_NODE_NUM);
-				size_t bytes_read = ifile.gcount();
+				size_t bytes_read;
 
-				for (size_t i = 0; i < bytes_read ; ++i) {
-					bitseq_t code = encode(inbuf[i]);
-					std::copy(std::begin(code), std::end(code), std::back_inserter(outbuf));
+				{
+					ScopedTimer timer(m_stats, INPUT_STAGE);
+					ifile.read(reinterpret_cast<char*>(inbuf), MAX_NODE_NUM);
+					bytes_read = ifile.gcount();
 				}
 
-				if (outbuf.size() >= MAX_NODE_NUM * CHAR_BIT)
+				{
+					ScopedTimer timer(m_stats, CODING_STAGE);
+					for (size_t i = 0; i < bytes_read ; ++i) {
+						bitseq_t code = encode(inbuf[i]);
+						std::copy(std::begin(code), std::end(code), std::back_inserter(outbuf));
+						m_stats.add(BITS_COUNTER, code.size());
+					}
+				}
+
+				m_stats.add(SYMBOLS_COUNTER, bytes_read);
+
+				if (outbuf.size() >= MAX_NODE_NUM * CHAR_BIT) {
+					ScopedTimer timer(m_stats, OUTPUT_STAGE);
 					flush_output_buffer(ofile, outbuf);
+				}
 			}
 
 			if (!outbuf.empty()) {
+				ScopedTimer timer(m_stats, OUTPUT_STAGE);
+
 				if (outbuf.size() % CHAR_BIT != 0) {
 					bitseq_t nyt_code = get_nyt_code();
 
@@ -307,32 +524,70 @@ namespace adaptivecodes {
 
 				flush_output_buffer(ofile, outbuf);
 			}
+
+			m_stats.add(FGK_SWAPS_COUNTER, m_swaps - swaps_before);
+			m_stats.add(TREE_BUILDS_COUNTER, m_rebuilds - rebuilds_before);
 		}
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile) {
+		void operator()(std::istream& ifile, std::ostream& ofile) {
 			compress(ifile, ofile);
 		}
 
-		CoderImpl(std::ifstream& ifile, std::ofstream& ofile) {
+		using fgk::set_aging;
+		using fgk::checkpoint;
+
+		void resume(checkpoint_t const& checkpoint) {
+			m_start  = checkpoint;
+			m_resume = true;
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		CoderImpl(std::istream& ifile, std::ostream& ofile) : m_model(nullptr), m_resume(false) {
 			compress(ifile, ofile);
 		}
 
-		CoderImpl()
+		CoderImpl(sharedmodels::Model const& model) : m_model(&model), m_resume(false)
+		{ }
+
+		CoderImpl() : m_model(nullptr), m_resume(false)
 		{ }
 	};
 
-	void ahcoder::compress(std::ifstream& ifile, std::ofstream& ofile) {
+	void ahcoder::compress(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->compress(ifile, ofile);
 	}
 
-	void ahcoder::operator()(std::ifstream& ifile, std::ofstream& ofile) {
+	void ahcoder::operator()(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->operator()(ifile, ofile);
 	}
 
-	ahcoder::ahcoder(std::ifstream& ifile, std::ofstream& ofile)
+	void ahcoder::set_aging(uint64_t period) {
+		m_pImpl->set_aging(period);
+	}
+
+	void ahcoder::resume(checkpoint_t const& checkpoint) {
+		m_pImpl->resume(checkpoint);
+	}
+
+	void ahcoder::checkpoint(checkpoint_t& checkpoint) const {
+		m_pImpl->checkpoint(checkpoint);
+	}
+
+	Stats const& ahcoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	ahcoder::ahcoder(std::istream& ifile, std::ostream& ofile)
 		: m_pImpl(new CoderImpl(ifile, ofile))
 	{ }
 
+	ahcoder::ahcoder(sharedmodels::Model const& model)
+		: m_pImpl(new CoderImpl(model))
+	{ }
+
 	ahcoder::ahcoder() : m_pImpl(new CoderImpl)
 	{ }
 
@@ -344,58 +599,165 @@ namespace adaptivecodes {
 	// -------------------------------------------------------
 
 	class ahdecoder::DecoderImpl : private fgk {
+		Stats                      m_stats;
+		sharedmodels::Model const* m_model;
+		uint64_t                   m_symbols;
+		checkpoint_t               m_start;
+		bool                       m_resume; // the next decompress call starts from m_start
+
 	public:
-		void decompress(std::ifstream& ifile, std::ofstream& ofile) {
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
+			// Without a model the padding (a prefix of the NYT code) ends decoding, with one the length is known
+			uint64_t remaining = UINT64_MAX;
+
+			if (m_model) {
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				if (!m_resume) restore(m_model->fgk_nodes(), m_model->fgk_size());
+				remaining = m_symbols;
+			}
+
+			if (m_resume) {
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				fgk::resume(m_start);
+				m_resume = false;
+			}
+
+			uint64_t swaps_before    = m_swaps;
+			uint64_t rebuilds_before = m_rebuilds;
+
 			uint8_t inbuf[MAX_NODE_NUM];
 
 			while (ifile.good()) {
-				ifile.read(reinterpret_cast<char*>(inbuf), MAX_NODE_NUM);
-				size_t bytes_read = ifile.gcount();
-
 				bitseq_t seq;
-				seq.reserve(MAX_NODE_NUM * CHAR_BIT);
 
-				for (size_t i = 0; i < bytes_read; ++i) {
-					bitseq_t code(CHAR_BIT);
-					for (size_t j = 0; j < CHAR_BIT; ++j)
-						code[j] = inbuf[i] & (1 << (7 - j));
+				{
+					ScopedTimer timer(m_stats, INPUT_STAGE);
+
+					ifile.read(reinterpret_cast<char*>(inbuf), MAX_NODE_NUM);
+					size_t bytes_read = ifile.gcount();
+
+					seq.reserve(MAX_NODE_NUM * CHAR_BIT);
+
+					for (size_t i = 0; i < bytes_read; ++i) {
+						bitseq_t code(CHAR_BIT);
+						for (size_t j = 0; j < CHAR_BIT; ++j)
+							code[j] = inbuf[i] & (1 << (7 - j));
+
+						std::copy(std::begin(code), std::end(code), std::back_inserter(seq));
+					}
+				}
+
+				m_stats.add(BITS_COUNTER, seq.size());
+
+				symbseq_t outbuf;
 
-					std::copy(std::begin(code), std::end(code), std::back_inserter(seq));
+				{
+					ScopedTimer timer(m_stats, CODING_STAGE);
+					outbuf = decode(seq);
 				}
 
-				symbseq_t outbuf = decode(seq);
-				ofile.write(reinterpret_cast<const char*>(&outbuf.front()), outbuf.size());
+				if (outbuf.size() > remaining) outbuf.resize(remaining);
+				remaining -= outbuf.size();
+
+				m_stats.add(SYMBOLS_COUNTER, outbuf.size());
+
+				ScopedTimer timer(m_stats, OUTPUT_STAGE);
+				ofile.write(reinterpret_cast<const char*>(outbuf.data()), outbuf.size());
 			}
+
+			m_stats.add(FGK_SWAPS_COUNTER, m_swaps - swaps_before);
+			m_stats.add(TREE_BUILDS_COUNTER, m_rebuilds - rebuilds_before);
 		}
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile) {
+		void operator()(std::istream& ifile, std::ostream& ofile) {
 			decompress(ifile, ofile);
 		}
 
-		DecoderImpl(std::ifstream& ifile, std::ofstream& ofile) {
+		using fgk::set_aging;
+		using fgk::checkpoint;
+
+		void resume(checkpoint_t const& checkpoint) {
+			m_start  = checkpoint;
+			m_resume = true;
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		DecoderImpl(std::istream& ifile, std::ostream& ofile) : m_model(nullptr), m_symbols(0), m_resume(false) {
 			decompress(ifile, ofile);
 		}
 
-		DecoderImpl()
+		DecoderImpl(sharedmodels::Model const& model, uint64_t symbols) : m_model(&model), m_symbols(symbols), m_resume(false)
+		{ }
+
+		DecoderImpl() : m_model(nullptr), m_symbols(0), m_resume(false)
 		{ }
 	};
 
-	void ahdecoder::decompress(std::ifstream& ifile, std::ofstream& ofile) {
+	void ahdecoder::decompress(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->decompress(ifile, ofile);
 	}
 
-	void ahdecoder::operator()(std::ifstream& ifile, std::ofstream& ofile) {
+	void ahdecoder::operator()(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->operator()(ifile, ofile);
 	}
 
-	ahdecoder::ahdecoder(std::ifstream& ifile, std::ofstream& ofile)
+	void ahdecoder::set_aging(uint64_t period) {
+		m_pImpl->set_aging(period);
+	}
+
+	void ahdecoder::resume(checkpoint_t const& checkpoint) {
+		m_pImpl->resume(checkpoint);
+	}
+
+	void ahdecoder::checkpoint(checkpoint_t& checkpoint) const {
+		m_pImpl->checkpoint(checkpoint);
+	}
+
+	Stats const& ahdecoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	ahdecoder::ahdecoder(std::istream& ifile, std::ostream& ofile)
 		: m_pImpl(new DecoderImpl(ifile, ofile))
 	{ }
 
+	ahdecoder::ahdecoder(sharedmodels::Model const& model, uint64_t symbols)
+		: m_pImpl(new DecoderImpl(model, symbols))
+	{ }
+
 	ahdecoder::ahdecoder() : m_pImpl(new DecoderImpl)
 	{ }
 
 	ahdecoder::~ahdecoder()
 	{ }
 
+	// -------------------------------------------------------
+	// ------------------------ TRAIN ------------------------
+	// -------------------------------------------------------
+
+	class FGKTrainer : private fgk {
+	public:
+		void train(std::istream& ifile, sharedmodels::fgk_state_t& state) {
+			uint8_t inbuf[MAX_NODE_NUM];
+
+			while (ifile.read(reinterpret_cast<char*>(inbuf), MAX_NODE_NUM) || ifile.gcount()) {
+				size_t bytes_read = ifile.gcount();
+				for (size_t i = 0; i < bytes_read; ++i)
+					learn(inbuf[i]);
+			}
+
+			dump(state);
+		}
+	};
+
+	void train_fgk(std::istream& ifile, sharedmodels::fgk_state_t& state) {
+		FGKTrainer trainer;
+		trainer.train(ifile, state);
+	}
+
 }
@@ -29,11 +29,31 @@
 #ifndef AHCODER_HXX
 #define AHCODER_HXX
 
-#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include <utility> // std::pair
 #include <memory>
+#include "instrument.hxx"
+#include "models.hxx"
 
 namespace adaptivecodes {
 
+	// Aging period that follows statistics drifting every few kilobytes at a cost of a fraction of
+	// a percent on stationary texts
+	static constexpr uint64_t DEFAULT_AGING_PERIOD = 1 << 12;
+
+	// State of the tree between two parts of a text: the weights of the symbols seen so far and the symbols
+	// coded since the last aging. The tree is rebuilt from the weights alone, so a checkpoint takes a few
+	// bytes per symbol instead of the nodes of the whole tree
+	struct checkpoint_t {
+		uint64_t                                    aging_count;
+		std::vector<std::pair<uint8_t, uint64_t> > weights; // (symbol, weight) of every leaf in the order of symbols
+
+		checkpoint_t() : aging_count(0)
+		{ }
+	};
+
 	// -------------------------------------------------------
 	// ----------------------- AHCODER -----------------------
 	// -------------------------------------------------------
@@ -45,11 +65,28 @@ namespace adaptivecodes {
 	public:
 
 		// Encodes text and writes the final bit sequence to the output file
-		void compress(std::ifstream& ifile, std::ofstream& ofile);
+		void compress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Halves the weights of the tree every "period" coded symbols (0, the default, never does), so that
+		// the codes follow the recent text on non-stationary streams. The decoder needs the same period
+		void set_aging(uint64_t period);
+
+		// Starts the next compress call from the tree rebuilt from a checkpoint instead of an empty (or the
+		// model) tree, so that a text coded in parts codes every part as a continuation of the one before
+		void resume(checkpoint_t const& checkpoint);
+
+		// Checkpoint of the tree after the last compress call
+		void checkpoint(checkpoint_t& checkpoint) const;
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile);
+		// Stage timers and counters of the last compress call
+		instrumentation::Stats const& stats() const;
 
-		ahcoder(std::ifstream& ifile, std::ofstream& ofile);
+		ahcoder(std::istream& ifile, std::ostream& ofile);
+
+		// Starts every compress call from the FGK tree of a pre-trained model instead of an empty tree
+		explicit ahcoder(sharedmodels::Model const& model);
 
 		ahcoder();
 
@@ -67,17 +104,36 @@ namespace adaptivecodes {
 	public:
 
 		// Decodes text and writes the final bit sequence to the output file
-		void decompress(std::ifstream& ifile, std::ofstream& ofile);
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Halves the weights of the tree every "period" decoded symbols, as the encoder did
+		void set_aging(uint64_t period);
+
+		// Starts the next decompress call from the tree rebuilt from the checkpoint the encoder resumed from
+		void resume(checkpoint_t const& checkpoint);
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile);
+		// Checkpoint of the tree after the last decompress call, the same as the encoder's after the same text
+		void checkpoint(checkpoint_t& checkpoint) const;
 
-		ahdecoder(std::ifstream& ifile, std::ofstream& ofile);
+		// Stage timers and counters of the last decompress call
+		instrumentation::Stats const& stats() const;
+
+		ahdecoder(std::istream& ifile, std::ostream& ofile);
+
+		// Starts every decompress call from the FGK tree of the model the text was coded with,
+		// "symbols" is the length of the text
+		ahdecoder(sharedmodels::Model const& model, uint64_t symbols);
 
 		ahdecoder();
 
 		~ahdecoder();
 	};
 
+	// Replays the text through an FGK tree and stores the tree it has adapted to (for shared models)
+	void train_fgk(std::istream& ifile, sharedmodels::fgk_state_t& state);
+
 }
 
 #endif // AHCODER_HXX
@@ -0,0 +1,237 @@
+/**
+ * archive.cxx
+ *
+ * Multi-File Archives with a Central Directory
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm> // std::min
+#include "archive.hxx"
+
+namespace archivecodes {
+
+	static constexpr char    MAGIC[]     = { 'L', 'C', 'A', 'R' };
+	static constexpr uint8_t VERSION     = 1;
+	static constexpr size_t  MAX_NAME    = 4096; // PATH_MAX
+	static constexpr size_t  BUFFER_SIZE = 1 << 16;
+
+	static void write_le64(std::ostream& ofile, uint64_t value) {
+		for (size_t i = 0; i < 8; ++i)
+			ofile.put(static_cast<char>(value >> (8 * i)));
+	}
+
+	static bool read_le64(std::istream& ifile, uint64_t& value) {
+		uint8_t bytes[8];
+		if (!ifile.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) return false;
+
+		value = 0;
+		for (size_t i = 0; i < 8; ++i)
+			value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+		return true;
+	}
+
+	std::string entry_name(std::string const& path) {
+		size_t start = 0;
+
+		while (true) {
+			if      (!path.compare(start, 1, "/"))   start += 1;
+			else if (!path.compare(start, 2, "./"))  start += 2;
+			else if (!path.compare(start, 3, "../")) start += 3;
+			else break;
+		}
+
+		std::string name = path.substr(start);
+		return valid_name(name) ? name : std::string();
+	}
+
+	bool valid_name(std::string const& name) {
+		if (name.empty() || name.size() > MAX_NAME || name[0] == '/' || name.find('\0') != std::string::npos) return false;
+
+		for (size_t begin = 0; begin <= name.size(); ) {
+			size_t      end       = std::min(name.find('/', begin), name.size());
+			std::string component = name.substr(begin, end - begin);
+
+			if (component.empty() || component == "." || component == "..") return false;
+			begin = end + 1;
+		}
+
+		return true;
+	}
+
+	void write_header(std::ostream& ofile) {
+		ofile.write(MAGIC, sizeof(MAGIC));
+		ofile.put(VERSION);
+	}
+
+	void write_directory(std::ostream& ofile, std::vector<entry_t> const& entries) {
+		uint64_t offset = ofile.tellp();
+
+		blockcodes::write_varint(ofile, entries.size());
+		for (const auto& entry : entries) {
+			blockcodes::write_varint(ofile, entry.name.size());
+			ofile.write(entry.name.data(), entry.name.size());
+			blockcodes::write_varint(ofile, entry.offset);
+			blockcodes::write_varint(ofile, entry.stored_size);
+			blockcodes::write_varint(ofile, entry.size);
+			ofile.put(static_cast<char>(entry.method));
+			write_le64(ofile, entry.digest);
+		}
+
+		write_le64(ofile, offset);
+		ofile.write(MAGIC, sizeof(MAGIC));
+	}
+
+	bool read_directory(std::istream& ifile, std::vector<entry_t>& entries, std::string& error) {
+		entries.clear();
+
+		char     magic[sizeof(MAGIC)];
+		uint64_t offset;
+
+		ifile.seekg(0, std::ios::end);
+		uint64_t size = ifile.tellg();
+
+		if (!ifile || size < HEADER_SIZE + TRAILER_SIZE) {
+			error = "Not an archive";
+			return false;
+		}
+
+		uint64_t end = size - TRAILER_SIZE;
+		ifile.seekg(0);
+
+		if (!ifile.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC))) {
+			error = "Not an archive";
+			return false;
+		}
+
+		if (ifile.get() != VERSION) {
+			error = "Unsupported archive version";
+			return false;
+		}
+
+		ifile.seekg(end);
+
+		if (!read_le64(ifile, offset) || !ifile.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) ||
+		    offset < HEADER_SIZE || offset > end) {
+			error = "Truncated archive or malformed trailer";
+			return false;
+		}
+
+		ifile.seekg(offset);
+
+		uint64_t count;
+		if (!blockcodes::read_varint(ifile, count) || count > end - offset) {
+			error = "Malformed central directory";
+			return false;
+		}
+
+		for (uint64_t i = 0; i < count; ++i) {
+			entry_t  entry;
+			uint64_t name_size;
+			int      method;
+
+			if (!blockcodes::read_varint(ifile, name_size) || name_size > MAX_NAME) {
+				error = "Malformed central directory";
+				return false;
+			}
+
+			entry.name.resize(name_size);
+
+			if (!ifile.read(&entry.name[0], name_size) || !blockcodes::read_varint(ifile, entry.offset) ||
+			    !blockcodes::read_varint(ifile, entry.stored_size) || !blockcodes::read_varint(ifile, entry.size) ||
+			    (method = ifile.get()) == EOF || !read_le64(ifile, entry.digest)) {
+				error = "Malformed central directory";
+				return false;
+			}
+
+			entry.method = static_cast<blockcodes::method_t>(method);
+
+			if (!valid_name(entry.name)) {
+				error = "Unsafe entry name in the central directory";
+				return false;
+			}
+
+			if (entry.offset < HEADER_SIZE || entry.offset > offset || entry.stored_size > offset - entry.offset ||
+			    (entry.method >= blockcodes::METHOD_NUM && entry.method != blockcodes::AUTO)) {
+				error = "Malformed central directory";
+				return false;
+			}
+
+			entries.push_back(entry);
+		}
+
+		if (static_cast<uint64_t>(ifile.tellg()) != end) {
+			error = "Malformed central directory";
+			entries.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	// -------------------------------------------------------
+	// --------------------- DIGESTREADER --------------------
+	// -------------------------------------------------------
+
+	DigestReader::int_type DigestReader::underflow() {
+		std::streamsize got = m_source->sgetn(m_buffer.data(), m_buffer.size());
+		if (got <= 0) return traits_type::eof();
+
+		m_hasher.update(m_buffer.data(), got);
+		m_size += got;
+
+		setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + got);
+		return traits_type::to_int_type(m_buffer[0]);
+	}
+
+	DigestReader::DigestReader(std::streambuf* source) : m_source(source), m_size(0), m_buffer(BUFFER_SIZE)
+	{ }
+
+	// -------------------------------------------------------
+	// --------------------- DIGESTWRITER --------------------
+	// -------------------------------------------------------
+
+	std::streamsize DigestWriter::xsputn(char const* data, std::streamsize size) {
+		std::streamsize put = m_sink->sputn(data, size);
+		if (put > 0) {
+			m_hasher.update(data, put);
+			m_size += put;
+		}
+		return put;
+	}
+
+	DigestWriter::int_type DigestWriter::overflow(int_type c) {
+		if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+
+		char ch = traits_type::to_char_type(c);
+		return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+	}
+
+	DigestWriter::DigestWriter(std::streambuf* sink) : m_sink(sink), m_size(0)
+	{ }
+
+}
@@ -0,0 +1,136 @@
+/**
+ * archive.hxx
+ *
+ * Multi-File Archives with a Central Directory
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef ARCHIVE_HXX
+#define ARCHIVE_HXX
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "blocks.hxx"
+#include "dedup.hxx"
+
+/**
+ * Archive layout:
+ *
+ *   magic "LCAR" | version (1 byte) | entries | central directory | directory offset (8 bytes) | magic "LCAR"
+ *
+ * Every entry is the block container of one file (see blockcodes::bcoder), the entries follow each other. The
+ * central directory after them lists them in the same order:
+ *
+ *   entries (varint) | per entry: name size (varint) | name | offset (varint) | stored size (varint) |
+ *   size (varint) | method (1 byte) | digest (8 bytes, little-endian)
+ *
+ * It is found through the fixed-size trailer, so listing reads the directory only and an entry is extracted
+ * by seeking to it, without touching the others. Digests are dedupcodes::Hasher digests of the files.
+ */
+
+namespace archivecodes {
+
+	// Bytes of the header and of the trailer
+	static constexpr size_t HEADER_SIZE  = 5;
+	static constexpr size_t TRAILER_SIZE = 12;
+
+	struct entry_t {
+		std::string          name;        // relative path, '/' separated
+		uint64_t             offset;      // of the container in the archive
+		uint64_t             stored_size; // of the container
+		uint64_t             size;        // of the file
+		blockcodes::method_t method;      // requested when compressing, AUTO if it was picked per block
+		uint64_t             digest;
+
+		entry_t() : offset(0), stored_size(0), size(0), method(blockcodes::STORED), digest(0) {}
+	};
+
+	// Entry name of a path: leading "/", "./" and "../" taken off; empty if nothing is left or ".." remains in it
+	std::string entry_name(std::string const& path);
+
+	// Relative, without empty, "." or ".." components: safe to extract under any directory
+	bool valid_name(std::string const& name);
+
+	void write_header(std::ostream& ofile);
+
+	// Writes the directory and the trailer, the stream must be at the end of the last entry
+	void write_directory(std::ostream& ofile, std::vector<entry_t> const& entries);
+
+	// Reads the directory of a seekable archive, false (with the reason in error) if it is not an archive or is
+	// malformed: entries must lie between the header and the directory and have valid names
+	bool read_directory(std::istream& ifile, std::vector<entry_t>& entries, std::string& error);
+
+	// -------------------------------------------------------
+	// --------------------- DIGESTREADER --------------------
+	// -------------------------------------------------------
+
+	// Input buffer that digests what is read through it from another one
+	class DigestReader : public std::streambuf {
+		std::streambuf*    m_source;
+		dedupcodes::Hasher m_hasher;
+		uint64_t           m_size;
+		std::vector<char>  m_buffer;
+
+	protected:
+		int_type underflow() override;
+
+	public:
+		uint64_t digest() const { return m_hasher.digest(); }
+
+		// Bytes read so far
+		uint64_t size() const { return m_size; }
+
+		explicit DigestReader(std::streambuf* source);
+	};
+
+	// -------------------------------------------------------
+	// --------------------- DIGESTWRITER --------------------
+	// -------------------------------------------------------
+
+	// Output buffer that digests what is written through it to another one
+	class DigestWriter : public std::streambuf {
+		std::streambuf*    m_sink;
+		dedupcodes::Hasher m_hasher;
+		uint64_t           m_size;
+
+	protected:
+		std::streamsize xsputn(char const* data, std::streamsize size) override;
+
+		int_type overflow(int_type c) override;
+
+	public:
+		uint64_t digest() const { return m_hasher.digest(); }
+
+		// Bytes written so far
+		uint64_t size() const { return m_size; }
+
+		explicit DigestWriter(std::streambuf* sink);
+	};
+
+}
+
+#endif // ARCHIVE_HXX
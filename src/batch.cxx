@@ -0,0 +1,790 @@
+/**
+ * batch.cxx
+ *
+ * Concurrent Batch Compression of Many Files
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>     // size_t
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>      // std::remove
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <algorithm>   // std::sort
+#include <unordered_map>
+#include <unordered_set>
+#include <dirent.h>    // opendir, readdir
+#include <sys/types.h> // S_ISREG, S_ISDIR
+#include <sys/stat.h>  // struct stat, mkdir
+#include "threadpool.hxx"
+#include "lzcoder.hxx"
+#include "dedup.hxx"
+#include "archive.hxx"
+#include "batch.hxx"
+
+namespace batchcodes {
+
+	options_t::options_t()
+		: operation(COMPRESS), method(blockcodes::HUFFMAN), speed_weight(blockcodes::PREFER_BALANCED), jobs(0),
+		  model(nullptr), memory_budget(0), aging_period(0), lz_level(dictcodes::DEFAULT_LEVEL),
+		  lz_window(dictcodes::DEFAULT_WINDOW), bwt_backend(blockcodes::ARITHMETIC),
+		  filter(filtercodes::NO_FILTER), stride(filtercodes::DEFAULT_STRIDE)
+	{ }
+
+	result_t::result_t() : ok(false), isize(0), osize(0), elapsed_ns(0)
+	{ }
+
+	dedup_report_t::dedup_report_t() : ok(false), chunks(0), unique_chunks(0), deduplicated_bytes(0), isize(0), osize(0)
+	{ }
+
+	archive_report_t::archive_report_t() : ok(false), entries(0), size(0)
+	{ }
+
+	// ------------------------------------------------------
+	// ----------------------- PATHS ------------------------
+	// ------------------------------------------------------
+
+	static bool ends_with(std::string const& s, std::string const& suffix) {
+		return s.size() >= suffix.size() && !s.compare(s.size() - suffix.size(), suffix.size(), suffix);
+	}
+
+	static std::string basename(std::string const& path) {
+		size_t slash = path.find_last_of('/');
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+
+	static std::string join(std::string const& dir, std::string const& name) {
+		if (dir.empty() || ends_with(dir, "/")) return dir + name;
+		return dir + '/' + name;
+	}
+
+	// Output name of a file: "name" -> "name.lc" when compressing, "name.lc" -> "name" (or any other
+	// "name" -> "name.out") when decompressing
+	static std::string output_name(std::string const& name, operation_t operation) {
+		if (operation == COMPRESS) return name + SUFFIX;
+		if (ends_with(name, SUFFIX)) return name.substr(0, name.size() - std::strlen(SUFFIX));
+		return name + ".out";
+	}
+
+	// Creates every missing directory on the way to the file
+	static bool make_parent_dirs(std::string const& path) {
+		for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+			std::string dir = path.substr(0, slash);
+			if (mkdir(dir.c_str(), 0755) && errno != EEXIST)
+				return false;
+		}
+
+		return true;
+	}
+
+	// Recursively collects regular files under dir as paths relative to it
+	static bool walk_dir(std::string const& root, std::string const& rel, std::vector<std::string>& files) {
+		std::string dir = rel.empty() ? root : join(root, rel);
+
+		DIR* dp = opendir(dir.c_str());
+		if (!dp) return false;
+
+		std::vector<std::string> names;
+		while (struct dirent* entry = readdir(dp))
+			if (std::strcmp(entry->d_name, ".") && std::strcmp(entry->d_name, ".."))
+				names.push_back(entry->d_name);
+
+		closedir(dp);
+
+		// Sorted, so that the job order (and the report) does not depend on the file system
+		std::sort(names.begin(), names.end());
+
+		for (const auto& name : names) {
+			std::string child = rel.empty() ? name : join(rel, name);
+			struct stat s;
+
+			if (stat(join(root, child).c_str(), &s)) continue;
+
+			if (S_ISDIR(s.st_mode)) walk_dir(root, child, files);
+			else if (S_ISREG(s.st_mode)) files.push_back(child);
+		}
+
+		return true;
+	}
+
+	std::vector<job_t> plan_jobs(std::vector<std::string> const& paths, options_t const& options, std::vector<result_t>& failures) {
+		std::vector<job_t> jobs;
+
+		for (const auto& path : paths) {
+			struct stat s;
+
+			if (stat(path.c_str(), &s)) {
+				result_t failure;
+				failure.ipath = path;
+				failure.error = std::strerror(errno);
+				failures.push_back(failure);
+				continue;
+			}
+
+			if (S_ISREG(s.st_mode)) {
+				job_t job;
+				job.ipath = path;
+				job.opath = options.out_dir.empty() ? output_name(path, options.operation)
+				                                    : join(options.out_dir, output_name(basename(path), options.operation));
+				jobs.push_back(job);
+			}
+			else if (S_ISDIR(s.st_mode)) {
+				std::vector<std::string> files;
+
+				if (!walk_dir(path, "", files)) {
+					result_t failure;
+					failure.ipath = path;
+					failure.error = std::strerror(errno);
+					failures.push_back(failure);
+					continue;
+				}
+
+				// Within trees pick only what the operation applies to, so that reruns skip earlier outputs
+				for (const auto& file : files) {
+					if (ends_with(file, SUFFIX) != (options.operation == DECOMPRESS)) continue;
+
+					job_t job;
+					job.ipath = join(path, file);
+					job.opath = output_name(options.out_dir.empty() ? job.ipath : join(options.out_dir, file), options.operation);
+					jobs.push_back(job);
+				}
+			}
+			else {
+				result_t failure;
+				failure.ipath = path;
+				failure.error = "Not a regular file or directory";
+				failures.push_back(failure);
+			}
+		}
+
+		return jobs;
+	}
+
+	// ------------------------------------------------------
+	// ------------------------ RUN -------------------------
+	// ------------------------------------------------------
+
+	static size_t workers(options_t const& options) {
+		return options.jobs ? options.jobs : concurrency::hardware_workers();
+	}
+
+	static void configure(blockcodes::bcoder& coder, options_t const& options, size_t sharers) {
+		coder.set_memory_budget(options.memory_budget, sharers);
+		if (options.aging_period) coder.set_aging(options.aging_period);
+		coder.set_lz77(options.lz_level, options.lz_window);
+		coder.set_bwt_backend(options.bwt_backend);
+		coder.set_filter(options.filter, options.stride);
+	}
+
+	static uint64_t elapsed_since(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Runners on the scheduler take the jobs in order, as many of them as the memory budget is shared by
+	template<typename Run>
+	static std::vector<result_t> run_all(std::vector<job_t> const& jobs, options_t const& options, Run const& run) {
+		std::vector<result_t> results(jobs.size());
+		std::atomic<size_t>   next(0);
+
+		concurrency::TaskGroup runners(concurrency::scheduler());
+
+		for (size_t i = 0; i < workers(options) && i < jobs.size(); ++i)
+			runners.run([&] {
+				for (size_t job = next++; job < jobs.size(); job = next++)
+					results[job] = run(jobs[job]);
+			});
+
+		runners.wait();
+		return results;
+	}
+
+	result_t run_job(job_t const& job, options_t const& options) {
+		result_t result;
+		result.ipath = job.ipath;
+		result.opath = job.opath;
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::ifstream ifile(job.ipath, std::ios::binary);
+		if (!ifile.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		if (!make_parent_dirs(job.opath)) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		std::ofstream ofile(job.opath, std::ios::binary);
+		if (!ofile.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		if (options.operation == COMPRESS) {
+			blockcodes::bcoder coder(options.method, blockcodes::DEFAULT_BLOCK_SIZE, options.speed_weight, options.model);
+			configure(coder, options, workers(options));
+			coder(ifile, ofile);
+			result.stats = coder.stats();
+			result.ok    = coder.good();
+			if (!result.ok) result.error = blockcodes::error_message(coder.error());
+		}
+		else {
+			blockcodes::bdecoder decoder(options.model);
+			decoder.set_memory_budget(options.memory_budget, workers(options));
+			decoder(ifile, ofile);
+			result.stats = decoder.stats();
+			result.ok    = decoder.good();
+			if (!result.ok) result.error = "Malformed or truncated compressed file";
+		}
+
+		if (result.ok && !ofile.flush()) {
+			result.ok    = false;
+			result.error = "Write error";
+		}
+
+		ifile.clear();
+		ifile.seekg(0, std::ios::end);
+		result.isize = ifile.tellg();
+		result.osize = ofile.tellp();
+
+		ofile.close();
+		if (!result.ok) std::remove(job.opath.c_str());
+
+		result.elapsed_ns = elapsed_since(start);
+		return result;
+	}
+
+	std::vector<result_t> run_jobs(std::vector<job_t> const& jobs, options_t const& options) {
+		return run_all(jobs, options, [&](job_t const& job) { return run_job(job, options); });
+	}
+
+	// Every job fails with the error, outputs written before are removed
+	static void fail_all(std::vector<result_t>& results, std::vector<job_t> const& jobs, std::string const& error) {
+		results.resize(jobs.size());
+
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			if (results[i].ok) std::remove(jobs[i].opath.c_str());
+
+			results[i].ipath = jobs[i].ipath;
+			results[i].opath = jobs[i].opath;
+			results[i].ok    = false;
+			results[i].error = error;
+		}
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- DEDUP ------------------------
+	// ------------------------------------------------------
+
+	// Chunks the input into the store and writes its recipe
+	static result_t add_job(job_t const& job, dedupcodes::ChunkStore& store) {
+		result_t result;
+		result.ipath = job.ipath;
+		result.opath = job.opath;
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::ifstream ifile(job.ipath, std::ios::binary);
+		if (!ifile.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		dedupcodes::recipe_t recipe;
+		if (!store.add(ifile, recipe)) {
+			result.error = "Read error";
+			return result;
+		}
+
+		if (!make_parent_dirs(job.opath)) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		std::ofstream ofile(job.opath, std::ios::binary);
+		if (!ofile.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		dedupcodes::write_recipe(ofile, recipe);
+
+		result.ok    = static_cast<bool>(ofile.flush());
+		result.isize = recipe.size;
+		result.osize = ofile.tellp();
+
+		ofile.close();
+		if (!result.ok) {
+			result.error = "Write error";
+			std::remove(job.opath.c_str());
+		}
+
+		result.elapsed_ns = elapsed_since(start);
+		return result;
+	}
+
+	// Rebuilds the file of a recipe from the decoded store text
+	static result_t rebuild_job(job_t const& job, std::string const& text_path, uint64_t text_size) {
+		result_t result;
+		result.ipath = job.ipath;
+		result.opath = job.opath;
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::ifstream ifile(job.ipath, std::ios::binary);
+		if (!ifile.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		dedupcodes::recipe_t recipe;
+		if (!dedupcodes::read_recipe(ifile, recipe)) {
+			result.error = "Not a deduplicated file";
+			return result;
+		}
+
+		std::ifstream text(text_path, std::ios::binary);
+		if (!text.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		if (!make_parent_dirs(job.opath)) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		std::ofstream ofile(job.opath, std::ios::binary);
+		if (!ofile.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		result.ok = dedupcodes::rebuild(recipe, text, text_size, ofile, result.error);
+		if (result.ok && !ofile.flush()) {
+			result.ok    = false;
+			result.error = "Write error";
+		}
+
+		ifile.clear();
+		ifile.seekg(0, std::ios::end);
+		result.isize = ifile.tellg();
+		result.osize = recipe.size;
+
+		ofile.close();
+		if (!result.ok) std::remove(job.opath.c_str());
+
+		result.elapsed_ns = elapsed_since(start);
+		return result;
+	}
+
+	// Inputs go through the store one by one, so that the store text (and with it every output) does not
+	// depend on timing; the store is coded by the only coder of the process, pipelined
+	static std::vector<result_t> dedup_compress(std::vector<job_t> const& jobs, options_t const& options, dedup_report_t& report) {
+		std::vector<result_t> results;
+		std::string           text_path = options.dedup_store + ".tmp";
+
+		std::fstream text(text_path, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+		if (!text.is_open()) {
+			report.error = std::strerror(errno);
+			fail_all(results, jobs, "Chunk store: " + report.error);
+			return results;
+		}
+
+		dedupcodes::ChunkStore store(text);
+
+		for (const auto& job : jobs)
+			results.push_back(add_job(job, store));
+
+		report.chunks             = store.chunks();
+		report.unique_chunks      = store.unique_chunks();
+		report.deduplicated_bytes = store.deduplicated_bytes();
+		report.isize              = store.size();
+
+		std::ofstream sfile;
+		if (!text.flush() || !make_parent_dirs(options.dedup_store) ||
+		    (sfile.open(options.dedup_store, std::ios::binary), !sfile.is_open())) {
+			report.error = std::strerror(errno);
+		}
+		else {
+			text.seekg(0);
+
+			blockcodes::bcoder coder(options.method, blockcodes::DEFAULT_BLOCK_SIZE, options.speed_weight, options.model);
+			configure(coder, options, 1);
+			coder.set_pipeline(workers(options));
+			coder(text, sfile);
+
+			report.stats = coder.stats();
+			report.ok = coder.good();
+			if (report.ok) report.osize = sfile.tellp();
+			else           report.error = blockcodes::error_message(coder.error());
+
+			sfile.close();
+			if (!report.ok) std::remove(options.dedup_store.c_str());
+		}
+
+		text.close();
+		std::remove(text_path.c_str());
+
+		if (!report.ok) fail_all(results, jobs, "Chunk store: " + report.error);
+		return results;
+	}
+
+	static std::vector<result_t> dedup_decompress(std::vector<job_t> const& jobs, options_t const& options, dedup_report_t& report) {
+		std::vector<result_t> results;
+		std::string           text_path = options.dedup_store + ".tmp";
+
+		std::ifstream sfile(options.dedup_store, std::ios::binary);
+		std::ofstream text;
+
+		if (!sfile.is_open() || (text.open(text_path, std::ios::binary), !text.is_open())) {
+			report.error = std::strerror(errno);
+			fail_all(results, jobs, "Chunk store: " + report.error);
+			return results;
+		}
+
+		blockcodes::bdecoder decoder(options.model);
+		decoder.set_memory_budget(options.memory_budget);
+		decoder(sfile, text);
+
+		report.stats = decoder.stats();
+		report.ok    = decoder.good() && text.flush();
+		report.osize = text.tellp();
+		if (!decoder.good())  report.error = "Malformed or truncated compressed file";
+		else if (!report.ok) report.error = "Write error";
+
+		sfile.clear();
+		sfile.seekg(0, std::ios::end);
+		report.isize = sfile.tellg();
+		text.close();
+
+		if (report.ok)
+			results = run_all(jobs, options, [&](job_t const& job) { return rebuild_job(job, text_path, report.osize); });
+		else
+			fail_all(results, jobs, "Chunk store: " + report.error);
+
+		std::remove(text_path.c_str());
+		return results;
+	}
+
+	std::vector<result_t> run_dedup_jobs(std::vector<job_t> const& jobs, options_t const& options, dedup_report_t& report) {
+		report = dedup_report_t();
+
+		return options.operation == COMPRESS ? dedup_compress(jobs, options, report)
+		                                     : dedup_decompress(jobs, options, report);
+	}
+
+	// ------------------------------------------------------
+	// ---------------------- ARCHIVE -----------------------
+	// ------------------------------------------------------
+
+	static result_t failed(std::string const& path, std::string const& error) {
+		result_t failure;
+		failure.ipath = path;
+		failure.error = error;
+		return failure;
+	}
+
+	// A file of the archive under its entry name, unless the name is unsafe or taken
+	static void plan_entry(std::string const& path, std::unordered_set<std::string>& names, std::vector<job_t>& jobs,
+	                       std::vector<result_t>& failures) {
+		job_t job;
+		job.ipath = path;
+		job.opath = archivecodes::entry_name(path);
+
+		if (job.opath.empty())                    failures.push_back(failed(path, "Unsafe entry name"));
+		else if (!names.insert(job.opath).second) failures.push_back(failed(path, "Repeated entry name " + job.opath));
+		else                                      jobs.push_back(job);
+	}
+
+	static std::vector<job_t> plan_archive_compress(std::vector<std::string> const& paths, std::vector<result_t>& failures) {
+		std::vector<job_t>              jobs;
+		std::unordered_set<std::string> names;
+
+		for (const auto& path : paths) {
+			struct stat s;
+
+			if (stat(path.c_str(), &s)) {
+				failures.push_back(failed(path, std::strerror(errno)));
+				continue;
+			}
+
+			if (S_ISREG(s.st_mode)) plan_entry(path, names, jobs, failures);
+			else if (S_ISDIR(s.st_mode)) {
+				std::vector<std::string> files;
+
+				if (!walk_dir(path, "", files)) {
+					failures.push_back(failed(path, std::strerror(errno)));
+					continue;
+				}
+
+				for (const auto& file : files)
+					plan_entry(join(path, file), names, jobs, failures);
+			}
+			else failures.push_back(failed(path, "Not a regular file or directory"));
+		}
+
+		return jobs;
+	}
+
+	static std::vector<job_t> plan_archive_extract(std::vector<std::string> const& names, options_t const& options,
+	                                               std::vector<result_t>& failures) {
+		std::vector<job_t>                 jobs;
+		std::vector<archivecodes::entry_t> entries;
+		std::string                        error;
+
+		std::ifstream afile(options.archive, std::ios::binary);
+		if (!afile.is_open()) {
+			failures.push_back(failed(options.archive, std::strerror(errno)));
+			return jobs;
+		}
+
+		if (!archivecodes::read_directory(afile, entries, error)) {
+			failures.push_back(failed(options.archive, error));
+			return jobs;
+		}
+
+		std::unordered_set<std::string> listed;
+		std::unordered_set<std::string> planned;
+
+		for (const auto& entry : entries)
+			listed.insert(entry.name);
+
+		std::vector<std::string> wanted = names;
+		if (wanted.empty())
+			for (const auto& entry : entries)
+				wanted.push_back(entry.name);
+
+		for (const auto& name : wanted) {
+			if (!listed.count(name)) failures.push_back(failed(name, "No such entry in the archive"));
+			else if (!planned.insert(name).second) failures.push_back(failed(name, "Repeated entry name"));
+			else {
+				job_t job;
+				job.ipath = name;
+				job.opath = options.out_dir.empty() ? name : join(options.out_dir, name);
+				jobs.push_back(job);
+			}
+		}
+
+		return jobs;
+	}
+
+	std::vector<job_t> plan_archive(std::vector<std::string> const& paths, options_t const& options, std::vector<result_t>& failures) {
+		return options.operation == COMPRESS ? plan_archive_compress(paths, failures)
+		                                     : plan_archive_extract(paths, options, failures);
+	}
+
+	// Codes the input onto the end of the archive and lists it in entries, on failure nothing is written
+	static result_t add_entry(job_t const& job, options_t const& options, struct stat const* archive, std::ostream& afile,
+	                          std::vector<archivecodes::entry_t>& entries) {
+		result_t result;
+		result.ipath = job.ipath;
+		result.opath = job.opath;
+
+		auto start = std::chrono::steady_clock::now();
+
+		struct stat s;
+		if (archive && !stat(job.ipath.c_str(), &s) && s.st_dev == archive->st_dev && s.st_ino == archive->st_ino) {
+			result.error = "The archive itself";
+			return result;
+		}
+
+		std::ifstream ifile(job.ipath, std::ios::binary);
+		if (!ifile.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		// The input is digested as the coder reads it, in one pass
+		archivecodes::DigestReader digest(ifile.rdbuf());
+		std::istream               input(&digest);
+
+		archivecodes::entry_t entry;
+		entry.name   = job.opath;
+		entry.offset = afile.tellp();
+		entry.method = options.method;
+
+		blockcodes::bcoder coder(options.method, blockcodes::DEFAULT_BLOCK_SIZE, options.speed_weight, options.model);
+		configure(coder, options, 1);
+		coder.set_pipeline(workers(options));
+		coder(input, afile);
+
+		result.stats = coder.stats();
+
+		if (!coder.good()) {
+			result.error = blockcodes::error_message(coder.error());
+			return result;
+		}
+
+		entry.stored_size = static_cast<uint64_t>(afile.tellp()) - entry.offset;
+		entry.size        = digest.size();
+		entry.digest      = digest.digest();
+		entries.push_back(entry);
+
+		result.ok         = true;
+		result.isize      = entry.size;
+		result.osize      = entry.stored_size;
+		result.elapsed_ns = elapsed_since(start);
+		return result;
+	}
+
+	// Decodes the entry of the job from its offset on and checks it against the directory
+	static result_t extract_entry(job_t const& job, archivecodes::entry_t const& entry, options_t const& options) {
+		result_t result;
+		result.ipath = job.ipath;
+		result.opath = job.opath;
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::ifstream afile(options.archive, std::ios::binary);
+		if (!afile.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		if (!make_parent_dirs(job.opath)) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		std::ofstream ofile(job.opath, std::ios::binary);
+		if (!ofile.is_open()) {
+			result.error = std::strerror(errno);
+			return result;
+		}
+
+		archivecodes::DigestWriter digest(ofile.rdbuf());
+		std::ostream               output(&digest);
+
+		afile.seekg(entry.offset);
+
+		blockcodes::bdecoder decoder(options.model);
+		decoder.set_memory_budget(options.memory_budget, workers(options));
+		decoder(afile, output);
+
+		result.stats = decoder.stats();
+
+		// The container has to end where the directory says it does
+		if (!decoder.good() || static_cast<uint64_t>(afile.tellg()) != entry.offset + entry.stored_size)
+			result.error = "Malformed or truncated entry";
+		else if (digest.size() != entry.size || digest.digest() != entry.digest)
+			result.error = "Checksum mismatch";
+		else if (!ofile.flush())
+			result.error = "Write error";
+		else
+			result.ok = true;
+
+		result.isize = entry.stored_size;
+		result.osize = digest.size();
+
+		ofile.close();
+		if (!result.ok) std::remove(job.opath.c_str());
+
+		result.elapsed_ns = elapsed_since(start);
+		return result;
+	}
+
+	// Entries go into the archive in the order of jobs, each coded by the only coder of the process, pipelined
+	static std::vector<result_t> archive_compress(std::vector<job_t> const& jobs, options_t const& options, archive_report_t& report) {
+		std::vector<result_t> results;
+
+		std::ofstream afile;
+		if (!make_parent_dirs(options.archive) || (afile.open(options.archive, std::ios::binary), !afile.is_open())) {
+			report.error = std::strerror(errno);
+			fail_all(results, jobs, "Archive: " + report.error);
+			return results;
+		}
+
+		// So that an archive written into one of the trees archived is not taken into itself
+		struct stat archive;
+		bool        known = !stat(options.archive.c_str(), &archive);
+
+		std::vector<archivecodes::entry_t> entries;
+		archivecodes::write_header(afile);
+
+		for (const auto& job : jobs)
+			results.push_back(add_entry(job, options, known ? &archive : nullptr, afile, entries));
+
+		archivecodes::write_directory(afile, entries);
+
+		report.ok      = static_cast<bool>(afile.flush());
+		report.entries = entries.size();
+		report.size    = afile.tellp();
+
+		afile.close();
+
+		if (!report.ok) {
+			report.error = "Write error";
+			std::remove(options.archive.c_str());
+			fail_all(results, jobs, "Archive: " + report.error);
+		}
+
+		return results;
+	}
+
+	// The directory is read once, then every worker opens the archive on its own and seeks to its entries
+	static std::vector<result_t> archive_extract(std::vector<job_t> const& jobs, options_t const& options, archive_report_t& report) {
+		std::vector<result_t>              results;
+		std::vector<archivecodes::entry_t> entries;
+
+		std::ifstream afile(options.archive, std::ios::binary);
+		if (!afile.is_open()) report.error = std::strerror(errno);
+		else if (archivecodes::read_directory(afile, entries, report.error)) report.ok = true;
+
+		if (!report.ok) {
+			fail_all(results, jobs, "Archive: " + report.error);
+			return results;
+		}
+
+		afile.clear();
+		afile.seekg(0, std::ios::end);
+		report.size    = afile.tellg();
+		report.entries = entries.size();
+		afile.close();
+
+		std::unordered_map<std::string, archivecodes::entry_t const*> by_name;
+		for (const auto& entry : entries)
+			by_name.insert({ entry.name, &entry });
+
+		return run_all(jobs, options, [&](job_t const& job) {
+			auto found = by_name.find(job.ipath);
+			return found == by_name.end() ? failed(job.ipath, "No such entry in the archive")
+			                              : extract_entry(job, *found->second, options);
+		});
+	}
+
+	std::vector<result_t> run_archive_jobs(std::vector<job_t> const& jobs, options_t const& options, archive_report_t& report) {
+		report = archive_report_t();
+
+		return options.operation == COMPRESS ? archive_compress(jobs, options, report)
+		                                     : archive_extract(jobs, options, report);
+	}
+
+}
@@ -0,0 +1,141 @@
+/**
+ * batch.hxx
+ *
+ * Concurrent Batch Compression of Many Files
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef BATCH_HXX
+#define BATCH_HXX
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "blocks.hxx"
+#include "instrument.hxx"
+#include "models.hxx"
+
+namespace batchcodes {
+
+	enum operation_t { COMPRESS, DECOMPRESS };
+
+	// Suffix appended to compressed files and stripped from decompressed ones
+	static constexpr char const* SUFFIX = ".lc";
+
+	struct options_t {
+		operation_t                operation;
+		blockcodes::method_t       method;        // compressing only
+		double                     speed_weight;  // compressing with AUTO only
+		size_t                     jobs;          // jobs run at once, 0 means one per hardware thread
+		std::string                out_dir;       // empty means next to the inputs
+		sharedmodels::Model const* model;         // shared model or nullptr
+		uint64_t                   memory_budget; // bytes shared by all the workers, 0 means no limit
+		uint64_t                   aging_period;  // wahuffman only, 0 means the default
+		int                        lz_level;      // lz77 only
+		size_t                     lz_window;     // lz77 only
+		blockcodes::method_t       bwt_backend;   // bwt only
+		filtercodes::filter_t      filter;        // compressing only
+		size_t                     stride;        // delta filter only
+		std::string                dedup_store;   // chunk store of deduplicating runs, empty means no deduplication
+		std::string                archive;       // archive of archiving runs, empty means a file per input
+
+		options_t();
+	};
+
+	struct job_t {
+		std::string ipath;
+		std::string opath;
+	};
+
+	struct result_t {
+		std::string            ipath;
+		std::string            opath;
+		bool                   ok;
+		std::string            error;
+		uint64_t               isize;
+		uint64_t               osize;
+		uint64_t               elapsed_ns;
+		instrumentation::Stats stats;
+
+		result_t();
+	};
+
+	// Chunk store of a deduplicating run: isize and osize are those of its text and the compressed store
+	// when compressing, the other way round when decompressing
+	struct dedup_report_t {
+		bool                   ok;
+		std::string            error;
+		uint64_t               chunks;             // compressing only
+		uint64_t               unique_chunks;      // compressing only
+		uint64_t               deduplicated_bytes; // compressing only
+		uint64_t               isize;
+		uint64_t               osize;
+		instrumentation::Stats stats;              // of coding the store
+
+		dedup_report_t();
+	};
+
+	// Archive of an archiving run, the files are reported by their jobs
+	struct archive_report_t {
+		bool        ok;
+		std::string error;
+		uint64_t    entries; // written to the archive or listed in it
+		uint64_t    size;    // of the archive
+
+		archive_report_t();
+	};
+
+	// Expands regular files and directory trees (walked recursively) into jobs. Outputs go next to the inputs
+	// or under out_dir, keeping paths relative to the given directories. Paths that cannot be read are
+	// reported in failures
+	std::vector<job_t> plan_jobs(std::vector<std::string> const& paths, options_t const& options, std::vector<result_t>& failures);
+
+	// Compresses or decompresses a single file in the calling thread, a failed job leaves no output file
+	result_t run_job(job_t const& job, options_t const& options);
+
+	// Runs the jobs on the scheduler, options.jobs of them at once, results come in the order of jobs
+	std::vector<result_t> run_jobs(std::vector<job_t> const& jobs, options_t const& options);
+
+	// Runs the jobs through the chunk store at options.dedup_store. Compressing chunks the inputs in the order of
+	// jobs (see dedupcodes::ChunkStore), writes the recipe of every file as its output and compresses the store
+	// text, pipelined on the scheduler; decompressing decodes the store first and then rebuilds the files from
+	// their recipes, options.jobs of them at once. If the store fails, every job fails
+	std::vector<result_t> run_dedup_jobs(std::vector<job_t> const& jobs, options_t const& options, dedup_report_t& report);
+
+	// Plans an archiving run on options.archive. Compressing, the inputs are regular files and directory trees as
+	// for plan_jobs, every job has its file as ipath and its entry name (see archivecodes::entry_name) as opath;
+	// extracting, the paths are the names of the entries to extract, all of them if none are given, and every
+	// job has its entry name as ipath and its output under out_dir as opath. Missing entries, unsafe and
+	// repeated names are reported in failures
+	std::vector<job_t> plan_archive(std::vector<std::string> const& paths, options_t const& options, std::vector<result_t>& failures);
+
+	// Runs archive jobs. Compressing codes the inputs one after the other into options.archive, each pipelined on
+	// the scheduler, and writes the central directory after them; extracting decodes the entries options.jobs
+	// at once, every one read by seeking to it, and checks its size and digest. If the archive fails, every job
+	// fails
+	std::vector<result_t> run_archive_jobs(std::vector<job_t> const& jobs, options_t const& options, archive_report_t& report);
+
+}
+
+#endif // BATCH_HXX
@@ -26,19 +26,22 @@
  */
 
 #include <iostream>
-#include <fstream>
 #include <cstdlib> // size_t
 #include <cstdint>
 #include <cstring>
 #include <cerrno>
 #include <vector>
 #include <queue>
+#include <memory>
 #include <utility> // std::pair
 #include <climits> // CHAR_BIT
 #include "bhcoder.hxx"
+#include "cache.hxx"
 
 namespace contextcodes {
 
+	using namespace instrumentation;
+
 	using freq_vec_t     = typename std::vector<uint32_t>;
 	using freq_table_t   = typename std::vector<freq_vec_t>;
 	using scheme_vec_t   = typename std::vector<std::vector<bool> >;
@@ -57,7 +60,7 @@ namespace contextcodes {
 		freq_table_t m_freq_table;
 		uint64_t     m_total_chars;
 
-		void create_freq_vector(std::ifstream& ifile) {
+		void create_freq_vector(std::istream& ifile) {
 			m_freq_vec.clear();
 			m_freq_vec.resize(ALPHABET, 0);
 
@@ -80,7 +83,8 @@ namespace contextcodes {
 				++m_freq_vec[static_cast<uint8_t>(c)];
 				++m_freq_table[static_cast<uint8_t>(context)][static_cast<uint8_t>(c)];
 
-				++m_total_chars;
+				// A text longer than 32-bit counts hold is refused, there is no use in reading the rest of it
+				if (++m_total_chars > UINT32_MAX) return;
 				context = c;
 			}
 		}
@@ -171,6 +175,40 @@ namespace contextcodes {
 		tree_t       m_tree;
 		scheme_vec_t m_scheme_vec;
 
+		struct tables_t {
+			tree_t       tree;
+			scheme_vec_t scheme;
+		};
+
+		// Same as create_code_scheme, but copies the tree and the scheme from the model cache if they were built
+		// before for the key. "context" is the previous byte, ALPHABET for the table of the first byte
+		void cached_code_scheme(freq_vec_t& m_freq_vec, sharedmodels::Model const* model, size_t context, Stats& stats) {
+			modelcache::ModelCache& cache = modelcache::ModelCache::instance();
+			modelcache::key_t key = model ? modelcache::model_key("bhuffman", model->id(), context)
+			                              : modelcache::histogram_key("bhuffman", &m_freq_vec[0], m_freq_vec.size());
+
+			if (std::shared_ptr<tables_t const> cached = cache.find<tables_t>(key)) {
+				stats.add(CACHE_HITS_COUNTER);
+				m_tree       = cached->tree;
+				m_scheme_vec = cached->scheme;
+				return;
+			}
+
+			stats.add(CACHE_MISSES_COUNTER);
+			create_code_scheme(m_freq_vec);
+			stats.add(TREE_BUILDS_COUNTER);
+
+			std::shared_ptr<tables_t> tables = std::make_shared<tables_t>();
+			tables->tree   = m_tree;
+			tables->scheme = m_scheme_vec;
+
+			size_t bytes = sizeof(tables_t) + m_tree.size() * sizeof(Node);
+			for (const auto& code : m_scheme_vec)
+				bytes += sizeof(code) + code.size() / CHAR_BIT;
+
+			cache.insert<tables_t>(key, tables, bytes);
+		}
+
 		void create_code_scheme(freq_vec_t& m_freq_vec) {
 			m_scheme_vec.clear();
 			m_scheme_vec.resize(ALPHABET);
@@ -191,11 +229,23 @@ namespace contextcodes {
 	// -------------------------------------------------------
 
 	class bhcoder::CoderImpl : private Statistics, private huffman {
-		scheme_table_t m_scheme_table;
-		bitseq_t       m_seq;
-		char           m_context;
+		scheme_table_t             m_scheme_table;
+		bitseq_t                   m_seq;
+		char                       m_context;
+		Stats                      m_stats;
+		sharedmodels::Model const* m_model;
+		bool                       m_good;
+
+		// Replaces the tables of the text with the ones of the shared model (only for contexts the text has)
+		void load_freq_tables() {
+			m_freq_vec.assign(m_model->order0(), m_model->order0() + ALPHABET);
+
+			for (size_t i = 0; i < m_freq_table.size(); ++i)
+				if (!m_freq_table[i].empty())
+					m_freq_table[i].assign(m_model->order1(i), m_model->order1(i) + ALPHABET);
+		}
 
-		void encode_first_byte(std::ifstream& ifile) {
+		void encode_first_byte(std::istream& ifile) {
 			m_seq.clear();
 			
 			ifile.clear();
@@ -213,7 +263,7 @@ namespace contextcodes {
 			}
 		}
 
-		void create_bit_sequence(std::ifstream& ifile) {
+		void create_bit_sequence(std::istream& ifile) {
 			char c;
 			while (ifile.read(&c, sizeof(c))) {
 				m_seq.insert(
@@ -227,40 +277,80 @@ namespace contextcodes {
 		}
 
 	public:
-		void compress(std::ifstream& ifile, std::ofstream& ofile) {
-			create_freq_vector(ifile);
-			create_code_scheme(m_freq_vec);
-			encode_first_byte(ifile);
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+			m_good = true;
+
+			{
+				ScopedTimer timer(m_stats, STATISTICS_STAGE);
+				create_freq_vector(ifile);
+				if (m_model) load_freq_tables();
+			}
+
+			// Counts are 32-bit, longer texts go through the block container
+			if (m_total_chars > UINT32_MAX) {
+				std::cerr << "bhcoder::compress: Text too long for one frequency table, code it in blocks" << std::endl;
+				m_good = false;
+				return;
+			}
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				cached_code_scheme(m_freq_vec, m_model, ALPHABET, m_stats);
+			}
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+				encode_first_byte(ifile);
+			}
+
 			m_tree.clear();
 
-			for (const auto& freq : m_freq_vec)
-				ofile.write(reinterpret_cast<const char*>(&freq), sizeof(freq));
+			if (!m_model) {
+				ScopedTimer timer(m_stats, OUTPUT_STAGE);
+				for (const auto& freq : m_freq_vec)
+					ofile.write(reinterpret_cast<const char*>(&freq), sizeof(freq));
+			}
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
 
-			m_scheme_table.clear();
-			m_scheme_table.resize(ALPHABET);
+				m_scheme_table.clear();
+				m_scheme_table.resize(ALPHABET);
 
-			for (size_t i = 0; i < m_freq_table.size(); ++i) {
-				if (!m_freq_table[i].empty()) {
-					create_code_scheme(m_freq_table[i]);
-					m_scheme_table[i].clear();
-					m_scheme_table[i].insert(m_scheme_table[i].end(), m_scheme_vec.begin(), m_scheme_vec.end());
-					m_tree.clear();
+				for (size_t i = 0; i < m_freq_table.size(); ++i) {
+					if (!m_freq_table[i].empty()) {
+						cached_code_scheme(m_freq_table[i], m_model, i, m_stats);
+						m_scheme_table[i].clear();
+						m_scheme_table[i].insert(m_scheme_table[i].end(), m_scheme_vec.begin(), m_scheme_vec.end());
+						m_tree.clear();
+					}
 				}
 			}
 
-			create_bit_sequence(ifile);
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+				create_bit_sequence(ifile);
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, m_total_chars);
+			m_stats.add(BITS_COUNTER, m_seq.size());
 
-			size_t num_not_empty = 0;
-			for (const auto& freq_vec : m_freq_table)
-				if (!freq_vec.empty())
-					++num_not_empty;
-			ofile.write(reinterpret_cast<const char*>(&num_not_empty), sizeof(num_not_empty));
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
 
-			for (size_t context = 0; context < m_freq_table.size(); ++context) {
-				if (!m_freq_table[context].empty()) {
-					ofile.write(reinterpret_cast<const char*>(&context), sizeof(context));
-					for (const auto& freq : m_freq_table[context])
-						ofile.write(reinterpret_cast<const char*>(&freq), sizeof(freq));
+			if (!m_model) {
+				size_t num_not_empty = 0;
+				for (const auto& freq_vec : m_freq_table)
+					if (!freq_vec.empty())
+						++num_not_empty;
+				ofile.write(reinterpret_cast<const char*>(&num_not_empty), sizeof(num_not_empty));
+
+				for (size_t context = 0; context < m_freq_table.size(); ++context) {
+					if (!m_freq_table[context].empty()) {
+						ofile.write(reinterpret_cast<const char*>(&context), sizeof(context));
+						for (const auto& freq : m_freq_table[context])
+							ofile.write(reinterpret_cast<const char*>(&freq), sizeof(freq));
+					}
 				}
 			}
 
@@ -280,30 +370,53 @@ namespace contextcodes {
 			if (bit_counter) ofile.write(reinterpret_cast<const char*>(&bit_buffer), sizeof(bit_buffer));
 		}
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile) {
+		void operator()(std::istream& ifile, std::ostream& ofile) {
 			compress(ifile, ofile);
 		}
 
-		CoderImpl(std::ifstream& ifile, std::ofstream& ofile) {
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		bool good() const {
+			return m_good;
+		}
+
+		CoderImpl(std::istream& ifile, std::ostream& ofile) : m_model(nullptr), m_good(true) {
 			compress(ifile, ofile);
 		}
 
-		CoderImpl()
+		CoderImpl(sharedmodels::Model const& model) : m_model(&model), m_good(true)
+		{ }
+
+		CoderImpl() : m_model(nullptr), m_good(true)
 		{ }
 	};
 
-	void bhcoder::compress(std::ifstream& ifile, std::ofstream& ofile) {
+	void bhcoder::compress(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->compress(ifile, ofile);
 	}
 
-	void bhcoder::operator()(std::ifstream& ifile, std::ofstream& ofile) {
+	void bhcoder::operator()(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->operator()(ifile, ofile);
 	}
 
-	bhcoder::bhcoder(std::ifstream& ifile, std::ofstream& ofile)
+	Stats const& bhcoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bool bhcoder::good() const {
+		return m_pImpl->good();
+	}
+
+	bhcoder::bhcoder(std::istream& ifile, std::ostream& ofile)
 		: m_pImpl(new CoderImpl(ifile, ofile))
 	{ }
 
+	bhcoder::bhcoder(sharedmodels::Model const& model)
+		: m_pImpl(new CoderImpl(model))
+	{ }
+
 	bhcoder::bhcoder() : m_pImpl(new CoderImpl)
 	{ }
 
@@ -315,10 +428,24 @@ namespace contextcodes {
 	// -------------------------------------------------------
 
 	class bhdecoder::DecoderImpl : private Statistics, private huffman {
-		forest_t m_forest;
-		char     m_context;
+		forest_t                   m_forest;
+		char                       m_context;
+		Stats                      m_stats;
+		uint64_t                   m_cnt_bits;
+		sharedmodels::Model const* m_model;
+		uint64_t                   m_symbols;
+
+		// A shared model has tables for every context, so their trees are built on first use only
+		void build_context_tree(uint8_t context) {
+			if (!m_model || !m_forest[context].empty()) return;
+
+			freq_vec_t freq_vec(m_model->order1(context), m_model->order1(context) + ALPHABET);
+			cached_code_scheme(freq_vec, m_model, context, m_stats);
+			m_forest[context].swap(m_tree);
+			m_tree.clear();
+		}
 
-		std::pair<char, int> decode_first_byte(std::ifstream& ifile, std::ofstream& ofile) {
+		std::pair<char, int> decode_first_byte(std::istream& ifile, std::ostream& ofile) {
 			char   curr_byte;
 			int    curr_index  = m_tree.size() - 1;
 			size_t bit_counter = 0;
@@ -327,6 +454,7 @@ namespace contextcodes {
 
 			while (true) {
 				bool curr_bit = curr_byte & (1 << (7 - bit_counter));
+				++m_cnt_bits;
 
 				if (!curr_bit) curr_index = m_tree[curr_index].left;
 				else           curr_index = m_tree[curr_index].right;
@@ -351,30 +479,44 @@ namespace contextcodes {
 		}
 
 	public:
-		void decompress(std::ifstream& ifile, std::ofstream& ofile) {
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+			m_cnt_bits = 0;
+
 			m_freq_vec.clear();
 			m_total_chars = 0;
 
-			for (size_t i = 0; i < ALPHABET; ++i) {
-				uint32_t tmp;
-				ifile.read(reinterpret_cast<char*>(&tmp), sizeof(tmp));
-				m_freq_vec.push_back(tmp);
-				m_total_chars += tmp;
+			if (m_model) {
+				m_freq_vec.assign(m_model->order0(), m_model->order0() + ALPHABET);
+				m_freq_table.clear();
+				m_freq_table.resize(ALPHABET);
+				m_total_chars = m_symbols;
+				if (!m_symbols) return;
 			}
+			else {
+				ScopedTimer timer(m_stats, INPUT_STAGE);
 
-			m_freq_table.clear();
-			m_freq_table.resize(ALPHABET);
-
-			size_t num_not_empty;
-			ifile.read(reinterpret_cast<char*>(&num_not_empty), sizeof(num_not_empty));
-
-			for (size_t i = 0; i < num_not_empty; ++i) {
-				size_t context;
-				ifile.read(reinterpret_cast<char*>(&context), sizeof(context));
-				for (size_t j = 0; j < ALPHABET; ++j) {
+				for (size_t i = 0; i < ALPHABET; ++i) {
 					uint32_t tmp;
 					ifile.read(reinterpret_cast<char*>(&tmp), sizeof(tmp));
-					m_freq_table[context].push_back(tmp);
+					m_freq_vec.push_back(tmp);
+					m_total_chars += tmp;
+				}
+
+				m_freq_table.clear();
+				m_freq_table.resize(ALPHABET);
+
+				size_t num_not_empty;
+				ifile.read(reinterpret_cast<char*>(&num_not_empty), sizeof(num_not_empty));
+
+				for (size_t i = 0; i < num_not_empty; ++i) {
+					size_t context;
+					ifile.read(reinterpret_cast<char*>(&context), sizeof(context));
+					for (size_t j = 0; j < ALPHABET; ++j) {
+						uint32_t tmp;
+						ifile.read(reinterpret_cast<char*>(&tmp), sizeof(tmp));
+						m_freq_table[context].push_back(tmp);
+					}
 				}
 			}
 
@@ -384,24 +526,48 @@ namespace contextcodes {
 				return;
 			}
 
-			create_code_scheme(m_freq_vec);
-			std::pair<char, int> first_byte_ret = decode_first_byte(ifile, ofile);
-			if (first_byte_ret.second == -1) return;
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				cached_code_scheme(m_freq_vec, m_model, ALPHABET, m_stats);
+			}
+
+			std::pair<char, int> first_byte_ret;
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+				first_byte_ret = decode_first_byte(ifile, ofile);
+			}
+
+			m_stats.add(SYMBOLS_COUNTER);
+
+			if (first_byte_ret.second == -1) {
+				m_stats.add(BITS_COUNTER, m_cnt_bits);
+				return;
+			}
+
 			m_tree.clear();
 
-			m_forest.clear();
-			m_forest.resize(ALPHABET);
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
 
-			for (size_t i = 0; i < m_freq_table.size(); ++i) {
-				if (!m_freq_table[i].empty()) {
-					create_code_scheme(m_freq_table[i]);
-					m_forest[i].insert(m_forest[i].end(), m_tree.begin(), m_tree.end());
-					m_tree.clear();
+				m_forest.clear();
+				m_forest.resize(ALPHABET);
+
+				for (size_t i = 0; i < m_freq_table.size(); ++i) {
+					if (!m_freq_table[i].empty()) {
+						cached_code_scheme(m_freq_table[i], m_model, i, m_stats);
+						m_forest[i].insert(m_forest[i].end(), m_tree.begin(), m_tree.end());
+						m_tree.clear();
+					}
 				}
 			}
 
+			ScopedTimer timer(m_stats, CODING_STAGE);
+
+			build_context_tree(m_context);
+
 			char     curr_byte   = first_byte_ret.first;
-			int      curr_index  = m_forest[static_cast<uint8_t>(m_context)].size() - 1;;
+			int      curr_index  = m_forest[static_cast<uint8_t>(m_context)].size() - 1;
 			size_t   bit_counter = first_byte_ret.second;
 			uint64_t cnt_chars   = 1;
 
@@ -412,6 +578,7 @@ namespace contextcodes {
 
 			while (true) {
 				bool curr_bit = curr_byte & (1 << (7 - bit_counter));
+				++m_cnt_bits;
 
 				if (!curr_bit) curr_index = m_forest[static_cast<uint8_t>(m_context)][curr_index].left;
 				else           curr_index = m_forest[static_cast<uint8_t>(m_context)][curr_index].right;
@@ -425,6 +592,7 @@ namespace contextcodes {
 					m_context = symbol;
 					++cnt_chars;
 
+					build_context_tree(m_context);
 					curr_index = m_forest[static_cast<uint8_t>(m_context)].size() - 1;
 				}
 
@@ -435,32 +603,50 @@ namespace contextcodes {
 					bit_counter = 0;
 				}
 			}
+
+			m_stats.add(SYMBOLS_COUNTER, cnt_chars - 1);
+			m_stats.add(BITS_COUNTER, m_cnt_bits);
 		}
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile) {
+		void operator()(std::istream& ifile, std::ostream& ofile) {
 			decompress(ifile, ofile);
 		}
 
-		DecoderImpl(std::ifstream& ifile, std::ofstream& ofile) {
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		DecoderImpl(std::istream& ifile, std::ostream& ofile) : m_model(nullptr), m_symbols(0) {
 			decompress(ifile, ofile);
 		}
 
-		DecoderImpl()
+		DecoderImpl(sharedmodels::Model const& model, uint64_t symbols) : m_model(&model), m_symbols(symbols)
+		{ }
+
+		DecoderImpl() : m_model(nullptr), m_symbols(0)
 		{ }
 	};
 
-	void bhdecoder::decompress(std::ifstream& ifile, std::ofstream& ofile) {
+	void bhdecoder::decompress(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->decompress(ifile, ofile);
 	}
 
-	void bhdecoder::operator()(std::ifstream& ifile, std::ofstream& ofile) {
+	void bhdecoder::operator()(std::istream& ifile, std::ostream& ofile) {
 		m_pImpl->operator()(ifile, ofile);
 	}
 
-	bhdecoder::bhdecoder(std::ifstream& ifile, std::ofstream& ofile)
+	Stats const& bhdecoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bhdecoder::bhdecoder(std::istream& ifile, std::ostream& ofile)
 		: m_pImpl(new DecoderImpl(ifile, ofile))
 	{ }
 
+	bhdecoder::bhdecoder(sharedmodels::Model const& model, uint64_t symbols)
+		: m_pImpl(new DecoderImpl(model, symbols))
+	{ }
+
 	bhdecoder::bhdecoder() : m_pImpl(new DecoderImpl)
 	{ }
 
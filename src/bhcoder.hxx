@@ -29,8 +29,11 @@
 #ifndef BHCODER_HXX
 #define BHCODER_HXX
 
-#include <fstream>
+#include <iostream>
+#include <cstdint>
 #include <memory>
+#include "instrument.hxx"
+#include "models.hxx"
 
 namespace contextcodes {
 
@@ -45,11 +48,20 @@ namespace contextcodes {
 	public:
 
 		// Encodes text and writes the final bit sequence to the output file
-		void compress(std::ifstream& ifile, std::ofstream& ofile);
+		void compress(std::istream& ifile, std::ostream& ofile);
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile);
+		void operator()(std::istream& ifile, std::ostream& ofile);
 
-		bhcoder(std::ifstream& ifile, std::ofstream& ofile);
+		// Stage timers and counters of the last compress call
+		instrumentation::Stats const& stats() const;
+
+		// False if the last compress call refused a text too long for one frequency table, nothing is written then
+		bool good() const;
+
+		bhcoder(std::istream& ifile, std::ostream& ofile);
+
+		// Codes with the byte and per-context tables of a pre-trained model, so no tables are written
+		explicit bhcoder(sharedmodels::Model const& model);
 
 		bhcoder();
 
@@ -67,11 +79,17 @@ namespace contextcodes {
 	public:
 
 		// Decodes text and writes the final bit sequence to the output file
-		void decompress(std::ifstream& ifile, std::ofstream& ofile);
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last decompress call
+		instrumentation::Stats const& stats() const;
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile);
+		bhdecoder(std::istream& ifile, std::ostream& ofile);
 
-		bhdecoder(std::ifstream& ifile, std::ofstream& ofile);
+		// Decodes a text of "symbols" chars coded with the tables of the model
+		bhdecoder(sharedmodels::Model const& model, uint64_t symbols);
 
 		bhdecoder();
 
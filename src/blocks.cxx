@@ -0,0 +1,2079 @@
+/**
+ * blocks.cxx
+ *
+ * Block Container with Stored-Block Fallback
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional> // std::function
+#include <cmath>   // std::log2, std::ceil
+#include <algorithm> // std::max
+#include <climits> // CHAR_BIT
+#include "queue.hxx"
+#include "threadpool.hxx"
+#include "pcoder.hxx"
+#include "bhcoder.hxx"
+#include "ahcoder.hxx"
+#include "acoder.hxx"
+#include "ihcoder.hxx"
+#include "lzcoder.hxx"
+#include "bwcoder.hxx"
+#include "dhcoder.hxx"
+#include "wcoder.hxx"
+#include "whcoder.hxx"
+#include "cache.hxx"
+#include "blocks.hxx"
+
+namespace blockcodes {
+
+	using namespace instrumentation;
+
+	static constexpr char MAGIC[] = { 'L', 'C' };
+
+	static char const* const METHOD_NAMES[METHOD_NUM] = {
+		"stored", "shennon", "fano", "huffman", "bhuffman", "ahuffman", "arithmetic", "huffman4", "wahuffman", "lz77", "bwt",
+		"dhuffman", "huffman16", "whuffman"
+	};
+
+	char const* method_name(method_t method) {
+		if (method == AUTO)       return "auto";
+		if (method >= METHOD_NUM) return "unknown";
+		return METHOD_NAMES[method];
+	}
+
+	char const* error_message(coder_error_t error) {
+		switch (error) {
+			case CODER_OK        : return "No error";
+			case BUDGET_ERROR    : return "Memory budget too small";
+			case CONTAINER_ERROR : return "Cannot append to the container";
+			case INPUT_ERROR     : return "Read error";
+			case OUTPUT_ERROR    : return "Write error";
+			default              : return "Unknown error";
+		}
+	}
+
+	method_t method_from_name(char const* name) {
+		if (!std::strcmp(name, "auto")) return AUTO;
+
+		for (size_t i = SHENNON; i < METHOD_NUM; ++i)
+			if (!std::strcmp(name, METHOD_NAMES[i]))
+				return static_cast<method_t>(i);
+
+		return STORED;
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- VARINT -----------------------
+	// ------------------------------------------------------
+
+	void write_varint(std::ostream& ofile, uint64_t value) {
+		uint8_t buf[10];
+		size_t  len = 0;
+
+		do {
+			uint8_t byte = value & 0x7F;
+			value >>= 7;
+			if (value) byte |= 0x80;
+			buf[len++] = byte;
+		} while (value);
+
+		ofile.write(reinterpret_cast<const char*>(buf), len);
+	}
+
+	bool read_varint(std::istream& ifile, uint64_t& value) {
+		value = 0;
+
+		for (size_t shift = 0; shift < 64; shift += 7) {
+			int byte = ifile.get();
+			if (byte == EOF) return false;
+
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+
+		return false;
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- MEMORY -----------------------
+	// ------------------------------------------------------
+
+	// Memory of the process before coding anything: code, libraries, stacks
+	static constexpr uint64_t PROCESS_MEMORY = 8 << 20;
+
+	// Working memory of a thread coding a block in bytes per byte of the block (the block, its stream copy,
+	// coded output and frame when compressing; payload, stream copy and decoded text when decompressing),
+	// measured peak RSS over many blocks with headroom for buffers that grow by doubling, plus code tables that
+	// do not depend on the block size
+	struct memory_cost_t {
+		double   compress;
+		double   decompress;
+		uint64_t tables;
+	};
+
+	static constexpr memory_cost_t MEMORY_COSTS[METHOD_NUM] = {
+		{ 3.0, 2.0,       0 }, // stored
+		{ 6.0, 2.0, 1 << 20 }, // shennon
+		{ 6.0, 2.0, 1 << 20 }, // fano
+		{ 6.0, 2.0, 1 << 20 }, // huffman
+		{ 6.0, 2.0, 8 << 20 }, // bhuffman, a code tree per context
+		{ 6.0, 2.0, 1 << 20 }, // ahuffman
+		{ 6.0, 3.0, 1 << 20 }, // arithmetic, the decoder unpacks the payload to a bit vector
+		{ 7.0, 3.0, 1 << 20 }, // huffman4, the encoder holds four streams
+		{ 6.0, 2.0, 1 << 20 }, // wahuffman
+		{ 9.0, 2.0, 1 << 20 }, // lz77, hash chains and up to 12 bytes of sequence per 4-byte match
+		{ 16.0, 8.0, 1 << 20 }, // bwt, the SA-IS input, types and suffix array, then the back end, and the LF links
+		{ 6.0, 3.0, 1 << 20 }, // dhuffman, the decoder holds the payload
+		{ 6.0, 3.0, 1 << 20 }, // huffman16, frequencies and indices of 2^16 symbols
+		{ 8.0, 3.0, 1 << 20 }  // whuffman, three words per token of the text and the decoding table of whole tokens
+	};
+
+	uint64_t memory_estimate(method_t method, bool compressing, size_t block_size, size_t workers, size_t buffers) {
+		memory_cost_t cost = MEMORY_COSTS[STORED];
+
+		// Automatic selection may pick any method for a block
+		if (method == AUTO)
+			for (const auto& c : MEMORY_COSTS) {
+				if (c.compress   > cost.compress)   cost.compress   = c.compress;
+				if (c.decompress > cost.decompress) cost.decompress = c.decompress;
+				if (c.tables     > cost.tables)     cost.tables     = c.tables;
+			}
+		else if (method < METHOD_NUM)
+			cost = MEMORY_COSTS[method];
+
+		double per_worker = (compressing ? cost.compress : cost.decompress) * block_size + cost.tables;
+
+		return PROCESS_MEMORY + modelcache::ModelCache::instance().capacity() +
+		       static_cast<uint64_t>(workers * per_worker) + static_cast<uint64_t>(buffers) * block_size;
+	}
+
+	size_t budget_block_size(method_t method, uint64_t budget, size_t block_size, size_t workers, size_t buffers) {
+		// The estimate grows linearly with the block size, so the first size that fits is the largest one
+		for (size_t size = block_size / MIN_BLOCK_SIZE * MIN_BLOCK_SIZE; size >= MIN_BLOCK_SIZE; size -= MIN_BLOCK_SIZE)
+			if (memory_estimate(method, true, size, workers, buffers) <= budget)
+				return size;
+
+		return 0;
+	}
+
+	static size_t varint_size(uint64_t value) {
+		size_t len = 1;
+		while (value >>= 7) ++len;
+		return len;
+	}
+
+	// ------------------------------------------------------
+	// ---------------------- DISPATCH ----------------------
+	// ------------------------------------------------------
+
+	using sharedmodels::Model;
+
+	template<typename Coder>
+	void run_coder(std::istream& ifile, std::ostream& ofile, Stats& stats) {
+		Coder coder;
+		coder(ifile, ofile);
+		stats += coder.stats();
+	}
+
+	template<typename Coder>
+	void run_coder(std::istream& ifile, std::ostream& ofile, Stats& stats, Model const* model) {
+		if (!model) return run_coder<Coder>(ifile, ofile, stats);
+
+		Coder coder(*model);
+		coder(ifile, ofile);
+		stats += coder.stats();
+	}
+
+	// Decoders with a shared model learn the length of the block from the container
+	template<typename Decoder>
+	void run_decoder(std::istream& ifile, std::ostream& ofile, Stats& stats, Model const* model, uint64_t raw_size) {
+		if (!model) return run_coder<Decoder>(ifile, ofile, stats);
+
+		Decoder decoder(*model, raw_size);
+		decoder(ifile, ofile);
+		stats += decoder.stats();
+	}
+
+	// Settings of the methods that have any
+	struct tuning_t {
+		uint64_t aging_period; // wahuffman
+		int      lz_level;     // lz77
+		size_t   lz_window;    // lz77
+
+		sortcodes::backend_t bwt_backend; // bwt
+
+		tuning_t()
+			: aging_period(adaptivecodes::DEFAULT_AGING_PERIOD), lz_level(dictcodes::DEFAULT_LEVEL),
+			  lz_window(dictcodes::DEFAULT_WINDOW), bwt_backend(sortcodes::DEFAULT_BACKEND)
+		{ }
+	};
+
+	static void run_bw_coder(std::istream& ifile, std::ostream& ofile, Stats& stats, tuning_t const& tuning) {
+		sortcodes::bwcoder coder;
+		coder.set_backend(tuning.bwt_backend);
+		coder(ifile, ofile);
+		stats += coder.stats();
+	}
+
+	// The block length bounds the runs of bwt blocks, with or without a model
+	static void run_bw_decoder(std::istream& ifile, std::ostream& ofile, Stats& stats, uint64_t raw_size) {
+		sortcodes::bwdecoder decoder;
+		decoder.set_limit(raw_size);
+		decoder(ifile, ofile);
+		stats += decoder.stats();
+	}
+
+	static void run_lz_coder(std::istream& ifile, std::ostream& ofile, Stats& stats, tuning_t const& tuning) {
+		dictcodes::lzcoder coder;
+		coder.set_level(tuning.lz_level, tuning.lz_window);
+		coder(ifile, ofile);
+		stats += coder.stats();
+	}
+
+	// Payloads of wahuffman start with the aging period, so that the decoder ages the tree in step
+	static void run_aged_coder(std::istream& ifile, std::ostream& ofile, Stats& stats, Model const* model, uint64_t period) {
+		std::unique_ptr<adaptivecodes::ahcoder> coder(model ? new adaptivecodes::ahcoder(*model) : new adaptivecodes::ahcoder);
+
+		write_varint(ofile, period);
+		coder->set_aging(period);
+		coder->compress(ifile, ofile);
+		stats += coder->stats();
+	}
+
+	static void run_aged_decoder(std::istream& ifile, std::ostream& ofile, Stats& stats, Model const* model, uint64_t raw_size) {
+		std::unique_ptr<adaptivecodes::ahdecoder> decoder(model ? new adaptivecodes::ahdecoder(*model, raw_size)
+		                                                        : new adaptivecodes::ahdecoder);
+
+		uint64_t period;
+		if (!read_varint(ifile, period)) return; // the missing text fails the block
+
+		decoder->set_aging(period);
+		decoder->decompress(ifile, ofile);
+		stats += decoder->stats();
+	}
+
+	static void encode_block(method_t method, Model const* model, tuning_t const& tuning, std::istream& ifile, std::ostream& ofile,
+	                         Stats& stats) {
+		using namespace staticcodes;
+
+		switch (method) {
+			case SHENNON    : run_coder<pcoder<shennon> >        (ifile, ofile, stats, model); break;
+			case FANO       : run_coder<pcoder<fano> >           (ifile, ofile, stats, model); break;
+			case HUFFMAN    : run_coder<pcoder<huffman> >        (ifile, ofile, stats, model); break;
+			case BHUFFMAN   : run_coder<contextcodes::bhcoder>   (ifile, ofile, stats, model); break;
+			case AHUFFMAN   : run_coder<adaptivecodes::ahcoder>  (ifile, ofile, stats, model); break;
+			case ARITHMETIC : run_coder<acoder>                  (ifile, ofile, stats, model); break;
+			case HUFFMAN4   : run_coder<ihcoder>                 (ifile, ofile, stats, model); break;
+			case WAHUFFMAN  : run_aged_coder                     (ifile, ofile, stats, model, tuning.aging_period); break;
+			case LZ77       : run_lz_coder                       (ifile, ofile, stats, tuning); break;
+			case BWT        : run_bw_coder                       (ifile, ofile, stats, tuning); break;
+			case DHUFFMAN   : run_coder<adaptivecodes::dhcoder>  (ifile, ofile, stats, model); break;
+			case HUFFMAN16  : run_coder<wcoder16>                (ifile, ofile, stats); break;
+			case WHUFFMAN   : run_coder<whcoder>                 (ifile, ofile, stats); break;
+			default         : break;
+		}
+	}
+
+	static void decode_block(method_t method, Model const* model, uint64_t raw_size, std::istream& ifile, std::ostream& ofile,
+	                         Stats& stats) {
+		using namespace staticcodes;
+
+		switch (method) {
+			case SHENNON    : run_decoder<pdecoder<shennon> >       (ifile, ofile, stats, model, raw_size); break;
+			case FANO       : run_decoder<pdecoder<fano> >          (ifile, ofile, stats, model, raw_size); break;
+			case HUFFMAN    : run_decoder<pdecoder<huffman> >       (ifile, ofile, stats, model, raw_size); break;
+			case BHUFFMAN   : run_decoder<contextcodes::bhdecoder>  (ifile, ofile, stats, model, raw_size); break;
+			case AHUFFMAN   : run_decoder<adaptivecodes::ahdecoder> (ifile, ofile, stats, model, raw_size); break;
+			case ARITHMETIC : run_decoder<adecoder>                 (ifile, ofile, stats, model, raw_size); break;
+			case HUFFMAN4   : run_decoder<ihdecoder>                (ifile, ofile, stats, model, raw_size); break;
+			case WAHUFFMAN  : run_aged_decoder                      (ifile, ofile, stats, model, raw_size); break;
+			case LZ77       : run_coder<dictcodes::lzdecoder>       (ifile, ofile, stats); break;
+			case BWT        : run_bw_decoder                        (ifile, ofile, stats, raw_size); break;
+			case DHUFFMAN   : run_decoder<adaptivecodes::dhdecoder> (ifile, ofile, stats, model, raw_size); break;
+			case HUFFMAN16  : run_coder<wdecoder16>                 (ifile, ofile, stats); break;
+			case WHUFFMAN   : run_coder<whdecoder>                  (ifile, ofile, stats); break;
+			default         : break;
+		}
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- CHAINS -----------------------
+	// ------------------------------------------------------
+
+	using adaptivecodes::checkpoint_t;
+
+	// Checkpoint that ends the last chained block, the next chained block may continue from it
+	struct chain_t {
+		bool         valid;
+		checkpoint_t checkpoint;
+
+		chain_t() : valid(false)
+		{ }
+	};
+
+	static constexpr uint8_t CONTINUES_FLAG = 0x01; // flags of a chained block
+
+	static void write_checkpoint(std::ostream& ofile, checkpoint_t const& checkpoint) {
+		write_varint(ofile, checkpoint.aging_count);
+		write_varint(ofile, checkpoint.weights.size());
+
+		for (const auto& leaf : checkpoint.weights) {
+			ofile.put(leaf.first);
+			write_varint(ofile, leaf.second);
+		}
+	}
+
+	// Leaves must come in the order of symbols with nonzero weights, as the coders take them
+	static bool read_checkpoint(std::istream& ifile, checkpoint_t& checkpoint) {
+		uint64_t leaves;
+		if (!read_varint(ifile, checkpoint.aging_count) || !read_varint(ifile, leaves) || leaves > sharedmodels::ALPHABET) return false;
+
+		checkpoint.weights.clear();
+
+		for (uint64_t i = 0; i < leaves; ++i) {
+			int      symbol = ifile.get();
+			uint64_t weight;
+
+			if (symbol == EOF || !read_varint(ifile, weight) || !weight || (i && symbol <= checkpoint.weights.back().first))
+				return false;
+
+			checkpoint.weights.emplace_back(symbol, weight);
+		}
+
+		return true;
+	}
+
+	static bool same_checkpoint(checkpoint_t const& a, checkpoint_t const& b) {
+		return a.aging_count == b.aging_count && a.weights == b.weights;
+	}
+
+	// Codes a chained ahuffman or wahuffman block, continuing from the chain if it is valid, and stores the
+	// checkpoint the block ends with into "next"
+	static void encode_chained_block(method_t method, Model const* model, tuning_t const& tuning, chain_t const& chain,
+	                                 std::istream& ifile, std::ostream& ofile, Stats& stats, checkpoint_t& next) {
+		std::unique_ptr<adaptivecodes::ahcoder> coder(model ? new adaptivecodes::ahcoder(*model) : new adaptivecodes::ahcoder);
+		std::ostringstream codes;
+
+		ofile.put(chain.valid ? CONTINUES_FLAG : 0);
+		if (method == WAHUFFMAN) {
+			write_varint(ofile, tuning.aging_period);
+			coder->set_aging(tuning.aging_period);
+		}
+
+		if (chain.valid) coder->resume(chain.checkpoint);
+		coder->compress(ifile, codes);
+		stats += coder->stats();
+
+		coder->checkpoint(next);
+
+		std::string const& data = codes.str();
+		write_varint(ofile, data.size());
+		ofile.write(data.data(), data.size());
+		write_checkpoint(ofile, next);
+	}
+
+	// Reads the payload of a chained block up to its checkpoint without decoding it, returns what is wrong
+	// with it or nullptr
+	static char const* parse_chained_block(std::istream& iblock, method_t method, bool& continues, uint64_t& period,
+	                                      std::string& codes, checkpoint_t& checkpoint) {
+		int flags = iblock.get();
+		uint64_t size;
+
+		period = 0;
+
+		if (flags == EOF || (flags & ~CONTINUES_FLAG) || (method != AHUFFMAN && method != WAHUFFMAN) ||
+		    (method == WAHUFFMAN && !read_varint(iblock, period)) || !read_varint(iblock, size) || size > MAX_BLOCK_SIZE)
+			return "Invalid chained block";
+
+		codes.resize(size);
+		if (!iblock.read(&codes[0], size) || !read_checkpoint(iblock, checkpoint))
+			return "Invalid chained block";
+
+		continues = flags & CONTINUES_FLAG;
+		return nullptr;
+	}
+
+	// Decodes a chained block into "text" from the checkpoint of the chain and leaves its own checkpoint in
+	// the chain, returns what is wrong with the block or nullptr
+	static char const* decode_chained_block(std::istream& iblock, method_t method, Model const* model, uint64_t raw_size,
+	                                        chain_t& chain, std::string& text, Stats& stats) {
+		bool         continues;
+		uint64_t     period;
+		std::string  codes;
+		checkpoint_t stored;
+
+		if (char const* error = parse_chained_block(iblock, method, continues, period, codes, stored)) return error;
+		if (continues && !chain.valid) return "Chained block without a checkpoint before it";
+
+		std::unique_ptr<adaptivecodes::ahdecoder> decoder(model ? new adaptivecodes::ahdecoder(*model, raw_size)
+		                                                        : new adaptivecodes::ahdecoder);
+
+		decoder->set_aging(period);
+		if (continues) decoder->resume(chain.checkpoint);
+
+		std::istringstream icodes(codes);
+		std::ostringstream otext;
+		decoder->decompress(icodes, otext);
+		stats += decoder->stats();
+
+		text = otext.str();
+		if (text.size() != raw_size) return "Decoded block size mismatch";
+
+		// The checkpoint is what the next block continues from, it must be the one the text leads to
+		decoder->checkpoint(chain.checkpoint);
+		if (!same_checkpoint(chain.checkpoint, stored)) {
+			chain.valid = false;
+			return "Checkpoint mismatch";
+		}
+
+		chain.valid = true;
+		return nullptr;
+	}
+
+	// ------------------------------------------------------
+	// ---------------------- ESTIMATE ----------------------
+	// ------------------------------------------------------
+
+	static constexpr size_t ALPHABET   = staticcodes::ALPHABET;
+	static constexpr size_t TABLE_SIZE = ALPHABET * sizeof(uint32_t);
+
+	// Sum of -log2(p) over a histogram, i.e. the number of bits an ideal coder would need
+	static double entropy_bits(uint32_t const* freq, size_t size, uint64_t total) {
+		double bits = 0.0;
+
+		for (size_t i = 0; i < size; ++i)
+			if (freq[i])
+				bits += freq[i] * std::log2(static_cast<double>(total) / freq[i]);
+
+		return bits;
+	}
+
+	// Order-0 entropy of the whole text in bits
+	static double order0_bits(char const* data, size_t size) {
+		uint32_t freq[ALPHABET] = { 0 };
+		for (size_t i = 0; i < size; ++i)
+			++freq[static_cast<uint8_t>(data[i])];
+
+		return entropy_bits(freq, ALPHABET, size);
+	}
+
+	// Order-1 (previous byte as context) entropy of the text in bits, "table" is a scratch bigram table
+	static double order1_bits(char const* data, size_t size, std::vector<uint32_t>& table) {
+		table.assign(ALPHABET * ALPHABET, 0);
+		for (size_t i = 1; i < size; ++i)
+			++table[static_cast<uint8_t>(data[i - 1]) * ALPHABET + static_cast<uint8_t>(data[i])];
+
+		double bits = 0.0;
+
+		for (size_t context = 0; context < ALPHABET; ++context) {
+			uint64_t total = 0;
+			for (size_t i = 0; i < ALPHABET; ++i)
+				total += table[context * ALPHABET + i];
+
+			if (total) bits += entropy_bits(&table[context * ALPHABET], ALPHABET, total);
+		}
+
+		return bits;
+	}
+
+	// Distinct little-endian 16-bit symbols of the text
+	static size_t wide_distinct(char const* data, size_t size) {
+		std::vector<bool> seen(1 << 16, false);
+		size_t distinct = 0;
+
+		uint8_t const* p = reinterpret_cast<uint8_t const*>(data);
+		for (size_t i = 0; i + 1 < size; i += 2) {
+			size_t symbol = p[i] | p[i + 1] << CHAR_BIT;
+			if (!seen[symbol]) {
+				seen[symbol] = true;
+				++distinct;
+			}
+		}
+
+		return distinct;
+	}
+
+	// Order-0 entropy of the text read as little-endian 16-bit symbols, "table" takes their counts
+	static double order0_wide_bits(char const* data, size_t size, std::vector<uint32_t>& table) {
+		table.assign(1 << 16, 0);
+
+		uint8_t const* p = reinterpret_cast<uint8_t const*>(data);
+		for (size_t i = 0; i + 1 < size; i += 2)
+			++table[p[i] | p[i + 1] << CHAR_BIT];
+
+		return entropy_bits(table.data(), table.size(), size / 2);
+	}
+
+	// Size of the model header the method writes before the coded text: one frequency table for static
+	// coders, one table per context for bhuffman, raw first occurrences of every symbol for (wa)huffman,
+	// code lengths and the jump table for huffman4 and nothing for dhuffman or with a shared model; lz77
+	// always stores both of its codes, huffman16 a gap and a length for every distinct 16-bit symbol and
+	// whuffman its vocabulary of words and separators
+	static uint64_t header_size(method_t method, Model const* model, char const* data, size_t size) {
+		if (method == LZ77)      return dictcodes::lz_header_size();
+		if (method == WHUFFMAN)  return staticcodes::wh_header_size(data, size);
+		if (method == HUFFMAN16) {
+			size_t distinct = wide_distinct(data, size);
+			return staticcodes::WC_HEADER_SIZE + size % 2 + 2 + distinct + canonicalcodes::lengths_size(distinct + 1);
+		}
+		if (model)               return 0;
+
+		bool seen[ALPHABET] = { false };
+		uint64_t distinct = 0;
+
+		// Contexts of bhuffman are all symbols but the last one, ahuffman pays for every distinct symbol
+		size_t span = (method == BHUFFMAN && size) ? size - 1 : size;
+		for (size_t i = 0; i < span; ++i)
+			if (!seen[static_cast<uint8_t>(data[i])]) {
+				seen[static_cast<uint8_t>(data[i])] = true;
+				++distinct;
+			}
+
+		switch (method) {
+			case BHUFFMAN : return TABLE_SIZE + sizeof(size_t) + distinct * (sizeof(size_t) + TABLE_SIZE);
+			case AHUFFMAN :
+			case WAHUFFMAN: return distinct;
+			case HUFFMAN4 : return staticcodes::ih_header_size();
+			case DHUFFMAN : return 0;
+			default       : return TABLE_SIZE;
+		}
+	}
+
+	// Lower estimate of a coded block size in bytes: the entropy bound of the payload (order-1 for bhuffman,
+	// order-0 for the rest, none for lz77 and whuffman whose matches and words beat both) plus the model header
+	// of the method
+	static uint64_t estimate_coded_size(method_t method, Model const* model, std::string const& block,
+	                                    std::vector<uint32_t>& table) {
+		if (method == LZ77 || method == WHUFFMAN) return header_size(method, model, block.data(), block.size());
+
+		double bits = (method == BHUFFMAN)  ? order1_bits(block.data(), block.size(), table)
+		            : (method == HUFFMAN16) ? order0_wide_bits(block.data(), block.size(), table)
+		                                    : order0_bits(block.data(), block.size());
+
+		return header_size(method, model, block.data(), block.size()) + std::ceil(bits / CHAR_BIT);
+	}
+
+	// ------------------------------------------------------
+	// ---------------------- SELECTOR ----------------------
+	// ------------------------------------------------------
+
+	static constexpr size_t SAMPLE_SLICES    = 4;
+	static constexpr size_t SAMPLE_SLICE_LEN = 1 << 14; // 16 KiB
+
+	// Evenly spaced contiguous slices of the block (contiguous, so that bigrams survive)
+	static void sample_block(std::string const& block, std::string& sample) {
+		if (block.size() <= SAMPLE_SLICES * SAMPLE_SLICE_LEN) {
+			sample = block;
+			return;
+		}
+
+		sample.clear();
+
+		// Even, so that the 16-bit symbols of huffman16 keep their alignment
+		size_t step = (block.size() - SAMPLE_SLICE_LEN) / (SAMPLE_SLICES - 1) & ~size_t(1);
+
+		for (size_t i = 0; i < SAMPLE_SLICES; ++i)
+			sample.append(block, i * step, SAMPLE_SLICE_LEN);
+	}
+
+	// Delta strides tried by automatic filter selection besides the requested one: bytes, 16-bit and 32-bit
+	// integers, RGB pixels and 64-bit values
+	static constexpr size_t FILTER_STRIDES[] = { 1, 2, 3, 4, 8 };
+
+	// A filter has to save this share of the cost of the sample to be picked, as it may cost context methods
+	// more than order-0 statistics show
+	static constexpr double FILTER_GAIN = 0.97;
+
+	// Order-0 entropy of the text in bits, but every symbol costs at least a bit as in a prefix code: filters
+	// that leave a text of mostly one symbol (mtf and delta on runs) look much better on entropy alone
+	static double order0_code_bits(char const* data, size_t size) {
+		uint32_t freq[ALPHABET] = { 0 };
+		for (size_t i = 0; i < size; ++i)
+			++freq[static_cast<uint8_t>(data[i])];
+
+		double bits = 0.0;
+
+		for (size_t i = 0; i < ALPHABET; ++i)
+			if (freq[i])
+				bits += freq[i] * std::max(1.0, std::log2(static_cast<double>(size) / freq[i]));
+
+		return bits;
+	}
+
+	// Picks the filter (and the stride of delta) whose output costs the fewest order-0 coded bits on a sample
+	// of the block, NO_FILTER if none pays off; "sample" and "trial" are scratch buffers
+	static filtercodes::filter_t select_filter(std::string const& block, size_t& stride, std::string& sample,
+	                                           std::string& trial) {
+		using namespace filtercodes;
+
+		sample_block(block, sample);
+
+		filter_t best        = NO_FILTER;
+		size_t   best_stride = stride;
+		double   best_bits   = order0_code_bits(sample.data(), sample.size()) * FILTER_GAIN;
+
+		auto try_filter = [&](filter_t filter, size_t s) {
+			apply_filter(filter, s, sample, trial);
+
+			double bits = order0_code_bits(trial.data(), trial.size());
+			if (bits < best_bits) {
+				best        = filter;
+				best_stride = s;
+				best_bits   = bits;
+			}
+		};
+
+		try_filter(RLE_FILTER, stride);
+		try_filter(MTF_FILTER, stride);
+		try_filter(DELTA_FILTER, stride);
+
+		for (const auto& s : FILTER_STRIDES)
+			if (s != stride) try_filter(DELTA_FILTER, s);
+
+		stride = best_stride;
+		return best;
+	}
+
+	// Compressing throughput of every method in MiB/s, measured once on English text and 16-bit sensor data
+	// (whole runs, I/O included) and averaged; only their ratios matter
+	static constexpr double METHOD_SPEEDS[METHOD_NUM] = {
+		0.0,  // stored
+		10.0, // shennon
+		9.0,  // fano
+		9.0,  // huffman
+		10.0, // bhuffman
+		5.5,  // ahuffman
+		5.5,  // arithmetic
+		23.0, // huffman4
+		4.2,  // wahuffman
+		10.0, // lz77, default level
+		4.5,  // bwt
+		24.0, // dhuffman
+		27.0, // huffman16
+		10.0  // whuffman
+	};
+
+	// Contiguous sample of window methods, at least: bwt sorts the whole block, so it has no window to match
+	static constexpr size_t WINDOW_SAMPLE_LEN = 1 << 18; // 256 KiB
+
+	// lz77 finds matches as far back as its window and bwt gathers contexts from the whole block, neither
+	// shows on short slices
+	static bool window_method(method_t method) {
+		return method == LZ77 || method == BWT;
+	}
+
+	// One contiguous slice of "size" bytes from the middle of the block
+	static void window_sample(std::string const& block, size_t size, std::string& sample) {
+		if (size >= block.size()) {
+			sample = block;
+			return;
+		}
+
+		sample.assign(block, (block.size() - size) / 2, size);
+	}
+
+	// Picks a method for a block by trial encoding a sample of it with every candidate and weighting the
+	// extrapolated block size against the coding time at the throughput of the method. Times are not
+	// measured, so the same block always gets the same method
+	class Selector {
+		double                m_speed_weight;
+		Model const*          m_model;
+		tuning_t              m_tuning;
+		std::vector<uint32_t> m_table;
+		std::string           m_sample;
+		std::string           m_window_sample;
+
+	public:
+		method_t select(std::string const& block) {
+			sample_block(block, m_sample);
+
+			double h0 = order0_bits(m_sample.data(), m_sample.size());
+
+			// Nothing to gain: the block will be stored anyway, so do not spend time on trials
+			if (h0 >= 7.95 * m_sample.size())
+				return HUFFMAN;
+
+			double h1 = order1_bits(m_sample.data(), m_sample.size(), m_table);
+
+			double est_size[METHOD_NUM] = { 0.0 };
+			double est_time[METHOD_NUM] = { 0.0 };
+			double best_size = 0.0;
+			double best_time = 0.0;
+
+			for (size_t i = SHENNON; i < METHOD_NUM; ++i) {
+				method_t method = static_cast<method_t>(i);
+
+				// Sampled bigram statistics are optimistic, so contexts must pay off clearly
+				if (method == BHUFFMAN && h1 > 0.9 * h0) continue;
+
+				std::string const* sample = &m_sample;
+				if (window_method(method)) {
+					window_sample(block, std::max(method == LZ77 ? m_tuning.lz_window : 0, WINDOW_SAMPLE_LEN), m_window_sample);
+					sample = &m_window_sample;
+				}
+
+				std::istringstream isample(*sample);
+				std::ostringstream osample;
+				Stats stats;
+
+				encode_block(method, m_model, m_tuning, isample, osample, stats);
+
+				// The coded body grows with the block, the model header depends on the block contents
+				double body = static_cast<double>(osample.tellp()) - header_size(method, m_model, sample->data(), sample->size());
+				if (body < 0) body = 0;
+
+				double scale = static_cast<double>(block.size()) / sample->size();
+
+				est_size[i] = header_size(method, m_model, block.data(), block.size()) + body * scale;
+				est_time[i] = block.size() / (METHOD_SPEEDS[i] * (1 << 20));
+
+				if (!best_size || est_size[i] < best_size) best_size = est_size[i];
+				if (!best_time || est_time[i] < best_time) best_time = est_time[i];
+			}
+
+			method_t best       = HUFFMAN;
+			double   best_score = 0.0;
+
+			for (size_t i = SHENNON; i < METHOD_NUM; ++i) {
+				if (!est_size[i]) continue;
+
+				double score = (1 - m_speed_weight) * est_size[i] / best_size + m_speed_weight * est_time[i] / best_time;
+				if (!best_score || score < best_score) {
+					best_score = score;
+					best       = static_cast<method_t>(i);
+				}
+			}
+
+			return best;
+		}
+
+		Selector(double speed_weight, Model const* model, tuning_t const& tuning)
+			: m_speed_weight(speed_weight), m_model(model), m_tuning(tuning)
+		{
+			if (m_speed_weight < 0) m_speed_weight = 0;
+			if (m_speed_weight > 1) m_speed_weight = 1;
+		}
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- CONTAINER ----------------------
+	// -------------------------------------------------------
+
+	// Reads the container header, returns what is wrong with it or nullptr. "block_model" is set to the model
+	// the blocks were coded with, nullptr if none
+	static char const* read_container_header(std::istream& ifile, Model const* model, method_t& method, uint32_t& model_id,
+	                                         Model const*& block_model) {
+		char header[sizeof(MAGIC) + 2];
+
+		if (!ifile.read(header, sizeof(header)) || std::memcmp(header, MAGIC, sizeof(MAGIC)))
+			return "Not a libcoders container";
+
+		uint8_t version = header[sizeof(MAGIC)];
+		method = static_cast<method_t>(static_cast<uint8_t>(header[sizeof(MAGIC) + 1]));
+
+		if (version == FORMAT_VERSION) return nullptr;
+		if (version != MODEL_FORMAT_VERSION) return "Unsupported container version";
+
+		uint64_t id;
+		if (!read_varint(ifile, id) || id > UINT32_MAX) return "Invalid model id";
+
+		model_id = id;
+
+		if (!model)                    return "Coded with a shared model, none given";
+		if (model->id() != model_id)   return "Coded with another shared model";
+
+		block_model = model;
+		return nullptr;
+	}
+
+	// Decodes the payload of a filtered block and undoes the filter into "text", returns what is wrong with the
+	// block or nullptr
+	static char const* decode_filtered_block(std::istream& iblock, method_t method, Model const* model, uint64_t raw_size,
+	                                         std::string& text, Stats& stats) {
+		using namespace filtercodes;
+
+		int      filter = iblock.get();
+		int      stride = iblock.get();
+		uint64_t filtered_size;
+
+		if (filter <= NO_FILTER || filter >= FILTER_NUM || stride == EOF || (filter == DELTA_FILTER && !stride) ||
+			!read_varint(iblock, filtered_size) || !filtered_size || filtered_size > max_filtered_size(raw_size)
+		)
+			return "Invalid block filter";
+
+		std::ostringstream ofiltered;
+		decode_block(method, model, filtered_size, iblock, ofiltered, stats);
+
+		std::string filtered = ofiltered.str();
+		if (filtered.size() != filtered_size) return "Decoded block size mismatch";
+
+		{
+			ScopedTimer timer(stats, MODEL_STAGE);
+
+			if (!revert_filter(static_cast<filter_t>(filter), stride, filtered, text, raw_size) || text.size() != raw_size)
+				return "Decoded block size mismatch";
+		}
+
+		stats.add(FILTERED_BLOCKS_COUNTER);
+		return nullptr;
+	}
+
+	// -------------------------------------------------------
+	// ---------------------- CODERIMPL ----------------------
+	// -------------------------------------------------------
+
+	class bcoder::CoderImpl {
+		// Scratch state of a thread coding blocks
+		struct worker_t {
+			Selector              selector;
+			std::vector<uint32_t> table;
+			std::ostringstream    frame;
+			std::string           filtered;
+			std::string           sample;
+			std::string           trial;
+			Stats                 stats;
+
+			worker_t(double speed_weight, Model const* model, tuning_t const& tuning)
+				: selector(speed_weight, model, tuning)
+			{ }
+		};
+
+		// Block travelling through the pipeline, buffers are reused from block to block
+		struct job_t {
+			uint64_t    seq;
+			std::string block;
+			std::string frame;
+		};
+
+		method_t      m_method;
+		size_t        m_block_size;
+		double        m_speed_weight;
+		Model const*  m_model;
+		size_t        m_workers;
+		size_t        m_depth;
+		uint64_t      m_budget;
+		size_t        m_sharers;
+		bool          m_good;
+		coder_error_t m_error;
+		tuning_t      m_tuning;
+		Stats         m_stats;
+
+		filtercodes::filter_t m_filter;
+		size_t                m_stride;
+
+		bool    m_appendable;
+		chain_t m_chain; // of the block written last
+
+		// Appendable ahuffman and wahuffman blocks continue each other, so they are coded in order
+		bool chained() const {
+			return m_appendable && (m_method == AHUFFMAN || m_method == WAHUFFMAN);
+		}
+
+		void fail(char const* call, coder_error_t error) {
+			std::cerr << "bcoder::" << call << ": " << error_message(error) << std::endl;
+			m_good  = false;
+			m_error = error;
+		}
+
+		// End of file is how the text ends, only a stream gone bad failed to read it; the output is flushed, so
+		// that a write error is not left to be found when the stream is closed
+		void check_streams(char const* call, std::istream& ifile, std::ostream& ofile) {
+			if      (ifile.bad())    fail(call, INPUT_ERROR);
+			else if (!ofile.flush()) fail(call, OUTPUT_ERROR);
+		}
+
+		bool read_block(std::istream& ifile, std::string& block, size_t block_size, Stats& stats) {
+			ScopedTimer timer(stats, INPUT_STAGE);
+
+			block.resize(block_size);
+			ifile.read(&block[0], block_size);
+			block.resize(ifile.gcount());
+
+			return !block.empty();
+		}
+
+		// Filters the block into the worker if filtering is on and pays off, returns the filter applied
+		filtercodes::filter_t filter_block(std::string const& block, size_t& stride, worker_t& worker) {
+			using namespace filtercodes;
+
+			filter_t filter = m_filter;
+			stride = m_stride;
+
+			if (filter == NO_FILTER || m_model || chained()) return NO_FILTER;
+
+			if (filter == AUTO_FILTER) {
+				ScopedTimer timer(worker.stats, STATISTICS_STAGE);
+				filter = select_filter(block, stride, worker.sample, worker.trial);
+				if (filter == NO_FILTER) return NO_FILTER;
+			}
+
+			ScopedTimer timer(worker.stats, MODEL_STAGE);
+			apply_filter(filter, stride, block, worker.filtered);
+			return filter;
+		}
+
+		// Codes a block into its container frame: the coded (possibly filtered) block or, if it would not be
+		// smaller than the original, the block itself
+		void frame_block(std::string const& block, std::string& frame, worker_t& worker) {
+			Stats& stats = worker.stats;
+			stats.add(BLOCKS_COUNTER);
+
+			size_t                stride;
+			filtercodes::filter_t filter = filter_block(block, stride, worker);
+			std::string const&    text   = filter == filtercodes::NO_FILTER ? block : worker.filtered;
+
+			method_t method = m_method;
+			uint64_t estimate;
+
+			{
+				ScopedTimer timer(stats, STATISTICS_STAGE);
+				if (method == AUTO) method = worker.selector.select(text);
+				estimate = estimate_coded_size(method, m_model, text, worker.table);
+			}
+
+			worker.frame.str(std::string());
+
+			// Skip coding altogether when even the estimate does not fit into the original size
+			if (estimate < block.size()) {
+				std::istringstream itext(text);
+				std::ostringstream oblock;
+
+				if (filter != filtercodes::NO_FILTER) {
+					oblock.put(filter);
+					oblock.put(static_cast<char>(filter == filtercodes::DELTA_FILTER ? stride : 0));
+					write_varint(oblock, text.size());
+				}
+
+				checkpoint_t next;
+				if (chained()) encode_chained_block(method, m_model, m_tuning, m_chain, itext, oblock, stats, next);
+				else           encode_block(method, m_model, m_tuning, itext, oblock, stats);
+				std::string payload = oblock.str();
+
+				if (payload.size() + varint_size(payload.size()) < block.size()) {
+					if (filter != filtercodes::NO_FILTER) stats.add(FILTERED_BLOCKS_COUNTER);
+
+					uint8_t tag = method;
+					if (filter != filtercodes::NO_FILTER) tag |= FILTER_FLAG;
+
+					if (chained()) {
+						tag |= CHAIN_FLAG;
+						m_chain.valid = true;
+						m_chain.checkpoint.aging_count = next.aging_count;
+						m_chain.checkpoint.weights.swap(next.weights);
+					}
+
+					worker.frame.put(tag);
+					write_varint(worker.frame, block.size());
+					write_varint(worker.frame, payload.size());
+					frame = worker.frame.str() + payload;
+					return;
+				}
+			}
+
+			// The block after a stored one starts a new chain; only chained coding (always sequential) touches it
+			if (chained()) m_chain.valid = false;
+			stats.add(STORED_BLOCKS_COUNTER);
+
+			worker.frame.put(STORED_TAG);
+			write_varint(worker.frame, block.size());
+			frame = worker.frame.str() + block;
+		}
+
+		void write_frame(std::ostream& ofile, std::string const& frame) {
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(frame.data(), frame.size());
+		}
+
+		void compress_sequential(std::istream& ifile, std::ostream& ofile, size_t block_size) {
+			worker_t    worker(m_speed_weight, m_model, m_tuning);
+			std::string block;
+			std::string frame;
+
+			while (ifile.good() && read_block(ifile, block, block_size, worker.stats)) {
+				frame_block(block, frame, worker);
+				write_frame(ofile, frame);
+			}
+
+			m_stats += worker.stats;
+		}
+
+		// Reader thread -> a coding task per block on the scheduler -> coded queue -> writer (the calling thread).
+		// The reader hands every block over with one of the workers' scratch states, so no more than m_workers
+		// blocks are coded at once, and jobs come back to it through the free queue, so there are never more
+		// blocks in memory than jobs
+		void compress_pipelined(std::istream& ifile, std::ostream& ofile, size_t block_size) {
+			size_t job_num = pipeline_jobs();
+			std::vector<job_t> jobs(job_num);
+
+			concurrency::BoundedQueue<job_t*>    free_jobs(job_num);
+			concurrency::BoundedQueue<job_t*>    coded_jobs(job_num);
+			concurrency::BoundedQueue<worker_t*> idle_workers(m_workers);
+
+			for (auto&& job : jobs)
+				free_jobs.push(&job);
+
+			std::vector<std::unique_ptr<worker_t> > workers;
+			for (size_t i = 0; i < m_workers; ++i) {
+				workers.emplace_back(new worker_t(m_speed_weight, m_model, m_tuning));
+				idle_workers.push(workers.back().get());
+			}
+
+			std::atomic<uint64_t> block_num(UINT64_MAX); // known once the reader is done
+			Stats reader_stats;
+
+			concurrency::ThreadPool& pool = concurrency::scheduler();
+			concurrency::TaskGroup   coding(pool);
+
+			std::thread reader([&] {
+				uint64_t seq = 0;
+
+				while (ifile.good()) {
+					worker_t* worker;
+					idle_workers.pop(worker);
+
+					job_t* job;
+					free_jobs.pop(job);
+
+					if (!read_block(ifile, job->block, block_size, reader_stats)) {
+						free_jobs.push(job);
+						idle_workers.push(worker);
+						break;
+					}
+
+					job->seq = seq++;
+					coding.run([&, job, worker] {
+						frame_block(job->block, job->frame, *worker);
+						idle_workers.push(worker);
+						coded_jobs.push(job);
+					});
+				}
+
+				block_num = seq;
+			});
+
+			// Blocks are coded out of order, each waits in its slot until the ones before it are written. While
+			// there is nothing to write the calling thread codes blocks too, so a pipeline started from a task of
+			// the scheduler cannot starve it
+			std::vector<job_t*> pending(job_num, nullptr);
+			uint64_t next = 0;
+			concurrency::Backoff backoff;
+
+			while (next != block_num) {
+				job_t* job;
+				if (!coded_jobs.try_pop(job)) {
+					if (!pool.run_pending()) backoff.pause();
+					continue;
+				}
+
+				pending[job->seq % job_num] = job;
+
+				while (job_t* ready = pending[next % job_num]) {
+					pending[next % job_num] = nullptr;
+					write_frame(ofile, ready->frame);
+					free_jobs.push(ready);
+					++next;
+				}
+			}
+
+			reader.join();
+			coding.wait();
+
+			m_stats += reader_stats;
+			for (auto&& worker : workers)
+				m_stats += worker->stats;
+		}
+
+		size_t pipeline_jobs() const {
+			return 2 * m_depth + m_workers;
+		}
+
+		// Largest block size up to the requested one that fits into the budget, 0 if none does
+		size_t fit_block_size() const {
+			if (!m_budget) return m_block_size;
+
+			// Pipelined, every job holds a block and its frame on top of what the coding workers take
+			bool pipelined = m_workers && !chained();
+
+			// A filtered copy of a block takes up to 1.25 blocks more per coding thread, the codes and the
+			// checkpoint of a chained block one more
+			size_t extra_buffers = (m_filter != filtercodes::NO_FILTER && !m_model && !chained()) ? 2 : chained() ? 1 : 0;
+
+			return pipelined ? budget_block_size(m_method, m_budget, m_block_size, m_sharers * m_workers,
+			                                     m_sharers * (2 * pipeline_jobs() + extra_buffers * m_workers))
+			                 : budget_block_size(m_method, m_budget, m_block_size, m_sharers, m_sharers * extra_buffers);
+		}
+
+		void code_blocks(std::istream& ifile, std::ostream& ofile, size_t block_size) {
+			if (m_workers && !chained()) compress_pipelined(ifile, ofile, block_size);
+			else                         compress_sequential(ifile, ofile, block_size);
+
+			ofile.put(END_TAG);
+		}
+
+		// Finds the end tag of a container and the chain its last block ends, returns what is wrong with
+		// the container or nullptr
+		char const* find_container_end(std::istream& container, std::streampos& end, method_t& method) {
+			uint32_t     model_id;
+			Model const* block_model = nullptr;
+
+			if (char const* error = read_container_header(container, m_model, method, model_id, block_model)) return error;
+			if (m_model && !block_model) return "Coded without a shared model";
+
+			std::string payload;
+
+			while (true) {
+				end = container.tellg();
+				int tag = container.get();
+
+				if (tag == EOF)     return "Unexpected end of container";
+				if (tag == END_TAG) return nullptr;
+
+				uint64_t raw_size;
+				if (!read_varint(container, raw_size) || !raw_size || raw_size > MAX_BLOCK_SIZE) return "Invalid block size";
+
+				if (tag == STORED_TAG) {
+					m_chain.valid = false;
+					if (!container.ignore(raw_size) || static_cast<uint64_t>(container.gcount()) != raw_size)
+						return "Truncated stored block";
+					continue;
+				}
+
+				int id = tag & ~(FILTER_FLAG | CHAIN_FLAG);
+				if (id == STORED || id >= METHOD_NUM || ((tag & FILTER_FLAG) && (tag & CHAIN_FLAG))) return "Unknown block method";
+
+				uint64_t payload_size;
+				if (!read_varint(container, payload_size) || payload_size >= raw_size) return "Invalid block size";
+
+				payload.resize(payload_size);
+				if (!container.read(&payload[0], payload_size)) return "Truncated coded block";
+
+				m_chain.valid = false;
+				if (!(tag & CHAIN_FLAG)) continue;
+
+				std::istringstream iblock(payload);
+				bool               continues;
+				uint64_t           period;
+				std::string        codes;
+
+				if (char const* error = parse_chained_block(iblock, static_cast<method_t>(id), continues, period, codes,
+				                                            m_chain.checkpoint))
+					return error;
+
+				m_chain.valid = true;
+			}
+		}
+
+	public:
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+			m_chain = chain_t();
+			m_good  = true;
+			m_error = CODER_OK;
+
+			size_t block_size = fit_block_size();
+			if (!block_size) {
+				fail("compress", BUDGET_ERROR);
+				return;
+			}
+
+			ofile.write(MAGIC, sizeof(MAGIC));
+			ofile.put(m_model ? MODEL_FORMAT_VERSION : FORMAT_VERSION);
+			ofile.put(m_method);
+			if (m_model) write_varint(ofile, m_model->id());
+
+			code_blocks(ifile, ofile, block_size);
+			check_streams("compress", ifile, ofile);
+		}
+
+		bool append(std::istream& ifile, std::iostream& container) {
+			m_stats.reset();
+			m_chain = chain_t();
+			m_good  = true;
+			m_error = CODER_OK;
+
+			// Appending always chains, so that the container can be appended to again
+			bool appendable = m_appendable;
+			m_appendable = true;
+
+			size_t block_size = fit_block_size();
+			if (!block_size) {
+				fail("append", BUDGET_ERROR);
+				m_appendable = appendable;
+				return false;
+			}
+
+			std::streampos end;
+			method_t       method;
+
+			if (char const* error = find_container_end(container, end, method)) {
+				std::cerr << "bcoder::append: " << error << std::endl;
+				m_good       = false;
+				m_error      = CONTAINER_ERROR;
+				m_appendable = appendable;
+				return false;
+			}
+
+			container.clear();
+
+			// The header names a single method only while every block was coded with it
+			if (method != m_method) {
+				container.seekp(sizeof(MAGIC) + 1);
+				container.put(AUTO);
+			}
+
+			container.seekp(end);
+			code_blocks(ifile, container, block_size);
+			check_streams("append", ifile, container);
+
+			m_appendable = appendable;
+			return m_good;
+		}
+
+		void set_appendable(bool appendable) {
+			m_appendable = appendable;
+		}
+
+		void set_pipeline(size_t workers, size_t depth) {
+			m_workers = workers;
+			m_depth   = depth ? depth : 1;
+		}
+
+		void set_memory_budget(uint64_t bytes, size_t sharers) {
+			m_budget  = bytes;
+			m_sharers = sharers ? sharers : 1;
+		}
+
+		void set_aging(uint64_t period) {
+			m_tuning.aging_period = period;
+		}
+
+		void set_lz77(int level, size_t window) {
+			m_tuning.lz_level  = level;
+			m_tuning.lz_window = window;
+		}
+
+		void set_bwt_backend(method_t backend) {
+			m_tuning.bwt_backend = backend == ARITHMETIC ? sortcodes::BW_ARITHMETIC : sortcodes::BW_HUFFMAN;
+		}
+
+		void set_filter(filtercodes::filter_t filter, size_t stride) {
+			m_filter = filter < filtercodes::FILTER_NUM || filter == filtercodes::AUTO_FILTER ? filter : filtercodes::NO_FILTER;
+			m_stride = stride && stride <= filtercodes::MAX_STRIDE ? stride : filtercodes::DEFAULT_STRIDE;
+		}
+
+		bool good() const {
+			return m_good;
+		}
+
+		coder_error_t error() const {
+			return m_error;
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			compress(ifile, ofile);
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		CoderImpl(std::istream& ifile, std::ostream& ofile, method_t method, size_t block_size, double speed_weight,
+		          Model const* model)
+			: CoderImpl(method, block_size, speed_weight, model)
+		{
+			compress(ifile, ofile);
+		}
+
+		CoderImpl(method_t method, size_t block_size, double speed_weight, Model const* model)
+			: m_method(method), m_block_size(block_size), m_speed_weight(speed_weight), m_model(model), m_workers(0),
+			  m_depth(DEFAULT_PIPELINE_DEPTH), m_budget(0), m_sharers(1), m_good(true), m_error(CODER_OK),
+			  m_filter(filtercodes::NO_FILTER), m_stride(filtercodes::DEFAULT_STRIDE), m_appendable(false)
+		{
+			if (!m_block_size)                  m_block_size = DEFAULT_BLOCK_SIZE;
+			if (m_block_size > MAX_BLOCK_SIZE)  m_block_size = MAX_BLOCK_SIZE;
+		}
+	};
+
+	void bcoder::compress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->compress(ifile, ofile);
+	}
+
+	void bcoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	bool bcoder::append(std::istream& ifile, std::iostream& container) {
+		return m_pImpl->append(ifile, container);
+	}
+
+	void bcoder::set_appendable(bool appendable) {
+		m_pImpl->set_appendable(appendable);
+	}
+
+	void bcoder::set_pipeline(size_t workers, size_t depth) {
+		m_pImpl->set_pipeline(workers, depth);
+	}
+
+	void bcoder::set_memory_budget(uint64_t bytes, size_t sharers) {
+		m_pImpl->set_memory_budget(bytes, sharers);
+	}
+
+	void bcoder::set_aging(uint64_t period) {
+		m_pImpl->set_aging(period);
+	}
+
+	void bcoder::set_lz77(int level, size_t window) {
+		m_pImpl->set_lz77(level, window);
+	}
+
+	void bcoder::set_bwt_backend(method_t backend) {
+		m_pImpl->set_bwt_backend(backend);
+	}
+
+	void bcoder::set_filter(filtercodes::filter_t filter, size_t stride) {
+		m_pImpl->set_filter(filter, stride);
+	}
+
+	bool bcoder::good() const {
+		return m_pImpl->good();
+	}
+
+	coder_error_t bcoder::error() const {
+		return m_pImpl->error();
+	}
+
+	Stats const& bcoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bcoder::bcoder(std::istream& ifile, std::ostream& ofile, method_t method, size_t block_size, double speed_weight,
+	               Model const* model)
+		: m_pImpl(new CoderImpl(ifile, ofile, method, block_size, speed_weight, model))
+	{ }
+
+	bcoder::bcoder(method_t method, size_t block_size, double speed_weight, Model const* model)
+		: m_pImpl(new CoderImpl(method, block_size, speed_weight, model))
+	{ }
+
+	bcoder::~bcoder()
+	{ }
+
+	// -------------------------------------------------------
+	// --------------------- DECODERIMPL ---------------------
+	// -------------------------------------------------------
+
+	class bdecoder::DecoderImpl {
+		Stats        m_stats;
+		std::string  m_buf;
+		std::string  m_text;
+		method_t     m_method;
+		Model const* m_model;
+		Model const* m_block_model; // the model of the container being decoded, if any
+		uint32_t     m_model_id;
+		method_t     m_legacy; // of inputs without a container header, STORED if they are rejected
+		uint64_t     m_budget;
+		size_t       m_sharers;
+		bool         m_good;
+		chain_t      m_chain; // of the block decoded (or skipped) last
+		uint64_t     m_start; // offset of the text to write from
+		uint64_t     m_pos;   // offset of the block being decoded
+
+		void fail(char const* what) {
+			std::cerr << "bdecoder::decompress: " << what << std::endl;
+			m_good = false;
+		}
+
+		bool read_header(std::istream& ifile) {
+			if (char const* error = read_container_header(ifile, m_model, m_method, m_model_id, m_block_model)) {
+				fail(error);
+				return false;
+			}
+
+			return true;
+		}
+
+		// Inputs written before containers are a single stream of a standalone coder with no header at all
+		bool has_header(std::istream& ifile) {
+			std::streampos begin = ifile.tellg();
+			char           magic[sizeof(MAGIC)];
+
+			bool found = ifile.read(magic, sizeof(magic)) && !std::memcmp(magic, MAGIC, sizeof(MAGIC));
+
+			ifile.clear();
+			ifile.seekg(begin);
+			return found;
+		}
+
+		void read_legacy(std::istream& ifile, std::ostream& ofile) {
+			m_method = m_legacy;
+
+			if (!m_start) {
+				decode_block(m_legacy, nullptr, 0, ifile, ofile, m_stats);
+				return;
+			}
+
+			std::ostringstream otext;
+			decode_block(m_legacy, nullptr, 0, ifile, otext, m_stats);
+
+			std::string const& text = otext.str();
+			if (m_start >= text.size()) return;
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(text.data() + m_start, text.size() - m_start);
+		}
+
+		bool read_stored_block(std::istream& ifile, std::ostream& ofile, uint64_t raw_size) {
+			m_stats.add(STORED_BLOCKS_COUNTER);
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+
+				m_buf.resize(raw_size);
+				if (!ifile.read(&m_buf[0], raw_size)) {
+					fail("Truncated stored block");
+					return false;
+				}
+			}
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(m_buf.data(), raw_size);
+			return true;
+		}
+
+		// Filtered blocks are decoded into a buffer first, the filter is undone on the way to the output
+		bool read_filtered_block(std::istream& iblock, std::ostream& ofile, method_t method, uint64_t raw_size) {
+			if (char const* error = decode_filtered_block(iblock, method, m_block_model, raw_size, m_text, m_stats)) {
+				fail(error);
+				return false;
+			}
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(m_text.data(), m_text.size());
+			return true;
+		}
+
+		// Chained blocks are decoded into a buffer first, their checkpoint is checked before the text is written
+		bool read_chained_block(std::istream& iblock, std::ostream& ofile, method_t method, uint64_t raw_size) {
+			if (char const* error = decode_chained_block(iblock, method, m_block_model, raw_size, m_chain, m_text, m_stats)) {
+				fail(error);
+				return false;
+			}
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(m_text.data(), m_text.size());
+			return true;
+		}
+
+		bool read_coded_block(std::istream& ifile, std::ostream& ofile, method_t method, uint64_t raw_size, bool filtered,
+		                      bool chained) {
+			uint64_t payload_size;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+
+				// A coded block is kept only if it is smaller than the original
+				if (!read_varint(ifile, payload_size) || payload_size >= raw_size) {
+					fail("Invalid block size");
+					return false;
+				}
+
+				m_buf.resize(payload_size);
+				if (!ifile.read(&m_buf[0], payload_size)) {
+					fail("Truncated coded block");
+					return false;
+				}
+			}
+
+			std::istringstream iblock(m_buf);
+			if (filtered) return read_filtered_block(iblock, ofile, method, raw_size);
+			if (chained)  return read_chained_block(iblock, ofile, method, raw_size);
+
+			std::streampos before = ofile.tellp();
+
+			decode_block(method, m_block_model, raw_size, iblock, ofile, m_stats);
+
+			std::streampos after = ofile.tellp();
+			if (before != std::streampos(-1) && after != std::streampos(-1) &&
+				static_cast<uint64_t>(after - before) != raw_size
+			) {
+				fail("Decoded block size mismatch");
+				return false;
+			}
+
+			return true;
+		}
+
+		// Passes over a block that ends before the start offset, keeping only the checkpoint of a chained one
+		bool skip_block(std::istream& ifile, int tag, method_t method, uint64_t raw_size) {
+			ScopedTimer timer(m_stats, INPUT_STAGE);
+
+			m_chain.valid = false;
+
+			if (tag == STORED_TAG) {
+				if (!ifile.ignore(raw_size) || static_cast<uint64_t>(ifile.gcount()) != raw_size) {
+					fail("Truncated stored block");
+					return false;
+				}
+
+				return true;
+			}
+
+			uint64_t payload_size;
+			if (!read_varint(ifile, payload_size) || payload_size >= raw_size) {
+				fail("Invalid block size");
+				return false;
+			}
+
+			m_buf.resize(payload_size);
+			if (!ifile.read(&m_buf[0], payload_size)) {
+				fail("Truncated coded block");
+				return false;
+			}
+
+			if (!(tag & CHAIN_FLAG)) return true;
+
+			std::istringstream iblock(m_buf);
+			bool               continues;
+			uint64_t           period;
+			std::string        codes;
+
+			if (char const* error = parse_chained_block(iblock, method, continues, period, codes, m_chain.checkpoint)) {
+				fail(error);
+				return false;
+			}
+
+			m_chain.valid = true;
+			return true;
+		}
+
+		bool read_block(std::istream& ifile, std::ostream& ofile, int tag, method_t method, uint64_t raw_size) {
+			bool filtered = tag & FILTER_FLAG;
+			bool chained  = tag & CHAIN_FLAG;
+
+			if (!chained) m_chain.valid = false;
+
+			if (tag == STORED_TAG) return read_stored_block(ifile, ofile, raw_size);
+			return read_coded_block(ifile, ofile, method, raw_size, filtered, chained);
+		}
+
+	public:
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+			m_good        = true;
+			m_block_model = nullptr;
+			m_model_id    = 0;
+			m_chain       = chain_t();
+			m_pos         = 0;
+
+			if (m_legacy != STORED && !has_header(ifile)) {
+				read_legacy(ifile, ofile);
+				return;
+			}
+
+			if (!read_header(ifile)) return;
+
+			while (true) {
+				int tag = ifile.get();
+
+				if (tag == EOF) {
+					fail("Unexpected end of container");
+					return;
+				}
+
+				if (tag == END_TAG) break;
+
+				uint64_t raw_size;
+				if (!read_varint(ifile, raw_size) || !raw_size || raw_size > MAX_BLOCK_SIZE) {
+					fail("Invalid block size");
+					return;
+				}
+
+				// Filtered and chained blocks take a buffer for the text on top of the method
+				bool     filtered = tag & FILTER_FLAG;
+				bool     chained  = tag & CHAIN_FLAG;
+				int      id       = tag & ~(FILTER_FLAG | CHAIN_FLAG);
+				method_t method   = id < METHOD_NUM ? static_cast<method_t>(id) : STORED;
+
+				if (tag != STORED_TAG && (id == STORED || id >= METHOD_NUM || (filtered && chained))) {
+					fail("Unknown block method");
+					return;
+				}
+
+				uint64_t pos = m_pos;
+				m_pos += raw_size;
+
+				if (m_pos <= m_start) {
+					if (!skip_block(ifile, tag, method, raw_size)) return;
+					continue;
+				}
+
+				m_stats.add(BLOCKS_COUNTER);
+
+				if (m_budget && memory_estimate(method, false, raw_size, m_sharers, filtered || chained ? 2 * m_sharers : 0) > m_budget) {
+					fail("Block exceeds the memory budget");
+					return;
+				}
+
+				if (pos >= m_start) {
+					if (!read_block(ifile, ofile, tag, method, raw_size)) return;
+					continue;
+				}
+
+				// The block the text starts in is decoded whole, only its tail is written
+				std::ostringstream otext;
+				if (!read_block(ifile, otext, tag, method, raw_size)) return;
+
+				std::string const& text = otext.str();
+				ScopedTimer timer(m_stats, OUTPUT_STAGE);
+				ofile.write(text.data() + (m_start - pos), text.size() - (m_start - pos));
+			}
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		bool good() const {
+			return m_good;
+		}
+
+		method_t method() const {
+			return m_method;
+		}
+
+		uint32_t model_id() const {
+			return m_model_id;
+		}
+
+		void set_memory_budget(uint64_t bytes, size_t sharers) {
+			m_budget  = bytes;
+			m_sharers = sharers ? sharers : 1;
+		}
+
+		void set_start(uint64_t offset) {
+			m_start = offset;
+		}
+
+		void set_legacy_method(method_t method) {
+			m_legacy = method >= SHENNON && method <= ARITHMETIC ? method : STORED;
+		}
+
+		DecoderImpl(std::istream& ifile, std::ostream& ofile) : DecoderImpl(nullptr) {
+			decompress(ifile, ofile);
+		}
+
+		DecoderImpl(Model const* model)
+			: m_method(STORED), m_model(model), m_block_model(nullptr), m_model_id(0), m_legacy(STORED), m_budget(0),
+			  m_sharers(1), m_good(true), m_start(0), m_pos(0)
+		{ }
+	};
+
+	void bdecoder::decompress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->decompress(ifile, ofile);
+	}
+
+	void bdecoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	Stats const& bdecoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bool bdecoder::good() const {
+		return m_pImpl->good();
+	}
+
+	method_t bdecoder::method() const {
+		return m_pImpl->method();
+	}
+
+	uint32_t bdecoder::model_id() const {
+		return m_pImpl->model_id();
+	}
+
+	void bdecoder::set_memory_budget(uint64_t bytes, size_t sharers) {
+		m_pImpl->set_memory_budget(bytes, sharers);
+	}
+
+	void bdecoder::set_start(uint64_t offset) {
+		m_pImpl->set_start(offset);
+	}
+
+	void bdecoder::set_legacy_method(method_t method) {
+		m_pImpl->set_legacy_method(method);
+	}
+
+	bdecoder::bdecoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new DecoderImpl(ifile, ofile))
+	{ }
+
+	bdecoder::bdecoder(Model const* model)
+		: m_pImpl(new DecoderImpl(model))
+	{ }
+
+	bdecoder::bdecoder() : m_pImpl(new DecoderImpl(nullptr))
+	{ }
+
+	bdecoder::~bdecoder()
+	{ }
+
+	// -------------------------------------------------------
+	// --------------------- SEARCHERIMPL --------------------
+	// -------------------------------------------------------
+
+	// Searches a block of a static method in its coded form, "text" decodes ranges of it afterwards
+	template<typename Algorithm>
+	static uint64_t search_static_block(std::string const& payload, Model const* model, uint64_t raw_size,
+	                                   std::string const& pattern, std::vector<uint64_t>& offsets,
+	                                   std::function<std::string(uint64_t, uint64_t)>& text, Stats& stats) {
+		std::shared_ptr<staticcodes::psearcher<Algorithm> > searcher(
+			model ? new staticcodes::psearcher<Algorithm>(*model, raw_size, pattern)
+			      : new staticcodes::psearcher<Algorithm>(pattern)
+		);
+
+		std::istringstream iblock(payload);
+		searcher->search(iblock);
+		stats += searcher->stats();
+
+		offsets = searcher->matches();
+		text    = [searcher](uint64_t begin, uint64_t end) { return searcher->extract(begin, end); };
+		return searcher->size();
+	}
+
+	class bsearcher::SearcherImpl {
+		// A match whose neighborhood waits for "need" more bytes of the following blocks
+		struct pending_t {
+			size_t   match;
+			uint64_t need;
+		};
+
+		Stats                  m_stats;
+		std::string            m_pattern;
+		size_t                 m_context;
+		Model const*           m_model;
+		Model const*           m_block_model;
+		bool                   m_good;
+		std::string            m_buf;
+		std::string            m_text;
+		std::string            m_recent; // the last bytes of the blocks searched before
+		uint64_t               m_base;   // offset of the block being searched
+		std::vector<match_t>   m_matches;
+		std::vector<pending_t> m_pending;
+		chain_t                m_chain;  // of the block searched last
+
+		void fail(char const* what) {
+			std::cerr << "bsearcher::search: " << what << std::endl;
+			m_good = false;
+		}
+
+		// Every occurrence of the pattern in a decoded block
+		void find_all(std::vector<uint64_t>& offsets) {
+			ScopedTimer timer(m_stats, CODING_STAGE);
+
+			offsets.clear();
+			for (size_t pos = m_text.find(m_pattern); pos != std::string::npos; pos = m_text.find(m_pattern, pos + 1))
+				offsets.push_back(pos);
+		}
+
+		void add_match(uint64_t offset, std::string const& before, std::string const& after, uint64_t need) {
+			match_t match;
+			match.offset = offset;
+			match.start  = offset - before.size();
+			match.text   = before + m_pattern + after;
+			m_matches.push_back(match);
+
+			if (need) {
+				pending_t pending;
+				pending.match = m_matches.size() - 1;
+				pending.need  = need;
+				m_pending.push_back(pending);
+			}
+
+			m_stats.add(MATCHES_COUNTER);
+		}
+
+		// Completes the neighborhoods of earlier matches, finds the matches that span blocks and takes the
+		// neighborhoods of those of the block, which are all that is decoded of a coded block
+		void add_block(uint64_t size, std::vector<uint64_t> const& offsets, std::function<std::string(uint64_t, uint64_t)> const& text) {
+			size_t plen   = m_pattern.size();
+			size_t reach  = plen - 1 + m_context;
+			std::string head = text(0, std::min<uint64_t>(size, reach));
+
+			for (auto&& pending : m_pending) {
+				size_t take = std::min<uint64_t>(pending.need, head.size());
+				m_matches[pending.match].text.append(head, 0, take);
+				pending.need -= take;
+			}
+
+			m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [](pending_t const& p) { return !p.need; }),
+			                m_pending.end());
+
+			// Matches that start in the blocks before and end in this one
+			std::string window = m_recent + head;
+			size_t first = m_recent.size() >= plen ? m_recent.size() - plen + 1 : 0;
+
+			for (size_t pos = first; pos < m_recent.size() && pos + plen <= window.size(); ++pos) {
+				if (window.compare(pos, plen, m_pattern)) continue;
+
+				size_t from = pos >= m_context ? pos - m_context : 0;
+				size_t to   = std::min(window.size(), pos + plen + m_context);
+				add_match(m_base - m_recent.size() + pos, window.substr(from, pos - from), window.substr(pos + plen, to - pos - plen),
+				          pos + plen + m_context - to);
+			}
+
+			for (const auto& offset : offsets) {
+				std::string before = offset < m_context ? m_recent.substr(m_recent.size() - std::min(m_recent.size(), m_context - offset)) : "";
+				before += text(offset >= m_context ? offset - m_context : 0, offset);
+
+				uint64_t end = std::min<uint64_t>(size, offset + plen + m_context);
+				add_match(m_base + offset, before, text(offset + plen, end), offset + plen + m_context - end);
+			}
+
+			// Keep enough of the text for matches that start here and their neighborhoods
+			m_recent += size > reach ? text(size - reach, size) : head;
+			if (m_recent.size() > reach) m_recent.erase(0, m_recent.size() - reach);
+
+			m_base += size;
+		}
+
+		bool search_stored_block(std::istream& ifile, uint64_t raw_size) {
+			m_stats.add(STORED_BLOCKS_COUNTER);
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+
+				m_text.resize(raw_size);
+				if (!ifile.read(&m_text[0], raw_size)) {
+					fail("Truncated stored block");
+					return false;
+				}
+			}
+
+			std::vector<uint64_t> offsets;
+			find_all(offsets);
+			add_block(raw_size, offsets, [this](uint64_t begin, uint64_t end) { return m_text.substr(begin, end - begin); });
+			return true;
+		}
+
+		bool search_coded_block(std::istream& ifile, method_t method, uint64_t raw_size, bool filtered, bool chained) {
+			using namespace staticcodes;
+
+			uint64_t payload_size;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+
+				if (!read_varint(ifile, payload_size) || payload_size >= raw_size) {
+					fail("Invalid block size");
+					return false;
+				}
+
+				m_buf.resize(payload_size);
+				if (!ifile.read(&m_buf[0], payload_size)) {
+					fail("Truncated coded block");
+					return false;
+				}
+			}
+
+			std::vector<uint64_t> offsets;
+			std::function<std::string(uint64_t, uint64_t)> text;
+
+			// The codes of static methods are found as they are, filtered blocks hold the codes of another text
+			if (!filtered && (method == SHENNON || method == FANO || method == HUFFMAN)) {
+				uint64_t size = 0;
+
+				switch (method) {
+					case SHENNON : size = search_static_block<shennon>(m_buf, m_block_model, raw_size, m_pattern, offsets, text, m_stats); break;
+					case FANO    : size = search_static_block<fano>   (m_buf, m_block_model, raw_size, m_pattern, offsets, text, m_stats); break;
+					default      : size = search_static_block<huffman>(m_buf, m_block_model, raw_size, m_pattern, offsets, text, m_stats); break;
+				}
+
+				if (size != raw_size) {
+					fail("Decoded block size mismatch");
+					return false;
+				}
+
+				m_stats.add(CODED_SEARCHES_COUNTER);
+				add_block(raw_size, offsets, text);
+				return true;
+			}
+
+			std::istringstream iblock(m_buf);
+
+			if (filtered) {
+				if (char const* error = decode_filtered_block(iblock, method, m_block_model, raw_size, m_text, m_stats)) {
+					fail(error);
+					return false;
+				}
+			}
+			else if (chained) {
+				if (char const* error = decode_chained_block(iblock, method, m_block_model, raw_size, m_chain, m_text, m_stats)) {
+					fail(error);
+					return false;
+				}
+			}
+			else {
+				std::ostringstream otext;
+				decode_block(method, m_block_model, raw_size, iblock, otext, m_stats);
+				m_text = otext.str();
+
+				if (m_text.size() != raw_size) {
+					fail("Decoded block size mismatch");
+					return false;
+				}
+			}
+
+			find_all(offsets);
+			add_block(raw_size, offsets, [this](uint64_t begin, uint64_t end) { return m_text.substr(begin, end - begin); });
+			return true;
+		}
+
+	public:
+		void search(std::istream& ifile) {
+			m_stats.reset();
+			m_matches.clear();
+			m_pending.clear();
+			m_recent.clear();
+			m_good        = true;
+			m_block_model = nullptr;
+			m_base        = 0;
+			m_chain       = chain_t();
+
+			method_t method;
+			uint32_t model_id;
+
+			if (char const* error = read_container_header(ifile, m_model, method, model_id, m_block_model)) {
+				fail(error);
+				return;
+			}
+
+			// An empty pattern is found nowhere
+			if (m_pattern.empty()) return;
+
+			while (true) {
+				int tag = ifile.get();
+
+				if (tag == EOF) {
+					fail("Unexpected end of container");
+					return;
+				}
+
+				if (tag == END_TAG) break;
+
+				uint64_t raw_size;
+				if (!read_varint(ifile, raw_size) || !raw_size || raw_size > MAX_BLOCK_SIZE) {
+					fail("Invalid block size");
+					return;
+				}
+
+				m_stats.add(BLOCKS_COUNTER);
+
+				bool filtered = tag & FILTER_FLAG;
+				bool chained  = tag & CHAIN_FLAG;
+				int  id       = tag & ~(FILTER_FLAG | CHAIN_FLAG);
+
+				if (!chained) m_chain.valid = false;
+
+				bool ok;
+				if (tag == STORED_TAG) ok = search_stored_block(ifile, raw_size);
+				else if (id != STORED && id < METHOD_NUM && !(filtered && chained))
+					ok = search_coded_block(ifile, static_cast<method_t>(id), raw_size, filtered, chained);
+				else {
+					fail("Unknown block method");
+					return;
+				}
+
+				if (!ok) return;
+			}
+		}
+
+		void operator()(std::istream& ifile) {
+			search(ifile);
+		}
+
+		std::vector<match_t> const& matches() const {
+			return m_matches;
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		bool good() const {
+			return m_good;
+		}
+
+		SearcherImpl(std::istream& ifile, std::string const& pattern, size_t context) : SearcherImpl(pattern, context, nullptr) {
+			search(ifile);
+		}
+
+		SearcherImpl(std::string const& pattern, size_t context, Model const* model)
+			: m_pattern(pattern), m_context(context), m_model(model), m_block_model(nullptr), m_good(true), m_base(0)
+		{ }
+	};
+
+	void bsearcher::search(std::istream& ifile) {
+		m_pImpl->search(ifile);
+	}
+
+	void bsearcher::operator()(std::istream& ifile) {
+		m_pImpl->operator()(ifile);
+	}
+
+	std::vector<match_t> const& bsearcher::matches() const {
+		return m_pImpl->matches();
+	}
+
+	Stats const& bsearcher::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bool bsearcher::good() const {
+		return m_pImpl->good();
+	}
+
+	bsearcher::bsearcher(std::istream& ifile, std::string const& pattern, size_t context)
+		: m_pImpl(new SearcherImpl(ifile, pattern, context))
+	{ }
+
+	bsearcher::bsearcher(std::string const& pattern, size_t context, Model const* model)
+		: m_pImpl(new SearcherImpl(pattern, context, model))
+	{ }
+
+	bsearcher::~bsearcher()
+	{ }
+
+}
@@ -0,0 +1,317 @@
+/**
+ * blocks.hxx
+ *
+ * Block Container with Stored-Block Fallback
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef BLOCKS_HXX
+#define BLOCKS_HXX
+
+#include <iostream>
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include "instrument.hxx"
+#include "filters.hxx"
+#include "models.hxx"
+
+/**
+ * Container layout (all sizes are LEB128 varints):
+ *
+ *   "LC" | version (1 byte) | method (1 byte) | [model id]
+ *   block*: tag (1 byte) | raw_size | [payload_size] | payload
+ *   END_TAG (1 byte)
+ *
+ * The tag of a block is either STORED_TAG (payload is raw_size bytes of input as is, no payload_size)
+ * or the id of the method that coded the payload, so decoding needs no method from the user.
+ * The method byte of the header is informational: the requested method or AUTO.
+ *
+ * Every block (of at most MAX_BLOCK_SIZE) is coded with its own tables and sizes are 64-bit varints, so the
+ * container has no limit on the length of the text: use it for inputs beyond the 4 GiB the standalone coders take.
+ *
+ * Containers of MODEL_FORMAT_VERSION were coded with a pre-trained shared model: the header ends with the id of
+ * the model and coded blocks carry no model header of their own, the decoder needs the same model.
+ *
+ * A coded block whose tag has FILTER_FLAG set was filtered before coding (see filtercodes), its payload is
+ *
+ *   filter (1 byte) | delta stride (1 byte) | filtered size | the filtered text coded with the method
+ *
+ * A coded block whose tag has CHAIN_FLAG set (ahuffman and wahuffman blocks of appendable containers) ends
+ * with a checkpoint of the FGK tree (see adaptivecodes::checkpoint_t), its payload is
+ *
+ *   flags (1 byte) | [aging period, wahuffman] | codes size | codes | checkpoint
+ *   checkpoint: aging count | leaves | leaves x (symbol (1 byte) | weight)
+ *
+ * With bit 0 of the flags set the block continues the chained block before it: its coder starts from the tree
+ * rebuilt from that checkpoint instead of an empty one. Appending to such a container codes only the new text
+ * and decoding may start at any block, from the checkpoint of the one before
+ */
+
+namespace blockcodes {
+
+	enum method_t {
+		STORED     = 0,
+		SHENNON    = 1,
+		FANO       = 2,
+		HUFFMAN    = 3,
+		BHUFFMAN   = 4,
+		AHUFFMAN   = 5,
+		ARITHMETIC = 6,
+		HUFFMAN4   = 7,
+		WAHUFFMAN  = 8, // ahuffman with weight aging, the payload starts with the aging period
+		LZ77       = 9, // matches and literals coded with canonical Huffman codes
+		BWT        = 10, // block sorting, move-to-front and zero runs coded by huffman4 or arithmetic
+		DHUFFMAN   = 11, // canonical Huffman codes rebuilt from running counts as the text is coded
+		HUFFMAN16  = 12, // canonical Huffman codes of little-endian 16-bit symbols (token ids), no model
+		WHUFFMAN   = 13, // canonical Huffman codes of words and separators over a stored vocabulary, no model
+		METHOD_NUM,
+
+		AUTO = 0x7F // picks a method per block, never written as a block tag
+	};
+
+	static constexpr uint8_t STORED_TAG  = STORED;
+	static constexpr uint8_t END_TAG     = 0xFF;
+	static constexpr uint8_t FILTER_FLAG = 0x40;
+	static constexpr uint8_t CHAIN_FLAG  = 0x20;
+
+	static constexpr uint8_t FORMAT_VERSION       = 1;
+	static constexpr uint8_t MODEL_FORMAT_VERSION = 2;
+	static constexpr size_t  DEFAULT_BLOCK_SIZE = 1 << 22; // 4 MiB
+	static constexpr size_t  MAX_BLOCK_SIZE     = 1 << 30; // 1 GiB
+	static constexpr size_t  MIN_BLOCK_SIZE     = 1 << 16; // 64 KiB, the smallest one a memory budget may pick
+
+	// Blocks waiting in every queue of the pipelined coder
+	static constexpr size_t DEFAULT_PIPELINE_DEPTH = 4;
+
+	// Bytes of text shown on either side of a match found by bsearcher
+	static constexpr size_t DEFAULT_SEARCH_CONTEXT = 16;
+
+	// Weight of coding speed against compression ratio when picking methods automatically:
+	// 0 picks the smallest output, 1 the fastest coder
+	static constexpr double PREFER_RATIO    = 0.0;
+	static constexpr double PREFER_BALANCED = 0.5;
+	static constexpr double PREFER_SPEED    = 1.0;
+
+	// What made the last compress or append call of a bcoder fail
+	enum coder_error_t {
+		CODER_OK,        // the call did not fail
+		BUDGET_ERROR,    // even the smallest blocks exceed the memory budget, nothing was written
+		CONTAINER_ERROR, // the container to append to is malformed or coded with another shared model
+		INPUT_ERROR,     // the text could not be read
+		OUTPUT_ERROR     // the container could not be written
+	};
+
+	// Returns the CLI name of the method ("shennon", "fano", ...)
+	char const* method_name(method_t method);
+
+	// Returns a description of the error ("Memory budget too small", ...)
+	char const* error_message(coder_error_t error);
+
+	// Returns the method with the given CLI name ("auto" included) or STORED if there is none
+	method_t method_from_name(char const* name);
+
+	// Writes an unsigned LEB128 varint
+	void write_varint(std::ostream& ofile, uint64_t value);
+
+	// Reads an unsigned LEB128 varint, returns false on a truncated or overlong value
+	bool read_varint(std::istream& ifile, uint64_t& value);
+
+	// Estimated peak memory in bytes of compressing (or decompressing) with blocks of block_size: the process
+	// itself, the model cache, the working memory of "workers" coding threads and "buffers" more blocks
+	// waiting in pipeline queues
+	uint64_t memory_estimate(method_t method, bool compressing, size_t block_size, size_t workers = 1, size_t buffers = 0);
+
+	// Largest block size (a multiple of MIN_BLOCK_SIZE, at most block_size) whose compressing estimate fits
+	// into the budget, 0 if even MIN_BLOCK_SIZE does not
+	size_t budget_block_size(method_t method, uint64_t budget, size_t block_size, size_t workers = 1, size_t buffers = 0);
+
+	// -------------------------------------------------------
+	// ----------------------- BCODER ------------------------
+	// -------------------------------------------------------
+
+	class bcoder {
+		class CoderImpl;
+		std::unique_ptr<CoderImpl> m_pImpl;
+
+	public:
+
+		// Splits text into blocks, encodes every block with the method (with AUTO: the method that best fits
+		// the speed weight on a sample of the block) and writes either the coded block or, if it would not be
+		// smaller than the original, the block itself to the output file
+		void compress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Appends text to a container in place of its end tag, coded as a compress call would code it with
+		// appendable blocks: ahuffman and wahuffman continue from the checkpoint of the last block. Returns false,
+		// leaving the container as it was, if it is malformed or was coded with another shared model (or
+		// without the one the coder has)
+		bool append(std::istream& ifile, std::iostream& container);
+
+		// Makes the following compress calls write ahuffman and wahuffman blocks as chained blocks that the
+		// container can be appended to; they continue each other, so they are coded sequentially and unfiltered
+		void set_appendable(bool appendable);
+
+		// Pipelines the following compress calls: a reader thread fills block buffers, up to "workers" of them
+		// are coded at once by tasks on the scheduler (see concurrency::scheduler) and the calling thread writes
+		// them in order, connected by lock-free queues of "depth" blocks. The output is the same as of
+		// sequential coding; 0 workers codes sequentially in the calling thread
+		void set_pipeline(size_t workers, size_t depth = DEFAULT_PIPELINE_DEPTH);
+
+		// Keeps the following compress calls within "bytes" of memory (0 means no limit) by coding smaller
+		// blocks where the requested ones would not fit; the budget is shared with sharers - 1 more coders
+		// running at once in the process
+		void set_memory_budget(uint64_t bytes, size_t sharers = 1);
+
+		// Aging period of wahuffman blocks in symbols (adaptivecodes::DEFAULT_AGING_PERIOD by default), it is
+		// recorded in every block
+		void set_aging(uint64_t period);
+
+		// Effort level and window size of lz77 blocks (see dictcodes::lzcoder::set_level)
+		void set_lz77(int level, size_t window);
+
+		// Back end of bwt blocks: ARITHMETIC (the default) or HUFFMAN (coded as huffman4, faster to decode)
+		void set_bwt_backend(method_t backend);
+
+		// Filter applied to every block before coding (none by default); AUTO_FILTER picks one per block by
+		// the order-0 entropy of a sample, trying delta with the given stride and a few common ones. Blocks
+		// coded with a shared model are never filtered, its statistics are those of unfiltered text
+		void set_filter(filtercodes::filter_t filter, size_t stride = filtercodes::DEFAULT_STRIDE);
+
+		// False if the last compress or append call failed, error() tells why
+		bool good() const;
+
+		// Why the last compress or append call failed, CODER_OK if it did not
+		coder_error_t error() const;
+
+		// Stage timers and counters of the last compress call (summed over blocks and, when pipelined,
+		// over threads)
+		instrumentation::Stats const& stats() const;
+
+		// With a shared model every block is coded with its statistics instead of its own
+		bcoder(std::istream& ifile, std::ostream& ofile, method_t method, size_t block_size = DEFAULT_BLOCK_SIZE,
+		       double speed_weight = PREFER_BALANCED, sharedmodels::Model const* model = nullptr);
+
+		bcoder(method_t method, size_t block_size = DEFAULT_BLOCK_SIZE, double speed_weight = PREFER_BALANCED,
+		       sharedmodels::Model const* model = nullptr);
+
+		~bcoder();
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- BDECODER -----------------------
+	// -------------------------------------------------------
+
+	class bdecoder {
+		class DecoderImpl;
+		std::unique_ptr<DecoderImpl> m_pImpl;
+
+	public:
+
+		// Decodes every block of the container and writes the text to the output file
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last decompress call (summed over blocks)
+		instrumentation::Stats const& stats() const;
+
+		// False if the last decompress call met a malformed or truncated container
+		bool good() const;
+
+		// Method recorded in the container header by the encoder (AUTO if it was picked per block)
+		method_t method() const;
+
+		// Makes the following decompress calls fail on blocks that would not fit into "bytes" of memory
+		// (0 means no limit) shared with sharers - 1 more decoders, the block size is chosen by the encoder
+		void set_memory_budget(uint64_t bytes, size_t sharers = 1);
+
+		// Id of the shared model recorded in the container header, 0 if it was coded without one
+		uint32_t model_id() const;
+
+		// Makes the following decompress calls write the text from "offset" on: blocks that end before it
+		// are passed over undecoded, chained ones leaving only their checkpoints
+		void set_start(uint64_t offset);
+
+		// Makes the following decompress calls take an input without a container header for a single stream
+		// coded with "method" by libcoders before containers, SHENNON to ARITHMETIC; STORED (the default)
+		// or any other method rejects such inputs
+		void set_legacy_method(method_t method);
+
+		bdecoder(std::istream& ifile, std::ostream& ofile);
+
+		// The model is required by containers coded with a shared model and ignored by the rest
+		explicit bdecoder(sharedmodels::Model const* model);
+
+		bdecoder();
+
+		~bdecoder();
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- BSEARCHER ----------------------
+	// -------------------------------------------------------
+
+	struct match_t {
+		uint64_t    offset; // of the match in the decoded text
+		uint64_t    start;  // offset of the neighborhood in the decoded text
+		std::string text;   // the match with up to "context" bytes of text on either side
+	};
+
+	class bsearcher {
+		class SearcherImpl;
+		std::unique_ptr<SearcherImpl> m_pImpl;
+
+	public:
+
+		// Finds every occurrence of the pattern in the text of the container, across block boundaries too.
+		// Blocks coded with shennon, fano or huffman are searched in their coded form (see staticcodes::psearcher)
+		// and only the neighborhoods of matches are decoded, stored blocks are searched as they are and the
+		// blocks of other methods are decoded first
+		void search(std::istream& ifile);
+
+		void operator()(std::istream& ifile);
+
+		// Matches of the last search call in the order of their offsets
+		std::vector<match_t> const& matches() const;
+
+		// Stage timers and counters of the last search call (summed over blocks)
+		instrumentation::Stats const& stats() const;
+
+		// False if the last search call met a malformed or truncated container
+		bool good() const;
+
+		bsearcher(std::istream& ifile, std::string const& pattern, size_t context = DEFAULT_SEARCH_CONTEXT);
+
+		// The model is required by containers coded with a shared model and ignored by the rest
+		bsearcher(std::string const& pattern, size_t context = DEFAULT_SEARCH_CONTEXT, sharedmodels::Model const* model = nullptr);
+
+		~bsearcher();
+	};
+
+}
+
+#endif // BLOCKS_HXX
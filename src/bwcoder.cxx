@@ -0,0 +1,629 @@
+/**
+ * bwcoder.cxx
+ *
+ * Block-Sorting (BWT + MTF + RLE) Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>   // size_t
+#include <cstdint>
+#include <cstring>   // std::memmove
+#include <string>
+#include <vector>
+#include <iterator>  // std::istreambuf_iterator
+#include <algorithm> // std::fill, std::min
+#include <climits>   // CHAR_BIT
+#include "pcoder.hxx"
+#include "acoder.hxx"
+#include "ihcoder.hxx"
+#include "bwcoder.hxx"
+
+namespace sortcodes {
+
+	using namespace instrumentation;
+
+	static constexpr size_t ALPHABET = 256;
+
+	// Bytes of the transformed stream: the two zero-run digits, then MTF values shifted by one; values from
+	// ESCAPE - 1 on take the escape byte and their offset from it
+	static constexpr uint8_t RUN_A  = 0;
+	static constexpr uint8_t RUN_B  = 1;
+	static constexpr uint8_t ESCAPE = 0xFF;
+
+	// Independent walks of the inverse transform, each over its share of the text
+	static constexpr size_t BW_SEGMENTS = 8;
+
+	// ------------------------------------------------------
+	// ----------------------- SA-IS ------------------------
+	// ------------------------------------------------------
+
+	// Suffix array by induced sorting (Nong, Zhang and Chan): suffixes are typed S (smaller than the next one)
+	// or L, the leftmost S suffixes of runs (LMS) are sorted by sorting their substrings with two induction
+	// passes and, if some substrings are equal, recursively sorting the string of their names
+	class SAIS {
+		std::vector<uint8_t> m_types; // 1 for S suffixes
+		std::vector<int32_t> m_buckets;
+
+		bool is_lms(int32_t i) const {
+			return i > 0 && m_types[i] && !m_types[i - 1];
+		}
+
+		// Starts (or ends) of the buckets of every symbol
+		void get_buckets(int32_t const* s, int32_t n, int32_t k, bool ends) {
+			m_buckets.assign(k + 1, 0);
+			for (int32_t i = 0; i < n; ++i)
+				++m_buckets[s[i]];
+
+			int32_t sum = 0;
+			for (int32_t c = 0; c <= k; ++c) {
+				sum += m_buckets[c];
+				m_buckets[c] = ends ? sum : sum - m_buckets[c];
+			}
+		}
+
+		void induce(int32_t const* s, int32_t* sa, int32_t n, int32_t k) {
+			get_buckets(s, n, k, false);
+			for (int32_t i = 0; i < n; ++i) {
+				int32_t j = sa[i] - 1;
+				if (j >= 0 && !m_types[j]) sa[m_buckets[s[j]]++] = j;
+			}
+
+			get_buckets(s, n, k, true);
+			for (int32_t i = n - 1; i >= 0; --i) {
+				int32_t j = sa[i] - 1;
+				if (j >= 0 && m_types[j]) sa[--m_buckets[s[j]]] = j;
+			}
+		}
+
+	public:
+
+		// s holds n symbols from 0 to k, the last one 0 and unique
+		void sort(int32_t const* s, int32_t* sa, int32_t n, int32_t k) {
+			m_types.assign(n, 0);
+			m_types[n - 1] = 1;
+			for (int32_t i = n - 2; i >= 0; --i)
+				m_types[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && m_types[i + 1]);
+
+			// Sort the LMS substrings
+			get_buckets(s, n, k, true);
+			std::fill(sa, sa + n, -1);
+			for (int32_t i = 1; i < n; ++i)
+				if (is_lms(i)) sa[--m_buckets[s[i]]] = i;
+
+			induce(s, sa, n, k);
+
+			// Compact the sorted LMS positions into the first n1 items
+			int32_t n1 = 0;
+			for (int32_t i = 0; i < n; ++i)
+				if (is_lms(sa[i])) sa[n1++] = sa[i];
+
+			// Name the LMS substrings, equal ones get equal names
+			std::fill(sa + n1, sa + n, -1);
+			int32_t name = 0, prev = -1;
+
+			for (int32_t i = 0; i < n1; ++i) {
+				int32_t pos  = sa[i];
+				bool    diff = false;
+
+				for (int32_t d = 0; d < n; ++d)
+					if (prev == -1 || s[pos + d] != s[prev + d] || m_types[pos + d] != m_types[prev + d]) {
+						diff = true;
+						break;
+					}
+					else if (d > 0 && (is_lms(pos + d) || is_lms(prev + d)))
+						break;
+
+				if (diff) {
+					++name;
+					prev = pos;
+				}
+
+				sa[n1 + pos / 2] = name - 1;
+			}
+
+			for (int32_t i = n - 1, j = n - 1; i >= n1; --i)
+				if (sa[i] >= 0) sa[j--] = sa[i];
+
+			// Sort the LMS suffixes: the string of names is in the last n1 items
+			int32_t* sa1 = sa;
+			int32_t* s1  = sa + n - n1;
+
+			if (name < n1) {
+				SAIS recursion;
+				recursion.sort(s1, sa1, n1, name - 1);
+			}
+			else
+				for (int32_t i = 0; i < n1; ++i)
+					sa1[s1[i]] = i;
+
+			// Induce the whole array from the sorted LMS suffixes
+			get_buckets(s, n, k, true);
+			for (int32_t i = 1, j = 0; i < n; ++i)
+				if (is_lms(i)) s1[j++] = i;
+			for (int32_t i = 0; i < n1; ++i)
+				sa1[i] = s1[sa1[i]];
+
+			std::fill(sa + n1, sa + n, -1);
+			for (int32_t i = n1 - 1; i >= 0; --i) {
+				int32_t j = sa[i];
+				sa[i] = -1;
+				sa[--m_buckets[s[j]]] = j;
+			}
+
+			induce(s, sa, n, k);
+		}
+	};
+
+	void suffix_array(uint8_t const* text, size_t size, uint32_t* sa) {
+		// Bytes shifted by one and a sentinel 0 at the end
+		std::vector<int32_t> s(size + 1);
+		for (size_t i = 0; i < size; ++i)
+			s[i] = text[i] + 1;
+		s[size] = 0;
+
+		std::vector<int32_t> full(size + 1);
+		SAIS sais;
+		sais.sort(s.data(), full.data(), size + 1, ALPHABET);
+
+		// The sentinel suffix is the smallest one
+		for (size_t i = 0; i < size; ++i)
+			sa[i] = full[i + 1];
+	}
+
+	// ------------------------------------------------------
+	// --------------------- TRANSFORMS ---------------------
+	// ------------------------------------------------------
+
+	// Ends of the segments the decoder walks at once: segment s ends where s + 1 segments of the text do
+	static size_t segment_end(size_t size, size_t segment) {
+		return static_cast<uint64_t>(size) * (segment + 1) / BW_SEGMENTS;
+	}
+
+	// Last column of the sorted rotations of text + sentinel without the sentinel. Rows are numbered with
+	// the sentinel suffix as row 0: "rows" gets the row of the suffix at the start of the text (the primary
+	// index) and those at the ends of the segments but the last one (which is row 0)
+	static void bwt(std::string const& text, std::string& last, uint32_t* rows) {
+		size_t size = text.size();
+		std::vector<uint32_t> sa(size);
+		suffix_array(reinterpret_cast<uint8_t const*>(text.data()), size, sa.data());
+
+		std::fill(rows, rows + BW_SEGMENTS, 0);
+		last.resize(size);
+		if (!size) return;
+
+		// Row 0 is preceded by the last byte of the text
+		size_t j = 0;
+		last[j++] = text[size - 1];
+
+		for (size_t i = 0; i < size; ++i) {
+			if (!sa[i]) rows[0] = i + 1;
+			else        last[j++] = text[sa[i] - 1];
+		}
+
+		for (size_t segment = 0; segment + 1 < BW_SEGMENTS; ++segment) {
+			size_t end = segment_end(size, segment);
+			for (size_t i = 0; i < size; ++i)
+				if (sa[i] == end) rows[segment + 1] = i + 1;
+		}
+	}
+
+	// Walks the rows back from the end of every segment. Every link holds the row preceding a row (LF mapping)
+	// and the byte that precedes it, so a step is a single random access; the segments are walked in lockstep
+	// so that their accesses overlap instead of waiting for each other
+	template<typename Link>
+	static void walk_rows(std::string const& last, uint32_t const* rows, uint64_t const* first, std::string& text) {
+		size_t size = last.size();
+		std::vector<Link> links(size + 1);
+		uint64_t seen[ALPHABET] = { 0 };
+
+		for (size_t row = 0, j = 0; row <= size; ++row) {
+			if (row == rows[0]) continue; // the sentinel, never walked through
+
+			uint8_t c = last[j++];
+			links[row] = static_cast<Link>(first[c] + seen[c]++) << CHAR_BIT | c;
+		}
+
+		// Segment s starts at the row of the end of segment s - 1 (the last one at row 0)
+		Link   link[BW_SEGMENTS];
+		size_t pos[BW_SEGMENTS];
+		size_t steps = size;
+
+		for (size_t segment = 0; segment < BW_SEGMENTS; ++segment) {
+			size_t start = segment ? segment_end(size, segment - 1) : 0;
+			pos[segment]  = segment_end(size, segment);
+			link[segment] = links[segment + 1 < BW_SEGMENTS ? rows[segment + 1] : 0];
+			steps = std::min(steps, pos[segment] - start);
+		}
+
+		char* p = &text[0];
+
+		for (size_t step = 0; step < steps; ++step)
+			for (size_t segment = 0; segment < BW_SEGMENTS; ++segment) {
+				p[--pos[segment]] = static_cast<char>(link[segment] & 0xFF);
+				link[segment]     = links[link[segment] >> CHAR_BIT];
+			}
+
+		for (size_t segment = 0; segment < BW_SEGMENTS; ++segment) {
+			size_t start = segment ? segment_end(size, segment - 1) : 0;
+			while (pos[segment] > start) {
+				p[--pos[segment]] = static_cast<char>(link[segment] & 0xFF);
+				link[segment]     = links[link[segment] >> CHAR_BIT];
+			}
+		}
+	}
+
+	// Undoes bwt, false if the rows do not fit
+	static bool inverse_bwt(std::string const& last, uint32_t const* rows, std::string& text) {
+		size_t size = last.size();
+
+		for (size_t segment = 0; segment < BW_SEGMENTS; ++segment)
+			if (rows[segment] > size) return false;
+		if (size && !rows[0]) return false;
+
+		text.resize(size);
+		if (!size) return true;
+
+		// First row of every byte in the sorted first column (row 0 is the sentinel)
+		uint64_t first[ALPHABET + 1] = { 0 };
+		for (const auto& c : last)
+			++first[static_cast<uint8_t>(c) + 1];
+		first[0] = 1;
+		for (size_t c = 1; c <= ALPHABET; ++c)
+			first[c] += first[c - 1];
+
+		// Rows and bytes share 32 bits in blocks of up to 16 MiB
+		if (size < (size_t(1) << 24)) walk_rows<uint32_t>(last, rows, first, text);
+		else                          walk_rows<uint64_t>(last, rows, first, text);
+
+		return true;
+	}
+
+	// Move-to-front with zero runs coded as RUN_A/RUN_B digits
+	static void mtf_encode(std::string const& last, std::string& out) {
+		uint8_t order[ALPHABET];
+		for (size_t c = 0; c < ALPHABET; ++c)
+			order[c] = c;
+
+		out.clear();
+		out.reserve(last.size() / 2 + 16);
+
+		uint64_t run = 0;
+
+		auto flush_run = [&] {
+			// Bijective base 2: digits RUN_A = 1 and RUN_B = 2, least significant first
+			for (; run; run = (run - 1) >> 1)
+				out.push_back(run & 1 ? RUN_A : RUN_B);
+		};
+
+		for (const auto& ch : last) {
+			uint8_t c = ch;
+
+			if (order[0] == c) {
+				++run;
+				continue;
+			}
+
+			flush_run();
+
+			size_t rank = 1;
+			while (order[rank] != c) ++rank;
+			std::memmove(order + 1, order, rank);
+			order[0] = c;
+
+			if (rank + 1 < ESCAPE) out.push_back(rank + 1);
+			else {
+				out.push_back(ESCAPE);
+				out.push_back(rank + 1 - ESCAPE);
+			}
+		}
+
+		flush_run();
+	}
+
+	// Undoes mtf_encode, false on malformed input or more than "limit" bytes
+	static bool mtf_decode(std::string const& in, std::string& last, size_t limit) {
+		uint8_t order[ALPHABET];
+		for (size_t c = 0; c < ALPHABET; ++c)
+			order[c] = c;
+
+		last.clear();
+		last.reserve(in.size());
+
+		uint64_t run    = 0;
+		uint64_t weight = 1;
+
+		for (size_t i = 0; i < in.size(); ++i) {
+			uint8_t symbol = in[i];
+
+			if (symbol == RUN_A || symbol == RUN_B) {
+				if (weight > limit) return false;
+				run    += symbol == RUN_A ? weight : 2 * weight;
+				weight <<= 1;
+				if (run > limit - last.size()) return false;
+				continue;
+			}
+
+			last.append(run, static_cast<char>(order[0]));
+			run    = 0;
+			weight = 1;
+
+			size_t rank = symbol - 1;
+			if (symbol == ESCAPE) {
+				if (++i == in.size()) return false;
+				rank = ESCAPE - 1 + static_cast<uint8_t>(in[i]);
+				if (rank >= ALPHABET) return false;
+			}
+
+			uint8_t c = order[rank];
+			std::memmove(order + 1, order, rank);
+			order[0] = c;
+
+			if (last.size() == limit) return false;
+			last.push_back(c);
+		}
+
+		last.append(run, static_cast<char>(order[0]));
+		return true;
+	}
+
+	// Timers and counters of the back end, but the symbols are those of the text
+	static void add_backend(Stats& stats, Stats const& backend) {
+		for (size_t stage = 0; stage < STAGE_NUM; ++stage)
+			stats.add_time(static_cast<stage_t>(stage), backend.time_ns(static_cast<stage_t>(stage)));
+
+		for (size_t counter = 0; counter < COUNTER_NUM; ++counter)
+			if (counter != SYMBOLS_COUNTER)
+				stats.add(static_cast<counter_t>(counter), backend.count(static_cast<counter_t>(counter)));
+	}
+
+	// -------------------------------------------------------
+	// ---------------------- CODERIMPL ----------------------
+	// -------------------------------------------------------
+
+	class bwcoder::CoderImpl {
+		Stats       m_stats;
+		backend_t   m_backend;
+		bool        m_good;
+		std::string m_text;
+		std::string m_last;
+		std::string m_mtf;
+
+		template<typename Coder>
+		void run_backend(std::ostream& ofile) {
+			std::istringstream imtf(m_mtf);
+			Coder coder;
+			coder(imtf, ofile);
+			add_backend(m_stats, coder.stats());
+		}
+
+	public:
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+			m_good = true;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+				m_text.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+			}
+
+			// SA-IS sorts the text and the sentinel with 32-bit signed positions, longer texts go through the
+			// block container
+			if (m_text.size() >= INT32_MAX) {
+				std::cerr << "bwcoder::compress: Text too long for one suffix array, code it in blocks" << std::endl;
+				m_good = false;
+				return;
+			}
+
+			uint32_t rows[BW_SEGMENTS];
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				bwt(m_text, m_last, rows);
+				mtf_encode(m_last, m_mtf);
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, m_text.size());
+
+			{
+				ScopedTimer timer(m_stats, OUTPUT_STAGE);
+				ofile.write(reinterpret_cast<const char*>(rows), sizeof(rows));
+				ofile.put(m_backend);
+			}
+
+			if (m_backend == BW_HUFFMAN) run_backend<staticcodes::ihcoder>(ofile);
+			else                         run_backend<staticcodes::acoder>(ofile);
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			compress(ifile, ofile);
+		}
+
+		void set_backend(backend_t backend) {
+			m_backend = backend < BW_BACKEND_NUM ? backend : DEFAULT_BACKEND;
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		bool good() const {
+			return m_good;
+		}
+
+		CoderImpl(std::istream& ifile, std::ostream& ofile) : m_backend(DEFAULT_BACKEND), m_good(true) {
+			compress(ifile, ofile);
+		}
+
+		CoderImpl() : m_backend(DEFAULT_BACKEND), m_good(true)
+		{ }
+	};
+
+	void bwcoder::compress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->compress(ifile, ofile);
+	}
+
+	void bwcoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	void bwcoder::set_backend(backend_t backend) {
+		m_pImpl->set_backend(backend);
+	}
+
+	Stats const& bwcoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bool bwcoder::good() const {
+		return m_pImpl->good();
+	}
+
+	bwcoder::bwcoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new CoderImpl(ifile, ofile))
+	{ }
+
+	bwcoder::bwcoder(sharedmodels::Model const& /* model */)
+		: m_pImpl(new CoderImpl)
+	{ }
+
+	bwcoder::bwcoder() : m_pImpl(new CoderImpl)
+	{ }
+
+	bwcoder::~bwcoder()
+	{ }
+
+	// -------------------------------------------------------
+	// --------------------- DECODERIMPL ---------------------
+	// -------------------------------------------------------
+
+	class bwdecoder::DecoderImpl {
+		Stats       m_stats;
+		uint64_t    m_limit;
+		std::string m_mtf;
+		std::string m_last;
+		std::string m_text;
+
+		void fail(char const* what) {
+			std::cerr << "bwdecoder::decompress: " << what << std::endl;
+		}
+
+		template<typename Decoder>
+		void run_backend(std::istream& ifile) {
+			std::ostringstream omtf;
+			Decoder decoder;
+			decoder(ifile, omtf);
+			add_backend(m_stats, decoder.stats());
+			m_mtf = omtf.str();
+		}
+
+	public:
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
+			uint32_t rows[BW_SEGMENTS];
+			int      backend;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+				ifile.read(reinterpret_cast<char*>(rows), sizeof(rows));
+				backend = ifile.get();
+			}
+
+			if (!ifile || backend < 0 || backend >= BW_BACKEND_NUM) {
+				fail("Truncated or invalid header");
+				return;
+			}
+
+			if (backend == BW_HUFFMAN) run_backend<staticcodes::ihdecoder>(ifile);
+			else                       run_backend<staticcodes::adecoder>(ifile);
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+
+				if (!mtf_decode(m_mtf, m_last, m_limit) || !inverse_bwt(m_last, rows, m_text)) {
+					fail("Malformed transformed text");
+					return;
+				}
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, m_text.size());
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(m_text.data(), m_text.size());
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		void set_limit(uint64_t symbols) {
+			m_limit = symbols;
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		DecoderImpl(std::istream& ifile, std::ostream& ofile) : m_limit(UINT32_MAX) {
+			decompress(ifile, ofile);
+		}
+
+		DecoderImpl(uint64_t limit) : m_limit(limit)
+		{ }
+
+		DecoderImpl() : m_limit(UINT32_MAX)
+		{ }
+	};
+
+	void bwdecoder::decompress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->decompress(ifile, ofile);
+	}
+
+	void bwdecoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	void bwdecoder::set_limit(uint64_t symbols) {
+		m_pImpl->set_limit(symbols);
+	}
+
+	Stats const& bwdecoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bwdecoder::bwdecoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new DecoderImpl(ifile, ofile))
+	{ }
+
+	bwdecoder::bwdecoder(sharedmodels::Model const& /* model */, uint64_t symbols)
+		: m_pImpl(new DecoderImpl(symbols))
+	{ }
+
+	bwdecoder::bwdecoder() : m_pImpl(new DecoderImpl)
+	{ }
+
+	bwdecoder::~bwdecoder()
+	{ }
+
+}
@@ -0,0 +1,130 @@
+/**
+ * bwcoder.hxx
+ *
+ * Block-Sorting (BWT + MTF + RLE) Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef BWCODER_HXX
+#define BWCODER_HXX
+
+#include <iostream>
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <memory>
+#include "instrument.hxx"
+#include "models.hxx"
+
+/**
+ * Coded text layout:
+ *
+ *   primary index (4 bytes) | rows of 7 segment ends (4 bytes each) | back end (1 byte) | transformed text
+ *
+ * The text goes through the Burrows-Wheeler transform (sorted with SA-IS in linear time), move-to-front and
+ * zero-run-length coding (bijective base 2, as in bzip2), which leaves a byte stream of mostly small values
+ * for one of the existing order-0 coders. MTF values 254 and 255 are escaped as 255 and a byte. The rows
+ * of the segment ends let the decoder undo the transform along eight independent walks.
+ */
+
+namespace sortcodes {
+
+	enum backend_t {
+		BW_HUFFMAN    = 0, // four-stream canonical Huffman (huffman4), fast to decode
+		BW_ARITHMETIC = 1, // arithmetic coding, smaller output
+		BW_BACKEND_NUM
+	};
+
+	static constexpr backend_t DEFAULT_BACKEND = BW_ARITHMETIC;
+
+	// Suffix array of the text (sa gets "size" positions), built with SA-IS in linear time
+	void suffix_array(uint8_t const* text, size_t size, uint32_t* sa);
+
+	// -------------------------------------------------------
+	// ----------------------- BWCODER -----------------------
+	// -------------------------------------------------------
+
+	class bwcoder {
+		class CoderImpl;
+		std::unique_ptr<CoderImpl> m_pImpl;
+
+	public:
+
+		// Transforms text and writes it coded by the back end to the output file
+		void compress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Back end of the following compress calls, recorded in the coded text
+		void set_backend(backend_t backend);
+
+		// Stage timers and counters of the last compress call (the back end included)
+		instrumentation::Stats const& stats() const;
+
+		// False if the last compress call refused a text too long for one suffix array, nothing is written then
+		bool good() const;
+
+		bwcoder(std::istream& ifile, std::ostream& ofile);
+
+		// Shared models hold statistics of texts, not of transformed ones, so they are not used
+		explicit bwcoder(sharedmodels::Model const& model);
+
+		bwcoder();
+
+		~bwcoder();
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- BWDECODER ----------------------
+	// -------------------------------------------------------
+
+	class bwdecoder {
+		class DecoderImpl;
+		std::unique_ptr<DecoderImpl> m_pImpl;
+
+	public:
+
+		// Decodes the back end, undoes the transforms and writes the text to the output file
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last decompress call (the back end included)
+		instrumentation::Stats const& stats() const;
+
+		// Makes the following decompress calls fail on texts longer than "symbols" (UINT32_MAX by default),
+		// so that corrupted run lengths cannot blow the text up
+		void set_limit(uint64_t symbols);
+
+		bwdecoder(std::istream& ifile, std::ostream& ofile);
+
+		// Decodes a text coded with a shared model, which the coded text does not depend on
+		bwdecoder(sharedmodels::Model const& model, uint64_t symbols);
+
+		bwdecoder();
+
+		~bwdecoder();
+	};
+
+}
+
+#endif // BWCODER_HXX
@@ -0,0 +1,152 @@
+/**
+ * cache.cxx
+ *
+ * LRU Cache of Built Code Tables
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include "cache.hxx"
+
+namespace modelcache {
+
+	key_t histogram_key(char const* tag, uint32_t const* freq, size_t size) {
+		key_t key(tag);
+		key += '\0';
+		key.append(reinterpret_cast<char const*>(freq), size * sizeof(uint32_t));
+		return key;
+	}
+
+	key_t model_key(char const* tag, uint32_t model_id, size_t context) {
+		key_t key(tag);
+		key += '\1';
+		key += std::to_string(model_id);
+		key += '/';
+		key += std::to_string(context);
+		return key;
+	}
+
+	// -------------------------------------------------------
+	// --------------------- MODELCACHE ----------------------
+	// -------------------------------------------------------
+
+	void ModelCache::evict() {
+		while (m_bytes > m_capacity && !m_lru.empty()) {
+			m_bytes -= m_lru.back().bytes;
+			m_index.erase(m_lru.back().key);
+			m_lru.pop_back();
+			++m_evictions;
+		}
+	}
+
+	ModelCache::value_t ModelCache::find_value(key_t const& key) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_index.find(key);
+		if (it == m_index.end()) {
+			++m_misses;
+			return value_t();
+		}
+
+		++m_hits;
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+		return it->second->value;
+	}
+
+	void ModelCache::insert_value(key_t const& key, value_t value, size_t bytes) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		bytes += key.size();
+		if (bytes > m_capacity) return;
+
+		// Another thread may have built the same tables meanwhile, keep the first ones
+		if (m_index.count(key)) return;
+
+		entry_t entry;
+		entry.key   = key;
+		entry.value = value;
+		entry.bytes = bytes;
+
+		m_lru.push_front(entry);
+		m_index[key] = m_lru.begin();
+		m_bytes += bytes;
+
+		evict();
+	}
+
+	void ModelCache::set_capacity(size_t bytes) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_capacity = bytes;
+		evict();
+	}
+
+	size_t ModelCache::capacity() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_capacity;
+	}
+
+	size_t ModelCache::bytes() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_bytes;
+	}
+
+	size_t ModelCache::entries() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_lru.size();
+	}
+
+	uint64_t ModelCache::hits() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_hits;
+	}
+
+	uint64_t ModelCache::misses() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_misses;
+	}
+
+	uint64_t ModelCache::evictions() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_evictions;
+	}
+
+	void ModelCache::clear() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_lru.clear();
+		m_index.clear();
+		m_bytes = 0;
+	}
+
+	ModelCache& ModelCache::instance() {
+		static ModelCache cache;
+		return cache;
+	}
+
+	ModelCache::ModelCache()
+		: m_capacity(DEFAULT_CAPACITY), m_bytes(0), m_hits(0), m_misses(0), m_evictions(0)
+	{ }
+
+}
@@ -0,0 +1,128 @@
+/**
+ * cache.hxx
+ *
+ * LRU Cache of Built Code Tables
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef CACHE_HXX
+#define CACHE_HXX
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+
+namespace modelcache {
+
+	static constexpr size_t DEFAULT_CAPACITY = 64 << 20; // 64 MiB
+
+	// Tag of the coder that built the tables followed by what they were built from: either the frequency
+	// table itself (so equal keys always mean equal tables) or the id of a shared model
+	using key_t = std::string;
+
+	key_t histogram_key(char const* tag, uint32_t const* freq, size_t size);
+
+	key_t model_key(char const* tag, uint32_t model_id, size_t context = 0);
+
+	// -------------------------------------------------------
+	// --------------------- MODELCACHE ----------------------
+	// -------------------------------------------------------
+
+	// Process-wide LRU cache of built code trees and schemes, shared by all coder objects and threads.
+	// Tables are immutable once inserted and stay alive while a coder holds them, even if evicted
+	class ModelCache {
+		using value_t = std::shared_ptr<void const>;
+
+		struct entry_t {
+			key_t   key;
+			value_t value;
+			size_t  bytes;
+		};
+
+		using lru_t = std::list<entry_t>;
+
+		mutable std::mutex                          m_mutex;
+		lru_t                                       m_lru; // most recently used first
+		std::unordered_map<key_t, lru_t::iterator>  m_index;
+		size_t                                      m_capacity;
+		size_t                                      m_bytes;
+		uint64_t                                    m_hits;
+		uint64_t                                    m_misses;
+		uint64_t                                    m_evictions;
+
+		// Drops least recently used entries until the cache fits into its capacity
+		void evict();
+
+		value_t find_value(key_t const& key);
+
+		void insert_value(key_t const& key, value_t value, size_t bytes);
+
+	public:
+
+		// Returns the tables stored under the key or nullptr
+		template<typename Tables>
+		std::shared_ptr<Tables const> find(key_t const& key) {
+			return std::static_pointer_cast<Tables const>(find_value(key));
+		}
+
+		// Stores tables taking approximately "bytes" of memory (ignored if larger than the whole capacity)
+		template<typename Tables>
+		void insert(key_t const& key, std::shared_ptr<Tables const> tables, size_t bytes) {
+			insert_value(key, std::static_pointer_cast<void const>(tables), bytes);
+		}
+
+		// Memory bound in bytes, 0 disables caching
+		void set_capacity(size_t bytes);
+
+		size_t capacity() const;
+
+		// Approximate memory taken by the cached tables
+		size_t bytes() const;
+
+		size_t entries() const;
+
+		uint64_t hits() const;
+
+		uint64_t misses() const;
+
+		uint64_t evictions() const;
+
+		void clear();
+
+		// The cache of the process
+		static ModelCache& instance();
+
+		ModelCache(ModelCache const&) = delete;
+		ModelCache& operator=(ModelCache const&) = delete;
+
+	private:
+		ModelCache();
+	};
+
+}
+
+#endif // CACHE_HXX
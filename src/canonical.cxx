@@ -0,0 +1,204 @@
+/**
+ * canonical.cxx
+ *
+ * Canonical Length-Limited Huffman Codes
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cstdlib>    // size_t
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <utility>    // std::pair
+#include <algorithm>  // std::sort
+#include <functional> // std::greater
+#include "canonical.hxx"
+
+namespace canonicalcodes {
+
+	// ------------------------------------------------------
+	// ---------------------- LENGTHS -----------------------
+	// ------------------------------------------------------
+
+	lengths_t code_lengths(uint32_t const* freq, size_t size, unsigned max_len) {
+		lengths_t lengths(size, 0);
+
+		std::vector<size_t> symbols;
+		for (size_t i = 0; i < size; ++i)
+			if (freq[i]) symbols.push_back(i);
+
+		if (symbols.empty()) return lengths;
+		if (symbols.size() == 1) {
+			lengths[symbols.front()] = 1;
+			return lengths;
+		}
+
+		// Huffman tree as parent links: leaves first, then internal nodes in the order they are merged
+		using pair_t = std::pair<uint64_t, size_t>;
+		std::priority_queue<pair_t, std::vector<pair_t>, std::greater<pair_t> > queue;
+		std::vector<size_t> parent(2 * symbols.size() - 1, 0);
+
+		for (size_t i = 0; i < symbols.size(); ++i)
+			queue.push(pair_t(freq[symbols[i]], i));
+
+		for (size_t node = symbols.size(); queue.size() > 1; ++node) {
+			pair_t child1 = queue.top(); queue.pop();
+			pair_t child2 = queue.top(); queue.pop();
+
+			parent[child1.second] = parent[child2.second] = node;
+			queue.push(pair_t(child1.first + child2.first, node));
+		}
+
+		// Parents come after their children, so depths are known walking down from the root
+		std::vector<unsigned> depth(parent.size(), 0);
+		for (size_t node = parent.size() - 1; node--; )
+			depth[node] = depth[parent[node]] + 1;
+
+		bool clipped = false;
+		for (size_t i = 0; i < symbols.size(); ++i) {
+			clipped |= depth[i] > max_len;
+			lengths[symbols[i]] = depth[i] > max_len ? max_len : depth[i];
+		}
+
+		if (!clipped) return lengths;
+
+		// Kraft sum in units of the longest code: the code is prefix-free while it does not exceed "full"
+		uint64_t full  = uint64_t(1) << max_len;
+		uint64_t kraft = 0;
+		for (const auto& symbol : symbols)
+			kraft += full >> lengths[symbol];
+
+		// Rarest symbols first
+		std::sort(symbols.begin(), symbols.end(), [&](size_t lhs, size_t rhs) {
+			return freq[lhs] < freq[rhs] || (freq[lhs] == freq[rhs] && lhs < rhs);
+		});
+
+		// Lengthening the longest code below the limit costs the least
+		while (kraft > full) {
+			size_t best = symbols.size();
+			for (size_t i = 0; i < symbols.size(); ++i)
+				if (lengths[symbols[i]] < max_len && (best == symbols.size() || lengths[symbols[i]] > lengths[symbols[best]]))
+					best = i;
+
+			uint8_t& len = lengths[symbols[best]];
+			++len;
+			kraft -= full >> len;
+		}
+
+		// Spend what is left of the code space on shortening the most frequent codes
+		for (size_t i = symbols.size(); i--; ) {
+			uint8_t& len = lengths[symbols[i]];
+			while (len > 1 && kraft + (full >> len) <= full) {
+				kraft += full >> len;
+				--len;
+			}
+		}
+
+		return lengths;
+	}
+
+	void write_lengths(std::ostream& ofile, lengths_t const& lengths) {
+		for (size_t i = 0; i < lengths.size(); i += 2) {
+			uint8_t byte = lengths[i] << 4;
+			if (i + 1 < lengths.size()) byte |= lengths[i + 1];
+			ofile.put(byte);
+		}
+	}
+
+	bool read_lengths(std::istream& ifile, lengths_t& lengths, size_t size) {
+		lengths.assign(size, 0);
+
+		for (size_t i = 0; i < size; i += 2) {
+			int byte = ifile.get();
+			if (byte == EOF) return false;
+
+			lengths[i] = byte >> 4;
+			if (i + 1 < size) lengths[i + 1] = byte & 0x0F;
+		}
+
+		return true;
+	}
+
+	// -------------------------------------------------------
+	// ------------------- CANONICALCODE ---------------------
+	// -------------------------------------------------------
+
+	bool CanonicalCode::assign(lengths_t const& lengths) {
+		m_codes.assign(lengths.size(), code_t());
+		m_table_bits = 0;
+
+		std::vector<size_t> count(MAX_CODE_LEN + 1, 0);
+		for (const auto& len : lengths) {
+			if (len > MAX_CODE_LEN) return false;
+			++count[len];
+			if (len > m_table_bits) m_table_bits = len;
+		}
+
+		if (!m_table_bits) {
+			m_table.assign(1, entry_t());
+			return true;
+		}
+
+		// Kraft inequality
+		uint64_t kraft = 0;
+		for (size_t len = 1; len <= MAX_CODE_LEN; ++len)
+			kraft += static_cast<uint64_t>(count[len]) << (MAX_CODE_LEN - len);
+
+		if (kraft > (uint64_t(1) << MAX_CODE_LEN)) return false;
+
+		// First code of every length: codes of a length follow the last code of the previous one, shifted
+		std::vector<uint32_t> next(MAX_CODE_LEN + 1, 0);
+		uint32_t code = 0;
+		count[0] = 0;
+
+		for (size_t len = 1; len <= MAX_CODE_LEN; ++len) {
+			code = (code + count[len - 1]) << 1;
+			next[len] = code;
+		}
+
+		// Bit patterns of no code (a single symbol or a broken table) decode as symbol 0, so that malformed
+		// input never stalls the decoder
+		entry_t filler = { 0, 1 };
+		m_table.assign(size_t(1) << m_table_bits, filler);
+
+		for (size_t symbol = 0; symbol < lengths.size(); ++symbol) {
+			uint8_t len = lengths[symbol];
+			if (!len) continue;
+
+			m_codes[symbol].bits = next[len]++;
+			m_codes[symbol].len  = len;
+
+			entry_t entry = { static_cast<uint16_t>(symbol), len };
+			size_t  shift = m_table_bits - len;
+			size_t  first = static_cast<size_t>(m_codes[symbol].bits) << shift;
+
+			std::fill(m_table.begin() + first, m_table.begin() + first + (size_t(1) << shift), entry);
+		}
+
+		return true;
+	}
+
+	CanonicalCode::CanonicalCode() : m_table_bits(0)
+	{ }
+
+}
@@ -0,0 +1,195 @@
+/**
+ * canonical.hxx
+ *
+ * Canonical Length-Limited Huffman Codes
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef CANONICAL_HXX
+#define CANONICAL_HXX
+
+#include <iostream>
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <string>
+#include <vector>
+
+namespace canonicalcodes {
+
+	// Longest code that can be stored (lengths take 4 bits) and the limit of the table-driven decoders,
+	// which keeps a decoding table in the L1 cache
+	static constexpr unsigned MAX_CODE_LEN     = 15;
+	static constexpr unsigned DEFAULT_CODE_LEN = 12;
+
+	using lengths_t = std::vector<uint8_t>;
+
+	// Code lengths of a Huffman code for the frequencies, limited to max_len bits (0 for symbols that do not
+	// occur, 1 for the only one); codes cut to max_len are paid for by lengthening the rarest shorter codes
+	lengths_t code_lengths(uint32_t const* freq, size_t size, unsigned max_len = DEFAULT_CODE_LEN);
+
+	// Bytes taken by the stored lengths of an alphabet
+	inline size_t lengths_size(size_t size) { return (size + 1) / 2; }
+
+	// Writes the lengths two per byte
+	void write_lengths(std::ostream& ofile, lengths_t const& lengths);
+
+	// Reads "size" lengths, false on a truncated table
+	bool read_lengths(std::istream& ifile, lengths_t& lengths, size_t size);
+
+	struct code_t {
+		uint32_t bits;
+		uint8_t  len;
+	};
+
+	struct entry_t {
+		uint16_t symbol;
+		uint8_t  len;
+	};
+
+	// -------------------------------------------------------
+	// ------------------- CANONICALCODE ---------------------
+	// -------------------------------------------------------
+
+	// Codes are assigned in the order of (length, symbol), so the lengths alone define the code. Decoding looks
+	// up the next table_bits() bits in a table holding the symbol and the length of the code they start with
+	class CanonicalCode {
+		std::vector<code_t>  m_codes;
+		std::vector<entry_t> m_table;
+		unsigned             m_table_bits;
+
+	public:
+
+		// False if the lengths do not form a prefix code or exceed MAX_CODE_LEN
+		bool assign(lengths_t const& lengths);
+
+		code_t const& code(size_t symbol) const { return m_codes[symbol]; }
+
+		entry_t const* table() const { return m_table.data(); }
+
+		unsigned table_bits() const { return m_table_bits; }
+
+		size_t size() const { return m_codes.size(); }
+
+		// Memory taken by the code and the table
+		size_t bytes() const { return sizeof(*this) + m_codes.size() * sizeof(code_t) + m_table.size() * sizeof(entry_t); }
+
+		CanonicalCode();
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- BITWRITER ----------------------
+	// -------------------------------------------------------
+
+	// Appends codes (up to 32 bits, first bit first) to a string
+	class BitWriter {
+		std::string& m_out;
+		uint64_t     m_bits;
+		unsigned     m_count;
+
+	public:
+		void put(uint32_t bits, unsigned len) {
+			m_bits  |= static_cast<uint64_t>(bits) << (64 - m_count - len);
+			m_count += len;
+
+			if (m_count >= 32) {
+				char buf[4] = {
+					static_cast<char>(m_bits >> 56), static_cast<char>(m_bits >> 48),
+					static_cast<char>(m_bits >> 40), static_cast<char>(m_bits >> 32)
+				};
+				m_out.append(buf, sizeof(buf));
+				m_bits  <<= 32;
+				m_count  -= 32;
+			}
+		}
+
+		void put(code_t const& code) {
+			put(code.bits, code.len);
+		}
+
+		// Writes the last bits padded with zeros
+		void flush() {
+			for (; m_count; m_count = m_count > 8 ? m_count - 8 : 0) {
+				m_out.push_back(static_cast<char>(m_bits >> 56));
+				m_bits <<= 8;
+			}
+		}
+
+		explicit BitWriter(std::string& out) : m_out(out), m_bits(0), m_count(0)
+		{ }
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- BITREADER ----------------------
+	// -------------------------------------------------------
+
+	// Reads bits first bit first from a buffer, past its end as zeros. After refill() there are at least
+	// 56 bits to peek at
+	class BitReader {
+		uint8_t const* m_ptr;
+		uint8_t const* m_end;
+		uint64_t       m_bits;
+		unsigned       m_count;
+
+	public:
+		void refill() {
+			if (m_end - m_ptr >= 8) {
+				uint64_t next;
+				std::memcpy(&next, m_ptr, sizeof(next));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+				next = __builtin_bswap64(next);
+#endif
+				// Bits beyond the count are the same data the next refill ORs in again
+				m_bits  |= next >> m_count;
+				m_ptr   += (63 - m_count) >> 3;
+				m_count += ((63 - m_count) >> 3) << 3;
+				return;
+			}
+
+			for (; m_count <= 56; m_count += 8)
+				m_bits |= static_cast<uint64_t>(m_ptr < m_end ? *m_ptr++ : 0) << (56 - m_count);
+		}
+
+		// The next n bits (1 to 56) as a number
+		uint64_t peek(unsigned n) const { return m_bits >> (64 - n); }
+
+		void skip(unsigned n) {
+			m_bits  <<= n;
+			m_count  -= n;
+		}
+
+		// Decodes a symbol
+		uint16_t decode(entry_t const* table, unsigned table_bits) {
+			entry_t const& entry = table[peek(table_bits)];
+			skip(entry.len);
+			return entry.symbol;
+		}
+
+		BitReader(uint8_t const* data, size_t size) : m_ptr(data), m_end(data + size), m_bits(0), m_count(0) {
+			refill();
+		}
+	};
+
+}
+
+#endif // CANONICAL_HXX
@@ -0,0 +1,332 @@
+/**
+ * dedup.cxx
+ *
+ * Content-Defined Chunking and Deduplication
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cstdlib>   // size_t
+#include <cstdint>
+#include <cstring>   // std::memcpy, std::memcmp
+#include <string>
+#include <vector>
+#include <algorithm> // std::min
+#include "blocks.hxx"
+#include "dedup.hxx"
+
+namespace dedupcodes {
+
+	// ------------------------------------------------------
+	// ---------------------- CHUNKING ----------------------
+	// ------------------------------------------------------
+
+	// The gear hash shifts one bit per byte, so its top bits depend on the last 64 bytes only
+	static constexpr uint64_t MASK_SMALL = ~0ULL << (64 - 15); // before AVG_CHUNK (2^13): harder to hit
+	static constexpr uint64_t MASK_LARGE = ~0ULL << (64 - 11); // after it: easier
+
+	// Random numbers for every byte value, from splitmix64 with a fixed seed so that cuts never change
+	struct gear_t {
+		uint64_t table[256];
+
+		gear_t() {
+			uint64_t x = 0x6C6962636F646572ULL;
+
+			for (size_t i = 0; i < 256; ++i) {
+				uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+				table[i] = z ^ (z >> 31);
+			}
+		}
+	};
+
+	size_t chunk_length(uint8_t const* data, size_t size) {
+		static gear_t const gear;
+
+		if (size <= MIN_CHUNK) return size;
+
+		size_t   normal = std::min(AVG_CHUNK, size);
+		size_t   end    = std::min(MAX_CHUNK, size);
+		uint64_t hash   = 0;
+		size_t   i      = MIN_CHUNK;
+
+		for (; i < normal; ++i) {
+			hash = (hash << 1) + gear.table[data[i]];
+			if (!(hash & MASK_SMALL)) return i + 1;
+		}
+
+		for (; i < end; ++i) {
+			hash = (hash << 1) + gear.table[data[i]];
+			if (!(hash & MASK_LARGE)) return i + 1;
+		}
+
+		return end;
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- HASHER -----------------------
+	// ------------------------------------------------------
+
+	// MurmurHash64A mixing of 8-byte words, the size goes in at the end instead of the start
+	static constexpr uint64_t MURMUR_MUL   = 0xC6A4A7935BD1E995ULL;
+	static constexpr int      MURMUR_SHIFT = 47;
+
+	static inline uint64_t mix(uint64_t state, uint64_t word) {
+		word *= MURMUR_MUL;
+		word ^= word >> MURMUR_SHIFT;
+		word *= MURMUR_MUL;
+		return (state ^ word) * MURMUR_MUL;
+	}
+
+	static inline uint64_t load_le64(uint8_t const* p) {
+		uint64_t word = 0;
+		for (size_t i = 0; i < 8; ++i)
+			word |= static_cast<uint64_t>(p[i]) << (8 * i);
+		return word;
+	}
+
+	Hasher::Hasher() : m_state(0x8445D61A4E774912ULL), m_size(0)
+	{ }
+
+	void Hasher::update(char const* data, size_t size) {
+		uint8_t const* p    = reinterpret_cast<uint8_t const*>(data);
+		size_t         tail = m_size % 8;
+
+		m_size += size;
+
+		// Complete the word left over from the last piece first
+		if (tail) {
+			size_t take = std::min(8 - tail, size);
+			std::memcpy(m_tail + tail, p, take);
+			p    += take;
+			size -= take;
+			if (tail + take < 8) return;
+
+			m_state = mix(m_state, load_le64(m_tail));
+		}
+
+		for (; size >= 8; p += 8, size -= 8)
+			m_state = mix(m_state, load_le64(p));
+
+		std::memcpy(m_tail, p, size);
+	}
+
+	uint64_t Hasher::digest() const {
+		uint64_t state = m_state;
+		size_t   tail  = m_size % 8;
+
+		if (tail) {
+			uint64_t word = 0;
+			for (size_t i = 0; i < tail; ++i)
+				word |= static_cast<uint64_t>(m_tail[i]) << (8 * i);
+			state = (state ^ word) * MURMUR_MUL;
+		}
+
+		state ^= m_size * MURMUR_MUL;
+		state ^= state >> MURMUR_SHIFT;
+		state *= MURMUR_MUL;
+		state ^= state >> MURMUR_SHIFT;
+		return state;
+	}
+
+	uint64_t fingerprint(char const* data, size_t size) {
+		Hasher hasher;
+		hasher.update(data, size);
+		return hasher.digest();
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- RECIPE -----------------------
+	// ------------------------------------------------------
+
+	static constexpr char    RECIPE_MAGIC[]  = { 'L', 'C', 'D', 'R' };
+	static constexpr uint8_t RECIPE_VERSION  = 1;
+	static constexpr size_t  COPY_SIZE       = 1 << 20; // 1 MiB
+
+	// magic | version | varint size | 8-byte digest | varint extents | (varint offset, varint size) per extent
+	void write_recipe(std::ostream& ofile, recipe_t const& recipe) {
+		ofile.write(RECIPE_MAGIC, sizeof(RECIPE_MAGIC));
+		ofile.put(RECIPE_VERSION);
+		blockcodes::write_varint(ofile, recipe.size);
+
+		for (size_t i = 0; i < 8; ++i)
+			ofile.put(static_cast<char>(recipe.digest >> (8 * i)));
+
+		blockcodes::write_varint(ofile, recipe.extents.size());
+		for (const auto& extent : recipe.extents) {
+			blockcodes::write_varint(ofile, extent.offset);
+			blockcodes::write_varint(ofile, extent.size);
+		}
+	}
+
+	// Extents must be nonempty and add up to the size
+	bool read_recipe(std::istream& ifile, recipe_t& recipe) {
+		char header[sizeof(RECIPE_MAGIC) + 1 + 8];
+		uint64_t count;
+
+		recipe = recipe_t();
+
+		if (!ifile.read(header, sizeof(RECIPE_MAGIC) + 1) || std::memcmp(header, RECIPE_MAGIC, sizeof(RECIPE_MAGIC)) ||
+		    header[sizeof(RECIPE_MAGIC)] != RECIPE_VERSION || !blockcodes::read_varint(ifile, recipe.size) ||
+		    !ifile.read(header, 8) || !blockcodes::read_varint(ifile, count) || count > recipe.size)
+			return false;
+
+		recipe.digest = load_le64(reinterpret_cast<uint8_t const*>(header));
+
+		uint64_t total = 0;
+		for (uint64_t i = 0; i < count; ++i) {
+			extent_t extent;
+			if (!blockcodes::read_varint(ifile, extent.offset) || !blockcodes::read_varint(ifile, extent.size) ||
+			    !extent.size || extent.size > recipe.size - total)
+				return false;
+
+			total += extent.size;
+			recipe.extents.push_back(extent);
+		}
+
+		return total == recipe.size && ifile.peek() == EOF;
+	}
+
+	bool rebuild(recipe_t const& recipe, std::istream& store, uint64_t store_size, std::ostream& ofile, std::string& error) {
+		Hasher      hasher;
+		std::string buffer;
+
+		for (const auto& extent : recipe.extents) {
+			if (extent.offset > store_size || extent.size > store_size - extent.offset) {
+				error = "Recipe refers past the end of the chunk store";
+				return false;
+			}
+
+			store.seekg(extent.offset);
+
+			for (uint64_t left = extent.size; left; ) {
+				size_t piece = std::min<uint64_t>(left, COPY_SIZE);
+				buffer.resize(piece);
+
+				if (!store.read(&buffer[0], piece)) {
+					error = "Read error";
+					return false;
+				}
+
+				hasher.update(buffer.data(), piece);
+				ofile.write(buffer.data(), piece);
+				left -= piece;
+			}
+		}
+
+		if (hasher.digest() != recipe.digest) {
+			error = "File does not match its recipe, wrong chunk store";
+			return false;
+		}
+
+		return true;
+	}
+
+	// ------------------------------------------------------
+	// --------------------- CHUNKSTORE ---------------------
+	// ------------------------------------------------------
+
+	static constexpr size_t READ_SIZE = 1 << 20; // 1 MiB
+
+	ChunkStore::ChunkStore(std::iostream& text)
+		: m_text(text), m_size(0), m_chunks(0), m_unique_chunks(0), m_deduplicated(0)
+	{ }
+
+	// A fingerprint collision only costs the later chunk its deduplication, the index keeps the first one
+	bool ChunkStore::intern(char const* data, size_t size, uint64_t& offset) {
+		uint64_t key = fingerprint(data, size);
+		auto     it  = m_index.find(key);
+
+		++m_chunks;
+
+		if (it != m_index.end() && it->second.size == size) {
+			m_stored.resize(size);
+			m_text.seekg(it->second.offset);
+			if (!m_text.read(&m_stored[0], size)) return false;
+
+			if (!std::memcmp(m_stored.data(), data, size)) {
+				offset          = it->second.offset;
+				m_deduplicated += size;
+				return true;
+			}
+		}
+
+		offset = m_size;
+		m_text.seekp(m_size);
+		if (!m_text.write(data, size)) return false;
+
+		m_size += size;
+		++m_unique_chunks;
+
+		if (it == m_index.end())
+			m_index.emplace(key, entry_t{ offset, size });
+
+		return true;
+	}
+
+	// The buffer always holds a whole MAX_CHUNK ahead unless the file ends sooner, so cuts do not depend on reads
+	bool ChunkStore::add(std::istream& ifile, recipe_t& recipe) {
+		Hasher hasher;
+		size_t pos = 0;
+		bool   eof = false;
+
+		recipe = recipe_t();
+		m_buffer.clear();
+
+		for (;;) {
+			if (!eof && m_buffer.size() - pos < MAX_CHUNK) {
+				m_buffer.erase(0, pos);
+				pos = 0;
+
+				size_t have = m_buffer.size();
+				m_buffer.resize(have + READ_SIZE);
+				ifile.read(&m_buffer[have], READ_SIZE);
+				m_buffer.resize(have + ifile.gcount());
+
+				if (ifile.bad()) return false;
+				eof = !ifile;
+			}
+
+			if (pos == m_buffer.size()) break;
+
+			char const* chunk = m_buffer.data() + pos;
+			size_t      size  = chunk_length(reinterpret_cast<uint8_t const*>(chunk), m_buffer.size() - pos);
+			uint64_t    offset;
+
+			if (!intern(chunk, size, offset)) return false;
+			hasher.update(chunk, size);
+
+			if (!recipe.extents.empty() && recipe.extents.back().offset + recipe.extents.back().size == offset)
+				recipe.extents.back().size += size;
+			else
+				recipe.extents.push_back(extent_t{ offset, size });
+
+			recipe.size += size;
+			pos         += size;
+		}
+
+		recipe.digest = hasher.digest();
+		return true;
+	}
+
+}
@@ -0,0 +1,136 @@
+/**
+ * dedup.hxx
+ *
+ * Content-Defined Chunking and Deduplication
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef DEDUP_HXX
+#define DEDUP_HXX
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/**
+ * Files are cut into chunks where a gear hash of the last 64 bytes hits a mask, so that equal content gives
+ * equal chunks whatever comes before it. A chunk store keeps the first occurrence of every chunk (found by
+ * fingerprint and compared byte for byte) and a file turns into a recipe: the extents of the store text it
+ * is made of, plus its size and digest. The store text is then coded like any other text.
+ */
+
+namespace dedupcodes {
+
+	static constexpr size_t MIN_CHUNK = 2  << 10; // 2 KiB
+	static constexpr size_t AVG_CHUNK = 8  << 10; // 8 KiB
+	static constexpr size_t MAX_CHUNK = 64 << 10; // 64 KiB
+
+	// Length of the chunk the data starts with: up to AVG_CHUNK cuts need more bits of the hash to be zero
+	// than after it, so that lengths gather around it; MIN_CHUNK to MAX_CHUNK bytes unless the data ends first
+	size_t chunk_length(uint8_t const* data, size_t size);
+
+	// 64-bit hash of a byte string fed in pieces (the same whatever the pieces)
+	class Hasher {
+		uint64_t m_state;
+		uint64_t m_size;
+		uint8_t  m_tail[8];
+
+	public:
+		void update(char const* data, size_t size);
+
+		uint64_t digest() const;
+
+		Hasher();
+	};
+
+	uint64_t fingerprint(char const* data, size_t size);
+
+	struct extent_t {
+		uint64_t offset; // in the store text
+		uint64_t size;
+	};
+
+	// What a file is rebuilt from: extents of the store text in order, adjacent ones merged
+	struct recipe_t {
+		uint64_t              size;
+		uint64_t              digest; // Hasher digest of the file
+		std::vector<extent_t> extents;
+
+		recipe_t() : size(0), digest(0) {}
+	};
+
+	void write_recipe(std::ostream& ofile, recipe_t const& recipe);
+
+	// False if the file is not a recipe or is malformed
+	bool read_recipe(std::istream& ifile, recipe_t& recipe);
+
+	// Writes the file of the recipe from a store text of store_size bytes, false (with the reason in error) on
+	// extents outside the text or a digest mismatch, which is what a store other than the recipe's gives
+	bool rebuild(recipe_t const& recipe, std::istream& store, uint64_t store_size, std::ostream& ofile, std::string& error);
+
+	// -------------------------------------------------------
+	// --------------------- CHUNKSTORE ----------------------
+	// -------------------------------------------------------
+
+	// Store text made of the first occurrences of the chunks of every file added to it, written to a
+	// seekable stream (read back to compare chunks with equal fingerprints). Not thread-safe
+	class ChunkStore {
+		struct entry_t {
+			uint64_t offset;
+			size_t   size;
+		};
+
+		std::iostream&                        m_text;
+		uint64_t                              m_size;
+		std::unordered_map<uint64_t, entry_t> m_index; // by fingerprint
+		uint64_t                              m_chunks;
+		uint64_t                              m_unique_chunks;
+		uint64_t                              m_deduplicated;
+		std::string                           m_buffer;
+		std::string                           m_stored;
+
+		// Offset of the chunk in the store text, appended unless already there; false on I/O errors
+		bool intern(char const* data, size_t size, uint64_t& offset);
+
+	public:
+		// Cuts the file into chunks, stores the new ones and fills its recipe; false on I/O errors
+		bool add(std::istream& ifile, recipe_t& recipe);
+
+		uint64_t size() const { return m_size; }
+
+		uint64_t chunks() const { return m_chunks; }
+
+		uint64_t unique_chunks() const { return m_unique_chunks; }
+
+		// Bytes of the added files taken by reference to chunks stored before
+		uint64_t deduplicated_bytes() const { return m_deduplicated; }
+
+		explicit ChunkStore(std::iostream& text);
+	};
+
+}
+
+#endif // DEDUP_HXX
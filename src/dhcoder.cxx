@@ -0,0 +1,382 @@
+/**
+ * dhcoder.cxx
+ *
+ * Dynamic Block Huffman Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <iostream>
+#include <cstdlib>  // size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <iterator> // std::istreambuf_iterator
+#include <climits>  // CHAR_BIT
+#include "canonical.hxx"
+#include "dhcoder.hxx"
+
+namespace adaptivecodes {
+
+	using namespace instrumentation;
+	using canonicalcodes::CanonicalCode;
+
+	static constexpr size_t   DH_ALPHABET      = sharedmodels::ALPHABET + 2;
+	static constexpr uint16_t DH_END           = sharedmodels::ALPHABET;     // the symbol that ends the text
+	static constexpr uint16_t DH_ESCAPE        = sharedmodels::ALPHABET + 1; // followed by a byte not in the code
+	static constexpr unsigned DH_MAX_LEN       = canonicalcodes::DEFAULT_CODE_LEN; // 4 codes fit into a refill
+	static constexpr uint64_t DH_FIRST_REBUILD = 1 << 6;
+	static constexpr uint32_t DH_MAX_TOTAL     = 1 << 16; // counts are halved beyond, so the code follows drifting text
+	static constexpr size_t   DH_CHUNK         = 1 << 16;
+
+	// -------------------------------------------------------
+	// --------------------- DYNAMICCODE ---------------------
+	// -------------------------------------------------------
+
+	// Running counts and the code built from them, the same in the encoder and the decoder as long as both
+	// count the same symbols. Only bytes seen so far get codes, so that the rest does not take code space
+	// from them under the length limit: the others are escaped until the next rebuild after they are seen
+	class DynamicCode {
+		uint32_t      m_freq[DH_ALPHABET];
+		uint64_t      m_total;
+		size_t        m_unseen;
+		uint64_t      m_period;    // symbols between the last rebuild and the next one
+		uint64_t      m_countdown; // symbols to the next rebuild
+		CanonicalCode m_code;
+
+		void rebuild(Stats& stats) {
+			m_freq[DH_ESCAPE] = m_unseen ? 1 : 0;
+			m_code.assign(canonicalcodes::code_lengths(m_freq, DH_ALPHABET, DH_MAX_LEN));
+			stats.add(TREE_BUILDS_COUNTER);
+
+			if (m_period < DH_REBUILD_PERIOD) m_period <<= 1;
+			m_countdown = m_period;
+		}
+
+	public:
+		CanonicalCode const& code() const { return m_code; }
+
+		// Counts a coded symbol, true if the code was rebuilt (tables taken from code() before are stale)
+		bool update(uint8_t symbol, Stats& stats) {
+			if (!m_freq[symbol]++) --m_unseen;
+
+			if (++m_total > DH_MAX_TOTAL) {
+				m_total = 0;
+				for (auto&& freq : m_freq) {
+					freq = (freq + 1) / 2; // seen bytes keep a count
+					m_total += freq;
+				}
+			}
+
+			if (--m_countdown) return false;
+
+			rebuild(stats);
+			return true;
+		}
+
+		// Starts with no bytes seen or, with a model, with its frequencies scaled to the weight of a rebuild
+		// period of text
+		void reset(sharedmodels::Model const* model, Stats& stats) {
+			for (auto&& freq : m_freq)
+				freq = 0;
+			m_freq[DH_END] = 1;
+
+			if (model) {
+				uint64_t model_total = 0;
+				for (size_t c = 0; c < sharedmodels::ALPHABET; ++c)
+					model_total += model->order0()[c];
+
+				if (model_total)
+					for (size_t c = 0; c < sharedmodels::ALPHABET; ++c)
+						if (model->order0()[c])
+							m_freq[c] = 1 + model->order0()[c] * DH_REBUILD_PERIOD / model_total;
+			}
+
+			m_total  = 0;
+			m_unseen = 0;
+			for (size_t c = 0; c < sharedmodels::ALPHABET; ++c) {
+				m_total += m_freq[c];
+				if (!m_freq[c]) ++m_unseen;
+			}
+
+			m_period = DH_FIRST_REBUILD / 2;
+			rebuild(stats);
+		}
+
+		DynamicCode() : m_total(0), m_unseen(0), m_period(0), m_countdown(0)
+		{ }
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- CODERIMPL ----------------------
+	// -------------------------------------------------------
+
+	class dhcoder::CoderImpl {
+		Stats                      m_stats;
+		sharedmodels::Model const* m_model;
+		DynamicCode                m_dynamic;
+		std::string                m_out;
+
+	public:
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				m_dynamic.reset(m_model, m_stats);
+			}
+
+			canonicalcodes::code_t const* codes = &m_dynamic.code().code(0);
+
+			char     inbuf[DH_CHUNK];
+			uint64_t symbols = 0;
+			uint64_t bytes   = 0;
+
+			m_out.clear();
+			m_out.reserve(DH_CHUNK + 8);
+			canonicalcodes::BitWriter writer(m_out);
+
+			while (ifile.good()) {
+				size_t bytes_read;
+
+				{
+					ScopedTimer timer(m_stats, INPUT_STAGE);
+					ifile.read(inbuf, sizeof(inbuf));
+					bytes_read = ifile.gcount();
+				}
+
+				{
+					ScopedTimer timer(m_stats, CODING_STAGE);
+
+					for (size_t i = 0; i < bytes_read; ++i) {
+						uint8_t symbol = inbuf[i];
+
+						if (codes[symbol].len) writer.put(codes[symbol]);
+						else {
+							writer.put(codes[DH_ESCAPE]);
+							writer.put(symbol, CHAR_BIT);
+						}
+
+						if (m_dynamic.update(symbol, m_stats))
+							codes = &m_dynamic.code().code(0);
+					}
+
+					if (ifile.eof())
+						writer.put(codes[DH_END]);
+				}
+
+				symbols += bytes_read;
+
+				if (ifile.eof()) {
+					ScopedTimer timer(m_stats, CODING_STAGE);
+					writer.flush();
+				}
+
+				ScopedTimer timer(m_stats, OUTPUT_STAGE);
+				ofile.write(m_out.data(), m_out.size());
+				bytes += m_out.size();
+				m_out.clear();
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, symbols);
+			m_stats.add(BITS_COUNTER, bytes * CHAR_BIT);
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			compress(ifile, ofile);
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		CoderImpl(std::istream& ifile, std::ostream& ofile) : m_model(nullptr) {
+			compress(ifile, ofile);
+		}
+
+		CoderImpl(sharedmodels::Model const& model) : m_model(&model)
+		{ }
+
+		CoderImpl() : m_model(nullptr)
+		{ }
+	};
+
+	void dhcoder::compress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->compress(ifile, ofile);
+	}
+
+	void dhcoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	Stats const& dhcoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	dhcoder::dhcoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new CoderImpl(ifile, ofile))
+	{ }
+
+	dhcoder::dhcoder(sharedmodels::Model const& model)
+		: m_pImpl(new CoderImpl(model))
+	{ }
+
+	dhcoder::dhcoder() : m_pImpl(new CoderImpl)
+	{ }
+
+	dhcoder::~dhcoder()
+	{ }
+
+	// -------------------------------------------------------
+	// --------------------- DECODERIMPL ---------------------
+	// -------------------------------------------------------
+
+	class dhdecoder::DecoderImpl {
+		Stats                      m_stats;
+		sharedmodels::Model const* m_model;
+		DynamicCode                m_dynamic;
+		std::string                m_payload;
+		std::string                m_text;
+
+	public:
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+				m_payload.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+			}
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				m_dynamic.reset(m_model, m_stats);
+			}
+
+			canonicalcodes::BitReader reader(reinterpret_cast<uint8_t const*>(m_payload.data()), m_payload.size());
+
+			canonicalcodes::entry_t const* table = m_dynamic.code().table();
+			unsigned bits = m_dynamic.code().table_bits();
+
+			// Every symbol takes a bit at least, past that the reader only sees the zeros of a missing end
+			uint64_t limit   = static_cast<uint64_t>(m_payload.size()) * CHAR_BIT;
+			uint64_t symbols = 0;
+			bool     ended   = false;
+
+			m_text.resize(DH_CHUNK);
+			char* out = &m_text[0];
+
+			while (!ended && symbols <= limit) {
+				size_t n = 0;
+
+				{
+					ScopedTimer timer(m_stats, CODING_STAGE);
+
+					while (n + 4 <= DH_CHUNK && symbols + n <= limit) {
+						reader.refill();
+
+						// A refill holds four codes of at most DH_MAX_LEN bits
+						for (size_t k = 0; k < 4; ++k) {
+							uint16_t symbol = reader.decode(table, bits);
+							if (symbol == DH_END) {
+								ended = true;
+								break;
+							}
+
+							// The byte may not fit behind the codes of the refill
+							if (symbol == DH_ESCAPE) {
+								reader.refill();
+								symbol = reader.peek(CHAR_BIT);
+								reader.skip(CHAR_BIT);
+							}
+
+							out[n++] = static_cast<char>(symbol);
+
+							if (m_dynamic.update(symbol, m_stats)) {
+								table = m_dynamic.code().table();
+								bits  = m_dynamic.code().table_bits();
+							}
+						}
+
+						if (ended) break;
+					}
+				}
+
+				symbols += n;
+
+				ScopedTimer timer(m_stats, OUTPUT_STAGE);
+				ofile.write(out, n);
+			}
+
+			if (!ended)
+				std::cerr << "dhdecoder::decompress: Missing end of text" << std::endl;
+
+			m_stats.add(SYMBOLS_COUNTER, symbols);
+			m_stats.add(BITS_COUNTER, m_payload.size() * CHAR_BIT);
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		DecoderImpl(std::istream& ifile, std::ostream& ofile) : m_model(nullptr) {
+			decompress(ifile, ofile);
+		}
+
+		DecoderImpl(sharedmodels::Model const& model) : m_model(&model)
+		{ }
+
+		DecoderImpl() : m_model(nullptr)
+		{ }
+	};
+
+	void dhdecoder::decompress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->decompress(ifile, ofile);
+	}
+
+	void dhdecoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	Stats const& dhdecoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	dhdecoder::dhdecoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new DecoderImpl(ifile, ofile))
+	{ }
+
+	dhdecoder::dhdecoder(sharedmodels::Model const& model, uint64_t /* symbols */)
+		: m_pImpl(new DecoderImpl(model))
+	{ }
+
+	dhdecoder::dhdecoder() : m_pImpl(new DecoderImpl)
+	{ }
+
+	dhdecoder::~dhdecoder()
+	{ }
+
+}
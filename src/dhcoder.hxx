@@ -0,0 +1,115 @@
+/**
+ * dhcoder.hxx
+ *
+ * Dynamic Block Huffman Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#ifndef DHCODER_HXX
+#define DHCODER_HXX
+
+#include <iostream>
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <memory>
+#include "instrument.hxx"
+#include "models.hxx"
+
+/**
+ * Coded text layout:
+ *
+ *   codes of the symbols | code of DH_END | zero bits up to a byte
+ *
+ * There is no header: encoder and decoder both start knowing only the end symbol (or the counts of a shared
+ * model) and rebuild a canonical Huffman code of at most 12 bits from the running counts after 64, 128, ...
+ * symbols and then every DH_REBUILD_PERIOD symbols. A byte not seen yet has no code of its own, it is coded
+ * as the escape symbol followed by its 8 bits. Counts are halved once they sum up to 2^16, so the code follows
+ * drifting text. Between rebuilds coding is table-driven, so the method is single-pass like ahuffman without
+ * updating a tree per symbol.
+ */
+
+namespace adaptivecodes {
+
+	static constexpr uint64_t DH_REBUILD_PERIOD = 1 << 12;
+
+	// -------------------------------------------------------
+	// ----------------------- DHCODER -----------------------
+	// -------------------------------------------------------
+
+	class dhcoder {
+		class CoderImpl;
+		std::unique_ptr<CoderImpl> m_pImpl;
+
+	public:
+
+		// Encodes the text as it is read and writes the codes to the output file
+		void compress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last compress call
+		instrumentation::Stats const& stats() const;
+
+		dhcoder(std::istream& ifile, std::ostream& ofile);
+
+		// Starts every compress call from the byte frequencies of a pre-trained model instead of equal counts
+		explicit dhcoder(sharedmodels::Model const& model);
+
+		dhcoder();
+
+		~dhcoder();
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- DHDECODER ----------------------
+	// -------------------------------------------------------
+
+	class dhdecoder {
+		class DecoderImpl;
+		std::unique_ptr<DecoderImpl> m_pImpl;
+
+	public:
+
+		// Decodes text up to the end symbol and writes it to the output file
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last decompress call
+		instrumentation::Stats const& stats() const;
+
+		dhdecoder(std::istream& ifile, std::ostream& ofile);
+
+		// Starts every decompress call from the frequencies of the model the text was coded with (the end
+		// symbol marks the length of the text anyway)
+		dhdecoder(sharedmodels::Model const& model, uint64_t symbols);
+
+		dhdecoder();
+
+		~dhdecoder();
+	};
+
+}
+
+#endif // DHCODER_HXX
@@ -0,0 +1,108 @@
+/**
+ * dispatch.cxx
+ *
+ * Runtime CPU Feature Dispatch
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cstdlib> // std::getenv
+#include <cstring> // std::strcmp
+#include <atomic>
+#include "dispatch.hxx"
+
+namespace cpudispatch {
+
+	static char const* const LEVEL_NAMES[LEVEL_NUM] = { "scalar", "sse2", "avx2", "avx512" };
+
+	char const* level_name(level_t level) {
+		if (level >= LEVEL_NUM) return "unknown";
+		return LEVEL_NAMES[level];
+	}
+
+	level_t level_from_name(char const* name) {
+		for (size_t i = SCALAR_LEVEL; i < LEVEL_NUM; ++i)
+			if (!std::strcmp(name, LEVEL_NAMES[i]))
+				return static_cast<level_t>(i);
+
+		return LEVEL_NUM;
+	}
+
+	// The builtins also check that the OS saves the wider registers
+	static level_t probe() {
+#if defined(DISPATCH_X86)
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx512bw")) return AVX512_LEVEL;
+		if (__builtin_cpu_supports("avx2"))     return AVX2_LEVEL;
+		if (__builtin_cpu_supports("sse2"))     return SSE2_LEVEL;
+#endif
+
+		return SCALAR_LEVEL;
+	}
+
+	level_t detected_level() {
+		static level_t const level = probe();
+		return level;
+	}
+
+	// A forced level the CPU lacks would crash on the first kernel, so it is reported and ignored
+	static level_t initial_level() {
+		level_t     level = detected_level();
+		char const* name  = std::getenv(LEVEL_ENV);
+
+		if (name && *name) {
+			level_t forced = level_from_name(name);
+
+			if (forced == LEVEL_NUM) {
+				std::cerr << "cpudispatch::active_level: Ignoring " << LEVEL_ENV << '=' << name << ", unknown level name (";
+				for (size_t i = SCALAR_LEVEL; i < LEVEL_NUM; ++i)
+					std::cerr << (i == SCALAR_LEVEL ? "" : ", ") << LEVEL_NAMES[i];
+				std::cerr << ')' << std::endl;
+			}
+			else if (forced > level)
+				std::cerr << "cpudispatch::active_level: Ignoring " << LEVEL_ENV << '=' << name << ", this CPU supports up to "
+				          << level_name(level) << std::endl;
+			else
+				level = forced;
+		}
+
+		return level;
+	}
+
+	static std::atomic<int>& active() {
+		static std::atomic<int> level(initial_level());
+		return level;
+	}
+
+	level_t active_level() {
+		return static_cast<level_t>(active().load(std::memory_order_relaxed));
+	}
+
+	bool set_level(level_t level) {
+		if (level > detected_level()) return false;
+
+		active().store(level, std::memory_order_relaxed);
+		return true;
+	}
+
+}
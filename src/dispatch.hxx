@@ -0,0 +1,89 @@
+/**
+ * dispatch.hxx
+ *
+ * Runtime CPU Feature Dispatch
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef DISPATCH_HXX
+#define DISPATCH_HXX
+
+#include <cstdlib> // size_t
+
+/**
+ * Vectorized kernels are built for every level below into the one binary (with target attributes, so the
+ * Makefile keeps generic flags), the CPU is probed once and each module looks its kernels up in a table
+ * indexed by the active level. The level can be forced down to test or benchmark the other paths on one
+ * machine, outputs never depend on it.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DISPATCH_X86 1
+#define DISPATCH_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// Loops templated on the kernels they call are forced into the wrappers that carry the target attribute,
+// so that those kernels inline into them
+#if defined(__GNUC__)
+#define DISPATCH_INLINE inline __attribute__((always_inline))
+#else
+#define DISPATCH_INLINE inline
+#endif
+
+namespace cpudispatch {
+
+	enum level_t {
+		SCALAR_LEVEL = 0, // plain C++
+		SSE2_LEVEL   = 1, // 16-byte vectors
+		AVX2_LEVEL   = 2, // 32-byte vectors
+		AVX512_LEVEL = 3, // 64-byte vectors, AVX-512BW byte operations
+		LEVEL_NUM
+	};
+
+	// Environment variable that forces a level (by its CLI name), read once on the first lookup
+	static constexpr char const* LEVEL_ENV = "LIBCODERS_CPU";
+
+	// Returns the CLI name of the level ("scalar", "sse2", ...)
+	char const* level_name(level_t level);
+
+	// Returns the level with the given CLI name or LEVEL_NUM if there is none
+	level_t level_from_name(char const* name);
+
+	// Highest level this CPU (and OS) supports, probed once
+	level_t detected_level();
+
+	// Level the kernels are looked up at: the detected one unless forced by LEVEL_ENV or set_level
+	level_t active_level();
+
+	// Forces a level for all kernels looked up from now on, false if the CPU does not support it
+	bool set_level(level_t level);
+
+	// Entry of a per-level kernel table for the active level
+	template<typename Kernels>
+	inline Kernels const& kernels(Kernels const (&table)[LEVEL_NUM]) {
+		return table[active_level()];
+	}
+
+}
+
+#endif // DISPATCH_HXX
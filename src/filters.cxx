@@ -0,0 +1,546 @@
+/**
+ * filters.cxx
+ *
+ * Reversible Filters Applied to Blocks Before Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>   // size_t
+#include <cstdint>
+#include <cstring>   // std::strcmp, std::memcpy, std::memmove
+#include <string>
+#include <algorithm> // std::min
+#include "dispatch.hxx"
+#include "filters.hxx"
+#if defined(DISPATCH_X86)
+#include <immintrin.h>
+#endif
+
+namespace filtercodes {
+
+	static char const* const FILTER_NAMES[FILTER_NUM] = { "none", "rle", "delta", "mtf" };
+
+	char const* filter_name(filter_t filter) {
+		if (filter == AUTO_FILTER) return "auto";
+		if (filter >= FILTER_NUM)  return "unknown";
+		return FILTER_NAMES[filter];
+	}
+
+	filter_t filter_from_name(char const* name) {
+		if (!std::strcmp(name, "auto")) return AUTO_FILTER;
+
+		for (size_t i = NO_FILTER; i < FILTER_NUM; ++i)
+			if (!std::strcmp(name, FILTER_NAMES[i]))
+				return static_cast<filter_t>(i);
+
+		return FILTER_NUM;
+	}
+
+	static constexpr size_t ALPHABET  = 256;
+	static constexpr size_t RUN_START = 4;               // equal bytes that take a count byte
+	static constexpr size_t MAX_RUN   = RUN_START + 255; // longest run a count byte covers
+
+	size_t max_filtered_size(size_t size) {
+		return size + size / RUN_START;
+	}
+
+	// Block-sized kernels, or their vector parts, for one level of vector instructions
+	struct kernels_t {
+		void   (*rle_encode)(std::string const& text, std::string& out);
+		size_t (*delta_encode)(uint8_t const* in, uint8_t* out, size_t i, size_t size, size_t stride);
+		size_t (*delta_decode)(uint8_t const* in, uint8_t* text, size_t i, size_t size, size_t stride);
+		void   (*mtf_encode)(std::string const& text, std::string& out);
+	};
+
+	static kernels_t const& kernels();
+
+#if defined(DISPATCH_X86)
+	DISPATCH_TARGET("sse2") static inline __m128i load128(uint8_t const* p) {
+		return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+	}
+
+	DISPATCH_TARGET("avx2") static inline __m256i load256(uint8_t const* p) {
+		return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+	}
+
+	DISPATCH_TARGET("avx512bw") static inline __m512i load512(uint8_t const* p) {
+		return _mm512_loadu_si512(p);
+	}
+
+	DISPATCH_TARGET("sse2") static inline void store(uint8_t* p, __m128i x) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p), x);
+	}
+
+	DISPATCH_TARGET("avx2") static inline void store(uint8_t* p, __m256i x) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x);
+	}
+
+	DISPATCH_TARGET("avx512bw") static inline void store(uint8_t* p, __m512i x) {
+		_mm512_storeu_si512(p, x);
+	}
+#endif
+
+	// ------------------------------------------------------
+	// ------------------------ RLE -------------------------
+	// ------------------------------------------------------
+
+	// Length of the run of p[0] at p, at most max, counted on from len
+	static inline size_t run_length_scalar(uint8_t const* p, size_t len, size_t max) {
+		while (len < max && p[len] == p[0]) ++len;
+		return len;
+	}
+
+	// First position in [p, end) that starts RUN_START equal bytes, end if there is none
+	static inline uint8_t const* find_run_scalar(uint8_t const* p, uint8_t const* end) {
+		for (; static_cast<size_t>(end - p) >= RUN_START; ++p)
+			if (p[0] == p[1] && p[1] == p[2] && p[2] == p[3])
+				return p;
+
+		return end;
+	}
+
+	// Vector versions compare whole vectors while they fit and leave the last bytes to the scalar ones
+#if defined(DISPATCH_X86)
+	DISPATCH_TARGET("sse2") static inline size_t run_length_sse2(uint8_t const* p, size_t len, size_t max) {
+		__m128i c = _mm_set1_epi8(static_cast<char>(p[0]));
+
+		for (; len + 16 <= max; len += 16) {
+			unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(load128(p + len), c));
+			if (mask != 0xFFFF) return len + __builtin_ctz(~mask);
+		}
+
+		return run_length_scalar(p, len, max);
+	}
+
+	DISPATCH_TARGET("avx2") static inline size_t run_length_avx2(uint8_t const* p, size_t len, size_t max) {
+		__m256i c = _mm256_set1_epi8(static_cast<char>(p[0]));
+
+		for (; len + 32 <= max; len += 32) {
+			unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(load256(p + len), c));
+			if (mask != 0xFFFFFFFF) return len + __builtin_ctz(~mask);
+		}
+
+		return run_length_sse2(p, len, max);
+	}
+
+	DISPATCH_TARGET("avx512bw") static inline size_t run_length_avx512(uint8_t const* p, size_t len, size_t max) {
+		__m512i c = _mm512_set1_epi8(static_cast<char>(p[0]));
+
+		for (; len + 64 <= max; len += 64) {
+			uint64_t mask = _mm512_cmpeq_epi8_mask(load512(p + len), c);
+			if (~mask) return len + __builtin_ctzll(~mask);
+		}
+
+		return run_length_avx2(p, len, max);
+	}
+
+	DISPATCH_TARGET("sse2") static inline uint8_t const* find_run_sse2(uint8_t const* p, uint8_t const* end) {
+		for (; static_cast<size_t>(end - p) >= 16 + RUN_START - 1; p += 16) {
+			__m128i a = load128(p);
+			__m128i b = load128(p + 1);
+			__m128i c = load128(p + 2);
+			__m128i d = load128(p + 3);
+
+			__m128i eq = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, b), _mm_cmpeq_epi8(b, c)), _mm_cmpeq_epi8(c, d));
+			unsigned mask = _mm_movemask_epi8(eq);
+			if (mask) return p + __builtin_ctz(mask);
+		}
+
+		return find_run_scalar(p, end);
+	}
+
+	DISPATCH_TARGET("avx2") static inline uint8_t const* find_run_avx2(uint8_t const* p, uint8_t const* end) {
+		for (; static_cast<size_t>(end - p) >= 32 + RUN_START - 1; p += 32) {
+			__m256i a = load256(p);
+			__m256i b = load256(p + 1);
+			__m256i c = load256(p + 2);
+			__m256i d = load256(p + 3);
+
+			__m256i eq = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(a, b), _mm256_cmpeq_epi8(b, c)),
+			                              _mm256_cmpeq_epi8(c, d));
+			unsigned mask = _mm256_movemask_epi8(eq);
+			if (mask) return p + __builtin_ctz(mask);
+		}
+
+		return find_run_sse2(p, end);
+	}
+
+	DISPATCH_TARGET("avx512bw") static inline uint8_t const* find_run_avx512(uint8_t const* p, uint8_t const* end) {
+		for (; static_cast<size_t>(end - p) >= 64 + RUN_START - 1; p += 64) {
+			__m512i a = load512(p);
+			__m512i b = load512(p + 1);
+			__m512i c = load512(p + 2);
+			__m512i d = load512(p + 3);
+
+			uint64_t mask = _mm512_cmpeq_epi8_mask(a, b) & _mm512_cmpeq_epi8_mask(b, c) & _mm512_cmpeq_epi8_mask(c, d);
+			if (mask) return p + __builtin_ctzll(mask);
+		}
+
+		return find_run_avx2(p, end);
+	}
+#endif
+
+	// Bytes between runs are copied as they are: they never hold RUN_START equal bytes in a row, and the first
+	// byte of a run differs from the one before it, so the decoder sees exactly the runs the encoder did
+	template<size_t (*RunLength)(uint8_t const*, size_t, size_t), uint8_t const* (*FindRun)(uint8_t const*, uint8_t const*)>
+	static DISPATCH_INLINE void rle_encode(std::string const& text, std::string& out) {
+		uint8_t const* p   = reinterpret_cast<uint8_t const*>(text.data());
+		uint8_t const* end = p + text.size();
+
+		out.clear();
+		out.reserve(max_filtered_size(text.size()));
+
+		while (p < end) {
+			uint8_t const* run = FindRun(p, end);
+			out.append(reinterpret_cast<char const*>(p), run - p);
+			if (run == end) break;
+
+			size_t len = RunLength(run, 1, std::min<size_t>(MAX_RUN, end - run));
+			out.append(RUN_START, static_cast<char>(*run));
+			out.push_back(static_cast<char>(len - RUN_START));
+			p = run + len;
+		}
+	}
+
+	static void rle_encode_scalar(std::string const& text, std::string& out) {
+		rle_encode<run_length_scalar, find_run_scalar>(text, out);
+	}
+
+#if defined(DISPATCH_X86)
+	DISPATCH_TARGET("sse2") static void rle_encode_sse2(std::string const& text, std::string& out) {
+		rle_encode<run_length_sse2, find_run_sse2>(text, out);
+	}
+
+	DISPATCH_TARGET("avx2") static void rle_encode_avx2(std::string const& text, std::string& out) {
+		rle_encode<run_length_avx2, find_run_avx2>(text, out);
+	}
+
+	DISPATCH_TARGET("avx512bw") static void rle_encode_avx512(std::string const& text, std::string& out) {
+		rle_encode<run_length_avx512, find_run_avx512>(text, out);
+	}
+#endif
+
+	static bool rle_decode(std::string const& in, std::string& text, size_t limit) {
+		text.clear();
+		text.reserve(std::min(limit, in.size()));
+
+		int    prev  = -1;
+		size_t count = 0;
+
+		for (size_t i = 0; i < in.size(); ++i) {
+			uint8_t c = in[i];
+
+			if (text.size() == limit) return false;
+			text.push_back(c);
+
+			count = (c == prev) ? count + 1 : 1;
+			prev  = c;
+			if (count < RUN_START) continue;
+
+			// A count byte follows, then counting starts over
+			if (++i == in.size()) return false;
+
+			size_t extra = static_cast<uint8_t>(in[i]);
+			if (extra > limit - text.size()) return false;
+
+			text.append(extra, static_cast<char>(c));
+			prev  = -1;
+			count = 0;
+		}
+
+		return true;
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- DELTA ------------------------
+	// ------------------------------------------------------
+
+	// Vector parts of delta coding start at i (at least stride) and return where they stopped, the scalar
+	// loops finish the last bytes
+	static size_t delta_encode_scalar(uint8_t const*, uint8_t*, size_t i, size_t, size_t) {
+		return i;
+	}
+
+	static size_t delta_decode_scalar(uint8_t const*, uint8_t*, size_t i, size_t, size_t) {
+		return i;
+	}
+
+#if defined(DISPATCH_X86)
+	DISPATCH_TARGET("sse2") static size_t delta_encode_sse2(uint8_t const* in, uint8_t* o, size_t i, size_t size, size_t stride) {
+		for (; i + 16 <= size; i += 16)
+			store(o + i, _mm_sub_epi8(load128(in + i), load128(in + i - stride)));
+
+		return i;
+	}
+
+	DISPATCH_TARGET("avx2") static size_t delta_encode_avx2(uint8_t const* in, uint8_t* o, size_t i, size_t size, size_t stride) {
+		for (; i + 32 <= size; i += 32)
+			store(o + i, _mm256_sub_epi8(load256(in + i), load256(in + i - stride)));
+
+		return delta_encode_sse2(in, o, i, size, stride);
+	}
+
+	DISPATCH_TARGET("avx512bw") static size_t delta_encode_avx512(uint8_t const* in, uint8_t* o, size_t i, size_t size,
+	                                                               size_t stride) {
+		for (; i + 64 <= size; i += 64)
+			store(o + i, _mm512_sub_epi8(load512(in + i), load512(in + i - stride)));
+
+		return delta_encode_avx2(in, o, i, size, stride);
+	}
+
+	// Sums of every byte with the bytes Stride, 2 * Stride, ... before it within the vector
+	template<int Stride>
+	DISPATCH_TARGET("sse2") static inline __m128i prefix_sum(__m128i x) {
+		x = _mm_add_epi8(x, _mm_slli_si128(x, Stride));
+		if (Stride < 8) x = _mm_add_epi8(x, _mm_slli_si128(x, 2 * Stride));
+		if (Stride < 4) x = _mm_add_epi8(x, _mm_slli_si128(x, 4 * Stride));
+		if (Stride < 2) x = _mm_add_epi8(x, _mm_slli_si128(x, 8 * Stride));
+		return x;
+	}
+
+	// The last Stride bytes of the previous vector repeated over the whole vector
+	template<int Stride>
+	DISPATCH_TARGET("sse2") static inline __m128i carry(__m128i prev) {
+		switch (Stride) {
+			case 1  : prev = _mm_unpackhi_epi8(prev, prev); // fall through
+			case 2  : return _mm_shuffle_epi32(_mm_shufflehi_epi16(prev, 0xFF), 0xFF);
+			case 4  : return _mm_shuffle_epi32(prev, 0xFF);
+			default : return _mm_unpackhi_epi64(prev, prev);
+		}
+	}
+
+	// Decodes whole vectors from i on (i at least 16), returns where it stopped
+	template<int Stride>
+	DISPATCH_TARGET("sse2") static inline size_t delta_decode_vectors(uint8_t const* in, uint8_t* t, size_t i, size_t size) {
+		for (; i + 16 <= size; i += 16)
+			store(t + i, _mm_add_epi8(prefix_sum<Stride>(load128(in + i)), carry<Stride>(load128(t + i - 16))));
+
+		return i;
+	}
+
+	// Strides of 16 and more add whole vectors, the powers of two below it sum within vectors
+	DISPATCH_TARGET("sse2") static size_t delta_decode_sse2(uint8_t const* p, uint8_t* t, size_t i, size_t size, size_t stride) {
+		if (stride >= 16) {
+			for (; i + 16 <= size; i += 16)
+				store(t + i, _mm_add_epi8(load128(p + i), load128(t + i - stride)));
+		}
+		else if (!(16 % stride)) {
+			for (; i < size && i < 16; ++i)
+				t[i] = p[i] + t[i - stride];
+
+			switch (stride) {
+				case 1  : i = delta_decode_vectors<1>(p, t, i, size); break;
+				case 2  : i = delta_decode_vectors<2>(p, t, i, size); break;
+				case 4  : i = delta_decode_vectors<4>(p, t, i, size); break;
+				default : i = delta_decode_vectors<8>(p, t, i, size); break;
+			}
+		}
+
+		return i;
+	}
+
+	// Wider vectors only help strides as wide as they are, the rest goes on 16 bytes at a time
+	DISPATCH_TARGET("avx2") static size_t delta_decode_avx2(uint8_t const* p, uint8_t* t, size_t i, size_t size, size_t stride) {
+		if (stride >= 32)
+			for (; i + 32 <= size; i += 32)
+				store(t + i, _mm256_add_epi8(load256(p + i), load256(t + i - stride)));
+
+		return delta_decode_sse2(p, t, i, size, stride);
+	}
+
+	DISPATCH_TARGET("avx512bw") static size_t delta_decode_avx512(uint8_t const* p, uint8_t* t, size_t i, size_t size,
+	                                                               size_t stride) {
+		if (stride >= 64)
+			for (; i + 64 <= size; i += 64)
+				store(t + i, _mm512_add_epi8(load512(p + i), load512(t + i - stride)));
+
+		return delta_decode_avx2(p, t, i, size, stride);
+	}
+#endif
+
+	static void delta_encode(std::string const& text, size_t stride, std::string& out) {
+		size_t size = text.size();
+		out.resize(size);
+		if (!size) return;
+
+		uint8_t const* in = reinterpret_cast<uint8_t const*>(text.data());
+		uint8_t*       o  = reinterpret_cast<uint8_t*>(&out[0]);
+
+		size_t i = std::min(stride, size);
+		std::memcpy(o, in, i);
+
+		for (i = kernels().delta_encode(in, o, i, size, stride); i < size; ++i)
+			o[i] = in[i] - in[i - stride];
+	}
+
+	static bool delta_decode(std::string const& in, size_t stride, std::string& text, size_t limit) {
+		size_t size = in.size();
+		if (size > limit || !stride || stride > MAX_STRIDE) return false;
+
+		text.resize(size);
+		if (!size) return true;
+
+		uint8_t const* p = reinterpret_cast<uint8_t const*>(in.data());
+		uint8_t*       t = reinterpret_cast<uint8_t*>(&text[0]);
+
+		size_t i = std::min(stride, size);
+		std::memcpy(t, p, i);
+
+		for (i = kernels().delta_decode(p, t, i, size, stride); i < size; ++i)
+			t[i] = p[i] + t[i - stride];
+
+		return true;
+	}
+
+	// ------------------------------------------------------
+	// ------------------------ MTF -------------------------
+	// ------------------------------------------------------
+
+	// Position of c in the list, which holds every byte once
+	static inline size_t rank_of_scalar(uint8_t const* order, uint8_t c) {
+		size_t rank = 0;
+		while (order[rank] != c) ++rank;
+		return rank;
+	}
+
+#if defined(DISPATCH_X86)
+	DISPATCH_TARGET("sse2") static inline size_t rank_of_sse2(uint8_t const* order, uint8_t c) {
+		__m128i v = _mm_set1_epi8(static_cast<char>(c));
+
+		for (size_t i = 0; ; i += 16) {
+			unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(load128(order + i), v));
+			if (mask) return i + __builtin_ctz(mask);
+		}
+	}
+
+	DISPATCH_TARGET("avx2") static inline size_t rank_of_avx2(uint8_t const* order, uint8_t c) {
+		__m256i v = _mm256_set1_epi8(static_cast<char>(c));
+
+		for (size_t i = 0; ; i += 32) {
+			unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(load256(order + i), v));
+			if (mask) return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	template<size_t (*RankOf)(uint8_t const*, uint8_t)>
+	static DISPATCH_INLINE void mtf_encode(std::string const& text, std::string& out) {
+		uint8_t order[ALPHABET];
+		for (size_t c = 0; c < ALPHABET; ++c)
+			order[c] = c;
+
+		out.resize(text.size());
+
+		for (size_t i = 0; i < text.size(); ++i) {
+			uint8_t c    = text[i];
+			size_t  rank = order[0] == c ? 0 : RankOf(order, c);
+
+			if (rank) {
+				std::memmove(order + 1, order, rank);
+				order[0] = c;
+			}
+
+			out[i] = static_cast<char>(rank);
+		}
+	}
+
+	static void mtf_encode_scalar(std::string const& text, std::string& out) {
+		mtf_encode<rank_of_scalar>(text, out);
+	}
+
+#if defined(DISPATCH_X86)
+	DISPATCH_TARGET("sse2") static void mtf_encode_sse2(std::string const& text, std::string& out) {
+		mtf_encode<rank_of_sse2>(text, out);
+	}
+
+	// The list is four vectors long at most, wider ones would not pay off
+	DISPATCH_TARGET("avx2") static void mtf_encode_avx2(std::string const& text, std::string& out) {
+		mtf_encode<rank_of_avx2>(text, out);
+	}
+#endif
+
+	static bool mtf_decode(std::string const& in, std::string& text, size_t limit) {
+		if (in.size() > limit) return false;
+
+		uint8_t order[ALPHABET];
+		for (size_t c = 0; c < ALPHABET; ++c)
+			order[c] = c;
+
+		text.resize(in.size());
+
+		for (size_t i = 0; i < in.size(); ++i) {
+			uint8_t rank = in[i];
+			uint8_t c    = order[rank];
+
+			if (rank) {
+				std::memmove(order + 1, order, rank);
+				order[0] = c;
+			}
+
+			text[i] = static_cast<char>(c);
+		}
+
+		return true;
+	}
+
+	// ------------------------------------------------------
+	// ---------------------- KERNELS -----------------------
+	// ------------------------------------------------------
+
+	// Levels above the detected one are never active, so other architectures leave their rows empty
+	static kernels_t const KERNELS[cpudispatch::LEVEL_NUM] = {
+		{ rle_encode_scalar, delta_encode_scalar, delta_decode_scalar, mtf_encode_scalar },
+#if defined(DISPATCH_X86)
+		{ rle_encode_sse2,   delta_encode_sse2,   delta_decode_sse2,   mtf_encode_sse2   },
+		{ rle_encode_avx2,   delta_encode_avx2,   delta_decode_avx2,   mtf_encode_avx2   },
+		{ rle_encode_avx512, delta_encode_avx512, delta_decode_avx512, mtf_encode_avx2   },
+#endif
+	};
+
+	static kernels_t const& kernels() {
+		return cpudispatch::kernels(KERNELS);
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- FILTER -----------------------
+	// ------------------------------------------------------
+
+	void apply_filter(filter_t filter, size_t stride, std::string const& text, std::string& out) {
+		switch (filter) {
+			case RLE_FILTER   : kernels().rle_encode(text, out); break;
+			case DELTA_FILTER : delta_encode(text, stride, out); break;
+			case MTF_FILTER   : kernels().mtf_encode(text, out); break;
+			default           : out = text; break;
+		}
+	}
+
+	bool revert_filter(filter_t filter, size_t stride, std::string const& in, std::string& text, size_t limit) {
+		switch (filter) {
+			case NO_FILTER    : if (in.size() > limit) return false; text = in; return true;
+			case RLE_FILTER   : return rle_decode(in, text, limit);
+			case DELTA_FILTER : return delta_decode(in, stride, text, limit);
+			case MTF_FILTER   : return mtf_decode(in, text, limit);
+			default           : return false;
+		}
+	}
+
+}
@@ -0,0 +1,80 @@
+/**
+ * filters.hxx
+ *
+ * Reversible Filters Applied to Blocks Before Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef FILTERS_HXX
+#define FILTERS_HXX
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <string>
+
+/**
+ * Filters turn a block into a text of the same information that order-0 coders do better on:
+ *
+ *   rle   - after four equal bytes a count byte (0 to 255) of further copies, so runs shrink
+ *   delta - every byte minus the one "stride" bytes before it, so slowly varying integers (or columns of
+ *           records "stride" bytes wide) turn into small differences
+ *   mtf   - every byte replaced with its rank in a list of recently seen bytes, so local clusters of
+ *           symbols turn into small ranks
+ *
+ * Delta (both ways), run and run start scanning of rle and rank search of mtf use SSE2, AVX2 or AVX-512
+ * vectors as cpudispatch picks at run time, results do not depend on them.
+ */
+
+namespace filtercodes {
+
+	enum filter_t {
+		NO_FILTER    = 0,
+		RLE_FILTER   = 1,
+		DELTA_FILTER = 2,
+		MTF_FILTER   = 3,
+		FILTER_NUM,
+
+		AUTO_FILTER = 0x7F // picks a filter per block, never recorded in a block
+	};
+
+	static constexpr size_t DEFAULT_STRIDE = 1;
+	static constexpr size_t MAX_STRIDE     = 255;
+
+	// Returns the CLI name of the filter ("none", "rle", ...)
+	char const* filter_name(filter_t filter);
+
+	// Returns the filter with the given CLI name ("auto" included) or FILTER_NUM if there is none
+	filter_t filter_from_name(char const* name);
+
+	// Longest output of a filter on size bytes (rle grows by a count byte per four bytes at worst)
+	size_t max_filtered_size(size_t size);
+
+	// Filters text into out, stride is that of delta (1 to MAX_STRIDE) and ignored by the rest
+	void apply_filter(filter_t filter, size_t stride, std::string const& text, std::string& out);
+
+	// Undoes apply_filter, false on malformed input or more than "limit" bytes of output
+	bool revert_filter(filter_t filter, size_t stride, std::string const& in, std::string& text, size_t limit);
+
+}
+
+#endif // FILTERS_HXX
@@ -0,0 +1,419 @@
+/**
+ * ihcoder.cxx
+ *
+ * Four-Stream Interleaved Huffman Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cstdlib>  // size_t
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <memory>
+#include <iterator> // std::istreambuf_iterator
+#include <climits>  // CHAR_BIT
+#include "canonical.hxx"
+#include "cache.hxx"
+#include "ihcoder.hxx"
+
+namespace staticcodes {
+
+	using namespace instrumentation;
+	using canonicalcodes::CanonicalCode;
+
+	static constexpr size_t   IH_ALPHABET = 256;
+	static constexpr unsigned IH_MAX_LEN  = canonicalcodes::DEFAULT_CODE_LEN; // 4 codes fit into a refill
+
+	size_t ih_header_size() {
+		return canonicalcodes::lengths_size(IH_ALPHABET) + sizeof(uint64_t) + (IH_STREAMS - 1) * sizeof(uint32_t);
+	}
+
+	// Canonical code of the frequencies (or of the shared model they came from): built once and taken from
+	// the model cache afterwards
+	static std::shared_ptr<CanonicalCode const> cached_code(uint32_t const* freq, sharedmodels::Model const* model, Stats& stats) {
+		modelcache::ModelCache& cache = modelcache::ModelCache::instance();
+		modelcache::key_t key = model ? modelcache::model_key("huffman4", model->id())
+		                              : modelcache::histogram_key("huffman4", freq, IH_ALPHABET);
+
+		if (std::shared_ptr<CanonicalCode const> cached = cache.find<CanonicalCode>(key)) {
+			stats.add(CACHE_HITS_COUNTER);
+			return cached;
+		}
+
+		stats.add(CACHE_MISSES_COUNTER);
+
+		std::shared_ptr<CanonicalCode> code = std::make_shared<CanonicalCode>();
+		code->assign(canonicalcodes::code_lengths(freq, IH_ALPHABET, IH_MAX_LEN));
+		stats.add(TREE_BUILDS_COUNTER);
+
+		cache.insert<CanonicalCode>(key, code, code->bytes());
+		return code;
+	}
+
+	// Same for the stored code lengths of a coded text, false if they are malformed
+	static bool cached_code(canonicalcodes::lengths_t const& lengths, std::shared_ptr<CanonicalCode const>& code, Stats& stats) {
+		std::vector<uint32_t> key_lengths(lengths.begin(), lengths.end());
+
+		modelcache::ModelCache& cache = modelcache::ModelCache::instance();
+		modelcache::key_t key = modelcache::histogram_key("huffman4-lengths", &key_lengths[0], key_lengths.size());
+
+		if ((code = cache.find<CanonicalCode>(key))) {
+			stats.add(CACHE_HITS_COUNTER);
+			return true;
+		}
+
+		stats.add(CACHE_MISSES_COUNTER);
+
+		std::shared_ptr<CanonicalCode> built = std::make_shared<CanonicalCode>();
+		if (!built->assign(lengths) || built->table_bits() > IH_MAX_LEN) return false;
+		stats.add(TREE_BUILDS_COUNTER);
+
+		cache.insert<CanonicalCode>(key, built, built->bytes());
+		code = built;
+		return true;
+	}
+
+	static void write_u32(std::ostream& ofile, uint32_t value) {
+		ofile.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	static void write_u64(std::ostream& ofile, uint64_t value) {
+		ofile.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	// -------------------------------------------------------
+	// ---------------------- CODERIMPL ----------------------
+	// -------------------------------------------------------
+
+	class ihcoder::CoderImpl {
+		Stats                      m_stats;
+		sharedmodels::Model const* m_model;
+		bool                       m_good;
+		std::string                m_streams[IH_STREAMS];
+
+	public:
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+			m_good = true;
+
+			std::string text;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+				text.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+			}
+
+			// Counts and stream offsets are 32-bit, longer texts go through the block container
+			if (text.size() > UINT32_MAX) {
+				std::cerr << "ihcoder::compress: Text too long for one frequency table, code it in blocks" << std::endl;
+				m_good = false;
+				return;
+			}
+
+			std::vector<uint32_t> freq(IH_ALPHABET, 0);
+
+			{
+				ScopedTimer timer(m_stats, STATISTICS_STAGE);
+				if (m_model) freq.assign(m_model->order0(), m_model->order0() + IH_ALPHABET);
+				else
+					for (const auto& c : text)
+						++freq[static_cast<uint8_t>(c)];
+			}
+
+			std::shared_ptr<CanonicalCode const> code;
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				code = cached_code(&freq[0], m_model, m_stats);
+			}
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+
+				for (auto&& stream : m_streams) {
+					stream.clear();
+					stream.reserve(text.size() / IH_STREAMS + 1);
+				}
+
+				canonicalcodes::BitWriter w0(m_streams[0]);
+				canonicalcodes::BitWriter w1(m_streams[1]);
+				canonicalcodes::BitWriter w2(m_streams[2]);
+				canonicalcodes::BitWriter w3(m_streams[3]);
+
+				uint8_t const* p = reinterpret_cast<uint8_t const*>(text.data());
+				size_t i = 0;
+
+				for (; i + IH_STREAMS <= text.size(); i += IH_STREAMS) {
+					w0.put(code->code(p[i]));
+					w1.put(code->code(p[i + 1]));
+					w2.put(code->code(p[i + 2]));
+					w3.put(code->code(p[i + 3]));
+				}
+
+				if (i < text.size())     w0.put(code->code(p[i]));
+				if (i + 1 < text.size()) w1.put(code->code(p[i + 1]));
+				if (i + 2 < text.size()) w2.put(code->code(p[i + 2]));
+
+				w0.flush();
+				w1.flush();
+				w2.flush();
+				w3.flush();
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, text.size());
+			for (const auto& stream : m_streams)
+				m_stats.add(BITS_COUNTER, stream.size() * CHAR_BIT);
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+
+			if (!m_model) {
+				canonicalcodes::lengths_t lengths(IH_ALPHABET);
+				for (size_t c = 0; c < IH_ALPHABET; ++c)
+					lengths[c] = code->code(c).len;
+				canonicalcodes::write_lengths(ofile, lengths);
+			}
+
+			// The jump table: where streams 1-3 start
+			write_u64(ofile, text.size());
+			for (size_t s = 0; s + 1 < IH_STREAMS; ++s)
+				write_u32(ofile, m_streams[s].size());
+
+			for (const auto& stream : m_streams)
+				ofile.write(stream.data(), stream.size());
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			compress(ifile, ofile);
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		bool good() const {
+			return m_good;
+		}
+
+		CoderImpl(std::istream& ifile, std::ostream& ofile) : m_model(nullptr), m_good(true) {
+			compress(ifile, ofile);
+		}
+
+		CoderImpl(sharedmodels::Model const& model) : m_model(&model), m_good(true)
+		{ }
+
+		CoderImpl() : m_model(nullptr), m_good(true)
+		{ }
+	};
+
+	void ihcoder::compress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->compress(ifile, ofile);
+	}
+
+	void ihcoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	Stats const& ihcoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bool ihcoder::good() const {
+		return m_pImpl->good();
+	}
+
+	ihcoder::ihcoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new CoderImpl(ifile, ofile))
+	{ }
+
+	ihcoder::ihcoder(sharedmodels::Model const& model)
+		: m_pImpl(new CoderImpl(model))
+	{ }
+
+	ihcoder::ihcoder() : m_pImpl(new CoderImpl)
+	{ }
+
+	ihcoder::~ihcoder()
+	{ }
+
+	// -------------------------------------------------------
+	// --------------------- DECODERIMPL ---------------------
+	// -------------------------------------------------------
+
+	class ihdecoder::DecoderImpl {
+		Stats                      m_stats;
+		sharedmodels::Model const* m_model;
+		std::string                m_payload;
+		std::string                m_text;
+
+		bool fail(char const* what) {
+			std::cerr << "ihdecoder::decompress: " << what << std::endl;
+			return false;
+		}
+
+		bool read_header(std::istream& ifile, std::shared_ptr<CanonicalCode const>& code, uint64_t& symbols, uint64_t* sizes) {
+			if (m_model) {
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				code = cached_code(m_model->order0(), m_model, m_stats);
+			}
+			else {
+				canonicalcodes::lengths_t lengths;
+
+				{
+					ScopedTimer timer(m_stats, INPUT_STAGE);
+					if (!canonicalcodes::read_lengths(ifile, lengths, IH_ALPHABET)) return fail("Truncated code lengths");
+				}
+
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				if (!cached_code(lengths, code, m_stats)) return fail("Invalid code lengths");
+			}
+
+			ScopedTimer timer(m_stats, INPUT_STAGE);
+
+			if (!ifile.read(reinterpret_cast<char*>(&symbols), sizeof(symbols))) return fail("Truncated header");
+
+			uint64_t total = 0;
+			for (size_t s = 0; s + 1 < IH_STREAMS; ++s) {
+				uint32_t size;
+				if (!ifile.read(reinterpret_cast<char*>(&size), sizeof(size))) return fail("Truncated jump table");
+				sizes[s] = size;
+				total   += size;
+			}
+
+			m_payload.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+			if (total > m_payload.size()) return fail("Truncated streams");
+
+			sizes[IH_STREAMS - 1] = m_payload.size() - total;
+			return true;
+		}
+
+	public:
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
+			std::shared_ptr<CanonicalCode const> code;
+			uint64_t symbols;
+			uint64_t sizes[IH_STREAMS];
+
+			if (!read_header(ifile, code, symbols, sizes)) return;
+
+			// Every symbol takes a bit at least
+			if (symbols > m_payload.size() * CHAR_BIT) {
+				fail("Invalid number of symbols");
+				return;
+			}
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+
+				uint8_t const* base = reinterpret_cast<uint8_t const*>(m_payload.data());
+				canonicalcodes::BitReader r0(base, sizes[0]);
+				canonicalcodes::BitReader r1(base + sizes[0], sizes[1]);
+				canonicalcodes::BitReader r2(base + sizes[0] + sizes[1], sizes[2]);
+				canonicalcodes::BitReader r3(base + sizes[0] + sizes[1] + sizes[2], sizes[3]);
+
+				canonicalcodes::entry_t const* table = code->table();
+				unsigned bits = code->table_bits();
+
+				m_text.resize(symbols);
+				char*    p = symbols ? &m_text[0] : nullptr;
+				uint64_t i = 0;
+
+				// Rounds of four symbols per stream: a refill holds four codes of at most IH_MAX_LEN bits
+				for (; i + IH_STREAMS * 4 <= symbols; i += IH_STREAMS * 4) {
+					r0.refill();
+					r1.refill();
+					r2.refill();
+					r3.refill();
+
+					for (size_t k = 0; k < 4 * IH_STREAMS; k += IH_STREAMS) {
+						p[i + k]     = r0.decode(table, bits);
+						p[i + k + 1] = r1.decode(table, bits);
+						p[i + k + 2] = r2.decode(table, bits);
+						p[i + k + 3] = r3.decode(table, bits);
+					}
+				}
+
+				canonicalcodes::BitReader* readers[IH_STREAMS] = { &r0, &r1, &r2, &r3 };
+
+				for (; i < symbols; ++i) {
+					canonicalcodes::BitReader& reader = *readers[i % IH_STREAMS];
+					reader.refill();
+					p[i] = reader.decode(table, bits);
+				}
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, symbols);
+			m_stats.add(BITS_COUNTER, m_payload.size() * CHAR_BIT);
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(m_text.data(), m_text.size());
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		DecoderImpl(std::istream& ifile, std::ostream& ofile) : m_model(nullptr) {
+			decompress(ifile, ofile);
+		}
+
+		DecoderImpl(sharedmodels::Model const& model) : m_model(&model)
+		{ }
+
+		DecoderImpl() : m_model(nullptr)
+		{ }
+	};
+
+	void ihdecoder::decompress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->decompress(ifile, ofile);
+	}
+
+	void ihdecoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	Stats const& ihdecoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	ihdecoder::ihdecoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new DecoderImpl(ifile, ofile))
+	{ }
+
+	ihdecoder::ihdecoder(sharedmodels::Model const& model, uint64_t /* symbols */)
+		: m_pImpl(new DecoderImpl(model))
+	{ }
+
+	ihdecoder::ihdecoder() : m_pImpl(new DecoderImpl)
+	{ }
+
+	ihdecoder::~ihdecoder()
+	{ }
+
+}
@@ -0,0 +1,115 @@
+/**
+ * ihcoder.hxx
+ *
+ * Four-Stream Interleaved Huffman Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef IHCODER_HXX
+#define IHCODER_HXX
+
+#include <iostream>
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <memory>
+#include "instrument.hxx"
+#include "models.hxx"
+
+/**
+ * Coded text layout:
+ *
+ *   [code lengths (4 bits each)] | symbols (8 bytes) | sizes of streams 0-2 (4 bytes each) | streams 0-3
+ *
+ * Symbol i of the text is coded into stream i % 4 with a canonical Huffman code of at most 12 bits, so the
+ * decoder runs four independent bit readers in lockstep. The lengths are left out with a shared model.
+ */
+
+namespace staticcodes {
+
+	static constexpr size_t IH_STREAMS = 4;
+
+	// Bytes of the coded text before the streams (without a shared model)
+	size_t ih_header_size();
+
+	// -------------------------------------------------------
+	// ----------------------- IHCODER -----------------------
+	// -------------------------------------------------------
+
+	class ihcoder {
+		class CoderImpl;
+		std::unique_ptr<CoderImpl> m_pImpl;
+
+	public:
+
+		// Encodes text into four interleaved streams and writes them to the output file
+		void compress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last compress call
+		instrumentation::Stats const& stats() const;
+
+		// False if the last compress call refused a text too long for one frequency table, nothing is written then
+		bool good() const;
+
+		ihcoder(std::istream& ifile, std::ostream& ofile);
+
+		// Codes with the frequencies of a pre-trained model, so no code lengths are written
+		explicit ihcoder(sharedmodels::Model const& model);
+
+		ihcoder();
+
+		~ihcoder();
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- IHDECODER ----------------------
+	// -------------------------------------------------------
+
+	class ihdecoder {
+		class DecoderImpl;
+		std::unique_ptr<DecoderImpl> m_pImpl;
+
+	public:
+
+		// Decodes the four streams in lockstep and writes the text to the output file
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last decompress call
+		instrumentation::Stats const& stats() const;
+
+		ihdecoder(std::istream& ifile, std::ostream& ofile);
+
+		// Decodes a text coded with the frequencies of the model (its length is in the coded text anyway)
+		ihdecoder(sharedmodels::Model const& model, uint64_t symbols);
+
+		ihdecoder();
+
+		~ihdecoder();
+	};
+
+}
+
+#endif // IHCODER_HXX
@@ -0,0 +1,373 @@
+/**
+ * instrument.cxx
+ *
+ * Per-Stage Timers and Counters
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <cstdio>  // std::snprintf
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <atomic>
+#include <algorithm> // std::fill
+#include <cerrno>
+#include <sys/resource.h> // getrusage
+#if defined(__linux__)
+#include <unistd.h>             // syscall, read, close
+#include <sys/syscall.h>        // __NR_perf_event_open
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+#endif
+#include "instrument.hxx"
+
+namespace instrumentation {
+
+	// -------------------------------------------------------
+	// ------------------------ STATS ------------------------
+	// -------------------------------------------------------
+
+	void Stats::reset() {
+		for (auto&& ns : m_stage_ns)
+			ns = 0;
+		for (auto&& cnt : m_counters)
+			cnt = 0;
+		for (auto&& stage : m_hw)
+			for (auto&& cnt : stage)
+				cnt = 0;
+	}
+
+	void Stats::add_hw(stage_t stage, uint64_t const* counts) {
+		for (size_t i = 0; i < HW_COUNTER_NUM; ++i)
+			m_hw[stage][i] += counts[i];
+	}
+
+	uint64_t Stats::hw_total(hw_counter_t counter) const {
+		uint64_t total = 0;
+		for (size_t i = 0; i < STAGE_NUM; ++i)
+			total += m_hw[i][counter];
+
+		return total;
+	}
+
+	uint64_t Stats::total_ns() const {
+		uint64_t total = 0;
+		for (const auto& ns : m_stage_ns)
+			total += ns;
+
+		return total;
+	}
+
+	Stats& Stats::operator+=(Stats const& other) {
+		for (size_t i = 0; i < STAGE_NUM; ++i)
+			m_stage_ns[i] += other.m_stage_ns[i];
+		for (size_t i = 0; i < COUNTER_NUM; ++i)
+			m_counters[i] += other.m_counters[i];
+		for (size_t i = 0; i < STAGE_NUM; ++i)
+			add_hw(static_cast<stage_t>(i), other.m_hw[i]);
+
+		return *this;
+	}
+
+	std::string Stats::to_json() const {
+		std::string json = "{\"stages_ns\":{";
+
+		for (size_t i = 0; i < STAGE_NUM; ++i) {
+			if (i) json += ',';
+			json += json_string(stage_name(static_cast<stage_t>(i))) + ':' + std::to_string(m_stage_ns[i]);
+		}
+
+		json += "},\"counters\":{";
+
+		for (size_t i = 0; i < COUNTER_NUM; ++i) {
+			if (i) json += ',';
+			json += json_string(counter_name(static_cast<counter_t>(i))) + ':' + std::to_string(m_counters[i]);
+		}
+
+		json += '}';
+
+		if (hw_total(CYCLES_HW)) {
+			json += ",\"hw_counters\":{";
+
+			for (size_t i = 0; i < STAGE_NUM; ++i) {
+				if (i) json += ',';
+				json += json_string(stage_name(static_cast<stage_t>(i))) + ":{";
+
+				for (size_t j = 0; j < HW_COUNTER_NUM; ++j) {
+					if (j) json += ',';
+					json += json_string(hw_counter_name(static_cast<hw_counter_t>(j))) + ':' + std::to_string(m_hw[i][j]);
+				}
+
+				json += '}';
+			}
+
+			json += '}';
+		}
+
+		json += '}';
+		return json;
+	}
+
+	char const* Stats::stage_name(stage_t stage) {
+		switch (stage) {
+			case INPUT_STAGE      : return "input";
+			case STATISTICS_STAGE : return "statistics";
+			case MODEL_STAGE      : return "model";
+			case CODING_STAGE     : return "coding";
+			case OUTPUT_STAGE     : return "output";
+			default               : return "unknown";
+		}
+	}
+
+	char const* Stats::counter_name(counter_t counter) {
+		switch (counter) {
+			case SYMBOLS_COUNTER         : return "symbols";
+			case BITS_COUNTER            : return "bits";
+			case TREE_BUILDS_COUNTER     : return "tree_rebuilds";
+			case FGK_SWAPS_COUNTER       : return "fgk_swaps";
+			case BLOCKS_COUNTER          : return "blocks";
+			case STORED_BLOCKS_COUNTER   : return "stored_blocks";
+			case CACHE_HITS_COUNTER      : return "cache_hits";
+			case CACHE_MISSES_COUNTER    : return "cache_misses";
+			case FILTERED_BLOCKS_COUNTER : return "filtered_blocks";
+			case CODED_SEARCHES_COUNTER  : return "coded_searches";
+			case MATCHES_COUNTER         : return "matches";
+			default                      : return "unknown";
+		}
+	}
+
+	char const* Stats::hw_counter_name(hw_counter_t counter) {
+		switch (counter) {
+			case CYCLES_HW        : return "cycles";
+			case INSTRUCTIONS_HW  : return "instructions";
+			case BRANCH_MISSES_HW : return "branch_misses";
+			case L1D_MISSES_HW    : return "l1d_misses";
+			case LLC_MISSES_HW    : return "llc_misses";
+			default               : return "unknown";
+		}
+	}
+
+	Stats::Stats() {
+		reset();
+	}
+
+	// -------------------------------------------------------
+	// ------------------ HARDWARE COUNTERS ------------------
+	// -------------------------------------------------------
+
+	static std::atomic<bool> hw_enabled(false);
+
+#if defined(__linux__)
+	// Events of a thread in one perf group led by the cycles counter, so that they are scheduled on the PMU
+	// together and read with a single system call. Events the PMU lacks are left out and read as 0
+	class HwCounters {
+		struct read_format_t {
+			uint64_t nr;
+			uint64_t time_enabled;
+			uint64_t time_running;
+			uint64_t values[HW_COUNTER_NUM];
+		};
+
+		int m_fds[HW_COUNTER_NUM];
+		int m_slots[HW_COUNTER_NUM]; // position of every event in the group read, -1 if it is left out
+		int m_errno;
+
+		static int open_event(uint32_t type, uint64_t config, int group_fd) {
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size           = sizeof(attr);
+			attr.type           = type;
+			attr.config         = config;
+			attr.disabled       = group_fd == -1; // the group starts with its leader
+			attr.exclude_kernel = 1;
+			attr.exclude_hv     = 1;
+			attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+		}
+
+		static uint64_t cache_miss(uint64_t cache) {
+			return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		}
+
+	public:
+		bool good() const { return m_fds[CYCLES_HW] >= 0; }
+
+		int error() const { return m_errno; }
+
+		bool read(hw_sample_t* sample) const {
+			read_format_t data;
+			if (::read(m_fds[CYCLES_HW], &data, sizeof(data)) < static_cast<ssize_t>(3 * sizeof(uint64_t)))
+				return false;
+
+			for (size_t i = 0; i < HW_COUNTER_NUM; ++i)
+				sample->counts[i] = m_slots[i] >= 0 && static_cast<uint64_t>(m_slots[i]) < data.nr ? data.values[m_slots[i]] : 0;
+
+			sample->time_enabled = data.time_enabled;
+			sample->time_running = data.time_running;
+			return true;
+		}
+
+		HwCounters() : m_errno(0) {
+			static const struct { uint32_t type; uint64_t config; } EVENTS[HW_COUNTER_NUM] = {
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+				{ PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D) },
+				{ PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL) }
+			};
+
+			int slot = 0;
+
+			for (size_t i = 0; i < HW_COUNTER_NUM; ++i) {
+				m_fds[i]   = open_event(EVENTS[i].type, EVENTS[i].config, i == CYCLES_HW ? -1 : m_fds[CYCLES_HW]);
+				m_slots[i] = m_fds[i] >= 0 ? slot++ : -1;
+
+				if (i == CYCLES_HW && m_fds[i] < 0) {
+					m_errno = errno;
+					for (size_t j = 1; j < HW_COUNTER_NUM; ++j)
+						m_fds[j] = m_slots[j] = -1;
+					return;
+				}
+			}
+
+			ioctl(m_fds[CYCLES_HW], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+
+		~HwCounters() {
+			for (int fd : m_fds)
+				if (fd >= 0) close(fd);
+		}
+
+		HwCounters(HwCounters const&) = delete;
+		HwCounters& operator=(HwCounters const&) = delete;
+	};
+
+	static HwCounters& thread_hw_counters() {
+		static thread_local HwCounters counters;
+		return counters;
+	}
+
+	bool enable_hw_counters(std::string* error) {
+		HwCounters& counters = thread_hw_counters();
+
+		if (!counters.good()) {
+			if (error) *error = std::strerror(counters.error());
+			return false;
+		}
+
+		hw_enabled = true;
+		return true;
+	}
+
+	bool read_hw_counters(hw_sample_t* sample) {
+		return thread_hw_counters().read(sample);
+	}
+#else
+	bool enable_hw_counters(std::string* error) {
+		if (error) *error = "Not supported on this system";
+		return false;
+	}
+
+	bool read_hw_counters(hw_sample_t* /* sample */) {
+		return false;
+	}
+#endif
+
+	bool hw_counters_enabled() {
+		return hw_enabled.load(std::memory_order_relaxed);
+	}
+
+	void hw_counts_between(hw_sample_t const& start, hw_sample_t const& end, uint64_t* counts) {
+		uint64_t enabled = end.time_enabled > start.time_enabled ? end.time_enabled - start.time_enabled : 0;
+		uint64_t running = end.time_running > start.time_running ? end.time_running - start.time_running : 0;
+
+		// Never scheduled on the PMU in between, the counts would be made up
+		if (!running) {
+			std::fill(counts, counts + HW_COUNTER_NUM, 0);
+			return;
+		}
+
+		// Multiplexed with other groups, the PMU counted only part of the time in between; scale the counts
+		// up to the whole of it the way perf stat does, so that stages and IPC are not undercounted
+		double scale = running < enabled ? static_cast<double>(enabled) / running : 1.0;
+
+		for (size_t i = 0; i < HW_COUNTER_NUM; ++i) {
+			uint64_t delta = end.counts[i] > start.counts[i] ? end.counts[i] - start.counts[i] : 0;
+			counts[i] = scale == 1.0 ? delta : static_cast<uint64_t>(delta * scale + 0.5);
+		}
+	}
+
+	// -------------------------------------------------------
+	// ------------------------ JSON -------------------------
+	// -------------------------------------------------------
+
+	std::string json_string(std::string const& s) {
+		std::string quoted = "\"";
+
+		for (const auto& c : s) {
+			switch (c) {
+				case '"'  : quoted += "\\\""; break;
+				case '\\' : quoted += "\\\\"; break;
+				case '\n' : quoted += "\\n";  break;
+				case '\r' : quoted += "\\r";  break;
+				case '\t' : quoted += "\\t";  break;
+				default:
+					if (static_cast<uint8_t>(c) < 0x20) {
+						char buf[8];
+						std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+						quoted += buf;
+					}
+					else quoted += c;
+			}
+		}
+
+		quoted += '"';
+		return quoted;
+	}
+
+	// -------------------------------------------------------
+	// ----------------------- MEMORY ------------------------
+	// -------------------------------------------------------
+
+	uint64_t peak_rss_bytes() {
+		// The high water mark of /proc follows reset_peak_rss, the one of getrusage does not
+		std::ifstream status("/proc/self/status");
+		std::string line;
+
+		while (std::getline(status, line))
+			if (!line.compare(0, std::strlen("VmHWM:"), "VmHWM:"))
+				return std::strtoull(line.c_str() + std::strlen("VmHWM:"), nullptr, 10) * 1024;
+
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage)) return 0;
+		return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+	}
+
+	bool reset_peak_rss() {
+		std::ofstream clear_refs("/proc/self/clear_refs");
+		return static_cast<bool>(clear_refs << "5" << std::flush);
+	}
+
+}
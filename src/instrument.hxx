@@ -0,0 +1,197 @@
+/**
+ * instrument.hxx
+ *
+ * Per-Stage Timers and Counters
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef INSTRUMENT_HXX
+#define INSTRUMENT_HXX
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <string>
+#include <chrono>
+
+namespace instrumentation {
+
+	// Coder stages: reading input or headers, gathering statistics, building code trees/schemes,
+	// entropy coding itself and bit packing with writes to the output file
+	enum stage_t {
+		INPUT_STAGE,
+		STATISTICS_STAGE,
+		MODEL_STAGE,
+		CODING_STAGE,
+		OUTPUT_STAGE,
+		STAGE_NUM
+	};
+
+	enum counter_t {
+		SYMBOLS_COUNTER,         // symbols coded (encoders) or decoded (decoders)
+		BITS_COUNTER,            // bits emitted (encoders) or consumed (decoders)
+		TREE_BUILDS_COUNTER,     // code trees built or rebuilt
+		FGK_SWAPS_COUNTER,       // node swaps performed while updating adaptive trees
+		BLOCKS_COUNTER,          // container blocks written or read
+		STORED_BLOCKS_COUNTER,   // container blocks kept as is because coding did not pay off
+		CACHE_HITS_COUNTER,      // code tables taken from the model cache
+		CACHE_MISSES_COUNTER,    // code tables built because the model cache had none
+		FILTERED_BLOCKS_COUNTER, // container blocks coded after a reversible filter
+		CODED_SEARCHES_COUNTER,  // container blocks searched in their coded form, without decoding
+		MATCHES_COUNTER,         // occurrences of a searched pattern
+		COUNTER_NUM
+	};
+
+	// Hardware events counted per stage while hardware counters are enabled
+	enum hw_counter_t {
+		CYCLES_HW,        // CPU cycles in user space
+		INSTRUCTIONS_HW,  // instructions retired
+		BRANCH_MISSES_HW, // mispredicted branches
+		L1D_MISSES_HW,    // L1 data cache read misses
+		LLC_MISSES_HW,    // last level cache read misses
+		HW_COUNTER_NUM
+	};
+
+	// -------------------------------------------------------
+	// ------------------------ STATS ------------------------
+	// -------------------------------------------------------
+
+	class Stats {
+		uint64_t m_stage_ns[STAGE_NUM];
+		uint64_t m_counters[COUNTER_NUM];
+		uint64_t m_hw[STAGE_NUM][HW_COUNTER_NUM];
+
+	public:
+		void reset();
+
+		void add_time(stage_t stage, uint64_t ns) { m_stage_ns[stage] += ns; }
+
+		void add(counter_t counter, uint64_t n = 1) { m_counters[counter] += n; }
+
+		uint64_t time_ns(stage_t stage) const { return m_stage_ns[stage]; }
+
+		uint64_t count(counter_t counter) const { return m_counters[counter]; }
+
+		// Adds HW_COUNTER_NUM event counts to the stage
+		void add_hw(stage_t stage, uint64_t const* counts);
+
+		uint64_t hw_count(stage_t stage, hw_counter_t counter) const { return m_hw[stage][counter]; }
+
+		// Sum of the event over all stages, 0 if hardware counters were off
+		uint64_t hw_total(hw_counter_t counter) const;
+
+		// Sum of all stage timers
+		uint64_t total_ns() const;
+
+		Stats& operator+=(Stats const& other);
+
+		// Serializes timers and counters as {"stages_ns":{...},"counters":{...}}, followed by
+		// "hw_counters":{stage:{event:count}} if any events were counted
+		std::string to_json() const;
+
+		static char const* stage_name(stage_t stage);
+
+		static char const* counter_name(counter_t counter);
+
+		static char const* hw_counter_name(hw_counter_t counter);
+
+		Stats();
+	};
+
+	// -------------------------------------------------------
+	// ------------------ HARDWARE COUNTERS ------------------
+	// -------------------------------------------------------
+
+	// Makes every ScopedTimer count hardware events of its thread too (with perf_event_open, every thread
+	// opens its counters on first use). False, with the reason in error, if the kernel counts none for the
+	// calling thread (not Linux, no PMU under a VM, perf_event_paranoid); timers then go on alone
+	bool enable_hw_counters(std::string* error = nullptr);
+
+	bool hw_counters_enabled();
+
+	// Raw counts of a thread with the times its counters were enabled and actually running on the PMU
+	struct hw_sample_t {
+		uint64_t counts[HW_COUNTER_NUM];
+		uint64_t time_enabled;
+		uint64_t time_running;
+	};
+
+	// Current sample of the calling thread, false if it has no counters
+	bool read_hw_counters(hw_sample_t* sample);
+
+	// Events between two samples, scaled by the enabled over running time in between when the counters
+	// were multiplexed; all 0 if the PMU did not count them in between
+	void hw_counts_between(hw_sample_t const& start, hw_sample_t const& end, uint64_t* counts);
+
+	// -------------------------------------------------------
+	// --------------------- SCOPEDTIMER ---------------------
+	// -------------------------------------------------------
+
+	// Adds the lifetime of the object to the given stage timer and, while hardware counters are enabled,
+	// the events of the thread to the counts of the stage
+	class ScopedTimer {
+		using clock_type = std::chrono::steady_clock;
+
+		Stats&                 m_stats;
+		stage_t                m_stage;
+		clock_type::time_point m_start;
+		hw_sample_t            m_hw_start;
+		bool                   m_hw;
+
+	public:
+		ScopedTimer(Stats& stats, stage_t stage)
+			: m_stats(stats), m_stage(stage), m_start(clock_type::now()),
+			  m_hw(hw_counters_enabled() && read_hw_counters(&m_hw_start))
+		{ }
+
+		~ScopedTimer() {
+			m_stats.add_time(m_stage, std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - m_start).count());
+
+			hw_sample_t hw_end;
+			if (m_hw && read_hw_counters(&hw_end)) {
+				uint64_t counts[HW_COUNTER_NUM];
+				hw_counts_between(m_hw_start, hw_end, counts);
+				m_stats.add_hw(m_stage, counts);
+			}
+		}
+
+		ScopedTimer(ScopedTimer const&) = delete;
+		ScopedTimer& operator=(ScopedTimer const&) = delete;
+	};
+
+	// Quotes and escapes a string to be used as a JSON value
+	std::string json_string(std::string const& s);
+
+	// -------------------------------------------------------
+	// ----------------------- MEMORY ------------------------
+	// -------------------------------------------------------
+
+	// Peak resident set size of the process in bytes since start or the last reset_peak_rss call
+	uint64_t peak_rss_bytes();
+
+	// Starts measuring the peak anew, so that it covers a single run of a long-lived process; false if
+	// the kernel cannot reset it (the peak then counts from the start of the process)
+	bool reset_peak_rss();
+
+}
+
+#endif // INSTRUMENT_HXX
@@ -0,0 +1,598 @@
+/**
+ * lzcoder.cxx
+ *
+ * LZ77 Front End with Canonical Huffman Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cstdlib>   // size_t
+#include <cstdint>
+#include <cstring>   // std::memcpy
+#include <string>
+#include <vector>
+#include <iterator>  // std::istreambuf_iterator
+#include <algorithm> // std::min, std::max
+#include <climits>   // CHAR_BIT
+#include "canonical.hxx"
+#include "lzcoder.hxx"
+
+namespace dictcodes {
+
+	using namespace instrumentation;
+	using canonicalcodes::CanonicalCode;
+
+	static constexpr size_t   LITERALS     = 256;
+	static constexpr size_t   LENGTH_CODES = 16; // buckets of MAX_MATCH - MIN_MATCH
+	static constexpr size_t   DIST_CODES   = 48; // buckets of MAX_WINDOW - 1
+	static constexpr size_t   LL_ALPHABET  = LITERALS + LENGTH_CODES;
+	static constexpr unsigned LZ_MAX_LEN   = canonicalcodes::DEFAULT_CODE_LEN;
+
+	static constexpr unsigned MIN_HASH_BITS = 10;
+	static constexpr unsigned MAX_HASH_BITS = 17;
+
+	size_t lz_header_size() {
+		return canonicalcodes::lengths_size(LL_ALPHABET) + canonicalcodes::lengths_size(DIST_CODES) + sizeof(uint64_t);
+	}
+
+	// ------------------------------------------------------
+	// ---------------------- BUCKETS -----------------------
+	// ------------------------------------------------------
+
+	// Values go into buckets of powers of two split in halves: 0-3 have their own codes, then every bucket
+	// holds 2^(n-1) values told apart by n - 1 extra bits (as the distance codes of Deflate)
+	struct bucket_t {
+		uint8_t  code;
+		uint8_t  extra_len;
+		uint32_t extra;
+	};
+
+	static inline unsigned log2_floor(uint32_t value) {
+		return 31 - __builtin_clz(value);
+	}
+
+	static inline bucket_t bucket(uint32_t value) {
+		if (value < 4) return bucket_t{ static_cast<uint8_t>(value), 0, 0 };
+
+		unsigned n  = log2_floor(value);
+		unsigned hi = (value >> (n - 1)) & 1;
+		return bucket_t{ static_cast<uint8_t>(2 * n + hi), static_cast<uint8_t>(n - 1), value & ((1u << (n - 1)) - 1) };
+	}
+
+	// First value of a bucket and the number of its extra bits
+	static inline uint32_t bucket_base(unsigned code, unsigned& extra_len) {
+		if (code < 4) {
+			extra_len = 0;
+			return code;
+		}
+
+		unsigned n = code / 2;
+		extra_len = n - 1;
+		return (2u | (code & 1)) << (n - 1);
+	}
+
+	static_assert(2 * 7 + 1 < LENGTH_CODES && 2 * 23 + 1 < DIST_CODES, "Buckets must cover every length and distance");
+
+	// ------------------------------------------------------
+	// -------------------- MATCHFINDER ---------------------
+	// ------------------------------------------------------
+
+	struct level_t {
+		size_t max_chain; // candidates tried per position
+		size_t nice_len;  // a match this long is taken at once
+		bool   lazy;
+	};
+
+	static constexpr level_t LEVELS[MAX_LEVEL + 1] = {
+		{    0,   0, false },
+		{    4,  16, false },
+		{    8,  32, false },
+		{   16,  64, false },
+		{   16,  64, true  },
+		{   32, 128, true  },
+		{   64, 128, true  },
+		{  128, 258, true  },
+		{  512, 258, true  },
+		{ 4096, 258, true  }
+	};
+
+	// Literal run followed by a match (the last one of a text has no match)
+	struct sequence_t {
+		uint32_t literals;
+		uint32_t length;
+		uint32_t distance;
+	};
+
+	// Hash chains over the window: the head of the chain of every hash of MIN_MATCH bytes and, per position,
+	// the previous position with the same hash (positions are stored plus one, 0 ends a chain)
+	class MatchFinder {
+		uint8_t const*        m_text;
+		size_t                m_size;
+		size_t                m_window;
+		unsigned              m_hash_bits;
+		level_t               m_level;
+		std::vector<uint32_t> m_head;
+		std::vector<uint32_t> m_prev;
+		size_t                m_next; // the first position not inserted yet
+
+		uint32_t hash(size_t pos) const {
+			uint32_t value;
+			std::memcpy(&value, m_text + pos, sizeof(value));
+			return (value * 2654435761u) >> (32 - m_hash_bits);
+		}
+
+		// Length of the common prefix of two positions, at most limit
+		size_t common_length(size_t a, size_t b, size_t limit) const {
+			size_t len = 0;
+
+			while (len + sizeof(uint64_t) <= limit) {
+				uint64_t x, y;
+				std::memcpy(&x, m_text + a + len, sizeof(x));
+				std::memcpy(&y, m_text + b + len, sizeof(y));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+				if (x != y) return len + (__builtin_ctzll(x ^ y) >> 3);
+#else
+				if (x != y) return len + (__builtin_clzll(x ^ y) >> 3);
+#endif
+				len += sizeof(uint64_t);
+			}
+
+			while (len < limit && m_text[a + len] == m_text[b + len])
+				++len;
+
+			return len;
+		}
+
+		// Inserts every position before pos that has MIN_MATCH bytes to hash
+		void insert_until(size_t pos) {
+			for (; m_next < pos && m_next + MIN_MATCH <= m_size; ++m_next) {
+				uint32_t& head = m_head[hash(m_next)];
+				m_prev[m_next & (m_window - 1)] = head;
+				head = m_next + 1;
+			}
+		}
+
+		// Longest match at pos with an earlier position of its chain
+		void find(size_t pos, uint32_t& best_len, uint32_t& best_dist) {
+			insert_until(pos);
+
+			best_len  = 0;
+			best_dist = 0;
+
+			size_t limit = std::min(MAX_MATCH, m_size - pos);
+			if (limit < MIN_MATCH) return;
+
+			size_t chain = m_level.max_chain;
+
+			for (uint32_t cand = m_head[hash(pos)]; cand && chain--; cand = m_prev[(cand - 1) & (m_window - 1)]) {
+				size_t prev = cand - 1;
+				if (pos - prev >= m_window) break;
+
+				// A longer match must differ from the best one at its end
+				if (m_text[prev + best_len] != m_text[pos + best_len]) continue;
+
+				size_t len = common_length(prev, pos, limit);
+				if (len > best_len) {
+					best_len  = len;
+					best_dist = pos - prev;
+					if (len >= m_level.nice_len || len == limit) break;
+				}
+			}
+
+			if (best_len < MIN_MATCH) best_len = 0;
+		}
+
+	public:
+
+		// Greedy parsing, or lazy with a level that asks for it
+		void parse(std::vector<sequence_t>& sequences) {
+			sequences.clear();
+
+			size_t pos    = 0;
+			size_t anchor = 0;
+
+			while (pos + MIN_MATCH <= m_size) {
+				uint32_t len, dist;
+				find(pos, len, dist);
+
+				if (!len) {
+					++pos;
+					continue;
+				}
+
+				if (m_level.lazy)
+					while (len < m_level.nice_len && pos + 1 + MIN_MATCH <= m_size) {
+						uint32_t next_len, next_dist;
+						find(pos + 1, next_len, next_dist);
+						if (next_len <= len) break;
+
+						++pos;
+						len  = next_len;
+						dist = next_dist;
+					}
+
+				sequences.push_back(sequence_t{ static_cast<uint32_t>(pos - anchor), len, dist });
+				pos   += len;
+				anchor = pos;
+			}
+
+			sequences.push_back(sequence_t{ static_cast<uint32_t>(m_size - anchor), 0, 0 });
+		}
+
+		MatchFinder(uint8_t const* text, size_t size, int level, size_t window)
+			: m_text(text), m_size(size), m_window(window), m_hash_bits(MIN_HASH_BITS), m_level(LEVELS[level]), m_next(0)
+		{
+			// Neither the chains nor the heads outgrow the text, so that small texts (and trial samples)
+			// do not pay for clearing them
+			while (m_window > MIN_WINDOW && m_window / 2 >= size) m_window /= 2;
+			while (m_hash_bits < MAX_HASH_BITS && (size_t(1) << m_hash_bits) < size) ++m_hash_bits;
+
+			m_prev.assign(m_window, 0);
+			m_head.assign(size_t(1) << m_hash_bits, 0);
+		}
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- CODERIMPL ----------------------
+	// -------------------------------------------------------
+
+	static void write_u64(std::ostream& ofile, uint64_t value) {
+		ofile.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	class lzcoder::CoderImpl {
+		Stats                   m_stats;
+		int                     m_level;
+		size_t                  m_window;
+		bool                    m_good;
+		std::string             m_text;
+		std::string             m_bits;
+		std::vector<sequence_t> m_sequences;
+
+		// Counts the symbols of both codes
+		void count(std::vector<uint32_t>& ll_freq, std::vector<uint32_t>& dist_freq) const {
+			ll_freq.assign(LL_ALPHABET, 0);
+			dist_freq.assign(DIST_CODES, 0);
+
+			uint8_t const* p = reinterpret_cast<uint8_t const*>(m_text.data());
+
+			for (const auto& seq : m_sequences) {
+				for (uint32_t i = 0; i < seq.literals; ++i)
+					++ll_freq[*p++];
+
+				if (!seq.length) break;
+
+				++ll_freq[LITERALS + bucket(seq.length - MIN_MATCH).code];
+				++dist_freq[bucket(seq.distance - 1).code];
+				p += seq.length;
+			}
+		}
+
+	public:
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+			m_good = true;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+				m_text.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+			}
+
+			// Hash chains hold 32-bit positions, longer texts go through the block container
+			if (m_text.size() >= UINT32_MAX) {
+				std::cerr << "lzcoder::compress: Text too long for one window, code it in blocks" << std::endl;
+				m_good = false;
+				return;
+			}
+
+			std::vector<uint32_t> ll_freq, dist_freq;
+
+			{
+				ScopedTimer timer(m_stats, STATISTICS_STAGE);
+
+				MatchFinder finder(reinterpret_cast<uint8_t const*>(m_text.data()), m_text.size(), m_level, m_window);
+				finder.parse(m_sequences);
+				count(ll_freq, dist_freq);
+			}
+
+			canonicalcodes::lengths_t ll_lengths, dist_lengths;
+			CanonicalCode ll_code, dist_code;
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+
+				ll_lengths   = canonicalcodes::code_lengths(&ll_freq[0], LL_ALPHABET, LZ_MAX_LEN);
+				dist_lengths = canonicalcodes::code_lengths(&dist_freq[0], DIST_CODES, LZ_MAX_LEN);
+				ll_code.assign(ll_lengths);
+				dist_code.assign(dist_lengths);
+				m_stats.add(TREE_BUILDS_COUNTER, 2);
+			}
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+
+				m_bits.clear();
+				m_bits.reserve(m_text.size() / 2 + 16);
+
+				canonicalcodes::BitWriter writer(m_bits);
+				uint8_t const* p = reinterpret_cast<uint8_t const*>(m_text.data());
+
+				for (const auto& seq : m_sequences) {
+					for (uint32_t i = 0; i < seq.literals; ++i)
+						writer.put(ll_code.code(*p++));
+
+					if (!seq.length) break;
+
+					bucket_t len  = bucket(seq.length - MIN_MATCH);
+					bucket_t dist = bucket(seq.distance - 1);
+
+					writer.put(ll_code.code(LITERALS + len.code));
+					if (len.extra_len) writer.put(len.extra, len.extra_len);
+					writer.put(dist_code.code(dist.code));
+					if (dist.extra_len) writer.put(dist.extra, dist.extra_len);
+
+					p += seq.length;
+				}
+
+				writer.flush();
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, m_text.size());
+			m_stats.add(BITS_COUNTER, m_bits.size() * CHAR_BIT);
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+
+			canonicalcodes::write_lengths(ofile, ll_lengths);
+			canonicalcodes::write_lengths(ofile, dist_lengths);
+			write_u64(ofile, m_text.size());
+			ofile.write(m_bits.data(), m_bits.size());
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			compress(ifile, ofile);
+		}
+
+		void set_level(int level, size_t window) {
+			m_level  = std::max(MIN_LEVEL, std::min(MAX_LEVEL, level));
+			m_window = MIN_WINDOW;
+			while (m_window < MAX_WINDOW && m_window * 2 <= window) m_window *= 2;
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		bool good() const {
+			return m_good;
+		}
+
+		CoderImpl(std::istream& ifile, std::ostream& ofile)
+			: m_level(DEFAULT_LEVEL), m_window(DEFAULT_WINDOW), m_good(true)
+		{
+			compress(ifile, ofile);
+		}
+
+		CoderImpl() : m_level(DEFAULT_LEVEL), m_window(DEFAULT_WINDOW), m_good(true)
+		{ }
+	};
+
+	void lzcoder::compress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->compress(ifile, ofile);
+	}
+
+	void lzcoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	void lzcoder::set_level(int level, size_t window) {
+		m_pImpl->set_level(level, window);
+	}
+
+	Stats const& lzcoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	bool lzcoder::good() const {
+		return m_pImpl->good();
+	}
+
+	lzcoder::lzcoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new CoderImpl(ifile, ofile))
+	{ }
+
+	lzcoder::lzcoder(sharedmodels::Model const& /* model */)
+		: m_pImpl(new CoderImpl)
+	{ }
+
+	lzcoder::lzcoder() : m_pImpl(new CoderImpl)
+	{ }
+
+	lzcoder::~lzcoder()
+	{ }
+
+	// -------------------------------------------------------
+	// --------------------- DECODERIMPL ---------------------
+	// -------------------------------------------------------
+
+	class lzdecoder::DecoderImpl {
+		Stats       m_stats;
+		std::string m_payload;
+		std::string m_text;
+
+		bool fail(char const* what) {
+			std::cerr << "lzdecoder::decompress: " << what << std::endl;
+			return false;
+		}
+
+		bool read_header(std::istream& ifile, CanonicalCode& ll_code, CanonicalCode& dist_code, uint64_t& symbols) {
+			canonicalcodes::lengths_t ll_lengths, dist_lengths;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+				if (!canonicalcodes::read_lengths(ifile, ll_lengths, LL_ALPHABET) ||
+				    !canonicalcodes::read_lengths(ifile, dist_lengths, DIST_CODES))
+					return fail("Truncated code lengths");
+			}
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				if (!ll_code.assign(ll_lengths)   || ll_code.table_bits() > LZ_MAX_LEN ||
+				    !dist_code.assign(dist_lengths) || dist_code.table_bits() > LZ_MAX_LEN)
+					return fail("Invalid code lengths");
+				m_stats.add(TREE_BUILDS_COUNTER, 2);
+			}
+
+			ScopedTimer timer(m_stats, INPUT_STAGE);
+
+			if (!ifile.read(reinterpret_cast<char*>(&symbols), sizeof(symbols))) return fail("Truncated header");
+			m_payload.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+
+			return true;
+		}
+
+		// Decodes the bits into m_text, false on a match reaching out of the text
+		bool decode(CanonicalCode const& ll_code, CanonicalCode const& dist_code, uint64_t symbols) {
+			canonicalcodes::BitReader reader(reinterpret_cast<uint8_t const*>(m_payload.data()), m_payload.size());
+
+			canonicalcodes::entry_t const* ll_table   = ll_code.table();
+			canonicalcodes::entry_t const* dist_table = dist_code.table();
+			unsigned ll_bits   = ll_code.table_bits();
+			unsigned dist_bits = dist_code.table_bits();
+
+			// Codes without symbols have no table to look bits up in
+			if (symbols && !ll_bits) return fail("Invalid code lengths");
+
+			m_text.resize(symbols);
+			char*    p   = symbols ? &m_text[0] : nullptr;
+			uint64_t pos = 0;
+
+			while (pos < symbols) {
+				// A refill holds a literal/length code, length extra bits, a distance code and its extra bits
+				reader.refill();
+
+				unsigned symbol = reader.decode(ll_table, ll_bits);
+				if (symbol < LITERALS) {
+					p[pos++] = static_cast<char>(symbol);
+					continue;
+				}
+
+				if (!dist_bits) return fail("Invalid match");
+
+				unsigned extra_len;
+				uint64_t len = bucket_base(symbol - LITERALS, extra_len) + MIN_MATCH;
+				if (extra_len) {
+					len += reader.peek(extra_len);
+					reader.skip(extra_len);
+				}
+
+				uint64_t dist = bucket_base(reader.decode(dist_table, dist_bits), extra_len) + 1;
+				if (extra_len) {
+					dist += reader.peek(extra_len);
+					reader.skip(extra_len);
+				}
+
+				if (dist > pos || len > symbols - pos) return fail("Invalid match");
+
+				// Overlapping matches repeat the bytes they have just copied
+				char* dst = p + pos;
+				char const* src = dst - dist;
+				if (dist >= len) std::memcpy(dst, src, len);
+				else
+					for (uint64_t i = 0; i < len; ++i)
+						dst[i] = src[i];
+
+				pos += len;
+			}
+
+			return true;
+		}
+
+	public:
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
+			CanonicalCode ll_code, dist_code;
+			uint64_t symbols;
+
+			if (!read_header(ifile, ll_code, dist_code, symbols)) return;
+
+			// A match takes at most MAX_MATCH bytes for a bit at least
+			if (symbols > m_payload.size() * CHAR_BIT * MAX_MATCH) {
+				fail("Invalid number of symbols");
+				return;
+			}
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+				if (!decode(ll_code, dist_code, symbols)) return;
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, symbols);
+			m_stats.add(BITS_COUNTER, m_payload.size() * CHAR_BIT);
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(m_text.data(), m_text.size());
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		DecoderImpl(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		DecoderImpl()
+		{ }
+	};
+
+	void lzdecoder::decompress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->decompress(ifile, ofile);
+	}
+
+	void lzdecoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	Stats const& lzdecoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	lzdecoder::lzdecoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new DecoderImpl(ifile, ofile))
+	{ }
+
+	lzdecoder::lzdecoder(sharedmodels::Model const& /* model */, uint64_t /* symbols */)
+		: m_pImpl(new DecoderImpl)
+	{ }
+
+	lzdecoder::lzdecoder() : m_pImpl(new DecoderImpl)
+	{ }
+
+	lzdecoder::~lzdecoder()
+	{ }
+
+}
@@ -0,0 +1,133 @@
+/**
+ * lzcoder.hxx
+ *
+ * LZ77 Front End with Canonical Huffman Coding
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef LZCODER_HXX
+#define LZCODER_HXX
+
+#include <iostream>
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <memory>
+#include "instrument.hxx"
+#include "models.hxx"
+
+/**
+ * Coded text layout:
+ *
+ *   literal/length code lengths (4 bits each) | distance code lengths (4 bits each) | symbols (8 bytes) | bits
+ *
+ * The text is parsed into literals and matches (a length of 4 to 258 bytes and a distance back into the text
+ * already coded) by hash-chain match finding with lazy evaluation. Literals and length buckets share one
+ * canonical Huffman code, distance buckets have another one; extra bits pick the value within a bucket.
+ * Both codes are at most 12 bits, so a refill of the bit reader holds a whole match.
+ */
+
+namespace dictcodes {
+
+	static constexpr size_t MIN_MATCH = 4;
+	static constexpr size_t MAX_MATCH = 258;
+
+	// Effort levels trade match finding time for shorter output: longer hash chains, and from level 4 on
+	// lazy matching (a match is put off when the next position starts a longer one)
+	static constexpr int MIN_LEVEL     = 1;
+	static constexpr int MAX_LEVEL     = 9;
+	static constexpr int DEFAULT_LEVEL = 6;
+
+	// Matches reach back at most a window of bytes, a power of two
+	static constexpr size_t MIN_WINDOW     = 1 << 10; // 1 KiB
+	static constexpr size_t MAX_WINDOW     = 1 << 24; // 16 MiB
+	static constexpr size_t DEFAULT_WINDOW = 1 << 20; // 1 MiB
+
+	// Bytes of the coded text before the bits
+	size_t lz_header_size();
+
+	// -------------------------------------------------------
+	// ----------------------- LZCODER -----------------------
+	// -------------------------------------------------------
+
+	class lzcoder {
+		class CoderImpl;
+		std::unique_ptr<CoderImpl> m_pImpl;
+
+	public:
+
+		// Parses text into literals and matches and writes them coded with canonical Huffman codes to the output file
+		void compress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Effort level (clamped to MIN_LEVEL..MAX_LEVEL) and window size (rounded down to a power of two within
+		// MIN_WINDOW..MAX_WINDOW) of the following compress calls, the decoder needs neither
+		void set_level(int level, size_t window = DEFAULT_WINDOW);
+
+		// Stage timers and counters of the last compress call
+		instrumentation::Stats const& stats() const;
+
+		// False if the last compress call refused a text too long for one window, nothing is written then
+		bool good() const;
+
+		lzcoder(std::istream& ifile, std::ostream& ofile);
+
+		// Shared models hold no match statistics, so the codes are stored as without one
+		explicit lzcoder(sharedmodels::Model const& model);
+
+		lzcoder();
+
+		~lzcoder();
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- LZDECODER ----------------------
+	// -------------------------------------------------------
+
+	class lzdecoder {
+		class DecoderImpl;
+		std::unique_ptr<DecoderImpl> m_pImpl;
+
+	public:
+
+		// Decodes literals and copies matches and writes the text to the output file
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last decompress call
+		instrumentation::Stats const& stats() const;
+
+		lzdecoder(std::istream& ifile, std::ostream& ofile);
+
+		// Decodes a text coded with a shared model, which the coded text does not depend on
+		lzdecoder(sharedmodels::Model const& model, uint64_t symbols);
+
+		lzdecoder();
+
+		~lzdecoder();
+	};
+
+}
+
+#endif // LZCODER_HXX
@@ -0,0 +1,285 @@
+/**
+ * models.cxx
+ *
+ * Pre-Trained Shared Models
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cstdlib>     // size_t
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <fcntl.h>     // open
+#include <unistd.h>    // close
+#include <sys/mman.h>  // mmap, munmap
+#include <sys/stat.h>  // fstat
+#include "ahcoder.hxx"
+#include "models.hxx"
+
+namespace sharedmodels {
+
+	static constexpr char   MAGIC[]     = { 'L', 'C', 'M', 'D' };
+	static constexpr size_t TABLES_SIZE = (ALPHABET + ALPHABET * ALPHABET) * sizeof(uint32_t);
+
+	static_assert(sizeof(header_t) % 8 == 0 && sizeof(fgk_node_t) % 8 == 0 && TABLES_SIZE % 8 == 0,
+	              "model sections must stay 8-byte aligned");
+
+	static size_t file_size(size_t fgk_nodes) {
+		return sizeof(header_t) + TABLES_SIZE + fgk_nodes * sizeof(fgk_node_t);
+	}
+
+	// 32-bit FNV-1a
+	static uint32_t fnv1a(char const* data, size_t size) {
+		uint32_t hash = 2166136261u;
+
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= static_cast<uint8_t>(data[i]);
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	// Smooths raw counts (+1 for every symbol) and scales them down to MAX_TOTAL if needed
+	static void scale_table(uint64_t const* counts, uint32_t* table) {
+		uint64_t total = 0;
+		for (size_t i = 0; i < ALPHABET; ++i)
+			total += counts[i];
+
+		double scale = (total + ALPHABET <= MAX_TOTAL) ? 1.0 : static_cast<double>(MAX_TOTAL - ALPHABET) / total;
+
+		for (size_t i = 0; i < ALPHABET; ++i)
+			table[i] = 1 + static_cast<uint32_t>(counts[i] * scale);
+	}
+
+	static bool valid_table(uint32_t const* table) {
+		uint64_t total = 0;
+
+		for (size_t i = 0; i < ALPHABET; ++i) {
+			if (!table[i]) return false;
+			total += table[i];
+		}
+
+		return total <= MAX_TOTAL;
+	}
+
+	// Every node but the root is the child of exactly one node with a higher order, internal nodes have both
+	// children, leaves are the NYT node (once) or distinct bytes
+	static bool valid_fgk(fgk_node_t const* nodes, size_t size) {
+		if (!size || size > 2 * ALPHABET + 1) return false;
+
+		std::vector<bool> is_child(size, false);
+		std::vector<bool> seen(ALPHABET, false);
+		bool nyt = false;
+
+		for (size_t i = 0; i < size; ++i) {
+			fgk_node_t const& node = nodes[i];
+
+			if (node.symbol == FGK_INTERNAL) {
+				int32_t children[] = { node.left, node.right };
+
+				for (int32_t child : children) {
+					if (child <= static_cast<int32_t>(i) || child >= static_cast<int32_t>(size) || is_child[child])
+						return false;
+					is_child[child] = true;
+				}
+			}
+			else if (node.left != -1 || node.right != -1) return false;
+			else if (node.symbol == FGK_NYT) {
+				if (nyt) return false;
+				nyt = true;
+			}
+			else if (node.symbol < 0 || node.symbol >= static_cast<int32_t>(ALPHABET) || seen[node.symbol]) return false;
+			else seen[node.symbol] = true;
+		}
+
+		for (size_t i = 1; i < size; ++i)
+			if (!is_child[i]) return false;
+
+		return nyt;
+	}
+
+	// -------------------------------------------------------
+	// ------------------------ MODEL ------------------------
+	// -------------------------------------------------------
+
+	void Model::bind(void const* data) {
+		m_header = static_cast<header_t const*>(data);
+		m_order0 = reinterpret_cast<uint32_t const*>(m_header + 1);
+		m_order1 = m_order0 + ALPHABET;
+		m_fgk    = reinterpret_cast<fgk_node_t const*>(m_order1 + ALPHABET * ALPHABET);
+	}
+
+	void Model::unmap() {
+		if (m_map) munmap(m_map, m_map_size);
+
+		m_map      = nullptr;
+		m_map_size = 0;
+		m_header   = nullptr;
+		m_order0   = nullptr;
+		m_order1   = nullptr;
+		m_fgk      = nullptr;
+
+		m_buf.clear();
+	}
+
+	void Model::train(std::istream& ifile) {
+		unmap();
+
+		std::vector<uint64_t> order0(ALPHABET, 0);
+		std::vector<uint64_t> order1(ALPHABET * ALPHABET, 0);
+		uint64_t symbols = 0;
+
+		ifile.clear();
+		ifile.seekg(0, std::ios::beg);
+
+		char   chunk[1 << 16];
+		size_t context = ALPHABET; // none yet
+
+		while (ifile.read(chunk, sizeof(chunk)) || ifile.gcount()) {
+			size_t n = ifile.gcount();
+
+			for (size_t i = 0; i < n; ++i) {
+				uint8_t c = chunk[i];
+
+				++order0[c];
+				if (context != ALPHABET) ++order1[context * ALPHABET + c];
+				context = c;
+			}
+
+			symbols += n;
+		}
+
+		fgk_state_t fgk;
+
+		ifile.clear();
+		ifile.seekg(0, std::ios::beg);
+		adaptivecodes::train_fgk(ifile, fgk);
+
+		size_t size = file_size(fgk.size());
+		m_buf.assign(size / sizeof(uint64_t), 0);
+		char* data = reinterpret_cast<char*>(&m_buf[0]);
+
+		header_t* header = reinterpret_cast<header_t*>(data);
+		std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+		header->version   = MODEL_VERSION;
+		header->fgk_nodes = fgk.size();
+		header->symbols   = symbols;
+
+		uint32_t* tables = reinterpret_cast<uint32_t*>(header + 1);
+		scale_table(&order0[0], tables);
+		for (size_t i = 0; i < ALPHABET; ++i)
+			scale_table(&order1[i * ALPHABET], tables + (i + 1) * ALPHABET);
+
+		std::memcpy(data + sizeof(header_t) + TABLES_SIZE, &fgk[0], fgk.size() * sizeof(fgk_node_t));
+
+		header->id = fnv1a(data + sizeof(header_t), size - sizeof(header_t));
+		bind(data);
+	}
+
+	bool Model::load(char const* path) {
+		unmap();
+
+		int fd = open(path, O_RDONLY);
+		if (fd == -1) {
+			std::cerr << "Model::load: " << std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		struct stat s;
+		if (fstat(fd, &s) || static_cast<size_t>(s.st_size) < sizeof(header_t) + TABLES_SIZE) {
+			close(fd);
+			std::cerr << "Model::load: Not a libcoders model" << std::endl;
+			return false;
+		}
+
+		void* map = mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+
+		if (map == MAP_FAILED) {
+			std::cerr << "Model::load: " << std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		m_map      = map;
+		m_map_size = s.st_size;
+
+		header_t const* header = static_cast<header_t const*>(map);
+		char const*     data   = static_cast<char const*>(map);
+		char const*     what   = nullptr;
+
+		if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)))
+			what = "Not a libcoders model";
+		else if (header->version != MODEL_VERSION)
+			what = "Unsupported model version";
+		else if (m_map_size != file_size(header->fgk_nodes))
+			what = "Truncated model";
+		else if (fnv1a(data + sizeof(header_t), m_map_size - sizeof(header_t)) != header->id)
+			what = "Corrupted model";
+
+		if (!what) {
+			bind(map);
+
+			bool valid = valid_table(m_order0) && valid_fgk(m_fgk, header->fgk_nodes);
+			for (size_t i = 0; valid && i < ALPHABET; ++i)
+				valid = valid_table(order1(i));
+
+			if (!valid) what = "Malformed model";
+		}
+
+		if (what) {
+			std::cerr << "Model::load: " << what << std::endl;
+			unmap();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Model::save(std::ostream& ofile) const {
+		if (!ofile.write(reinterpret_cast<const char*>(m_header), size()) || !ofile.flush()) {
+			std::cerr << "Model::save: " << std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	size_t Model::size() const {
+		return m_header ? file_size(m_header->fgk_nodes) : 0;
+	}
+
+	Model::Model(char const* path) : Model() {
+		load(path);
+	}
+
+	Model::Model()
+		: m_map(nullptr), m_map_size(0), m_header(nullptr), m_order0(nullptr), m_order1(nullptr), m_fgk(nullptr)
+	{ }
+
+	Model::~Model() {
+		unmap();
+	}
+
+}
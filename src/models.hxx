@@ -0,0 +1,137 @@
+/**
+ * models.hxx
+ *
+ * Pre-Trained Shared Models
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef MODELS_HXX
+#define MODELS_HXX
+
+#include <iostream>
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <vector>
+
+/**
+ * Model file layout (native byte order, every section 8-byte aligned, so that a mapped file is used in place):
+ *
+ *   header_t
+ *   order-0 frequencies: ALPHABET x uint32
+ *   order-1 frequencies: ALPHABET x ALPHABET x uint32, one row per previous byte
+ *   FGK tree: fgk_nodes x fgk_node_t, record i is the node with the i-th highest order (the root first)
+ *
+ * Frequencies are smoothed (every symbol gets at least 1) and scaled to MAX_TOTAL per table, so that any text
+ * can be coded with them.
+ */
+
+namespace sharedmodels {
+
+	static constexpr size_t   ALPHABET      = 256;
+	static constexpr uint32_t MODEL_VERSION = 1;
+	static constexpr uint32_t MAX_TOTAL     = 1 << 24;
+
+	// Symbols of FGK nodes that are not leaves of a byte
+	static constexpr int32_t FGK_NYT      = -1;
+	static constexpr int32_t FGK_INTERNAL = -2;
+
+	struct header_t {
+		char     magic[4];  // "LCMD"
+		uint32_t version;
+		uint32_t id;        // FNV-1a of everything after the header
+		uint32_t fgk_nodes;
+		uint64_t symbols;   // size of the training corpus
+	};
+
+	struct fgk_node_t {
+		int32_t  symbol;    // byte, FGK_NYT or FGK_INTERNAL
+		int32_t  left;      // record index of the left child, -1 for leaves
+		int32_t  right;     // record index of the right child, -1 for leaves
+		uint32_t reserved;
+		uint64_t weight;
+	};
+
+	using fgk_state_t = typename std::vector<fgk_node_t>;
+
+	// -------------------------------------------------------
+	// ------------------------ MODEL ------------------------
+	// -------------------------------------------------------
+
+	class Model {
+		std::vector<uint64_t> m_buf;      // storage of a trained model
+		void*                 m_map;      // storage of a loaded model
+		size_t                m_map_size;
+
+		header_t const*   m_header;
+		uint32_t const*   m_order0;
+		uint32_t const*   m_order1;
+		fgk_node_t const* m_fgk;
+
+		// Points the accessors into a buffer laid out as the model file
+		void bind(void const* data);
+
+		void unmap();
+
+	public:
+
+		// Builds the model from a sample corpus: byte and bigram frequencies and the state of an FGK tree
+		// that has adapted to the whole corpus
+		void train(std::istream& ifile);
+
+		// Maps a model file, returns false (the model stays empty) if it is missing or malformed
+		bool load(char const* path);
+
+		// Writes the model file, returns false on a write error
+		bool save(std::ostream& ofile) const;
+
+		bool good() const { return m_header != nullptr; }
+
+		uint32_t id() const { return m_header->id; }
+
+		// Size of the training corpus
+		uint64_t symbols() const { return m_header->symbols; }
+
+		// Size of the model file
+		size_t size() const;
+
+		uint32_t const* order0() const { return m_order0; }
+
+		uint32_t const* order1(uint8_t context) const { return m_order1 + context * ALPHABET; }
+
+		fgk_node_t const* fgk_nodes() const { return m_fgk; }
+
+		size_t fgk_size() const { return m_header->fgk_nodes; }
+
+		explicit Model(char const* path);
+
+		Model();
+
+		~Model();
+
+		Model(Model const&) = delete;
+		Model& operator=(Model const&) = delete;
+	};
+
+}
+
+#endif // MODELS_HXX
@@ -26,7 +26,6 @@
  */
 
 #include <iostream>
-#include <fstream>
 #include <cstdlib>    // size_t, std::abs
 #include <cstdint>
 #include <vector>
@@ -42,7 +41,7 @@ namespace staticcodes {
 	// --------------------- STATISTICS ---------------------
 	// ------------------------------------------------------
 
-	void Statistics::create_freq_vector(std::ifstream& ifile) {
+	void Statistics::create_freq_vector(std::istream& ifile) {
 		m_freq_vec.clear();
 		m_freq_vec.resize(ALPHABET, 0);
 
@@ -51,10 +50,20 @@ namespace staticcodes {
 		char c;
 		while (ifile.read(&c, sizeof(c))) {
 			++m_freq_vec[static_cast<uint8_t>(c)];
-			++m_total_chars;
+
+			// A text longer than 32-bit counts hold is refused, there is no use in reading the rest of it
+			if (++m_total_chars > MAX_TABLE_TEXT) return;
 		}
 	}
 
+	void Statistics::load_freq_vector(uint32_t const* freq) {
+		m_freq_vec.assign(freq, freq + ALPHABET);
+
+		m_total_chars = 0;
+		for (const auto& f : m_freq_vec)
+			m_total_chars += f;
+	}
+
 	void Statistics::create_distr_vector() {
 		m_distr_vec.clear();
 
@@ -162,6 +171,13 @@ namespace staticcodes {
 		code.pop_back();
 	}
 
+	void CodeTree::single_symbol_tree(tree_t& m_tree, scheme_vec_t& m_scheme_vec, uint8_t symbol) {
+		m_tree.push_back(Node(1, -1, 0, 1)); // ROOT
+		m_tree.push_back(Node(-1, -1, symbol, 1));
+
+		m_scheme_vec[symbol] = bitseq_t(1, 0);
+	}
+
 	CodeTree::CodeTree()
 	{ }
 
@@ -212,12 +228,14 @@ namespace staticcodes {
 	}
 
 	void shennon::create_code_scheme(distr_vec_t& m_distr_vec) {
+		m_tree.clear();
 		m_scheme_vec.clear();
 		m_scheme_vec.resize(ALPHABET);
 
 		if (m_distr_vec.empty()) return;
 		if (m_distr_vec.size() == 1) {
-			m_scheme_vec[m_distr_vec.front().first] = bitseq_t(1, 0);
+			single_symbol_tree(m_tree, m_scheme_vec, m_distr_vec.front().first);
+			m_root = 0;
 			return;
 		}
 
@@ -272,12 +290,14 @@ namespace staticcodes {
 	}
 
 	void fano::create_code_scheme(distr_vec_t& m_distr_vec) {
+		m_tree.clear();
 		m_scheme_vec.clear();
 		m_scheme_vec.resize(ALPHABET);
 
 		if (m_distr_vec.empty()) return;
 		if (m_distr_vec.size() == 1) {
-			m_scheme_vec[m_distr_vec.front().first] = bitseq_t(1, 0);
+			single_symbol_tree(m_tree, m_scheme_vec, m_distr_vec.front().first);
+			m_root = 0;
 			return;
 		}
 		
@@ -317,12 +337,14 @@ namespace staticcodes {
 	}
 
 	void huffman::create_code_scheme(distr_vec_t& m_distr_vec) {
+		m_tree.clear();
 		m_scheme_vec.clear();
 		m_scheme_vec.resize(ALPHABET);
 
 		if (m_distr_vec.empty()) return;
 		if (m_distr_vec.size() == 1) {
-			m_scheme_vec[m_distr_vec.front().first] = bitseq_t(1, 0);
+			single_symbol_tree(m_tree, m_scheme_vec, m_distr_vec.front().first);
+			m_root = 0;
 			return;
 		}
 
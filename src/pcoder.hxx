@@ -30,14 +30,20 @@
 #define PCODER_HXX
 
 #include <iostream>
-#include <fstream>
 #include <cstdlib> // size_t
 #include <cstdint>
 #include <cstring>
 #include <cerrno>
+#include <string>
 #include <vector>
-#include <utility> // std::pair
-#include <climits> // CHAR_BIT
+#include <memory>
+#include <utility>  // std::pair
+#include <algorithm> // std::upper_bound
+#include <climits>  // CHAR_BIT
+#include <typeinfo> // typeid
+#include "instrument.hxx"
+#include "models.hxx"
+#include "cache.hxx"
 
 namespace staticcodes {
 
@@ -49,6 +55,10 @@ namespace staticcodes {
 
 	static constexpr size_t ALPHABET = 256;
 
+	// Longest text a coder with a frequency table of 32-bit counts takes in one piece; longer inputs go
+	// through the block container (blockcodes), where every block of at most 1 GiB has a table of its own
+	static constexpr uint64_t MAX_TABLE_TEXT = UINT32_MAX;
+
 	// ------------------------------------------------------
 	// --------------------- STATISTICS ---------------------
 	// ------------------------------------------------------
@@ -61,7 +71,10 @@ namespace staticcodes {
 		uint64_t    m_total_chars;
 
 		// Creates a frequency vector containing number of occurrencies of every char in the input file
-		void create_freq_vector(std::ifstream& ifile);
+		void create_freq_vector(std::istream& ifile);
+
+		// Fills the frequency vector with the order-0 table of a shared model
+		void load_freq_vector(uint32_t const* freq);
 
 		// Creates a probability distribution vector containing pairs <char, char_probability>
 		void create_distr_vector();
@@ -69,6 +82,15 @@ namespace staticcodes {
 		// Creates a probability ranges vector containing pairs <char_left_border, char_right_border> (acoder only)
 		void create_range_vector();
 
+		// Same as create_range_vector, but takes the vector from the model cache if it was created before
+		// for the frequency vector (or the shared model it was loaded from)
+		void cached_range_vector(sharedmodels::Model const* model, instrumentation::Stats& stats);
+
+		// Returns the code scheme of the frequency vector (or of the shared model it was loaded from): built
+		// once and taken from the model cache afterwards
+		template<typename Algorithm>
+		std::shared_ptr<Algorithm const> cached_code_scheme(sharedmodels::Model const* model, instrumentation::Stats& stats);
+
 		Statistics();
 	};
 
@@ -103,6 +125,9 @@ namespace staticcodes {
 		// Creates code scheme by recursively traversalling the code tree
 		void traverse_code_tree(tree_t& m_tree, scheme_vec_t& m_scheme_vec, int index, bitseq_t code);
 
+		// Creates a root with a single left leaf, so that the only symbol is coded with one 0 bit
+		void single_symbol_tree(tree_t& m_tree, scheme_vec_t& m_scheme_vec, uint8_t symbol);
+
 		CodeTree();
 	};
 
@@ -173,20 +198,33 @@ namespace staticcodes {
 
 	template<typename Algorithm>
 	class pcoder : private Statistics {
-		Algorithm m_alg;
-		bitseq_t  m_seq;
+		std::shared_ptr<Algorithm const> m_alg;
+		bitseq_t                         m_seq;
+		instrumentation::Stats           m_stats;
+		sharedmodels::Model const*       m_model;
+		bool                             m_good;
 
-		// Creates a vector with a bit sequence containing binary code that will be written to the output file
-		void create_bit_sequence(std::ifstream& ifile);
+		// Creates a vector with a bit sequence containing binary code that will be written to the output file,
+		// returns the number of coded chars
+		uint64_t create_bit_sequence(std::istream& ifile);
 
 	public:
 
 		// Encodes text and writes the final bit sequence to the output file
-		void compress(std::ifstream& ifile, std::ofstream& ofile);
+		void compress(std::istream& ifile, std::ostream& ofile);
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile);
+		void operator()(std::istream& ifile, std::ostream& ofile);
 
-		pcoder(std::ifstream& ifile, std::ofstream& ofile);
+		// Stage timers and counters of the last compress call
+		instrumentation::Stats const& stats() const { return m_stats; }
+
+		// False if the last compress call refused a text longer than MAX_TABLE_TEXT, nothing is written then
+		bool good() const { return m_good; }
+
+		pcoder(std::istream& ifile, std::ostream& ofile);
+
+		// Codes with the frequencies of a pre-trained model, so no frequency table is written
+		explicit pcoder(sharedmodels::Model const& model);
 
 		pcoder();
 	};
@@ -197,50 +235,220 @@ namespace staticcodes {
 
 	template<typename Algorithm>
 	class pdecoder : private Statistics {
-		Algorithm m_alg;
+		std::shared_ptr<Algorithm const> m_alg;
+		instrumentation::Stats           m_stats;
+		sharedmodels::Model const*       m_model;
+		uint64_t                         m_symbols;
 
 	public:
 
 		// Decodes text and writes the final bit sequence to the output file
-		void decompress(std::ifstream& ifile, std::ofstream& ofile);
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last decompress call
+		instrumentation::Stats const& stats() const { return m_stats; }
 
-		void operator()(std::ifstream& ifile, std::ofstream& ofile);
+		pdecoder(std::istream& ifile, std::ostream& ofile);
 
-		pdecoder(std::ifstream& ifile, std::ofstream& ofile);
+		// Decodes a text of "symbols" chars coded with the frequencies of the model
+		pdecoder(sharedmodels::Model const& model, uint64_t symbols);
 
 		pdecoder();
 	};
 
+	// -------------------------------------------------------
+	// ---------------------- PSEARCHER ----------------------
+	// -------------------------------------------------------
+
+	// Coded bytes between the sync marks a psearcher keeps to decode neighborhoods of matches
+	static constexpr size_t SYNC_INTERVAL = 1 << 8;
+
+	// Finds a pattern in a text coded by pcoder without decoding it: the pattern is coded with the code of the
+	// text and its bits are looked for in the coded stream, a match counts only where a code starts
+	template<typename Algorithm>
+	class psearcher : private Statistics {
+		// Decoder state at a byte boundary (the code tree node reached) and a byte of codes: the state after the
+		// byte and the number of codes the byte completes
+		struct step_t {
+			uint16_t next;
+			uint16_t symbols;
+		};
+
+		// State and number of completed codes at the start of every SYNC_INTERVAL-th coded byte
+		struct mark_t {
+			uint64_t symbols;
+			uint16_t state;
+		};
+
+		std::shared_ptr<Algorithm const> m_alg;
+		instrumentation::Stats           m_stats;
+		sharedmodels::Model const*       m_model;
+		uint64_t                         m_symbols;
+		std::string                      m_pattern;
+		std::string                      m_data;
+		std::vector<int>                 m_nodes;  // tree node of every state, the root is state 0
+		std::vector<step_t>              m_steps;  // 256 steps per state
+		std::vector<mark_t>              m_marks;
+		std::vector<uint8_t>             m_shifts; // bit offsets in a byte where the coded pattern may start
+		std::vector<uint64_t>            m_matches;
+		uint64_t                         m_total;
+
+		bool is_leaf(int index) const {
+			return m_alg->m_tree[index].left == -1 && m_alg->m_tree[index].right == -1;
+		}
+
+		bool bit(uint64_t pos) const {
+			return static_cast<uint8_t>(m_data[pos / CHAR_BIT]) & (1 << (7 - pos % CHAR_BIT));
+		}
+
+		// Follows a bit from a tree node, a leaf completes a code and leads back to the root (as does a
+		// missing child of a corrupted text)
+		int follow(int index, bool bit, uint64_t& symbols) const {
+			index = bit ? m_alg->m_tree[index].right : m_alg->m_tree[index].left;
+			if (index == -1) return m_alg->m_root;
+
+			if (is_leaf(index)) {
+				++symbols;
+				return m_alg->m_root;
+			}
+
+			return index;
+		}
+
+		// Builds the byte steps of every inner node of the code tree
+		void create_step_table();
+
+		// Walks the coded text a byte at a time, marking sync points and checking every bit offset where the
+		// coded pattern may start
+		void scan(bitseq_t const& code);
+
+	public:
+
+		// Reads a coded text and finds every occurrence of the pattern in it
+		void search(std::istream& ifile);
+
+		void operator()(std::istream& ifile);
+
+		// Offsets of the matches of the last search call in the decoded text, in increasing order (overlapping
+		// ones included)
+		std::vector<uint64_t> const& matches() const { return m_matches; }
+
+		// Length of the decoded text of the last search call
+		uint64_t size() const { return m_total; }
+
+		// Decodes chars [begin, end) of the text of the last search call, starting from the nearest sync mark
+		std::string extract(uint64_t begin, uint64_t end) const;
+
+		// Stage timers and counters of the last search call
+		instrumentation::Stats const& stats() const { return m_stats; }
+
+		psearcher(std::istream& ifile, std::string const& pattern);
+
+		explicit psearcher(std::string const& pattern);
+
+		// Searches a text of "symbols" chars coded with the frequencies of the model
+		psearcher(sharedmodels::Model const& model, uint64_t symbols, std::string const& pattern);
+	};
+
+	// -------------------------------------------------------
+	// ------------------- STATISTICS IMPL -------------------
+	// -------------------------------------------------------
+
+	template<typename Algorithm>
+	std::shared_ptr<Algorithm const> Statistics::cached_code_scheme(sharedmodels::Model const* model, instrumentation::Stats& stats) {
+		using namespace instrumentation;
+
+		modelcache::ModelCache& cache = modelcache::ModelCache::instance();
+		modelcache::key_t key = model ? modelcache::model_key(typeid(Algorithm).name(), model->id())
+		                              : modelcache::histogram_key(typeid(Algorithm).name(), &m_freq_vec[0], m_freq_vec.size());
+
+		if (std::shared_ptr<Algorithm const> cached = cache.find<Algorithm>(key)) {
+			stats.add(CACHE_HITS_COUNTER);
+			return cached;
+		}
+
+		stats.add(CACHE_MISSES_COUNTER);
+
+		std::shared_ptr<Algorithm> alg = std::make_shared<Algorithm>();
+		create_distr_vector();
+		alg->create_code_scheme(m_distr_vec);
+		stats.add(TREE_BUILDS_COUNTER);
+
+		size_t bytes = sizeof(Algorithm) + alg->m_tree.size() * sizeof(Node);
+		for (const auto& code : alg->m_scheme_vec)
+			bytes += sizeof(code) + code.size() / CHAR_BIT;
+
+		cache.insert<Algorithm>(key, alg, bytes);
+		return alg;
+	}
+
 	// -------------------------------------------------------
 	// --------------------- PCODER IMPL ---------------------
 	// -------------------------------------------------------
 
 	template<typename Algorithm>
-	void pcoder<Algorithm>::create_bit_sequence(std::ifstream& ifile) {
+	uint64_t pcoder<Algorithm>::create_bit_sequence(std::istream& ifile) {
 		m_seq.clear();
 
 		ifile.clear();
 		ifile.seekg(0, std::ios::beg);
 
+		uint64_t cnt_chars = 0;
+
 		char c;
-		while (ifile.read(&c, sizeof(c)))
+		while (ifile.read(&c, sizeof(c))) {
 			m_seq.insert(
 				m_seq.end(),
-				m_alg.m_scheme_vec[static_cast<uint8_t>(c)].begin(),
-				m_alg.m_scheme_vec[static_cast<uint8_t>(c)].end()
+				m_alg->m_scheme_vec[static_cast<uint8_t>(c)].begin(),
+				m_alg->m_scheme_vec[static_cast<uint8_t>(c)].end()
 			);
+			++cnt_chars;
+		}
+
+		return cnt_chars;
 	}
 
 	template<typename Algorithm>
-	void pcoder<Algorithm>::compress(std::ifstream& ifile, std::ofstream& ofile) {
-		create_freq_vector(ifile);
-		create_distr_vector();
-		m_alg.create_code_scheme(m_distr_vec);
-		create_bit_sequence(ifile);
+	void pcoder<Algorithm>::compress(std::istream& ifile, std::ostream& ofile) {
+		using namespace instrumentation;
+		m_stats.reset();
+		m_good = true;
+
+		{
+			ScopedTimer timer(m_stats, STATISTICS_STAGE);
+			if (m_model) load_freq_vector(m_model->order0());
+			else         create_freq_vector(ifile);
+		}
 
-		// Writing the frequency table to file (in binary notation)
-		for (const auto& freq : m_freq_vec)
-			ofile.write(reinterpret_cast<const char*>(&freq), sizeof(freq));
+		if (m_total_chars > MAX_TABLE_TEXT) {
+			std::cerr << "pcoder::compress: Text too long for one frequency table, code it in blocks" << std::endl;
+			m_good = false;
+			return;
+		}
+
+		{
+			ScopedTimer timer(m_stats, MODEL_STAGE);
+			m_alg = cached_code_scheme<Algorithm>(m_model, m_stats);
+		}
+
+		uint64_t cnt_chars;
+
+		{
+			ScopedTimer timer(m_stats, CODING_STAGE);
+			cnt_chars = create_bit_sequence(ifile);
+		}
+
+		m_stats.add(SYMBOLS_COUNTER, cnt_chars);
+		m_stats.add(BITS_COUNTER, m_seq.size());
+
+		ScopedTimer timer(m_stats, OUTPUT_STAGE);
+
+		// Writing the frequency table to file (in binary notation), a shared model is known to the decoder
+		if (!m_model)
+			for (const auto& freq : m_freq_vec)
+				ofile.write(reinterpret_cast<const char*>(&freq), sizeof(freq));
 
 		uint8_t bit_buffer  = 0;
 		size_t  bit_counter = 0;
@@ -262,17 +470,21 @@ namespace staticcodes {
 	}
 
 	template<typename Algorithm>
-	void pcoder<Algorithm>::operator()(std::ifstream& ifile, std::ofstream& ofile) {
+	void pcoder<Algorithm>::operator()(std::istream& ifile, std::ostream& ofile) {
 		compress(ifile, ofile);
 	}
 
 	template<typename Algorithm>
-	pcoder<Algorithm>::pcoder(std::ifstream& ifile, std::ofstream& ofile) {
+	pcoder<Algorithm>::pcoder(std::istream& ifile, std::ostream& ofile) : m_model(nullptr), m_good(true) {
 		compress(ifile, ofile);
 	}
 
 	template<typename Algorithm>
-	pcoder<Algorithm>::pcoder()
+	pcoder<Algorithm>::pcoder(sharedmodels::Model const& model) : m_model(&model), m_good(true)
+	{ }
+
+	template<typename Algorithm>
+	pcoder<Algorithm>::pcoder() : m_model(nullptr), m_good(true)
 	{ }
 
 	// -------------------------------------------------------
@@ -280,18 +492,33 @@ namespace staticcodes {
 	// -------------------------------------------------------
 
 	template<typename Algorithm>
-	void pdecoder<Algorithm>::decompress(std::ifstream& ifile, std::ofstream& ofile) {
+	void pdecoder<Algorithm>::decompress(std::istream& ifile, std::ostream& ofile) {
+		using namespace instrumentation;
+		m_stats.reset();
+
 		m_freq_vec.clear();
 		m_total_chars = 0;
 
-		// Reading the frequency table and filling the frequency vector with it
-		for (size_t i = 0; i < ALPHABET; ++i) {
-			uint32_t tmp;
-			ifile.read(reinterpret_cast<char*>(&tmp), sizeof(tmp));
-			m_freq_vec.push_back(tmp);
-			m_total_chars += tmp;
+		if (m_model) {
+			ScopedTimer timer(m_stats, STATISTICS_STAGE);
+			load_freq_vector(m_model->order0());
+			if (!m_symbols) return;
+		}
+		else {
+			ScopedTimer timer(m_stats, INPUT_STAGE);
+
+			// Reading the frequency table and filling the frequency vector with it
+			for (size_t i = 0; i < ALPHABET; ++i) {
+				uint32_t tmp;
+				ifile.read(reinterpret_cast<char*>(&tmp), sizeof(tmp));
+				m_freq_vec.push_back(tmp);
+				m_total_chars += tmp;
+			}
 		}
 
+		// Model frequencies only shape the code, the text length comes with the model
+		uint64_t total_chars = m_model ? m_symbols : m_total_chars;
+
 		// If there is no coded text in the input file after the header (frequency table) -> exit
 		if (ifile.peek() == EOF) {
 			if (!ifile.eof())
@@ -299,56 +526,291 @@ namespace staticcodes {
 			return;
 		}
 
-		create_distr_vector();
-		m_alg.create_code_scheme(m_distr_vec);
+		{
+			ScopedTimer timer(m_stats, MODEL_STAGE);
+			m_alg = cached_code_scheme<Algorithm>(m_model, m_stats);
+		}
+
+		ScopedTimer timer(m_stats, CODING_STAGE);
 
 		char     curr_byte;
-		int      curr_index  = m_alg.m_root;
+		int      curr_index  = m_alg->m_root;
 		size_t   bit_counter = 0;
 		uint64_t cnt_chars   = 0;
+		uint64_t cnt_bits    = 0;
 
 		ifile.read(&curr_byte, sizeof(curr_byte));
 
 		// Decoding
 		while (true) {
+			++cnt_bits;
+
 			// Read 1 bit from current byte
 			bool curr_bit = curr_byte & (1 << (7 - bit_counter));
 
 			// Traverse the code tree
-			if (!curr_bit) curr_index = m_alg.m_tree[curr_index].left;
-			else           curr_index = m_alg.m_tree[curr_index].right;
+			if (!curr_bit) curr_index = m_alg->m_tree[curr_index].left;
+			else           curr_index = m_alg->m_tree[curr_index].right;
 
 			// If current node is a list -> send it to file
-			if (m_alg.m_tree[curr_index].left == -1 && m_alg.m_tree[curr_index].right == -1) {
-				char symbol = m_alg.m_tree[curr_index].symbol;
+			if (m_alg->m_tree[curr_index].left == -1 && m_alg->m_tree[curr_index].right == -1) {
+				char symbol = m_alg->m_tree[curr_index].symbol;
 				ofile.write(&symbol, sizeof(symbol));
-				curr_index = m_alg.m_root;
+				curr_index = m_alg->m_root;
 				++cnt_chars;
 			}
 
 			// If number of decoded chars != number of chars in original text (~ remove padding) -> exit loop
-			if (cnt_chars == m_total_chars) break;
+			if (cnt_chars == total_chars) break;
 
-			// Read next data chunk
+			// Read next data chunk, a text cut short (or a corrupted frequency table) ends here
 			if (++bit_counter == CHAR_BIT) {
-				ifile.read(&curr_byte, sizeof(curr_byte));
+				if (!ifile.read(&curr_byte, sizeof(curr_byte))) break;
 				bit_counter = 0;
 			}
 		}
+
+		m_stats.add(SYMBOLS_COUNTER, cnt_chars);
+		m_stats.add(BITS_COUNTER, cnt_bits);
 	}
 
 	template<typename Algorithm>
-	void pdecoder<Algorithm>::operator()(std::ifstream& ifile, std::ofstream& ofile) {
+	void pdecoder<Algorithm>::operator()(std::istream& ifile, std::ostream& ofile) {
 		decompress(ifile, ofile);
 	}
 
 	template<typename Algorithm>
-	pdecoder<Algorithm>::pdecoder(std::ifstream& ifile, std::ofstream& ofile) {
+	pdecoder<Algorithm>::pdecoder(std::istream& ifile, std::ostream& ofile) : m_model(nullptr), m_symbols(0) {
 		decompress(ifile, ofile);
 	}
 
 	template<typename Algorithm>
-	pdecoder<Algorithm>::pdecoder()
+	pdecoder<Algorithm>::pdecoder(sharedmodels::Model const& model, uint64_t symbols)
+		: m_model(&model), m_symbols(symbols)
+	{ }
+
+	template<typename Algorithm>
+	pdecoder<Algorithm>::pdecoder() : m_model(nullptr), m_symbols(0)
+	{ }
+
+	// -------------------------------------------------------
+	// ------------------- PSEARCHER IMPL --------------------
+	// -------------------------------------------------------
+
+	template<typename Algorithm>
+	void psearcher<Algorithm>::create_step_table() {
+		std::vector<int> state_of(m_alg->m_tree.size(), -1);
+
+		m_nodes.assign(1, m_alg->m_root);
+		state_of[m_alg->m_root] = 0;
+
+		for (size_t i = 0; i < m_alg->m_tree.size(); ++i)
+			if (static_cast<int>(i) != m_alg->m_root && !is_leaf(i)) {
+				state_of[i] = m_nodes.size();
+				m_nodes.push_back(i);
+			}
+
+		m_steps.resize(m_nodes.size() * 256);
+
+		for (size_t state = 0; state < m_nodes.size(); ++state)
+			for (size_t byte = 0; byte < 256; ++byte) {
+				int      index   = m_nodes[state];
+				uint64_t symbols = 0;
+
+				for (size_t k = 0; k < CHAR_BIT; ++k)
+					index = follow(index, byte & (1 << (7 - k)), symbols);
+
+				m_steps[state * 256 + byte].next    = state_of[index];
+				m_steps[state * 256 + byte].symbols = symbols;
+			}
+	}
+
+	template<typename Algorithm>
+	void psearcher<Algorithm>::scan(bitseq_t const& code) {
+		uint64_t bits      = code.size();
+		uint64_t head_bits = bits < 57 ? bits : 57; // compared at once in a 64-bit window shifted by up to 7
+		uint64_t head      = 0;
+
+		for (size_t i = 0; i < head_bits; ++i)
+			head = head << 1 | code[i];
+
+		// Up to 8 first bits of the pattern against every 16 bits of the stream, so that most bytes are passed
+		// by a single lookup
+		size_t   lead_bits = head_bits < CHAR_BIT ? head_bits : CHAR_BIT;
+		uint32_t lead      = head >> (head_bits - lead_bits);
+
+		m_shifts.assign(bits ? 1 << 16 : 0, 0);
+		for (uint32_t v = 0; v < m_shifts.size(); ++v)
+			for (size_t shift = 0; shift < CHAR_BIT; ++shift)
+				if ((v << shift & 0xFFFF) >> (16 - lead_bits) == lead)
+					m_shifts[v] |= 1 << shift;
+
+		size_t   size    = m_data.size();
+		uint64_t window  = 0;
+		uint64_t symbols = 0;
+		size_t   state   = 0;
+
+		for (size_t i = 0; i < sizeof(window); ++i)
+			window = window << CHAR_BIT | (i < size ? static_cast<uint8_t>(m_data[i]) : 0);
+
+		for (size_t i = 0; i < size && symbols < m_total; ++i) {
+			if (i % SYNC_INTERVAL == 0) {
+				mark_t mark;
+				mark.symbols = symbols;
+				mark.state   = state;
+				m_marks.push_back(mark);
+			}
+
+			for (uint32_t shifts = bits ? m_shifts[window >> 48] : 0; shifts; shifts &= shifts - 1) {
+				size_t shift = __builtin_ctz(shifts);
+				if ((window << shift) >> (64 - head_bits) != head) continue;
+
+				// The bits match, the pattern is there if a code starts at them
+				int      index = m_nodes[state];
+				uint64_t at    = symbols;
+				for (size_t k = 0; k < shift; ++k)
+					index = follow(index, bit(i * CHAR_BIT + k), at);
+
+				if (index != m_alg->m_root || at + m_pattern.size() > m_total) continue;
+
+				uint64_t pos  = i * CHAR_BIT + shift;
+				bool     same = pos + bits <= size * CHAR_BIT;
+				for (uint64_t k = head_bits; same && k < bits; ++k)
+					same = bit(pos + k) == code[k];
+
+				if (same) m_matches.push_back(at);
+			}
+
+			step_t const& step = m_steps[state * 256 + static_cast<uint8_t>(m_data[i])];
+			symbols += step.symbols;
+			state    = step.next;
+
+			window = window << CHAR_BIT | (i + sizeof(window) < size ? static_cast<uint8_t>(m_data[i + sizeof(window)]) : 0);
+		}
+	}
+
+	template<typename Algorithm>
+	void psearcher<Algorithm>::search(std::istream& ifile) {
+		using namespace instrumentation;
+		m_stats.reset();
+
+		m_matches.clear();
+		m_marks.clear();
+		m_data.clear();
+		m_freq_vec.clear();
+		m_total_chars = 0;
+		m_total       = 0;
+
+		if (m_model) {
+			ScopedTimer timer(m_stats, STATISTICS_STAGE);
+			load_freq_vector(m_model->order0());
+		}
+		else {
+			ScopedTimer timer(m_stats, INPUT_STAGE);
+
+			for (size_t i = 0; i < ALPHABET; ++i) {
+				uint32_t tmp;
+				if (!ifile.read(reinterpret_cast<char*>(&tmp), sizeof(tmp))) return;
+				m_freq_vec.push_back(tmp);
+				m_total_chars += tmp;
+			}
+		}
+
+		m_total = m_model ? m_symbols : m_total_chars;
+		if (!m_total) return;
+
+		{
+			ScopedTimer timer(m_stats, INPUT_STAGE);
+			char chunk[1 << 16];
+			while (ifile.read(chunk, sizeof(chunk)) || ifile.gcount())
+				m_data.append(chunk, ifile.gcount());
+		}
+
+		bitseq_t code;
+
+		{
+			ScopedTimer timer(m_stats, MODEL_STAGE);
+			m_alg = cached_code_scheme<Algorithm>(m_model, m_stats);
+			create_step_table();
+
+			// A char with no code does not occur in the text, so neither does the pattern
+			for (const auto& c : m_pattern) {
+				bitseq_t const& char_code = m_alg->m_scheme_vec[static_cast<uint8_t>(c)];
+				if (char_code.empty()) {
+					code.clear();
+					break;
+				}
+				code.insert(code.end(), char_code.begin(), char_code.end());
+			}
+		}
+
+		ScopedTimer timer(m_stats, CODING_STAGE);
+		scan(code);
+
+		m_stats.add(BITS_COUNTER, m_data.size() * CHAR_BIT);
+	}
+
+	template<typename Algorithm>
+	void psearcher<Algorithm>::operator()(std::istream& ifile) {
+		search(ifile);
+	}
+
+	template<typename Algorithm>
+	std::string psearcher<Algorithm>::extract(uint64_t begin, uint64_t end) const {
+		std::string text;
+		if (end > m_total) end = m_total;
+		if (begin >= end || m_marks.empty()) return text;
+
+		// The last mark before the first code of the range
+		size_t m = std::upper_bound(m_marks.begin() + 1, m_marks.end(), begin, [](uint64_t symbols, mark_t const& mark) {
+			return symbols < mark.symbols;
+		}) - m_marks.begin() - 1;
+
+		size_t   byte    = m * SYNC_INTERVAL;
+		size_t   state   = m_marks[m].state;
+		uint64_t symbols = m_marks[m].symbols;
+
+		// Whole bytes that complete no code of the range are stepped over
+		for (; byte < m_data.size(); ++byte) {
+			step_t const& step = m_steps[state * 256 + static_cast<uint8_t>(m_data[byte])];
+			if (symbols + step.symbols > begin) break;
+
+			symbols += step.symbols;
+			state    = step.next;
+		}
+
+		int index = m_nodes[state];
+
+		for (uint64_t pos = byte * CHAR_BIT; pos < m_data.size() * CHAR_BIT && symbols < end; ++pos) {
+			uint64_t before = symbols;
+			int      next   = follow(index, bit(pos), symbols);
+
+			if (symbols != before && before >= begin) {
+				int leaf = bit(pos) ? m_alg->m_tree[index].right : m_alg->m_tree[index].left;
+				text.push_back(m_alg->m_tree[leaf].symbol);
+			}
+
+			index = next;
+		}
+
+		return text;
+	}
+
+	template<typename Algorithm>
+	psearcher<Algorithm>::psearcher(std::istream& ifile, std::string const& pattern)
+		: m_model(nullptr), m_symbols(0), m_pattern(pattern), m_total(0)
+	{
+		search(ifile);
+	}
+
+	template<typename Algorithm>
+	psearcher<Algorithm>::psearcher(std::string const& pattern)
+		: m_model(nullptr), m_symbols(0), m_pattern(pattern), m_total(0)
+	{ }
+
+	template<typename Algorithm>
+	psearcher<Algorithm>::psearcher(sharedmodels::Model const& model, uint64_t symbols, std::string const& pattern)
+		: m_model(&model), m_symbols(symbols), m_pattern(pattern), m_total(0)
 	{ }
 	
 }
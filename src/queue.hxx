@@ -0,0 +1,163 @@
+/**
+ * queue.hxx
+ *
+ * Bounded Lock-Free Queue
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef QUEUE_HXX
+#define QUEUE_HXX
+
+#include <cstdlib> // size_t
+#include <cstdint> // intptr_t
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+namespace concurrency {
+
+	// Waiting strategy of the blocking queue operations: yields for a while, then naps, so that an idle
+	// stage does not keep a core busy while another one waits for the disk
+	class Backoff {
+		static constexpr unsigned YIELD_LIMIT = 64;
+
+		unsigned m_spins;
+
+	public:
+		void pause() {
+			if (m_spins < YIELD_LIMIT) {
+				++m_spins;
+				std::this_thread::yield();
+			}
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+
+		Backoff() : m_spins(0)
+		{ }
+	};
+
+	// -------------------------------------------------------
+	// -------------------- BOUNDEDQUEUE ---------------------
+	// -------------------------------------------------------
+
+	// Multi-producer multi-consumer ring buffer (D. Vyukov's bounded queue): every cell carries a sequence
+	// number telling whether it is free for the producer of a lap or full for its consumer, so producers
+	// and consumers only contend on their own position counter
+	template<typename T>
+	class BoundedQueue {
+		struct cell_t {
+			std::atomic<size_t> sequence;
+			T                   value;
+		};
+
+		static constexpr size_t CACHE_LINE = 64;
+
+		std::unique_ptr<cell_t[]> m_cells;
+		size_t                    m_mask;
+
+		alignas(CACHE_LINE) std::atomic<size_t> m_push_pos;
+		alignas(CACHE_LINE) std::atomic<size_t> m_pop_pos;
+
+	public:
+
+		// Returns false if the queue is full
+		bool try_push(T const& value) {
+			size_t pos = m_push_pos.load(std::memory_order_relaxed);
+
+			while (true) {
+				cell_t& cell = m_cells[pos & m_mask];
+				size_t  seq  = cell.sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+				if (!diff) {
+					if (m_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						cell.value = value;
+						cell.sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0)
+					return false;
+				else
+					pos = m_push_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		// Returns false if the queue is empty
+		bool try_pop(T& value) {
+			size_t pos = m_pop_pos.load(std::memory_order_relaxed);
+
+			while (true) {
+				cell_t& cell = m_cells[pos & m_mask];
+				size_t  seq  = cell.sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+				if (!diff) {
+					if (m_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						value = cell.value;
+						cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0)
+					return false;
+				else
+					pos = m_pop_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		// Waits for a free cell
+		void push(T const& value) {
+			Backoff backoff;
+			while (!try_push(value)) backoff.pause();
+		}
+
+		// Waits for a value
+		void pop(T& value) {
+			Backoff backoff;
+			while (!try_pop(value)) backoff.pause();
+		}
+
+		size_t capacity() const { return m_mask + 1; }
+
+		// The capacity is rounded up to a power of two
+		explicit BoundedQueue(size_t capacity) : m_push_pos(0), m_pop_pos(0) {
+			size_t size = 2;
+			while (size < capacity) size <<= 1;
+
+			m_cells.reset(new cell_t[size]);
+			m_mask = size - 1;
+
+			for (size_t i = 0; i < size; ++i)
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		BoundedQueue(BoundedQueue const&) = delete;
+		BoundedQueue& operator=(BoundedQueue const&) = delete;
+	};
+
+}
+
+#endif // QUEUE_HXX
@@ -0,0 +1,443 @@
+/**
+ * server.cxx
+ *
+ * Local Compression Server over a Unix Socket
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>      // size_t
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <csignal>      // std::sig_atomic_t
+#include <string>
+#include <utility>      // std::move
+#include <memory>
+#include <future>
+#include <thread>
+#include <chrono>
+#include <unistd.h>     // close, unlink
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>   // S_ISSOCK
+#include <sys/socket.h>
+#include <sys/un.h>     // struct sockaddr_un
+#include "batch.hxx"
+#include "server.hxx"
+
+namespace servercodes {
+
+	// How often the accepting loop checks for stop() when no client connects
+	static constexpr int POLL_INTERVAL_MS = 200;
+
+	// Copies of the data of a buffer request held while it is coded
+	static constexpr uint64_t BUFFER_COPIES = 4;
+
+	static volatile std::sig_atomic_t stop_requested = 0;
+
+	request_t::request_t()
+		: type(COMPRESS_BUFFER), method(blockcodes::HUFFMAN), speed_weight(blockcodes::PREFER_BALANCED)
+	{ }
+
+	response_t::response_t() : status(FAILED), isize(0), osize(0), queue_ns(0), elapsed_ns(0)
+	{ }
+
+	static uint64_t nanoseconds_since(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// ------------------------------------------------------
+	// ---------------------- SOCKETS -----------------------
+	// ------------------------------------------------------
+
+	static bool read_full(int fd, void* buf, size_t size) {
+		char* p = static_cast<char*>(buf);
+
+		while (size) {
+			ssize_t n = ::recv(fd, p, size, 0);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+
+			p    += n;
+			size -= n;
+		}
+
+		return true;
+	}
+
+	static bool write_full(int fd, void const* buf, size_t size) {
+		char const* p = static_cast<char const*>(buf);
+
+		while (size) {
+			// No SIGPIPE when the peer is gone, the write just fails
+			ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+
+			p    += n;
+			size -= n;
+		}
+
+		return true;
+	}
+
+	static bool write_full(int fd, std::string const& s) {
+		return write_full(fd, s.data(), s.size());
+	}
+
+	// Same encoding as blockcodes::read_varint, read from the socket byte by byte
+	static bool read_varint(int fd, uint64_t& value) {
+		value = 0;
+
+		for (size_t shift = 0; shift < 64; shift += 7) {
+			uint8_t byte;
+			if (!read_full(fd, &byte, 1)) return false;
+
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+
+		return false;
+	}
+
+	static bool read_string(int fd, std::string& s, uint64_t size) {
+		s.resize(size);
+		return !size || read_full(fd, &s[0], size);
+	}
+
+	static sockaddr_un socket_address(std::string const& path) {
+		sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+		return addr;
+	}
+
+	// Reads everything of a request but its data
+	static bool read_request_header(int fd, request_t& request, uint64_t& size) {
+		uint8_t header[3];
+		if (!read_full(fd, header, sizeof(header))) return false;
+
+		request.type         = static_cast<request_type_t>(header[0]);
+		request.method       = static_cast<blockcodes::method_t>(header[1]);
+		request.speed_weight = header[2] / 100.0;
+
+		return read_varint(fd, size);
+	}
+
+	static bool write_request(int fd, request_t const& request) {
+		std::ostringstream header;
+		header.put(request.type);
+		header.put(request.method);
+		header.put(static_cast<char>(request.speed_weight * 100 + 0.5));
+		blockcodes::write_varint(header, request.data.size());
+
+		return write_full(fd, header.str()) && write_full(fd, request.data);
+	}
+
+	static bool read_response(int fd, response_t& response) {
+		uint8_t  status;
+		uint64_t size;
+
+		if (!read_full(fd, &status, 1)) return false;
+		response.status = static_cast<status_t>(status);
+
+		return read_varint(fd, response.isize)    && read_varint(fd, response.osize)      &&
+		       read_varint(fd, response.queue_ns) && read_varint(fd, response.elapsed_ns) &&
+		       read_varint(fd, size) && read_string(fd, response.data,  size)             &&
+		       read_varint(fd, size) && read_string(fd, response.stats, size);
+	}
+
+	static bool write_response(int fd, response_t const& response) {
+		std::ostringstream header;
+		header.put(response.status);
+		blockcodes::write_varint(header, response.isize);
+		blockcodes::write_varint(header, response.osize);
+		blockcodes::write_varint(header, response.queue_ns);
+		blockcodes::write_varint(header, response.elapsed_ns);
+		blockcodes::write_varint(header, response.data.size());
+
+		std::ostringstream trailer;
+		blockcodes::write_varint(trailer, response.stats.size());
+		trailer << response.stats;
+
+		return write_full(fd, header.str()) && write_full(fd, response.data) && write_full(fd, trailer.str());
+	}
+
+	static response_t failure(std::string const& error) {
+		response_t response;
+		response.data = error;
+		return response;
+	}
+
+	// ------------------------------------------------------
+	// ---------------------- REQUESTS ----------------------
+	// ------------------------------------------------------
+
+	static bool compressing(request_type_t type) {
+		return type == COMPRESS_BUFFER || type == COMPRESS_FILE;
+	}
+
+	static response_t run_buffer_request(request_t const& request, sharedmodels::Model const* model, uint64_t memory_budget,
+	                                     size_t sharers) {
+		response_t response;
+
+		std::istringstream ifile(request.data);
+		std::ostringstream ofile;
+
+		if (compressing(request.type)) {
+			blockcodes::bcoder coder(request.method, blockcodes::DEFAULT_BLOCK_SIZE, request.speed_weight, model);
+			coder.set_memory_budget(memory_budget, sharers);
+			coder(ifile, ofile);
+			if (!coder.good()) return failure(blockcodes::error_message(coder.error()));
+			response.stats = coder.stats().to_json();
+		}
+		else {
+			blockcodes::bdecoder decoder(model);
+			decoder.set_memory_budget(memory_budget, sharers);
+			decoder(ifile, ofile);
+			if (!decoder.good()) return failure("Malformed or truncated compressed data");
+			response.stats = decoder.stats().to_json();
+		}
+
+		response.status = OK;
+		response.data   = ofile.str();
+		response.isize  = request.data.size();
+		response.osize  = response.data.size();
+		return response;
+	}
+
+	static response_t run_file_request(request_t const& request, sharedmodels::Model const* model, uint64_t memory_budget,
+	                                   size_t sharers) {
+		size_t separator = request.data.find('\0');
+		if (separator == std::string::npos || !separator || separator + 1 == request.data.size())
+			return failure("Malformed file request");
+
+		batchcodes::job_t job;
+		job.ipath = request.data.substr(0, separator);
+		job.opath = request.data.substr(separator + 1);
+
+		batchcodes::options_t options;
+		options.operation    = compressing(request.type) ? batchcodes::COMPRESS : batchcodes::DECOMPRESS;
+		options.method       = request.method;
+		options.speed_weight = request.speed_weight;
+		options.model         = model;
+		options.jobs          = sharers;
+		options.memory_budget = memory_budget;
+
+		batchcodes::result_t result = batchcodes::run_job(job, options);
+		if (!result.ok) return failure(result.error);
+
+		response_t response;
+		response.status = OK;
+		response.isize  = result.isize;
+		response.osize  = result.osize;
+		response.stats  = result.stats.to_json();
+		return response;
+	}
+
+	response_t run_request(request_t const& request, sharedmodels::Model const* model, uint64_t memory_budget, size_t sharers) {
+		auto start = std::chrono::steady_clock::now();
+
+		if (request.type < COMPRESS_BUFFER || request.type > DECOMPRESS_FILE)
+			return failure("Invalid request type");
+
+		if (compressing(request.type) && request.method != blockcodes::AUTO &&
+		    (request.method <= blockcodes::STORED || request.method >= blockcodes::METHOD_NUM))
+			return failure("Invalid coding method");
+
+		if (request.speed_weight > blockcodes::PREFER_SPEED)
+			return failure("Invalid preference");
+
+		response_t response = request.type == COMPRESS_BUFFER || request.type == DECOMPRESS_BUFFER
+		                      ? run_buffer_request(request, model, memory_budget, sharers)
+		                      : run_file_request(request, model, memory_budget, sharers);
+
+		response.elapsed_ns = nanoseconds_since(start);
+		return response;
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- SERVER -----------------------
+	// ------------------------------------------------------
+
+	bool Server::listen() {
+		sockaddr_un addr = socket_address(m_path);
+
+		if (m_path.empty() || m_path.size() >= sizeof(addr.sun_path)) {
+			std::cerr << "Server::listen: Invalid socket path" << std::endl;
+			return false;
+		}
+
+		// A socket file nobody accepts on is left by a server that did not exit cleanly
+		struct stat s;
+		if (!stat(m_path.c_str(), &s)) {
+			Client probe;
+			if (!S_ISSOCK(s.st_mode) || probe.connect(m_path)) {
+				std::cerr << "Server::listen: " << m_path << " is in use" << std::endl;
+				return false;
+			}
+			unlink(m_path.c_str());
+		}
+
+		m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (m_fd < 0 || ::bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+		    ::listen(m_fd, SOMAXCONN)) {
+			std::cerr << "Server::listen: " << std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	void Server::serve_connection(int fd) {
+		request_t request;
+		uint64_t  size;
+
+		while (read_request_header(fd, request, size)) {
+			if (size > MAX_REQUEST_SIZE) {
+				++m_requests;
+				++m_failed;
+				write_response(fd, failure("Request too large"));
+				break;
+			}
+
+			// A request buffer, its stream copy, the output and the response data of every worker
+			if (m_budget && BUFFER_COPIES * size * workers() > m_budget / 2) {
+				++m_requests;
+				++m_failed;
+				write_response(fd, failure("Request exceeds the memory budget"));
+				break;
+			}
+
+			if (!read_string(fd, request.data, size)) break;
+
+			std::promise<response_t> promise;
+			std::future<response_t>  future = promise.get_future();
+			auto queued = std::chrono::steady_clock::now();
+
+			m_pool.submit([this, &request, &promise, queued] {
+				uint64_t queue_ns = nanoseconds_since(queued);
+				response_t response = run_request(request, m_model, m_budget / 2, workers());
+				response.queue_ns = queue_ns;
+				promise.set_value(std::move(response));
+			});
+
+			response_t response = future.get();
+
+			++m_requests;
+			if (response.status != OK) ++m_failed;
+
+			if (!write_response(fd, response)) break;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_clients.erase(fd);
+		close(fd);
+
+		if (!--m_connections)
+			m_idle_cv.notify_all();
+	}
+
+	void Server::run() {
+		while (!stop_requested) {
+			pollfd pfd = { m_fd, POLLIN, 0 };
+			if (poll(&pfd, 1, POLL_INTERVAL_MS) <= 0) continue; // timed out or interrupted by a signal
+
+			int fd = ::accept(m_fd, nullptr, nullptr);
+			if (fd < 0) continue;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_clients.insert(fd);
+			++m_connections;
+			std::thread(&Server::serve_connection, this, fd).detach();
+		}
+
+		close(m_fd);
+		m_fd = -1;
+		unlink(m_path.c_str());
+
+		// Wake up the connections waiting for another request, the ones being coded still get their response
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (int fd : m_clients)
+			::shutdown(fd, SHUT_RD);
+
+		m_idle_cv.wait(lock, [this] { return !m_connections; });
+	}
+
+	void Server::stop() {
+		stop_requested = 1;
+	}
+
+	Server::Server(std::string const& path, sharedmodels::Model const* model, uint64_t memory_budget)
+		: m_path(path), m_fd(-1), m_model(model), m_budget(memory_budget), m_pool(concurrency::scheduler()), m_connections(0), m_requests(0),
+		  m_failed(0)
+	{ }
+
+	Server::~Server() {
+		if (m_fd >= 0) {
+			close(m_fd);
+			unlink(m_path.c_str());
+		}
+	}
+
+	// ------------------------------------------------------
+	// ----------------------- CLIENT -----------------------
+	// ------------------------------------------------------
+
+	bool Client::connect(std::string const& path) {
+		sockaddr_un addr = socket_address(path);
+
+		if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+			errno = ENAMETOOLONG;
+			return false;
+		}
+
+		if (m_fd >= 0) close(m_fd);
+		m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (m_fd < 0 || ::connect(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) {
+			int error = errno;
+			if (m_fd >= 0) close(m_fd);
+			m_fd  = -1;
+			errno = error;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Client::request(request_t const& request, response_t& response) {
+		return m_fd >= 0 && write_request(m_fd, request) && read_response(m_fd, response);
+	}
+
+	Client::Client() : m_fd(-1)
+	{ }
+
+	Client::~Client() {
+		if (m_fd >= 0) close(m_fd);
+	}
+
+}
@@ -0,0 +1,166 @@
+/**
+ * server.hxx
+ *
+ * Local Compression Server over a Unix Socket
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef SERVER_HXX
+#define SERVER_HXX
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <string>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "threadpool.hxx"
+#include "blocks.hxx"
+#include "models.hxx"
+
+/**
+ * Protocol (all sizes and times are LEB128 varints), any number of requests per connection, answered in order:
+ *
+ *   request:  type (1 byte) | method (1 byte) | preference (1 byte) | size | data
+ *   response: status (1 byte) | isize | osize | queue_ns | elapsed_ns | size | data | stats_size | stats
+ *
+ * Buffer requests carry the input as data and get the output back as data. File requests carry
+ * "input path\0output path" (resolved by the server) and get no data back. The method (a method_t id)
+ * and the preference (speed weight in percent for AUTO) are used by compressing requests only.
+ *
+ * A failed request gets FAILED and the error message as data. Stats are the JSON stage timers and counters
+ * of the coder; queue_ns is the time the request waited for a free worker, elapsed_ns the time it was coded.
+ */
+
+namespace servercodes {
+
+	enum request_type_t : uint8_t {
+		COMPRESS_BUFFER   = 1,
+		DECOMPRESS_BUFFER = 2,
+		COMPRESS_FILE     = 3,
+		DECOMPRESS_FILE   = 4
+	};
+
+	enum status_t : uint8_t { OK = 0, FAILED = 1 };
+
+	// Requests with more data than that are refused and their connection closed
+	static constexpr uint64_t MAX_REQUEST_SIZE = blockcodes::MAX_BLOCK_SIZE;
+
+	struct request_t {
+		request_type_t       type;
+		blockcodes::method_t method;
+		double               speed_weight;
+		std::string          data;
+
+		request_t();
+	};
+
+	struct response_t {
+		status_t    status;
+		uint64_t    isize;
+		uint64_t    osize;
+		uint64_t    queue_ns;
+		uint64_t    elapsed_ns;
+		std::string data;
+		std::string stats;
+
+		response_t();
+	};
+
+	// Runs a request in the calling thread, within a memory budget shared with sharers - 1 more requests
+	response_t run_request(request_t const& request, sharedmodels::Model const* model, uint64_t memory_budget = 0,
+	                       size_t sharers = 1);
+
+	// -------------------------------------------------------
+	// ----------------------- SERVER ------------------------
+	// -------------------------------------------------------
+
+	class Server {
+		std::string                m_path;
+		int                        m_fd;
+		sharedmodels::Model const* m_model;
+		uint64_t                   m_budget;
+		concurrency::ThreadPool&   m_pool;
+
+		std::mutex                 m_mutex;
+		std::condition_variable    m_idle_cv;
+		std::set<int>              m_clients;
+		size_t                     m_connections;
+		std::atomic<uint64_t>      m_requests;
+		std::atomic<uint64_t>      m_failed;
+
+		void serve_connection(int fd);
+
+	public:
+
+		// Binds the socket (replacing a stale socket file left by a previous server), false on failure
+		bool listen();
+
+		// Accepts connections until stop() is called, every connection gets a thread of its own that reads
+		// requests and hands them to the scheduler of the process (see concurrency::scheduler)
+		void run();
+
+		// Makes run() return once the requests being coded are answered; async-signal-safe
+		static void stop();
+
+		uint64_t requests() const { return m_requests; }
+		uint64_t failed()   const { return m_failed; }
+		size_t   workers()  const { return m_pool.size(); }
+
+		// The model (if any) compresses every compressing request and stays loaded for the life of the server.
+		// With a memory budget (0 means none) buffers of requests take at most half of it and coding the rest
+		Server(std::string const& path, sharedmodels::Model const* model, uint64_t memory_budget = 0);
+
+		~Server();
+
+		Server(Server const&) = delete;
+		Server& operator=(Server const&) = delete;
+	};
+
+	// -------------------------------------------------------
+	// ----------------------- CLIENT ------------------------
+	// -------------------------------------------------------
+
+	class Client {
+		int m_fd;
+
+	public:
+
+		// Connects to a server, false on failure (errno tells why)
+		bool connect(std::string const& path);
+
+		// Sends a request and waits for its response, false if the connection broke
+		bool request(request_t const& request, response_t& response);
+
+		Client();
+
+		~Client();
+
+		Client(Client const&) = delete;
+		Client& operator=(Client const&) = delete;
+	};
+
+}
+
+#endif // SERVER_HXX
@@ -0,0 +1,335 @@
+/**
+ * threadpool.cxx
+ *
+ * Work-Stealing Task Scheduler
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <utility> // std::move
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#if defined(__linux__)
+#include <pthread.h> // pthread_setaffinity_np
+#include <sched.h>   // cpu_set_t
+#endif
+#include "queue.hxx" // Backoff
+#include "threadpool.hxx"
+
+namespace concurrency {
+
+	size_t hardware_workers() {
+		size_t n = std::thread::hardware_concurrency();
+		return n ? n : 1;
+	}
+
+	// -------------------------------------------------------
+	// --------------------- THREADPOOL ----------------------
+	// -------------------------------------------------------
+
+	// Pool and index of the worker running the current thread
+	struct worker_id_t {
+		ThreadPool const* pool;
+		size_t            index;
+	};
+
+	static thread_local worker_id_t current_worker = { nullptr, 0 };
+
+	size_t ThreadPool::worker_index() const {
+		return current_worker.pool == this ? current_worker.index : size();
+	}
+
+	bool ThreadPool::pop_task(size_t index, task_t& task) {
+		deque_t& deque = m_deques[index];
+		std::lock_guard<std::mutex> lock(deque.mutex);
+		if (deque.tasks.empty()) return false;
+
+		task = std::move(deque.tasks.back());
+		deque.tasks.pop_back();
+		--m_queued;
+		return true;
+	}
+
+	// Takes the oldest task of the other deques, starting from the next one so that thieves spread out
+	bool ThreadPool::steal_task(size_t index, task_t& task) {
+		size_t n = size();
+
+		for (size_t i = 1; i <= n; ++i) {
+			size_t victim = (index + i) % n;
+			if (victim == index) continue;
+
+			deque_t& deque = m_deques[victim];
+			std::lock_guard<std::mutex> lock(deque.mutex);
+			if (deque.tasks.empty()) continue;
+
+			task = std::move(deque.tasks.front());
+			deque.tasks.pop_front();
+			--m_queued;
+			return true;
+		}
+
+		return false;
+	}
+
+	void ThreadPool::run_task(task_t& task) {
+		task();
+
+		if (m_unfinished.fetch_sub(1) == 1) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_idle_cv.notify_all();
+		}
+	}
+
+	void ThreadPool::worker_loop(size_t index) {
+		current_worker.pool  = this;
+		current_worker.index = index;
+
+		while (true) {
+			task_t task;
+
+			if (pop_task(index, task) || steal_task(index, task)) {
+				run_task(task);
+				continue;
+			}
+
+			// Submitters count the task before they look for sleepers, sleepers count themselves before they
+			// look for tasks, so a task is never left behind with every worker asleep
+			std::unique_lock<std::mutex> lock(m_mutex);
+			++m_sleepers;
+			m_task_cv.wait(lock, [this] { return m_stop || m_queued; });
+			--m_sleepers;
+
+			if (m_stop && !m_queued) return; // stopped and drained
+		}
+	}
+
+	void ThreadPool::submit(task_t task) {
+		size_t index = worker_index();
+		if (index == size()) index = m_next++ % size();
+
+		++m_unfinished;
+
+		{
+			deque_t& deque = m_deques[index];
+			std::lock_guard<std::mutex> lock(deque.mutex);
+			deque.tasks.push_back(std::move(task));
+		}
+
+		++m_queued;
+
+		if (m_sleepers) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_task_cv.notify_one();
+		}
+	}
+
+	bool ThreadPool::run_pending() {
+		size_t index = worker_index();
+		task_t task;
+
+		if ((index < size() && pop_task(index, task)) || steal_task(index, task)) {
+			run_task(task);
+			return true;
+		}
+
+		return false;
+	}
+
+	void ThreadPool::wait() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idle_cv.wait(lock, [this] { return !m_unfinished; });
+	}
+
+	ThreadPool::ThreadPool(size_t workers, bool pin)
+		: m_size(workers ? workers : 1), m_next(0), m_queued(0), m_unfinished(0), m_sleepers(0), m_pinned(false), m_stop(false) {
+		workers = m_size;
+
+		m_deques.reset(new deque_t[workers]);
+		m_workers.reserve(workers);
+
+		for (size_t i = 0; i < workers; ++i)
+			m_workers.emplace_back(&ThreadPool::worker_loop, this, i);
+
+#if defined(__linux__)
+		if (pin) {
+			m_pinned = true;
+
+			for (size_t i = 0; i < workers; ++i) {
+				cpu_set_t cpus;
+				CPU_ZERO(&cpus);
+				CPU_SET(i % hardware_workers(), &cpus);
+				if (pthread_setaffinity_np(m_workers[i].native_handle(), sizeof(cpus), &cpus))
+					m_pinned = false;
+			}
+		}
+#else
+		(void)pin;
+#endif
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+
+		m_task_cv.notify_all();
+
+		for (auto&& worker : m_workers)
+			worker.join();
+	}
+
+	// -------------------------------------------------------
+	// ---------------------- TASKGROUP ----------------------
+	// -------------------------------------------------------
+
+	void TaskGroup::run(std::function<void()> task) {
+		++m_pending;
+		m_pool.submit([this, task] {
+			task();
+			--m_pending;
+		});
+	}
+
+	void TaskGroup::wait() {
+		Backoff backoff;
+
+		while (m_pending)
+			if (!m_pool.run_pending())
+				backoff.pause();
+	}
+
+	TaskGroup::TaskGroup(ThreadPool& pool) : m_pool(pool), m_pending(0)
+	{ }
+
+	TaskGroup::~TaskGroup() {
+		wait();
+	}
+
+	// -------------------------------------------------------
+	// ---------------------- SCHEDULER ----------------------
+	// -------------------------------------------------------
+
+	struct scheduler_state_t {
+		std::mutex                  mutex;
+		std::unique_ptr<ThreadPool> pool;
+		size_t                      workers;
+		bool                        pin;
+	};
+
+	static scheduler_state_t& scheduler_state() {
+		static scheduler_state_t state = { {}, nullptr, 0, false };
+		return state;
+	}
+
+	ThreadPool& scheduler() {
+		scheduler_state_t& state = scheduler_state();
+		std::lock_guard<std::mutex> lock(state.mutex);
+
+		if (!state.pool)
+			state.pool.reset(new ThreadPool(state.workers ? state.workers : hardware_workers(), state.pin));
+
+		return *state.pool;
+	}
+
+	bool configure_scheduler(size_t workers, bool pin) {
+		scheduler_state_t& state = scheduler_state();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (state.pool) return false;
+
+		state.workers = workers;
+		state.pin     = pin;
+		return true;
+	}
+
+	// -------------------------------------------------------
+	// ------------------------ BENCH ------------------------
+	// -------------------------------------------------------
+
+	static constexpr size_t   BENCH_EMPTY_TASKS = 1 << 18;
+	static constexpr size_t   BENCH_WORK_TASKS  = 256;
+	static constexpr unsigned BENCH_WORK_STEPS  = 1 << 20; // about a millisecond of xorshift steps
+
+	static std::atomic<uint64_t> bench_sink(0);
+
+	static void bench_work(uint64_t seed) {
+		uint64_t x = seed | 1;
+
+		for (unsigned i = 0; i < BENCH_WORK_STEPS; ++i) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+		}
+
+		bench_sink += x;
+	}
+
+	static double elapsed_ns(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	std::vector<bench_result_t> bench_scheduler(size_t max_workers, bool pin) {
+		std::vector<bench_result_t> results;
+		if (!max_workers) max_workers = hardware_workers();
+
+		for (size_t workers = 1; workers <= max_workers; ++workers) {
+			ThreadPool pool(workers, pin);
+			bench_result_t result;
+			result.workers = workers;
+
+			// Every task from the calling thread, dealt to the deques in turn
+			auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < BENCH_EMPTY_TASKS; ++i)
+				pool.submit([] { });
+			pool.wait();
+			result.empty_task_ns = elapsed_ns(start) / BENCH_EMPTY_TASKS;
+
+			// Every task from a worker into its own deque, the rest of the workers steal
+			start = std::chrono::steady_clock::now();
+			for (size_t w = 0; w < workers; ++w)
+				pool.submit([&pool, workers] {
+					for (size_t i = 0; i < BENCH_EMPTY_TASKS / workers; ++i)
+						pool.submit([] { });
+				});
+			pool.wait();
+			result.spawn_task_ns = elapsed_ns(start) / (BENCH_EMPTY_TASKS / workers * workers);
+
+			start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < BENCH_WORK_TASKS; ++i)
+				pool.submit([i] { bench_work(i); });
+			pool.wait();
+			result.work_ms = elapsed_ns(start) / 1e6;
+
+			result.speedup = results.empty() ? 1.0 : results.front().work_ms / result.work_ms;
+			results.push_back(result);
+		}
+
+		return results;
+	}
+
+}
@@ -0,0 +1,162 @@
+/**
+ * threadpool.hxx
+ *
+ * Work-Stealing Task Scheduler
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef THREADPOOL_HXX
+#define THREADPOOL_HXX
+
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace concurrency {
+
+	// Number of hardware threads, at least 1
+	size_t hardware_workers();
+
+	// -------------------------------------------------------
+	// --------------------- THREADPOOL ----------------------
+	// -------------------------------------------------------
+
+	// Work-stealing pool: every worker owns a deque, pushes and pops the tasks it submits at the back (the
+	// most recent one is the hottest in its cache) and, once it runs dry, steals the oldest task from the
+	// front of another deque. Tasks submitted from outside the pool are dealt to the deques in turn
+	class ThreadPool {
+		using task_t = std::function<void()>;
+
+		static constexpr size_t CACHE_LINE = 64;
+
+		// Padded, so that workers busy with their own deques do not share cache lines (C++11 new ignores
+		// alignas beyond that of std::max_align_t)
+		struct deque_t {
+			std::mutex         mutex;
+			std::deque<task_t> tasks;
+			char               padding[CACHE_LINE];
+		};
+
+		std::vector<std::thread>   m_workers;
+		size_t                     m_size;       // of m_workers, fixed before the first worker starts
+		std::unique_ptr<deque_t[]> m_deques;
+		std::atomic<size_t>        m_next;       // deque of the next task submitted from outside
+		std::atomic<size_t>        m_queued;     // tasks waiting in the deques
+		std::atomic<size_t>        m_unfinished; // tasks submitted and not finished yet
+		std::atomic<size_t>        m_sleepers;
+		std::mutex                 m_mutex;
+		std::condition_variable    m_task_cv;
+		std::condition_variable    m_idle_cv;
+		bool                       m_pinned;
+		bool                       m_stop;
+
+		bool pop_task(size_t index, task_t& task);
+		bool steal_task(size_t index, task_t& task);
+		void run_task(task_t& task);
+		void worker_loop(size_t index);
+
+	public:
+
+		// Queues a task, one of the workers runs it as soon as it is free
+		void submit(task_t task);
+
+		// Runs one queued task in the calling thread, false if there is none; lets threads waiting for
+		// tasks help instead of blocking the workers they wait for
+		bool run_pending();
+
+		// Blocks until every submitted task has finished
+		void wait();
+
+		size_t size() const { return m_size; }
+
+		bool pinned() const { return m_pinned; }
+
+		// Index of the worker of this pool running the calling thread, size() for any other thread
+		size_t worker_index() const;
+
+		// With pin, worker i is bound to hardware thread i modulo hardware_workers() (where supported)
+		explicit ThreadPool(size_t workers = hardware_workers(), bool pin = false);
+
+		~ThreadPool();
+
+		ThreadPool(ThreadPool const&) = delete;
+		ThreadPool& operator=(ThreadPool const&) = delete;
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- TASKGROUP ----------------------
+	// -------------------------------------------------------
+
+	// Tasks of one job on a shared pool: wait() returns once they are finished, no matter what else runs on
+	// the pool, and runs pending tasks meanwhile, so a task may wait for a group of its own
+	class TaskGroup {
+		ThreadPool&         m_pool;
+		std::atomic<size_t> m_pending;
+
+	public:
+
+		void run(std::function<void()> task);
+
+		void wait();
+
+		explicit TaskGroup(ThreadPool& pool);
+
+		~TaskGroup();
+
+		TaskGroup(TaskGroup const&) = delete;
+		TaskGroup& operator=(TaskGroup const&) = delete;
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- SCHEDULER ----------------------
+	// -------------------------------------------------------
+
+	// The pool of the process every parallel path submits to (created on first use, with hardware_workers()
+	// workers unless configured before)
+	ThreadPool& scheduler();
+
+	// Sets the size and pinning of the scheduler, 0 workers means hardware_workers(); false once it exists
+	bool configure_scheduler(size_t workers, bool pin = false);
+
+	// Scheduling overhead and scaling of a pool
+	struct bench_result_t {
+		size_t workers;
+		double empty_task_ns; // wall time per empty task, submit and run
+		double spawn_task_ns; // the same with tasks submitted by the workers themselves
+		double work_ms;       // wall time of a fixed amount of work split into tasks
+		double speedup;       // of work_ms over the single-worker run
+	};
+
+	// Runs the microbenchmark on pools of 1 to max_workers workers
+	std::vector<bench_result_t> bench_scheduler(size_t max_workers, bool pin = false);
+
+}
+
+#endif // THREADPOOL_HXX
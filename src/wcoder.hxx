@@ -0,0 +1,448 @@
+/**
+ * wcoder.hxx
+ *
+ * Static Huffman Coding of Wide and Small Alphabets
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#ifndef WCODER_HXX
+#define WCODER_HXX
+
+#include <iostream>
+#include <cstdlib>     // size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iterator>    // std::istreambuf_iterator
+#include <algorithm>   // std::nth_element, std::sort
+#include <type_traits> // std::integral_constant, std::is_unsigned
+#include <climits>     // CHAR_BIT
+#include "instrument.hxx"
+#include "canonical.hxx"
+
+/**
+ * Coded text layout:
+ *
+ *   symbols (8 bytes) | tail size (1 byte) | tail | code table | codes
+ *
+ * The text is read as little-endian symbols of sizeof(Symbol) bytes, the bytes after the last whole one are
+ * the tail and stored as they are. Symbols get canonical Huffman codes of at most 15 bits; a symbol without
+ * a code of its own is coded as the escape followed by its bits. The code table of alphabets of up to
+ * WC_DENSE_LIMIT symbols is dense:
+ *
+ *   code lengths of the alphabet and the escape (4 bits each)
+ *
+ * and that of larger alphabets (16-bit token ids) is sparse, only the symbols of the text are in it:
+ *
+ *   coded symbols (2 bytes) | gaps to the symbol before (1 byte, or 0xFF and 2 bytes) | code lengths of the
+ *   coded symbols and the escape (4 bits each)
+ *
+ * The WC_MAX_CODED most frequent symbols of the text get codes, the rarest ones beyond them are escaped.
+ * Which table a coder uses is decided by its template arguments at compile time, so does the symbol width.
+ */
+
+namespace staticcodes {
+
+	// Alphabets of up to this many symbols store a length for every symbol, larger ones for the symbols seen
+	static constexpr size_t WC_DENSE_LIMIT = 1 << 12;
+
+	// Symbols of a sparse table, at most: 15-bit codes leave room for the escape
+	static constexpr size_t WC_MAX_CODED = 1 << 14;
+
+	// Bytes of the coded text before the tail and the code table
+	static constexpr size_t WC_HEADER_SIZE = sizeof(uint64_t) + 1;
+
+	template<typename Symbol, size_t Alphabet>
+	struct symbol_traits {
+		static_assert(std::is_unsigned<Symbol>::value && sizeof(Symbol) <= sizeof(uint16_t),
+		              "Symbols are unsigned and at most 16 bits wide");
+		static_assert(Alphabet >= 2 && Alphabet <= (size_t(1) << (sizeof(Symbol) * CHAR_BIT)),
+		              "The alphabet must fit the symbol type");
+
+		static constexpr unsigned BITS  = sizeof(Symbol) * CHAR_BIT;
+		static constexpr bool     DENSE = Alphabet <= WC_DENSE_LIMIT;
+
+		using table_t = std::integral_constant<bool, DENSE>;
+
+		static Symbol load(uint8_t const* p) {
+			Symbol symbol = 0;
+			for (size_t i = 0; i < sizeof(Symbol); ++i)
+				symbol |= static_cast<Symbol>(p[i]) << (i * CHAR_BIT);
+			return symbol;
+		}
+
+		static void store(Symbol symbol, char* p) {
+			for (size_t i = 0; i < sizeof(Symbol); ++i)
+				p[i] = static_cast<char>(symbol >> (i * CHAR_BIT));
+		}
+	};
+
+	// Length limit of a code for "size" symbols: the decoding table stays within 12 bits where it can
+	inline unsigned wc_max_len(size_t size) {
+		unsigned bits = 0;
+		while ((size_t(1) << bits) < size) ++bits;
+
+		return bits + 1 > canonicalcodes::DEFAULT_CODE_LEN
+			? (bits + 1 > canonicalcodes::MAX_CODE_LEN ? canonicalcodes::MAX_CODE_LEN : bits + 1)
+			: canonicalcodes::DEFAULT_CODE_LEN;
+	}
+
+	// -------------------------------------------------------
+	// ----------------------- WCODER ------------------------
+	// -------------------------------------------------------
+
+	template<typename Symbol, size_t Alphabet = size_t(1) << (sizeof(Symbol) * CHAR_BIT)>
+	class wcoder {
+		using traits = symbol_traits<Symbol, Alphabet>;
+
+		instrumentation::Stats m_stats;
+		std::vector<uint32_t>  m_freq;    // of every symbol and (last) of the symbols outside the alphabet
+		std::vector<uint32_t>  m_coded;   // frequencies of the coded alphabet, the escape last
+		std::vector<Symbol>    m_symbols; // symbols of the sparse table in their order
+		std::vector<uint16_t>  m_index;   // index of every symbol in the coded alphabet (sparse only)
+		std::string            m_codes;
+
+		// Dense: the coded alphabet is the alphabet with the escape after it
+		void build_alphabet(std::true_type) {
+			m_coded = m_freq;
+		}
+
+		// Sparse: the symbols seen, the most frequent ones if there are too many
+		void build_alphabet(std::false_type) {
+			m_symbols.clear();
+			for (size_t symbol = 0; symbol < Alphabet; ++symbol)
+				if (m_freq[symbol]) m_symbols.push_back(symbol);
+
+			uint64_t escaped = m_freq[Alphabet];
+
+			if (m_symbols.size() > WC_MAX_CODED) {
+				std::nth_element(m_symbols.begin(), m_symbols.begin() + WC_MAX_CODED, m_symbols.end(), [this](Symbol a, Symbol b) {
+					return m_freq[a] > m_freq[b] || (m_freq[a] == m_freq[b] && a < b);
+				});
+
+				for (size_t i = WC_MAX_CODED; i < m_symbols.size(); ++i)
+					escaped += m_freq[m_symbols[i]];
+
+				m_symbols.resize(WC_MAX_CODED);
+				std::sort(m_symbols.begin(), m_symbols.end());
+			}
+
+			m_index.assign(Alphabet, m_symbols.size());
+			m_coded.assign(m_symbols.size() + 1, 0);
+
+			for (size_t i = 0; i < m_symbols.size(); ++i) {
+				m_index[m_symbols[i]] = i;
+				m_coded[i] = m_freq[m_symbols[i]];
+			}
+
+			// The text is at most UINT32_MAX symbols long
+			m_coded.back() = static_cast<uint32_t>(escaped);
+		}
+
+		size_t index(Symbol symbol, std::true_type) const {
+			return symbol < Alphabet ? symbol : Alphabet;
+		}
+
+		size_t index(Symbol symbol, std::false_type) const {
+			return symbol < Alphabet ? m_index[symbol] : m_symbols.size();
+		}
+
+		void write_table(std::ostream& ofile, canonicalcodes::lengths_t const& lengths, std::true_type) const {
+			canonicalcodes::write_lengths(ofile, lengths);
+		}
+
+		void write_table(std::ostream& ofile, canonicalcodes::lengths_t const& lengths, std::false_type) const {
+			ofile.put(static_cast<char>(m_symbols.size()));
+			ofile.put(static_cast<char>(m_symbols.size() >> CHAR_BIT));
+
+			for (size_t i = 0; i < m_symbols.size(); ++i) {
+				size_t gap = i ? m_symbols[i] - m_symbols[i - 1] - 1 : m_symbols[i];
+
+				if (gap < 0xFF) ofile.put(static_cast<char>(gap));
+				else {
+					ofile.put(static_cast<char>(0xFF));
+					ofile.put(static_cast<char>(gap));
+					ofile.put(static_cast<char>(gap >> CHAR_BIT));
+				}
+			}
+
+			canonicalcodes::write_lengths(ofile, lengths);
+		}
+
+	public:
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			using namespace instrumentation;
+
+			m_stats.reset();
+
+			std::string text;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+				text.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+			}
+
+			uint64_t       symbols = text.size() / sizeof(Symbol);
+			size_t         tail    = text.size() % sizeof(Symbol);
+			uint8_t const* p       = reinterpret_cast<uint8_t const*>(text.data());
+
+			// Counts are 32-bit, longer texts go through the block container
+			if (symbols > UINT32_MAX) {
+				std::cerr << "wcoder::compress: Text too long for one frequency table, code it in blocks" << std::endl;
+				return;
+			}
+
+			{
+				ScopedTimer timer(m_stats, STATISTICS_STAGE);
+
+				m_freq.assign(Alphabet + 1, 0);
+				for (uint64_t i = 0; i < symbols; ++i) {
+					Symbol symbol = traits::load(p + i * sizeof(Symbol));
+					++m_freq[symbol < Alphabet ? symbol : Alphabet];
+				}
+			}
+
+			canonicalcodes::lengths_t     lengths;
+			canonicalcodes::CanonicalCode code;
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+
+				build_alphabet(typename traits::table_t());
+				lengths = canonicalcodes::code_lengths(m_coded.data(), m_coded.size(), wc_max_len(m_coded.size()));
+				code.assign(lengths);
+			}
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+
+				m_codes.clear();
+				m_codes.reserve(text.size() / 2 + 1);
+
+				canonicalcodes::BitWriter writer(m_codes);
+				size_t escape = m_coded.size() - 1;
+
+				for (uint64_t i = 0; i < symbols; ++i) {
+					Symbol symbol = traits::load(p + i * sizeof(Symbol));
+					size_t coded  = index(symbol, typename traits::table_t());
+
+					writer.put(code.code(coded));
+					if (coded == escape) writer.put(symbol, traits::BITS);
+				}
+
+				writer.flush();
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, symbols);
+			m_stats.add(BITS_COUNTER, m_codes.size() * CHAR_BIT);
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+
+			ofile.write(reinterpret_cast<char const*>(&symbols), sizeof(symbols));
+			ofile.put(static_cast<char>(tail));
+			ofile.write(text.data() + symbols * sizeof(Symbol), tail);
+			write_table(ofile, lengths, typename traits::table_t());
+			ofile.write(m_codes.data(), m_codes.size());
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			compress(ifile, ofile);
+		}
+
+		// Stage timers and counters of the last compress call
+		instrumentation::Stats const& stats() const {
+			return m_stats;
+		}
+
+		wcoder(std::istream& ifile, std::ostream& ofile) {
+			compress(ifile, ofile);
+		}
+
+		wcoder()
+		{ }
+	};
+
+	// -------------------------------------------------------
+	// ----------------------- WDECODER ----------------------
+	// -------------------------------------------------------
+
+	template<typename Symbol, size_t Alphabet = size_t(1) << (sizeof(Symbol) * CHAR_BIT)>
+	class wdecoder {
+		using traits = symbol_traits<Symbol, Alphabet>;
+
+		instrumentation::Stats m_stats;
+		std::vector<Symbol>    m_symbols; // of the sparse table
+		std::string            m_payload;
+		std::string            m_text;
+
+		bool fail(char const* what) {
+			std::cerr << "wdecoder::decompress: " << what << std::endl;
+			return false;
+		}
+
+		bool read_table(std::istream& ifile, canonicalcodes::lengths_t& lengths, std::true_type) {
+			return canonicalcodes::read_lengths(ifile, lengths, Alphabet + 1);
+		}
+
+		bool read_table(std::istream& ifile, canonicalcodes::lengths_t& lengths, std::false_type) {
+			int lo = ifile.get();
+			int hi = ifile.get();
+			if (hi == EOF) return false;
+
+			size_t size = lo | hi << CHAR_BIT;
+			if (size > WC_MAX_CODED) return false;
+
+			m_symbols.clear();
+			size_t next = 0;
+
+			for (size_t i = 0; i < size; ++i) {
+				int gap = ifile.get();
+				if (gap == 0xFF) {
+					lo  = ifile.get();
+					hi  = ifile.get();
+					gap = hi == EOF ? EOF : lo | hi << CHAR_BIT;
+				}
+
+				if (gap == EOF || next + gap >= Alphabet) return false;
+
+				m_symbols.push_back(next + gap);
+				next += gap + 1;
+			}
+
+			return canonicalcodes::read_lengths(ifile, lengths, size + 1);
+		}
+
+		Symbol symbol(size_t coded, std::true_type) const {
+			return coded;
+		}
+
+		Symbol symbol(size_t coded, std::false_type) const {
+			return m_symbols[coded];
+		}
+
+	public:
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			using namespace instrumentation;
+
+			m_stats.reset();
+
+			uint64_t                      symbols;
+			char                          tail[sizeof(Symbol)];
+			int                           tail_size;
+			canonicalcodes::lengths_t     lengths;
+			canonicalcodes::CanonicalCode code;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+
+				if (!ifile.read(reinterpret_cast<char*>(&symbols), sizeof(symbols)) ||
+				    (tail_size = ifile.get()) == EOF || static_cast<size_t>(tail_size) >= sizeof(Symbol) ||
+				    !ifile.read(tail, tail_size)
+				) {
+					fail("Truncated header");
+					return;
+				}
+
+				if (!read_table(ifile, lengths, typename traits::table_t())) {
+					fail("Truncated code table");
+					return;
+				}
+
+				m_payload.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+			}
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+				if (!code.assign(lengths)) {
+					fail("Invalid code lengths");
+					return;
+				}
+			}
+
+			// Every symbol takes a bit at least
+			if (symbols > m_payload.size() * CHAR_BIT) {
+				fail("Invalid number of symbols");
+				return;
+			}
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+
+				canonicalcodes::BitReader      reader(reinterpret_cast<uint8_t const*>(m_payload.data()), m_payload.size());
+				canonicalcodes::entry_t const* table  = code.table();
+				unsigned                       bits   = code.table_bits();
+				size_t                         escape = lengths.size() - 1;
+
+				m_text.resize(symbols * sizeof(Symbol) + tail_size);
+				char* p = m_text.empty() ? nullptr : &m_text[0];
+
+				// A refill holds a code and the bits of an escaped symbol
+				for (uint64_t i = 0; i < symbols; ++i) {
+					reader.refill();
+					size_t coded = reader.decode(table, bits);
+
+					Symbol next;
+					if (coded == escape) {
+						next = static_cast<Symbol>(reader.peek(traits::BITS));
+						reader.skip(traits::BITS);
+					}
+					else next = symbol(coded, typename traits::table_t());
+
+					traits::store(next, p + i * sizeof(Symbol));
+				}
+
+				std::copy(tail, tail + tail_size, m_text.begin() + symbols * sizeof(Symbol));
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, symbols);
+			m_stats.add(BITS_COUNTER, m_payload.size() * CHAR_BIT);
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(m_text.data(), m_text.size());
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		// Stage timers and counters of the last decompress call
+		instrumentation::Stats const& stats() const {
+			return m_stats;
+		}
+
+		wdecoder(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		wdecoder()
+		{ }
+	};
+
+	// Token streams of 16-bit ids
+	using wcoder16   = wcoder<uint16_t>;
+	using wdecoder16 = wdecoder<uint16_t>;
+
+}
+
+#endif // WCODER_HXX
@@ -0,0 +1,587 @@
+/**
+ * whcoder.cxx
+ *
+ * Static Huffman Coding of Words and Separators
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cstdlib>       // size_t
+#include <cstdint>
+#include <cstring>       // std::memcmp, std::memcpy
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>     // std::nth_element, std::sort, std::min
+#include <iterator>      // std::istreambuf_iterator
+#include <climits>       // CHAR_BIT
+#include "canonical.hxx"
+#include "wcoder.hxx"    // wc_max_len
+#include "whcoder.hxx"
+
+namespace staticcodes {
+
+	using namespace instrumentation;
+	using canonicalcodes::CanonicalCode;
+
+	static constexpr uint8_t WH_LONG_ESCAPED = 0xFF; // size byte of escaped tokens of 0xFF bytes or more
+	static constexpr size_t  WH_COPY         = 16;   // tokens up to this size are copied in one fixed-size move
+	static constexpr size_t  WH_PER_REFILL   = 3;    // codes of at most 15 bits a refill holds
+
+	// Letters, digits and the bytes of multibyte UTF-8 characters
+	static inline bool is_word(uint8_t c) {
+		return static_cast<uint8_t>(c - '0') < 10 || static_cast<uint8_t>((c | 0x20) - 'a') < 26 || c >= 0x80;
+	}
+
+	struct token_t {
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	// Cuts the text into maximal runs of word and of other bytes, single spaces between words left out
+	static void tokenize(uint8_t const* p, size_t size, std::vector<token_t>& tokens) {
+		tokens.clear();
+		tokens.reserve(size / 4 + 1);
+
+		bool   after_word = false;
+		size_t i          = 0;
+
+		while (i < size) {
+			bool   word = is_word(p[i]);
+			size_t j    = i + 1;
+			while (j < size && is_word(p[j]) == word) ++j;
+
+			// A run of other bytes ending before the end of the text has a word after it
+			if (!word && after_word && j - i == 1 && p[i] == ' ' && j < size) {
+				i = j;
+				continue;
+			}
+
+			tokens.push_back({ static_cast<uint32_t>(i), static_cast<uint32_t>(j - i) });
+			after_word = word;
+			i          = j;
+		}
+	}
+
+	struct token_key {
+		char const* data;
+		size_t      size;
+
+		bool operator==(token_key const& other) const {
+			return size == other.size && !std::memcmp(data, other.data, size);
+		}
+	};
+
+	// FNV-1a: tokens are a few bytes long
+	struct token_hash {
+		size_t operator()(token_key const& key) const {
+			uint64_t hash = 14695981039346656037ULL;
+			for (size_t i = 0; i < key.size; ++i)
+				hash = (hash ^ static_cast<uint8_t>(key.data[i])) * 1099511628211ULL;
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	// Distinct tokens of a text and the vocabulary chosen from them
+	struct vocabulary_t {
+		std::vector<token_t>  tokens;   // of the text in their order
+		std::vector<uint32_t> ids;      // distinct token of every token
+		std::vector<token_t>  distinct; // first occurrence of every distinct token
+		std::vector<uint32_t> freq;     // of every distinct token
+		std::vector<uint32_t> words;    // distinct tokens of the vocabulary, sorted
+		std::vector<uint32_t> symbols;  // of every distinct token: its index in the vocabulary or the escape
+	};
+
+	static void build_vocabulary(char const* text, size_t size, vocabulary_t& v) {
+		tokenize(reinterpret_cast<uint8_t const*>(text), size, v.tokens);
+
+		std::unordered_map<token_key, uint32_t, token_hash> index;
+		index.reserve(v.tokens.size() / 8 + 16);
+
+		v.ids.resize(v.tokens.size());
+		v.distinct.clear();
+		v.freq.clear();
+
+		for (size_t t = 0; t < v.tokens.size(); ++t) {
+			token_t const& token = v.tokens[t];
+			auto inserted = index.insert({ { text + token.offset, token.size }, static_cast<uint32_t>(v.distinct.size()) });
+
+			if (inserted.second) {
+				v.distinct.push_back(token);
+				v.freq.push_back(0);
+			}
+
+			v.ids[t] = inserted.first->second;
+			++v.freq[inserted.first->second];
+		}
+
+		// Tokens seen once cost less escaped than stored in the vocabulary
+		v.words.clear();
+		for (size_t id = 0; id < v.distinct.size(); ++id)
+			if (v.freq[id] > 1 && v.distinct[id].size <= WH_MAX_TOKEN) v.words.push_back(id);
+
+		if (v.words.size() > WH_MAX_VOCABULARY) {
+			std::nth_element(v.words.begin(), v.words.begin() + WH_MAX_VOCABULARY, v.words.end(), [&v](uint32_t a, uint32_t b) {
+				return v.freq[a] > v.freq[b] || (v.freq[a] == v.freq[b] && a < b);
+			});
+			v.words.resize(WH_MAX_VOCABULARY);
+		}
+
+		std::sort(v.words.begin(), v.words.end(), [&v, text](uint32_t a, uint32_t b) {
+			token_t const& x = v.distinct[a];
+			token_t const& y = v.distinct[b];
+
+			int order = std::memcmp(text + x.offset, text + y.offset, std::min(x.size, y.size));
+			return order < 0 || (order == 0 && x.size < y.size);
+		});
+
+		v.symbols.assign(v.distinct.size(), v.words.size());
+		for (size_t i = 0; i < v.words.size(); ++i)
+			v.symbols[v.words[i]] = i;
+	}
+
+	// Leading bytes a token of the vocabulary shares with the one before it
+	static size_t shared_prefix(char const* text, token_t const& prev, token_t const& token) {
+		size_t size   = std::min(prev.size, token.size);
+		size_t shared = 0;
+		while (shared < size && text[prev.offset + shared] == text[token.offset + shared]) ++shared;
+		return shared;
+	}
+
+	static size_t vocabulary_size(char const* text, vocabulary_t const& v) {
+		size_t size = sizeof(uint16_t);
+		for (size_t i = 0; i < v.words.size(); ++i) {
+			token_t const& token = v.distinct[v.words[i]];
+			size += 2 + token.size - (i ? shared_prefix(text, v.distinct[v.words[i - 1]], token) : 0);
+		}
+		return size;
+	}
+
+	size_t wh_header_size(char const* data, size_t size) {
+		vocabulary_t v;
+		build_vocabulary(data, size, v);
+
+		return WH_HEADER_SIZE + vocabulary_size(data, v) + canonicalcodes::lengths_size(v.words.size() + 1)
+			+ sizeof(uint32_t);
+	}
+
+	// -------------------------------------------------------
+	// ---------------------- CODERIMPL ----------------------
+	// -------------------------------------------------------
+
+	class whcoder::CoderImpl {
+		Stats        m_stats;
+		vocabulary_t m_vocabulary;
+		std::string  m_escaped;
+		std::string  m_codes;
+
+		void write_vocabulary(std::ostream& ofile, char const* text) const {
+			vocabulary_t const& v = m_vocabulary;
+
+			ofile.put(static_cast<char>(v.words.size()));
+			ofile.put(static_cast<char>(v.words.size() >> CHAR_BIT));
+
+			for (size_t i = 0; i < v.words.size(); ++i) {
+				token_t const& token  = v.distinct[v.words[i]];
+				size_t         shared = i ? shared_prefix(text, v.distinct[v.words[i - 1]], token) : 0;
+
+				ofile.put(static_cast<char>(shared));
+				ofile.put(static_cast<char>(token.size - shared));
+				ofile.write(text + token.offset + shared, token.size - shared);
+			}
+		}
+
+		void escape(char const* text, token_t const& token) {
+			if (token.size < WH_LONG_ESCAPED) m_escaped.push_back(static_cast<char>(token.size));
+			else {
+				m_escaped.push_back(static_cast<char>(WH_LONG_ESCAPED));
+				m_escaped.append(reinterpret_cast<char const*>(&token.size), sizeof(token.size));
+			}
+
+			m_escaped.append(text + token.offset, token.size);
+		}
+
+	public:
+		void compress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
+			std::string text;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+				text.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+			}
+
+			// Token offsets and counts are 32-bit, longer texts go through the block container
+			if (text.size() > UINT32_MAX) {
+				std::cerr << "whcoder::compress: Text too long for one vocabulary, code it in blocks" << std::endl;
+				return;
+			}
+
+			vocabulary_t& v = m_vocabulary;
+
+			{
+				ScopedTimer timer(m_stats, STATISTICS_STAGE);
+				build_vocabulary(text.data(), text.size(), v);
+			}
+
+			canonicalcodes::lengths_t lengths;
+			CanonicalCode             code;
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+
+				std::vector<uint32_t> freq(v.words.size() + 1, 0);
+				for (size_t id = 0; id < v.distinct.size(); ++id)
+					freq[v.symbols[id]] += v.freq[id];
+
+				lengths = canonicalcodes::code_lengths(freq.data(), freq.size(), wc_max_len(freq.size()));
+				code.assign(lengths);
+			}
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+
+				m_escaped.clear();
+				m_codes.clear();
+				m_codes.reserve(v.tokens.size() + 1);
+
+				canonicalcodes::BitWriter writer(m_codes);
+				size_t esc = v.words.size();
+
+				for (size_t t = 0; t < v.tokens.size(); ++t) {
+					size_t symbol = v.symbols[v.ids[t]];
+
+					writer.put(code.code(symbol));
+					if (symbol == esc) escape(text.data(), v.tokens[t]);
+				}
+
+				writer.flush();
+			}
+
+			uint64_t size   = text.size();
+			uint64_t tokens = v.tokens.size();
+			uint32_t escaped = m_escaped.size();
+
+			m_stats.add(SYMBOLS_COUNTER, tokens);
+			m_stats.add(BITS_COUNTER, m_codes.size() * CHAR_BIT);
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+
+			ofile.write(reinterpret_cast<char const*>(&size), sizeof(size));
+			ofile.write(reinterpret_cast<char const*>(&tokens), sizeof(tokens));
+			write_vocabulary(ofile, text.data());
+			canonicalcodes::write_lengths(ofile, lengths);
+			ofile.write(reinterpret_cast<char const*>(&escaped), sizeof(escaped));
+			ofile.write(m_escaped.data(), m_escaped.size());
+			ofile.write(m_codes.data(), m_codes.size());
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			compress(ifile, ofile);
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		CoderImpl(std::istream& ifile, std::ostream& ofile) {
+			compress(ifile, ofile);
+		}
+
+		CoderImpl()
+		{ }
+	};
+
+	void whcoder::compress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->compress(ifile, ofile);
+	}
+
+	void whcoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	Stats const& whcoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	whcoder::whcoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new CoderImpl(ifile, ofile))
+	{ }
+
+	whcoder::whcoder() : m_pImpl(new CoderImpl)
+	{ }
+
+	whcoder::~whcoder()
+	{ }
+
+	// -------------------------------------------------------
+	// --------------------- DECODERIMPL ---------------------
+	// -------------------------------------------------------
+
+	class whdecoder::DecoderImpl {
+
+		// Decoding table entry: the token the next bits start with and the length of its code
+		struct entry_t {
+			uint32_t offset; // of the token in the vocabulary buffer
+			uint8_t  len;
+			uint8_t  size;
+			uint8_t  word;
+			uint8_t  escape;
+		};
+
+		Stats                m_stats;
+		std::string          m_vocabulary; // every token after a space, so a word after a word is copied with it
+		std::vector<entry_t> m_tokens;     // of every symbol, the escape last
+		std::vector<entry_t> m_table;
+		std::string          m_payload;
+		std::string          m_text;
+
+		bool fail(char const* what) {
+			std::cerr << "whdecoder::decompress: " << what << std::endl;
+			return false;
+		}
+
+		bool read_vocabulary(std::istream& ifile) {
+			uint8_t count[2];
+			if (!ifile.read(reinterpret_cast<char*>(count), sizeof(count))) return fail("Truncated vocabulary");
+
+			size_t words = count[0] | count[1] << CHAR_BIT;
+			if (words > WH_MAX_VOCABULARY) return fail("Vocabulary too large");
+
+			m_vocabulary.clear();
+			m_tokens.assign(words + 1, entry_t());
+
+			char   prev[WH_MAX_TOKEN];
+			size_t prev_size = 0;
+
+			for (size_t i = 0; i < words; ++i) {
+				uint8_t sizes[2];
+				if (!ifile.read(reinterpret_cast<char*>(sizes), sizeof(sizes))) return fail("Truncated vocabulary");
+
+				size_t shared = sizes[0];
+				size_t size   = shared + sizes[1];
+
+				if (shared > prev_size || !size || size > WH_MAX_TOKEN) return fail("Invalid vocabulary");
+				if (!ifile.read(prev + shared, sizes[1])) return fail("Truncated vocabulary");
+
+				m_vocabulary.push_back(' ');
+				m_tokens[i].offset = m_vocabulary.size();
+				m_tokens[i].size   = size;
+				m_tokens[i].word   = is_word(prev[0]);
+				m_vocabulary.append(prev, size);
+				prev_size = size;
+			}
+
+			m_tokens[words].escape = 1;
+			m_vocabulary.append(WH_COPY, '\0');
+			return true;
+		}
+
+		bool read_header(std::istream& ifile, CanonicalCode& code, uint64_t& size, uint64_t& tokens, uint32_t& escaped) {
+			canonicalcodes::lengths_t lengths;
+
+			{
+				ScopedTimer timer(m_stats, INPUT_STAGE);
+
+				if (!ifile.read(reinterpret_cast<char*>(&size), sizeof(size))
+				 || !ifile.read(reinterpret_cast<char*>(&tokens), sizeof(tokens))) return fail("Truncated header");
+
+				if (!read_vocabulary(ifile)) return false;
+				if (!canonicalcodes::read_lengths(ifile, lengths, m_tokens.size())) return fail("Truncated code lengths");
+			}
+
+			{
+				ScopedTimer timer(m_stats, MODEL_STAGE);
+
+				if (!code.assign(lengths)) return fail("Invalid code lengths");
+
+				// Every entry holds its token, so a decode is one lookup
+				canonicalcodes::entry_t const* table = code.table();
+				m_table.resize(size_t(1) << code.table_bits());
+
+				for (size_t i = 0; i < m_table.size(); ++i) {
+					m_table[i]     = m_tokens[table[i].symbol];
+					m_table[i].len = table[i].len;
+				}
+			}
+
+			ScopedTimer timer(m_stats, INPUT_STAGE);
+
+			if (!ifile.read(reinterpret_cast<char*>(&escaped), sizeof(escaped))) return fail("Truncated header");
+
+			m_payload.assign(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
+			if (escaped > m_payload.size()) return fail("Truncated escaped tokens");
+
+			return true;
+		}
+
+	public:
+		void decompress(std::istream& ifile, std::ostream& ofile) {
+			m_stats.reset();
+
+			CanonicalCode code;
+			uint64_t      size;
+			uint64_t      tokens;
+			uint32_t      escaped;
+
+			if (!read_header(ifile, code, size, tokens, escaped)) return;
+
+			size_t codes = m_payload.size() - escaped;
+
+			// Every token takes a bit at least and is a space and a vocabulary token or an escaped one
+			if (tokens > codes * CHAR_BIT || size > tokens * (WH_MAX_TOKEN + 1) + escaped) {
+				fail("Invalid number of tokens");
+				return;
+			}
+
+			{
+				ScopedTimer timer(m_stats, CODING_STAGE);
+
+				m_text.resize(size + WH_COPY);
+
+				uint8_t const* esc     = reinterpret_cast<uint8_t const*>(m_payload.data());
+				uint8_t const* esc_end = esc + escaped;
+				canonicalcodes::BitReader reader(esc_end, codes);
+
+				entry_t const* table      = m_table.data();
+				unsigned       bits       = code.table_bits();
+				char const*    vocabulary = m_vocabulary.data();
+				char*          out        = &m_text[0];
+				char* const    end        = out + size;
+				uint8_t        after_word = 0;
+
+				auto next = [&]() -> bool {
+					entry_t const& entry = table[reader.peek(bits)];
+					reader.skip(entry.len);
+
+					if (!entry.escape) {
+						// The space before a word after a word is the byte before it in the vocabulary
+						size_t      space = entry.word & after_word;
+						char const* src   = vocabulary + entry.offset - space;
+						size_t      n     = entry.size + space;
+
+						if (n > size_t(end - out)) return fail("Text longer than its size");
+
+						if (n <= WH_COPY) std::memcpy(out, src, WH_COPY);
+						else              std::memcpy(out, src, n);
+
+						out       += n;
+						after_word = entry.word;
+						return true;
+					}
+
+					if (esc == esc_end) return fail("Truncated escaped tokens");
+
+					size_t n = *esc++;
+					if (n == WH_LONG_ESCAPED) {
+						uint32_t long_size;
+						if (size_t(esc_end - esc) < sizeof(long_size)) return fail("Truncated escaped tokens");
+						std::memcpy(&long_size, esc, sizeof(long_size));
+						esc += sizeof(long_size);
+						n    = long_size;
+					}
+
+					if (!n || n > size_t(esc_end - esc)) return fail("Invalid escaped token");
+
+					uint8_t word = is_word(esc[0]);
+					if (word & after_word) {
+						if (out == end) return fail("Text longer than its size");
+						*out++ = ' ';
+					}
+
+					if (n > size_t(end - out)) return fail("Text longer than its size");
+
+					std::memcpy(out, esc, n);
+					out       += n;
+					esc       += n;
+					after_word = word;
+					return true;
+				};
+
+				uint64_t i = 0;
+
+				for (; i + WH_PER_REFILL <= tokens; i += WH_PER_REFILL) {
+					reader.refill();
+					if (!next() || !next() || !next()) return;
+				}
+
+				for (; i < tokens; ++i) {
+					reader.refill();
+					if (!next()) return;
+				}
+
+				if (out != end) {
+					fail("Text shorter than its size");
+					return;
+				}
+
+				m_text.resize(size);
+			}
+
+			m_stats.add(SYMBOLS_COUNTER, tokens);
+			m_stats.add(BITS_COUNTER, codes * CHAR_BIT);
+
+			ScopedTimer timer(m_stats, OUTPUT_STAGE);
+			ofile.write(m_text.data(), m_text.size());
+		}
+
+		void operator()(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		Stats const& stats() const {
+			return m_stats;
+		}
+
+		DecoderImpl(std::istream& ifile, std::ostream& ofile) {
+			decompress(ifile, ofile);
+		}
+
+		DecoderImpl()
+		{ }
+	};
+
+	void whdecoder::decompress(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->decompress(ifile, ofile);
+	}
+
+	void whdecoder::operator()(std::istream& ifile, std::ostream& ofile) {
+		m_pImpl->operator()(ifile, ofile);
+	}
+
+	Stats const& whdecoder::stats() const {
+		return m_pImpl->stats();
+	}
+
+	whdecoder::whdecoder(std::istream& ifile, std::ostream& ofile)
+		: m_pImpl(new DecoderImpl(ifile, ofile))
+	{ }
+
+	whdecoder::whdecoder() : m_pImpl(new DecoderImpl)
+	{ }
+
+	whdecoder::~whdecoder()
+	{ }
+
+}
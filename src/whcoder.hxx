@@ -0,0 +1,123 @@
+/**
+ * whcoder.hxx
+ *
+ * Static Huffman Coding of Words and Separators
+ * 10.2026
+ */
+
+/**
+ * Copyright (C) 2026 libcoders contributors
+ *
+ * This file is part of libcoders.
+ *
+ * libcoders is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libcoders is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libcoders.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef WHCODER_HXX
+#define WHCODER_HXX
+
+#include <iostream>
+#include <cstdlib> // size_t
+#include <cstdint>
+#include <memory>
+#include "instrument.hxx"
+
+/**
+ * Coded text layout:
+ *
+ *   text size (8 bytes) | tokens (8 bytes) | vocabulary | code lengths (4 bits each) | escaped size (4 bytes) |
+ *   escaped tokens | codes
+ *
+ * The text is cut into tokens: maximal runs of word bytes (letters, digits and bytes of 0x80 and above, so
+ * UTF-8 letters too) and maximal runs of the other bytes. A single space between two words is left out and
+ * put back by the decoder (spaceless words), so the usual text is mostly words. Tokens that occur twice
+ * or more, at most WH_MAX_VOCABULARY of the most frequent ones, make the vocabulary; they are sorted and
+ * front coded:
+ *
+ *   tokens (2 bytes) | per token: bytes shared with the token before (1 byte) | rest size (1 byte) | rest
+ *
+ * Every token is coded with a canonical Huffman code over the vocabulary and the escape (the last symbol);
+ * escaped tokens follow each other in their own stream, each as its size (1 byte, or 0xFF and 4 bytes) and
+ * bytes. The decoder looks up the next bits in a table whose entries hold the whole token to copy.
+ */
+
+namespace staticcodes {
+
+	// Tokens of the vocabulary, at most: 15-bit codes leave room for the escape
+	static constexpr size_t WH_MAX_VOCABULARY = 1 << 14;
+
+	// Longest token the vocabulary takes
+	static constexpr size_t WH_MAX_TOKEN = 255;
+
+	// Bytes of the coded text before the vocabulary
+	static constexpr size_t WH_HEADER_SIZE = 2 * sizeof(uint64_t);
+
+	// Bytes of the coded text before the escaped tokens (text size, vocabulary and code lengths) for a text
+	size_t wh_header_size(char const* data, size_t size);
+
+	// -------------------------------------------------------
+	// ----------------------- WHCODER -----------------------
+	// -------------------------------------------------------
+
+	class whcoder {
+		class CoderImpl;
+		std::unique_ptr<CoderImpl> m_pImpl;
+
+	public:
+
+		// Cuts text into words and separators and writes the vocabulary and the codes of the tokens to the
+		// output file
+		void compress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last compress call
+		instrumentation::Stats const& stats() const;
+
+		whcoder(std::istream& ifile, std::ostream& ofile);
+
+		whcoder();
+
+		~whcoder();
+	};
+
+	// -------------------------------------------------------
+	// ---------------------- WHDECODER ----------------------
+	// -------------------------------------------------------
+
+	class whdecoder {
+		class DecoderImpl;
+		std::unique_ptr<DecoderImpl> m_pImpl;
+
+	public:
+
+		// Decodes a token per table lookup and writes the text to the output file
+		void decompress(std::istream& ifile, std::ostream& ofile);
+
+		void operator()(std::istream& ifile, std::ostream& ofile);
+
+		// Stage timers and counters of the last decompress call
+		instrumentation::Stats const& stats() const;
+
+		whdecoder(std::istream& ifile, std::ostream& ofile);
+
+		whdecoder();
+
+		~whdecoder();
+	};
+
+}
+
+#endif // WHCODER_HXX